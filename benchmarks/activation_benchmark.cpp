@@ -0,0 +1,163 @@
+#include "activation.h"
+#include "simd_math.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Speed and accuracy of the vectorized activation kernels against the
+ * scalar reference functions, for each instruction set this CPU supports.
+ * The "max_ulp" counter is the largest error in ULP against long double
+ * results. Softmax and the fused backward passes run on network-shaped
+ * matrices (classes or neurons x batch).
+*/
+
+namespace {
+
+constexpr size_t n_elements = 1 << 16;
+
+const char* isa_name(SimdMath::Isa isa) {
+    switch (isa) {
+        case SimdMath::Isa::Avx512: return "avx512";
+        case SimdMath::Isa::Avx2: return "avx2";
+        default: return "generic";
+    }
+}
+
+template <typename T>
+double ulp_error(T val, long double reference) {
+    const T rounded = static_cast<T>(reference);
+    const long double ulp = std::nextafter(std::fabs(rounded), std::numeric_limits<T>::infinity()) - std::fabs(rounded);
+    return static_cast<double>(std::fabs(val - reference) / ulp);
+}
+
+template <typename T>
+std::vector<T> random_input(double lo, double hi) {
+    std::vector<T> in(n_elements);
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(lo, hi);
+    for (T& val : in) {
+        val = static_cast<T>(distribution(generator));
+    }
+    return in;
+}
+
+struct Function {
+    const char* name;
+    long double (*reference)(long double);
+    double lo;
+    double hi;
+};
+
+// A kernel of the instruction set isa, or the scalar function when kernel is nullptr
+template <typename T>
+void run(benchmark::State& state, const Function& function, T (*scalar)(T), void (*kernel)(const T*, T*, size_t),
+         SimdMath::Isa isa) {
+    const std::vector<T> in = random_input<T>(function.lo, function.hi);
+    std::vector<T> out(n_elements);
+
+    const SimdMath::Isa detected = SimdMath::active_isa();
+    SimdMath::set_isa(isa);
+    for (auto _ : state) {
+        if (kernel != nullptr) {
+            kernel(in.data(), out.data(), n_elements);
+        } else {
+            for (size_t i = 0; i < n_elements; ++i) {
+                out[i] = scalar(in[i]);
+            }
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    SimdMath::set_isa(detected);
+
+    double error = 0.0;
+    for (size_t i = 0; i < n_elements; ++i) {
+        error = std::max(error, ulp_error<T>(out[i], function.reference(in[i])));
+    }
+    state.counters["max_ulp"] = error;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n_elements));
+}
+
+template <typename T>
+void register_function(const Function& function, const char* type, T (*scalar)(T), void (*kernel)(const T*, T*, size_t)) {
+    const std::string prefix = std::string("activation/") + function.name + "/" + type + "/";
+    benchmark::RegisterBenchmark((prefix + "scalar").c_str(), [=](benchmark::State& state) {
+        run<T>(state, function, scalar, nullptr, SimdMath::active_isa());
+    });
+    const SimdMath::Isa detected = SimdMath::active_isa();
+    for (SimdMath::Isa isa : { SimdMath::Isa::Generic, SimdMath::Isa::Avx2, SimdMath::Isa::Avx512 }) {
+        if (static_cast<int>(isa) > static_cast<int>(detected)) {
+            break;
+        }
+        benchmark::RegisterBenchmark((prefix + isa_name(isa)).c_str(), [=](benchmark::State& state) {
+            run<T>(state, function, scalar, kernel, isa);
+        });
+    }
+}
+
+long double relu_reference(long double x) { return x > 0.0L ? x : 0.0L; }
+long double sigmoid_reference(long double x) { return 1.0L / (1.0L + std::exp(-x)); }
+long double sigmoid_derivative_reference(long double x) { return sigmoid_reference(x) * (1.0L - sigmoid_reference(x)); }
+long double tanh_reference(long double x) { return std::tanh(x); }
+long double tanh_derivative_reference(long double x) { return 1.0L - std::tanh(x) * std::tanh(x); }
+
+const bool registered = []() {
+    const Function relu = { "relu", relu_reference, -10.0, 10.0 };
+    const Function sigmoid = { "sigmoid", sigmoid_reference, -20.0, 20.0 };
+    const Function sigmoid_derivative = { "sigmoid'", sigmoid_derivative_reference, -5.0, 5.0 };
+    const Function tanh = { "tanh", tanh_reference, -10.0, 10.0 };
+    const Function tanh_derivative = { "tanh'", tanh_derivative_reference, -2.0, 2.0 };
+    register_function<double>(relu, "double", Activation::relu, Activation::relu<double>);
+    register_function<double>(sigmoid, "double", Activation::sigmoid, Activation::sigmoid<double>);
+    register_function<float>(sigmoid, "float", Activation::sigmoid, Activation::sigmoid<float>);
+    register_function<double>(sigmoid_derivative, "double", Activation::sigmoid_derivative, Activation::sigmoid_derivative<double>);
+    register_function<double>(tanh, "double", Activation::tanh, Activation::tanh<double>);
+    register_function<float>(tanh, "float", Activation::tanh, Activation::tanh<float>);
+    register_function<double>(tanh_derivative, "double", Activation::tanh_derivative, Activation::tanh_derivative<double>);
+    return true;
+}();
+
+// Column-wise softmax of a classes x batch matrix
+void softmax(benchmark::State& state) {
+    Matrix logits(static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    logits.fill_random(-10.0, 10.0);
+    Matrix out(logits.get_rows(), logits.get_cols());
+    for (auto _ : state) {
+        Activation::softmax(logits, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * logits.get_rows() * logits.get_cols()));
+}
+
+// dZ = dA * f'(Z) through the cached output A of a neurons x batch layer
+template <void (*backward)(const Matrix&, const Matrix&, Matrix&)>
+void fused_backward(benchmark::State& state) {
+    Matrix dA(static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    Matrix A(dA.get_rows(), dA.get_cols());
+    Matrix dZ(dA.get_rows(), dA.get_cols());
+    dA.fill_random();
+    A.fill_random(0.0, 1.0);
+    for (auto _ : state) {
+        backward(dA, A, dZ);
+        benchmark::DoNotOptimize(dZ.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * dA.get_rows() * dA.get_cols()));
+}
+
+}
+
+BENCHMARK(softmax)->Name("activation/softmax/double")->ArgNames({ "classes", "batch" })
+    ->Args({ 10, 64 })->Args({ 10, 4096 })->Args({ 1000, 64 });
+BENCHMARK_TEMPLATE(fused_backward, Activation::relu_backward<double>)->Name("activation/relu_backward/double")
+    ->ArgNames({ "neurons", "batch" })->Args({ 128, 64 })->Args({ 1024, 256 });
+BENCHMARK_TEMPLATE(fused_backward, Activation::sigmoid_backward<double>)->Name("activation/sigmoid_backward/double")
+    ->ArgNames({ "neurons", "batch" })->Args({ 128, 64 })->Args({ 1024, 256 });
+BENCHMARK_TEMPLATE(fused_backward, Activation::tanh_backward<double>)->Name("activation/tanh_backward/double")
+    ->ArgNames({ "neurons", "batch" })->Args({ 128, 64 })->Args({ 1024, 256 });
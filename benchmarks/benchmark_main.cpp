@@ -0,0 +1,38 @@
+#include "parallel_tuning.h"
+#include "profiler.h"
+#include "simd_math.h"
+
+#include <benchmark/benchmark.h>
+#include "spdlog/spdlog.h"
+
+#include <string>
+#include <thread>
+
+/**
+ * Runs all benchmarks of the suite with the usual Google Benchmark flags,
+ * e.g. --benchmark_filter=gemm or --benchmark_out=results.json
+ * --benchmark_out_format=json. The build configuration of the library is
+ * recorded in the context of the results, so runs stay comparable.
+*/
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    spdlog::set_level(spdlog::level::off);
+
+    switch (SimdMath::active_isa()) {
+        case SimdMath::Isa::Avx512: benchmark::AddCustomContext("cppnn_isa", "avx512"); break;
+        case SimdMath::Isa::Avx2: benchmark::AddCustomContext("cppnn_isa", "avx2"); break;
+        default: benchmark::AddCustomContext("cppnn_isa", "generic"); break;
+    }
+    benchmark::AddCustomContext("cppnn_profile", Profiler::ENABLED ? "on" : "off");
+    benchmark::AddCustomContext("cppnn_hardware_threads", std::to_string(std::thread::hardware_concurrency()));
+    benchmark::AddCustomContext("cppnn_elementwise_threshold", std::to_string(Parallel::get_threshold(Parallel::Kernel::Elementwise)));
+    benchmark::AddCustomContext("cppnn_gemm_threshold", std::to_string(Parallel::get_threshold(Parallel::Kernel::Gemm)));
+    benchmark::AddCustomContext("cppnn_reduce_threshold", std::to_string(Parallel::get_threshold(Parallel::Kernel::Reduce)));
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "dataset.h"
+#include "dataset_stream.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+/**
+ * CSV loading throughput (bytes per second of file) of a whole file into
+ * a Dataset and of the mini-batches of a DatasetStream, over a generated
+ * file of n_rows samples with an index column, n_features numeric
+ * features and a class label.
+*/
+
+namespace {
+
+constexpr size_t n_rows = 50000;
+constexpr size_t n_features = 16;
+
+// Written on first use, removed with the last benchmark of the file
+class CsvFile {
+public:
+    CsvFile() : path_((std::filesystem::temp_directory_path() / "cppnn_benchmark.csv").string()) {
+        std::ofstream file(path_);
+        file.precision(10);
+        file << "id";
+        for (size_t col = 0; col < n_features; ++col) {
+            file << ",x" << col;
+        }
+        file << ",label\n";
+        std::mt19937 generator(42);
+        std::normal_distribution<double> distribution(0.0, 100.0);
+        for (size_t row = 0; row < n_rows; ++row) {
+            file << row;
+            for (size_t col = 0; col < n_features; ++col) {
+                file << ',' << distribution(generator);
+            }
+            file << ',' << row % 10 << '\n';
+        }
+        file.close();
+        size_ = std::filesystem::file_size(path_);
+    }
+
+    ~CsvFile() {
+        std::remove(path_.c_str());
+    }
+
+    const std::string& path() const { return path_; }
+    size_t size() const { return size_; }
+
+private:
+    std::string path_;
+    size_t size_;
+};
+
+const CsvFile& csv_file() {
+    static CsvFile file;
+    return file;
+}
+
+void load_csv(benchmark::State& state) {
+    const CsvFile& file = csv_file();
+    for (auto _ : state) {
+        Dataset dataset;
+        dataset.load_csv(file.path(), true, true, n_features + 1);
+        benchmark::DoNotOptimize(dataset.size());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n_rows));
+}
+
+void stream_csv(benchmark::State& state) {
+    const CsvFile& file = csv_file();
+    DatasetStream stream(file.path(), static_cast<size_t>(state.range(0)), true, true, n_features + 1);
+    DatasetStream::Batch batch;
+    for (auto _ : state) {
+        stream.reset();
+        size_t rows = 0;
+        while (stream.next(batch)) {
+            rows += batch.data.get_rows();
+        }
+        benchmark::DoNotOptimize(rows);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n_rows));
+}
+
+}
+
+BENCHMARK(load_csv)->Name("dataset/load_csv")->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(stream_csv)->Name("dataset/stream_csv")->ArgName("batch")->Arg(64)->Arg(1024)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,51 @@
+#include "matrix.h"
+
+#include <benchmark/benchmark.h>
+
+/**
+ * GEMM throughput, result (m x n) = lhs (m x k) * rhs (k x n), for the
+ * shapes the network produces: square blocks, tall-skinny products (a
+ * whole batch through a narrow layer, and the k-heavy weight gradients
+ * X dZ^T) and batch-1 GEMV (inference on a single sample). The "flops"
+ * counter is the achieved FLOP/s.
+*/
+
+namespace {
+
+template <typename T>
+void gemm(benchmark::State& state) {
+    const size_t m = static_cast<size_t>(state.range(0));
+    const size_t k = static_cast<size_t>(state.range(1));
+    const size_t n = static_cast<size_t>(state.range(2));
+    BasicMatrix<T> lhs(m, k);
+    BasicMatrix<T> rhs(k, n);
+    BasicMatrix<T> result(m, n);
+    lhs.fill_random();
+    rhs.fill_random();
+
+    for (auto _ : state) {
+        BasicMatrix<T>::multiply_into(lhs, false, rhs, false, result.view());
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    state.counters["flops"] = benchmark::Counter(2.0 * static_cast<double>(m * n * k) * static_cast<double>(state.iterations()),
+                                                 benchmark::Counter::kIsRate);
+}
+
+}
+
+BENCHMARK_TEMPLATE(gemm, double)->Name("gemm/square/double")->ArgNames({ "m", "k", "n" })
+    ->Args({ 64, 64, 64 })->Args({ 128, 128, 128 })->Args({ 256, 256, 256 })->Args({ 512, 512, 512 })->Args({ 1024, 1024, 1024 })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(gemm, float)->Name("gemm/square/float")->ArgNames({ "m", "k", "n" })
+    ->Args({ 64, 64, 64 })->Args({ 256, 256, 256 })->Args({ 1024, 1024, 1024 })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(gemm, double)->Name("gemm/tall_skinny/double")->ArgNames({ "m", "k", "n" })
+    ->Args({ 4096, 64, 64 })->Args({ 64, 4096, 64 })->Args({ 128, 784, 64 })->Args({ 784, 64, 128 })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(gemm, double)->Name("gemm/gemv/double")->ArgNames({ "m", "k", "n" })
+    ->Args({ 128, 784, 1 })->Args({ 1024, 1024, 1 })->Args({ 10, 128, 1 })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(gemm, float)->Name("gemm/gemv/float")->ArgNames({ "m", "k", "n" })
+    ->Args({ 128, 784, 1 })->Args({ 1024, 1024, 1 })
+    ->Unit(benchmark::kMicrosecond);
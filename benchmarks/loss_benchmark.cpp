@@ -0,0 +1,100 @@
+#include "activation.h"
+#include "loss.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+/**
+ * Losses and their gradients on classes x batch matrices. The cross
+ * entropies start from logits either way: the generic path runs the output
+ * activation, the loss, its derivative and the activation backward pass,
+ * the fused kernels the output layer uses do it all in one.
+*/
+
+namespace {
+
+// One-hot targets of a classes x batch matrix, or 0/1 labels for one class
+Matrix random_targets(size_t classes, size_t batch) {
+    Matrix targets(classes, batch, 0.0);
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> distribution(0, classes - 1);
+    for (size_t col = 0; col < batch; ++col) {
+        if (classes == 1) {
+            targets(0, col) = static_cast<double>(generator() % 2);
+        } else {
+            targets(distribution(generator), col) = 1.0;
+        }
+    }
+    return targets;
+}
+
+template <typename Step>
+void loss(benchmark::State& state, Step step) {
+    const size_t classes = static_cast<size_t>(state.range(0));
+    const size_t batch = static_cast<size_t>(state.range(1));
+    const Matrix targets = random_targets(classes, batch);
+    Matrix outputs(classes, batch);
+    outputs.fill_random(0.01, 0.99);
+    Matrix activations(classes, batch);
+    Matrix grad(classes, batch);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(step(targets, outputs, activations, grad));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * classes * batch));
+}
+
+void mse(benchmark::State& state) {
+    loss(state, [](const Matrix& y, const Matrix& p, Matrix&, Matrix& grad) {
+        grad = Loss::mse_derivative(y, p);
+        return Loss::mse(y, p);
+    });
+}
+
+void categorical_cross_entropy(benchmark::State& state) {
+    loss(state, [](const Matrix& y, const Matrix& z, Matrix& p, Matrix& grad) {
+        Activation::softmax(z, p);
+        grad = Loss::categorical_cross_entropy_derivative(y, p);
+        Activation::softmax_backward(grad, p, grad);
+        return Loss::categorical_cross_entropy(y, p);
+    });
+}
+
+void softmax_cross_entropy_with_logits(benchmark::State& state) {
+    loss(state, [](const Matrix& y, const Matrix& z, Matrix&, Matrix& grad) {
+        return Loss::softmax_cross_entropy_with_logits(y, z, grad);
+    });
+}
+
+void binary_cross_entropy(benchmark::State& state) {
+    loss(state, [](const Matrix& y, const Matrix& z, Matrix& p, Matrix& grad) {
+        Activation::sigmoid(z, p);
+        grad = Loss::binary_cross_entropy_derivative(y, p);
+        Activation::sigmoid_backward(grad, p, grad);
+        return Loss::binary_cross_entropy(y, p);
+    });
+}
+
+void sigmoid_bce_with_logits(benchmark::State& state) {
+    loss(state, [](const Matrix& y, const Matrix& z, Matrix&, Matrix& grad) {
+        return Loss::sigmoid_bce_with_logits(y, z, grad);
+    });
+}
+
+void multi_class(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "classes", "batch" })->Args({ 10, 64 })->Args({ 10, 4096 })->Args({ 1000, 256 });
+}
+
+void binary(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "classes", "batch" })->Args({ 1, 64 })->Args({ 1, 65536 });
+}
+
+}
+
+BENCHMARK(mse)->Name("loss/mse")->Apply(multi_class);
+BENCHMARK(categorical_cross_entropy)->Name("loss/categorical_cross_entropy")->Apply(multi_class);
+BENCHMARK(softmax_cross_entropy_with_logits)->Name("loss/softmax_cross_entropy_with_logits")->Apply(multi_class);
+BENCHMARK(binary_cross_entropy)->Name("loss/binary_cross_entropy")->Apply(binary);
+BENCHMARK(sigmoid_bce_with_logits)->Name("loss/sigmoid_bce_with_logits")->Apply(binary);
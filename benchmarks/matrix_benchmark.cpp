@@ -0,0 +1,70 @@
+#include "matrix.h"
+#include "matrix_expr.h"
+#include "parallel_tuning.h"
+
+#include <benchmark/benchmark.h>
+
+/**
+ * Element-wise Matrix operations on rows x 256 matrices, with the row
+ * counts around the default element-wise threshold of Parallel, where
+ * they switch from one thread to the pool. Bytes processed count every
+ * operand read and the result written once.
+*/
+
+namespace {
+
+constexpr size_t n_cols = 256;
+
+template <typename Operation>
+void elementwise(benchmark::State& state, size_t n_operands, Operation operation) {
+    const size_t rows = static_cast<size_t>(state.range(0));
+    Matrix a(rows, n_cols);
+    Matrix b(rows, n_cols);
+    a.fill_random();
+    b.fill_random();
+
+    for (auto _ : state) {
+        Matrix result = operation(a, b);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (n_operands + 1) * rows * n_cols * sizeof(double)));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * rows * n_cols));
+}
+
+void add(benchmark::State& state) {
+    elementwise(state, 2, [](const Matrix& a, const Matrix& b) { return a + b; });
+}
+
+void add_scalar(benchmark::State& state) {
+    elementwise(state, 1, [](const Matrix& a, const Matrix&) { return a + 1.0; });
+}
+
+void multiply_scalar(benchmark::State& state) {
+    elementwise(state, 1, [](const Matrix& a, const Matrix&) { return a * 2.0; });
+}
+
+// a - b * 2 + 1 in one fused pass
+void expression(benchmark::State& state) {
+    elementwise(state, 2, [](const Matrix& a, const Matrix& b) { return Matrix(Expr::lazy(a) - Expr::lazy(b) * 2.0 + 1.0); });
+}
+
+// The same as three eager operations, each with its own temporary
+void expression_eager(benchmark::State& state) {
+    elementwise(state, 2, [](const Matrix& a, const Matrix& b) { return a - b * 2.0 + 1.0; });
+}
+
+void around_threshold(benchmark::internal::Benchmark* benchmark) {
+    const int64_t threshold = static_cast<int64_t>(Parallel::DEFAULT_ELEMENTWISE_THRESHOLD / n_cols);
+    benchmark->ArgName("rows");
+    for (int64_t rows : { threshold / 4, threshold / 2, threshold - 1, threshold, threshold * 2, threshold * 8 }) {
+        benchmark->Arg(rows);
+    }
+}
+
+}
+
+BENCHMARK(add)->Name("elementwise/add")->Apply(around_threshold);
+BENCHMARK(add_scalar)->Name("elementwise/add_scalar")->Apply(around_threshold);
+BENCHMARK(multiply_scalar)->Name("elementwise/multiply_scalar")->Apply(around_threshold);
+BENCHMARK(expression)->Name("elementwise/expression")->Apply(around_threshold);
+BENCHMARK(expression_eager)->Name("elementwise/expression_eager")->Apply(around_threshold);
@@ -0,0 +1,79 @@
+#include "neural_network.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+/**
+ * End-to-end steps of a 784-256-128-10 classifier (MNIST-sized): the
+ * inference forward pass and the training step (forward and backward
+ * with the weight update) per batch. "steps" is the rate of passes,
+ * items are samples.
+*/
+
+namespace {
+
+const vector<size_t> shape = { 784, 256, 128, 10 };
+const vector<ActivationFunction> activation_functions = {
+    ActivationFunction::ReLU, ActivationFunction::ReLU, ActivationFunction::ReLU, ActivationFunction::Softmax
+};
+
+template <typename T>
+struct Fixture {
+    explicit Fixture(size_t batch_size)
+        : nn(shape, activation_functions),
+          input(shape.front(), batch_size),
+          target(shape.back(), batch_size, T(0)),
+          output(shape.back(), batch_size) {
+        nn.build(batch_size);
+        input.fill_random(0.0, 1.0);
+        std::mt19937 generator(42);
+        for (size_t col = 0; col < batch_size; ++col) {
+            target(generator() % shape.back(), col) = T(1);
+        }
+    }
+
+    BasicNeuralNetwork<T> nn;
+    BasicMatrix<T> input;
+    BasicMatrix<T> target;
+    BasicMatrix<T> output;
+};
+
+void count_steps(benchmark::State& state, size_t batch_size) {
+    state.counters["steps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch_size));
+}
+
+template <typename T>
+void forward(benchmark::State& state) {
+    const size_t batch_size = static_cast<size_t>(state.range(0));
+    Fixture<T> fixture(batch_size);
+    for (auto _ : state) {
+        fixture.nn.forward_into(fixture.input, fixture.output.view());
+        benchmark::DoNotOptimize(fixture.output.data());
+        benchmark::ClobberMemory();
+    }
+    count_steps(state, batch_size);
+}
+
+template <typename T>
+void train_step(benchmark::State& state) {
+    const size_t batch_size = static_cast<size_t>(state.range(0));
+    Fixture<T> fixture(batch_size);
+    for (auto _ : state) {
+        fixture.nn.forward_into(fixture.input, fixture.output.view(), true);
+        benchmark::DoNotOptimize(fixture.nn.backward(fixture.input, fixture.target, 1e-3, LossFunction::CategoricalCrossEntropy));
+    }
+    count_steps(state, batch_size);
+}
+
+}
+
+BENCHMARK_TEMPLATE(forward, double)->Name("model/forward/double")->ArgName("batch")->Arg(1)->Arg(64)->Arg(256)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(forward, float)->Name("model/forward/float")->ArgName("batch")->Arg(1)->Arg(64)->Arg(256)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(train_step, double)->Name("model/train_step/double")->ArgName("batch")->Arg(1)->Arg(64)->Arg(256)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(train_step, float)->Name("model/train_step/float")->ArgName("batch")->Arg(1)->Arg(64)->Arg(256)
+    ->Unit(benchmark::kMicrosecond);
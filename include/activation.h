@@ -3,23 +3,144 @@
 
 #include "matrix.h"
 
+/**
+ * The scalar functions are the reference implementations. The array
+ * overloads f(in, out, n) are vectorized kernels over n contiguous elements
+ * (in may equal out): they run on AVX-512 or AVX2 when the CPU has it and
+ * compute exp with the polynomial approximation of simd_math.h, so they may
+ * differ from the reference by the few ULP listed there (the derivatives
+ * stay within 4 ULP, avoiding the cancellation of s(1 - s) and 1 - t^2 in
+ * the tails). Matrix overloads use the kernels. Both are defined for float,
+ * double and bfloat16 elements.
+ *
+ * Every function comes in four forms besides the scalar one: f(in, out, n),
+ * f(view, out_view) for strided views of the same shape, f(mat, out) which
+ * resizes out only if its shape differs, and the in-place f_(mat). In all of
+ * them out may be the input itself. f(mat) returns a new matrix.
+ *
+ * f_backward(dA, A, dZ) is the backward pass dZ = dA * f'(Z) fused into one
+ * sweep, with the derivative expressed through the cached output A = f(Z)
+ * (relu: A > 0, sigmoid: A (1 - A), tanh: 1 - A^2, softmax: the Jacobian-
+ * vector product per column), so no exponential is evaluated. dZ may be dA.
+*/
 namespace Activation {
     double relu(double x);
-    Matrix relu(const Matrix& mat);
+    float relu(float x);
+    template <typename T>
+    void relu(const T* in, T* out, size_t n);
+    template <typename T>
+    void relu(BasicMatrixView<const T> in, BasicMatrixView<T> out);
+    template <typename T>
+    void relu(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void relu_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> relu(const BasicMatrix<T>& mat);
     double relu_derivative(double x);
-    Matrix relu_derivative(const Matrix& mat);
+    float relu_derivative(float x);
+    template <typename T>
+    void relu_derivative(const T* in, T* out, size_t n);
+    template <typename T>
+    void relu_derivative(BasicMatrixView<const T> in, BasicMatrixView<T> out);
+    template <typename T>
+    void relu_derivative(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void relu_derivative_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> relu_derivative(const BasicMatrix<T>& mat);
+    template <typename T>
+    void relu_backward(const T* dA, const T* A, T* dZ, size_t n);
+    template <typename T>
+    void relu_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ);
+    template <typename T>
+    void relu_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ);
+    template <typename T>
+    BasicMatrix<T> relu_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A);
 
-    Matrix softmax(const Matrix& mat);
+    template <typename T>
+    void softmax(const T* in, T* out, size_t n); // One vector
+    template <typename T>
+    void softmax(BasicMatrixView<const T> in, BasicMatrixView<T> out); // Column-wise (one sample per column), out may be in
+    template <typename T>
+    void softmax(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void softmax_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> softmax(const BasicMatrix<T>& mat);
+    template <typename T>
+    void softmax_backward(const T* dA, const T* A, T* dZ, size_t n);
+    template <typename T>
+    void softmax_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ);
+    template <typename T>
+    void softmax_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ);
+    template <typename T>
+    BasicMatrix<T> softmax_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A);
 
     double tanh(double x);
-    Matrix tanh(const Matrix& mat);
+    float tanh(float x);
+    template <typename T>
+    void tanh(const T* in, T* out, size_t n);
+    template <typename T>
+    void tanh(BasicMatrixView<const T> in, BasicMatrixView<T> out);
+    template <typename T>
+    void tanh(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void tanh_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> tanh(const BasicMatrix<T>& mat);
     double tanh_derivative(double x);
-    Matrix tanh_derivative(const Matrix& mat);
+    float tanh_derivative(float x);
+    template <typename T>
+    void tanh_derivative(const T* in, T* out, size_t n);
+    template <typename T>
+    void tanh_derivative(BasicMatrixView<const T> in, BasicMatrixView<T> out);
+    template <typename T>
+    void tanh_derivative(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void tanh_derivative_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> tanh_derivative(const BasicMatrix<T>& mat);
+    template <typename T>
+    void tanh_backward(const T* dA, const T* A, T* dZ, size_t n);
+    template <typename T>
+    void tanh_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ);
+    template <typename T>
+    void tanh_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ);
+    template <typename T>
+    BasicMatrix<T> tanh_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A);
 
     double sigmoid(double x);
-    Matrix sigmoid(const Matrix& mat);
+    float sigmoid(float x);
+    template <typename T>
+    void sigmoid(const T* in, T* out, size_t n);
+    template <typename T>
+    void sigmoid(BasicMatrixView<const T> in, BasicMatrixView<T> out);
+    template <typename T>
+    void sigmoid(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void sigmoid_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> sigmoid(const BasicMatrix<T>& mat);
     double sigmoid_derivative(double x);
-    Matrix sigmoid_derivative(const Matrix& mat);
+    float sigmoid_derivative(float x);
+    template <typename T>
+    void sigmoid_derivative(const T* in, T* out, size_t n);
+    template <typename T>
+    void sigmoid_derivative(BasicMatrixView<const T> in, BasicMatrixView<T> out);
+    template <typename T>
+    void sigmoid_derivative(const BasicMatrix<T>& mat, BasicMatrix<T>& out);
+    template <typename T>
+    void sigmoid_derivative_(BasicMatrix<T>& mat);
+    template <typename T>
+    BasicMatrix<T> sigmoid_derivative(const BasicMatrix<T>& mat);
+    template <typename T>
+    void sigmoid_backward(const T* dA, const T* A, T* dZ, size_t n);
+    template <typename T>
+    void sigmoid_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ);
+    template <typename T>
+    void sigmoid_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ);
+    template <typename T>
+    BasicMatrix<T> sigmoid_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A);
 }
 
-#endif // ACTIVATION_H
\ No newline at end of file
+#endif // ACTIVATION_H
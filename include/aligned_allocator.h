@@ -0,0 +1,60 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+/**
+ * Process-wide count of the allocations made through AlignedAllocator, i.e.
+ * of every matrix and GEMM packing buffer. Tests use it to check that a code
+ * path is allocation free: take count() before and after and compare.
+*/
+namespace AllocationCounter {
+    inline std::atomic<size_t> allocations{0};
+
+    inline size_t count() { return allocations.load(std::memory_order_relaxed); }
+}
+
+/**
+ * Minimal standard-conforming allocator which returns storage aligned
+ * to the given boundary (64 bytes by default, i.e. one cache line and
+ * one AVX-512 register).
+*/
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        AllocationCounter::allocations.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* ptr, size_t) noexcept {
+        if (ptr != nullptr) {
+            ::operator delete(ptr, std::align_val_t(Alignment));
+        }
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+#endif // ALIGNED_ALLOCATOR_H
@@ -0,0 +1,129 @@
+#ifndef BATCH_LOADER_H
+#define BATCH_LOADER_H
+
+#include "matrix.h"
+#include "dataset_stream.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/**
+ * Background mini-batch loader: producer threads assemble batches ahead of
+ * the training loop into a bounded queue of n_buffers batch buffers (2 for
+ * double, 3 for triple buffering), so that next() normally returns at once.
+ *
+ * Two sources are supported:
+ *  - samples in memory (rows of `data` and `targets`), shuffled with a full
+ *    permutation per epoch and gathered by n_workers threads;
+ *  - a DatasetStream, shuffled through a reservoir of `shuffle_buffer`
+ *    samples, since the whole file is never in memory: every sample read
+ *    replaces a random one of the reservoir, which goes into the batch.
+ *
+ * Batches come out in the same order for the same seed, whatever the
+ * number of workers. The time next() spends waiting for a batch is
+ * recorded: steady stalls mean the queue is too short or the producers
+ * too slow.
+*/
+class BatchLoader {
+public:
+    using Batch = DatasetStream::Batch;
+
+    struct Stats {
+        size_t batches = 0;         // Handed out by next()
+        size_t stalls = 0;          // Of which not ready when asked for
+        double stall_seconds = 0.0; // Total time next() waited for them
+    };
+
+    // The matrices are not copied and must outlive the loader
+    BatchLoader(
+        const Matrix& data,
+        const Matrix& targets,
+        size_t batch_size,
+        bool shuffle = true,
+        size_t n_buffers = 3,
+        size_t n_workers = 1,
+        uint64_t seed = 0
+    );  // throws std::invalid_argument
+    BatchLoader(
+        DatasetStream& stream,
+        size_t shuffle_buffer,
+        bool shuffle = true,
+        size_t n_buffers = 3,
+        uint64_t seed = 0
+    );  // throws std::invalid_argument
+    BatchLoader(const BatchLoader&) = delete;
+    BatchLoader& operator=(const BatchLoader&) = delete;
+    ~BatchLoader();
+
+    /**
+     * Moves to the next batch of the epoch, false at its end. The views stay
+     * valid until the next call of next() or reset(). Errors of the producers
+     * (e.g. of the stream) are rethrown here.
+    */
+    bool next(Batch& batch);
+    void reset();   // Starts the next epoch, with a new order when shuffling
+
+    size_t get_batch_size() const { return batch_size_; }
+    size_t get_features_count() const { return n_features_; }
+    size_t get_targets_count() const { return n_targets_; }
+    const Stats& get_stats() const { return stats_; }
+    void reset_stats() { stats_ = Stats(); }
+
+private:
+    struct Slot {
+        Matrix data;
+        Matrix targets;
+        size_t rows = 0;
+    };
+
+    void start_();
+    void stop_();
+    void gather_loop_();
+    void stream_loop_();
+    Slot* acquire_free_slot_(size_t* index);   // Claims the next batch index too when given one
+    void publish_(size_t index, Slot* slot);
+    void finish_producer_(std::exception_ptr error);
+
+    // In memory source
+    MatrixView data_;
+    MatrixView targets_;
+    vector<size_t> order_;
+    size_t n_batches_;
+    size_t n_workers_;
+
+    // Streaming source
+    DatasetStream* stream_;
+    size_t shuffle_buffer_;
+
+    size_t batch_size_;
+    size_t n_features_;
+    size_t n_targets_;
+    bool shuffle_;
+    uint64_t seed_;
+    size_t epoch_;
+    Stats stats_;
+
+    vector<Slot> slots_;
+    std::deque<Slot*> free_;
+    std::map<size_t, Slot*> ready_;    // By batch index, delivered in order
+    Slot* current_;
+    size_t next_index_;         // Next batch index to claim by a producer
+    size_t next_delivered_;     // Next batch index for next()
+    size_t running_producers_;
+    bool stopping_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable slot_freed_;
+    std::condition_variable slot_ready_;
+    vector<std::thread> producers_;
+};
+
+#endif // BATCH_LOADER_H
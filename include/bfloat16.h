@@ -0,0 +1,69 @@
+#ifndef BFLOAT16_H
+#define BFLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+/**
+ * 16-bit brain floating point number: the upper half of an IEEE 754 float
+ * (1 sign bit, 8 exponent bits, 7 mantissa bits). It is a storage format,
+ * arithmetic is done in float and the result rounded back to nearest-even.
+*/
+class bfloat16 {
+public:
+    bfloat16() = default;
+    bfloat16(float val) : bits_(round_(val)) {}
+    bfloat16(double val) : bfloat16(static_cast<float>(val)) {}
+    bfloat16(int val) : bfloat16(static_cast<float>(val)) {}
+
+    operator float() const {
+        uint32_t bits = static_cast<uint32_t>(bits_) << 16;
+        float val;
+        std::memcpy(&val, &bits, sizeof(val));
+        return val;
+    }
+
+    bfloat16& operator+=(float val) { return *this = float(*this) + val; }
+    bfloat16& operator-=(float val) { return *this = float(*this) - val; }
+    bfloat16& operator*=(float val) { return *this = float(*this) * val; }
+    bfloat16& operator/=(float val) { return *this = float(*this) / val; }
+
+    uint16_t bits() const { return bits_; }
+    static bfloat16 from_bits(uint16_t bits) {
+        bfloat16 val;
+        val.bits_ = bits;
+        return val;
+    }
+
+private:
+    static uint16_t round_(float val) {
+        uint32_t bits;
+        std::memcpy(&bits, &val, sizeof(bits));
+        if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+            return static_cast<uint16_t>((bits >> 16) | 0x0040u); // Keep NaN quiet
+        }
+        // Round to nearest, ties to even
+        bits += 0x7FFFu + ((bits >> 16) & 1u);
+        return static_cast<uint16_t>(bits >> 16);
+    }
+
+    uint16_t bits_ = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, bfloat16 val) {
+    return os << static_cast<float>(val);
+}
+
+// Type used for arithmetic on elements of type T (bfloat16 is computed in float)
+template <typename T>
+struct compute_type { using type = T; };
+
+template <>
+struct compute_type<bfloat16> { using type = float; };
+
+template <typename T>
+using compute_t = typename compute_type<T>::type;
+
+#endif // BFLOAT16_H
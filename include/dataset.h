@@ -2,17 +2,36 @@
 #define DATASET_H
 
 #include "matrix.h"
+#include "mapped_file.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
+#include <memory>
 
 using std::string;
 using std::vector;
 using std::unordered_map;
 
 /**
- * Simple class for loading and saving data in CSV format.
+ * Simple class for loading and saving data in CSV format, and in a binary
+ * columnar cache format.
+ *
+ * Both loaders produce a table with one aligned row per file column and
+ * one entry per line of the file: numbers as they are, categorical cells
+ * as indices into the column's sorted labels. The data and targets are
+ * views of that table, so they are only copied when the feature columns
+ * are not adjacent. The setters re-slice the same table and never read
+ * the file again.
+ *
+ * load_csv() memory-maps the file and parses newline-aligned chunks of it
+ * in parallel straight into the table. load_binary() maps a file written
+ * by save_binary() and uses its column blocks as the table without any
+ * parsing. The string cells (get_raw_data(), get_row(), save_csv()) are
+ * only rebuilt when first asked for. The mapping stays alive with the
+ * dataset, so the file may be removed after loading but must not be
+ * rewritten in place.
  * 
  * [WARNING]
  * Categorical data is not supported yet!
@@ -31,13 +50,16 @@ public:
         size_t target_column = -1
     );  // throws std::runtime_error and std::invalid_argument
     void save_csv(const string& path);
+    void load_binary(const string& path);           // throws std::runtime_error
+    void save_binary(const string& path) const;     // throws std::runtime_error
 
-    Matrix operator[](size_t row) const;
-    Matrix get_data() const { return data_; }
-    Matrix get_targets() const { return targets_; }
-    const vector<vector<string>>& get_raw_data() const { return raw_data_; }
-    const vector<string>& get_raw_targets() const { return raw_data_[target_column_]; }
-    Matrix get_range(size_t start, size_t end) const; // throws std::invalid_argument
+    // Zero-copy views, valid until the data is reloaded or a set_*() call changes the columns
+    MatrixView operator[](size_t row) const;
+    Matrix get_data() const { return data_.to_matrix(); }
+    Matrix get_targets() const { return targets_.to_matrix(); }
+    const vector<vector<string>>& get_raw_data() const;    // Read on first use, throws std::runtime_error
+    const vector<string>& get_raw_targets() const;
+    MatrixView get_range(size_t start, size_t end) const; // Zero-copy like operator[], throws std::invalid_argument
     const vector<string>& get_row(size_t row) const;
     const vector<string>& get_headers() const { return header_names_; }
     size_t size() const { return size_; }
@@ -45,23 +67,56 @@ public:
     size_t get_features_count() const { return data_.get_cols(); }
     bool empty() const { return size_ == 0; }
     void print() const;
+    // The setters re-slice the loaded table and invalidate the views handed out before
     void set_target_column(size_t target_column);   // throws std::runtime_error and std::invalid_argument
     void set_index_column(bool index_column);       // throws std::runtime_error and std::invalid_argument
     void set_headers(bool headers);                 // throws std::runtime_error and std::invalid_argument
 
 private:
+    // What the table holds for one column of the file
+    struct Column {
+        vector<string> labels;      // Sorted labels of lines 1.., empty for numeric columns
+        bool first_numeric = true;  // The cell of the first line is a number (or a known label)
+    };
+
+    // The loaded file, its table and the options it is sliced with: everything a load replaces
+    // before derive_views_() can tell whether the new data is usable
+    struct Source {
+        string path;
+        std::shared_ptr<const MappedFile> file;
+        bool binary;
+        std::shared_ptr<const Matrix> table_storage;
+        MatrixView table;
+        vector<Column> columns;
+        vector<string> first_line;
+        long long target_column;
+        bool headers;
+        bool index_column;
+    };
+
     void process_data_();
-    void convert_to_numerical_();
+    Source take_source_();
+    void restore_source_(Source&& source);
+    void derive_views_();
+    void reconfigure_(long long target_column, bool index_column, bool headers);
+    void map_targets_(size_t target_col, size_t first_row);
+    void load_raw_data_() const;
     vector<string> split_csv_line_(const string& line) const;
     void trim_(string& str) const;
-    bool is_data_categorical_() const;
-    bool is_float_(const string& float_str) const;
-    bool is_target_column_categorical_() const;
 
     string path_;
-    vector<vector<string>> raw_data_;
-    Matrix data_;       // Contains all numerical data (without target values)
-    Matrix targets_;    // Contains targets' numerical data
+    std::shared_ptr<const MappedFile> file_;    // The loaded file, CSV text or binary cache
+    bool binary_;
+    std::shared_ptr<const Matrix> table_storage_;   // Owns the table when it was parsed from CSV
+    MatrixView table_;          // Row per file column, column per line of the file
+    vector<Column> columns_;
+    vector<string> first_line_; // Cells of the first line, the headers when headers_ is set
+    std::shared_ptr<const Matrix> data_storage_;    // Gathered features, when not adjacent in the table
+    std::shared_ptr<const Matrix> targets_storage_; // Relabelled targets, see map_targets_()
+    mutable vector<vector<string>> raw_data_;   // Lazily rebuilt string cells, see get_raw_data()
+    mutable bool raw_data_loaded_;
+    MatrixView data_;       // All numerical data (without target values), one sample per row
+    MatrixView targets_;    // Targets' numerical data, one column
     vector<string> header_names_;
     unordered_map<string, int> label_to_int_map_;
     unordered_map<int, string> int_to_label_map_;
@@ -69,7 +124,6 @@ private:
     long long target_column_;
     bool headers_;
     bool index_column_;
-    bool categorical_;  // Does not concern the target column
 };
 
 #endif // DATASET_H
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef DATASET_STREAM_H
+#define DATASET_STREAM_H
+
+#include "matrix.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ * Out-of-core reader of CSV files too large for Dataset: yields mini-batches
+ * of a fixed size, one sample per row, in file order.
+ *
+ * A reader thread reads the file front to back in large blocks (with
+ * sequential readahead advice to the kernel) and parses the lines into a
+ * bounded ring of batch buffers, staying ahead of the consumer by at most
+ * n_buffers - 1 batches. Memory use depends on the batch size and the
+ * number of buffers only, never on the size of the file.
+ *
+ * The columns follow Dataset::load_csv(): optional header line, optional
+ * index column, the target column (last by default) and numeric features.
+ * Unlike Dataset, targets have to be numeric, since labels can not be
+ * numbered before the whole file has been seen.
+*/
+class DatasetStream {
+public:
+    struct Batch {
+        MatrixView data;    // batch rows x features
+        MatrixView targets; // batch rows x 1
+    };
+
+    DatasetStream(
+        const string& path,
+        size_t batch_size,
+        bool headers = false,
+        bool index_column = false,
+        size_t target_column = -1,
+        size_t n_buffers = 3
+    );  // throws std::runtime_error and std::invalid_argument
+    DatasetStream(const DatasetStream&) = delete;
+    DatasetStream& operator=(const DatasetStream&) = delete;
+    ~DatasetStream();
+
+    /**
+     * Moves to the next batch, false at the end of the file. The views stay
+     * valid until the next call of next() or reset(). The last batch may be
+     * smaller than the batch size. Parse errors of the file are rethrown
+     * here (std::invalid_argument) once the batches before them are consumed.
+    */
+    bool next(Batch& batch);
+    void reset();   // Back to the first batch, e.g. for the next epoch
+
+    size_t get_batch_size() const { return batch_size_; }
+    size_t get_features_count() const { return n_features_; }
+    size_t get_targets_count() const { return 1; }
+    size_t get_columns_count() const { return n_cols_; }
+    const vector<string>& get_headers() const { return header_names_; }
+
+private:
+    // One buffer of the ring
+    struct Slot {
+        Matrix data;
+        Matrix targets;
+        size_t rows = 0;
+    };
+
+    void start_();
+    void stop_();
+    void read_loop_();
+    void parse_line_(const char* begin, const char* end, Slot& slot) const;    // throws std::invalid_argument
+    Slot* acquire_free_slot_();
+    void publish_(Slot* slot);
+
+    string path_;
+    size_t batch_size_;
+    bool index_column_;
+    size_t target_column_;
+    size_t n_cols_;
+    size_t n_features_;
+    size_t data_offset_;    // Bytes before the first data line
+    vector<size_t> feature_of_; // Matrix column of every file column, the index and target columns have none
+    vector<string> header_names_;
+
+    vector<Slot> slots_;
+    std::deque<Slot*> free_;
+    std::deque<Slot*> ready_;
+    Slot* current_;         // Handed out by next(), returned on the following call
+    bool finished_;         // The reader published its last batch
+    bool stopping_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable slot_freed_;
+    std::condition_variable slot_ready_;
+    std::thread reader_;
+};
+
+#endif // DATASET_STREAM_H
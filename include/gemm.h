@@ -0,0 +1,89 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <cstddef>
+#include "bfloat16.h"
+
+/**
+ * General matrix-matrix multiplication kernels used by Matrix::operator*.
+ *
+ * Operands are described by a pointer plus a row stride (rs) and a column
+ * stride (cs), so element (i, j) of A is a[i * a_rs + j * a_cs]. Passing
+ * swapped strides multiplies by a transposed operand without materializing it.
+ *
+ * The packed path follows the usual three-level blocking scheme:
+ *   - NC columns of B (KC x NC panel) are packed once and stay in L3,
+ *   - MC rows of A (MC x KC block) are packed and stay in L2,
+ *   - an MR x NR register tile of C is updated by the micro-kernel from L1.
+ *
+ * The kernels are instantiated for double, float and bfloat16. Doubles and
+ * floats take the packed AVX2/FMA path when available (a float tile is twice
+ * as wide), bfloat16 always uses the reference loop with float accumulation.
+*/
+namespace Gemm {
+    enum class Kernel { Reference, Avx2Fma };
+
+    constexpr size_t MR = 6;     // Rows of the register tile
+
+    // Columns of the register tile (two 256-bit registers of T)
+    template <typename T>
+    constexpr size_t NR_OF = 2 * 32 / sizeof(T);
+    constexpr size_t NR = NR_OF<double>;
+
+    constexpr size_t KC = 256;   // Depth of the packed panels (MR x KC sliver of A fits in L1)
+    constexpr size_t MC = 96;    // Rows of A packed per block (MC x KC block fits in L2)
+    constexpr size_t NC = 4096;  // Columns of B packed per panel (KC x NC panel fits in L3)
+
+    /**
+     * Work done on every finished tile of C while it is still in cache.
+     * bias[i] is added to each element of row i of C, then, if an activation
+     * is given, activation(C) is written to `out` (same shape as C, row stride
+     * out_rs) by calling it on runs of consecutive elements of one row.
+    */
+    template <typename T>
+    struct Epilogue {
+        using Function = void (*)(const T* in, T* out, size_t n);
+
+        const T* bias = nullptr;
+        Function activation = nullptr;
+        T* out = nullptr;
+        size_t out_rs = 0;
+
+        bool empty() const { return bias == nullptr && activation == nullptr; }
+
+        // The epilogue of the sub-block of C starting at (row, col)
+        Epilogue at(size_t row, size_t col) const {
+            Epilogue shifted = *this;
+            if (shifted.bias != nullptr) {
+                shifted.bias += row;
+            }
+            if (shifted.out != nullptr) {
+                shifted.out += row * out_rs + col;
+            }
+            return shifted;
+        }
+    };
+
+    // C (m x n) = A (m x k) * B (k x n), or C += A * B when accumulate is set, followed by the epilogue
+    template <typename T>
+    void multiply(size_t m, size_t n, size_t k,
+                  const T* a, size_t a_rs, size_t a_cs,
+                  const T* b, size_t b_rs, size_t b_cs,
+                  T* c, size_t c_rs,
+                  bool accumulate = false,
+                  const Epilogue<T>& epilogue = {});
+
+    // Same contract as multiply(), always using the portable i-j-k loop (accumulates in compute_t<T>)
+    template <typename T>
+    void multiply_reference(size_t m, size_t n, size_t k,
+                            const T* a, size_t a_rs, size_t a_cs,
+                            const T* b, size_t b_rs, size_t b_cs,
+                            T* c, size_t c_rs,
+                            bool accumulate = false,
+                            const Epilogue<T>& epilogue = {});
+
+    bool has_avx2_fma();    // Queried once from CPUID
+    Kernel active_kernel(); // Kernel used by multiply() on this machine
+}
+
+#endif // GEMM_H
@@ -3,18 +3,55 @@
 
 #include "matrix.h"
 
+// Defined for float, double and bfloat16 elements (see loss.cpp), losses are always returned as double.
+// The view overloads take strided views too, e.g. targets given as transposed sample rows.
 namespace Loss {
-    double mse(const Matrix& y_true, const Matrix& y_pred);
-    Matrix mse_derivative(const Matrix& y_true, const Matrix& y_pred);
+    template <typename T>
+    double mse(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred);
+    template <typename T>
+    double mse(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
+    template <typename T>
+    BasicMatrix<T> mse_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
     
-    double mae(const Matrix& y_true, const Matrix& y_pred);
-    Matrix mae_derivative(const Matrix& y_true, const Matrix& y_pred);
+    template <typename T>
+    double mae(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred);
+    template <typename T>
+    double mae(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
+    template <typename T>
+    BasicMatrix<T> mae_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
 
-    double categorical_cross_entropy(const Matrix& y_true, const Matrix& y_pred);
-    Matrix categorical_cross_entropy_derivative(const Matrix& y_true, const Matrix& y_pred);
+    template <typename T>
+    double categorical_cross_entropy(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred);
+    template <typename T>
+    double categorical_cross_entropy(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
+    template <typename T>
+    BasicMatrix<T> categorical_cross_entropy_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
     
-    double binary_cross_entropy(const Matrix& y_true, const Matrix& y_pred);
-    Matrix binary_cross_entropy_derivative(const Matrix& y_true, const Matrix& y_pred);
+    template <typename T>
+    double binary_cross_entropy(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred);
+    template <typename T>
+    double binary_cross_entropy(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
+    template <typename T>
+    BasicMatrix<T> binary_cross_entropy_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred);
+
+    /**
+     * Output activation and cross entropy fused into one vectorized, parallel
+     * pass over the logits Z (softmax works column-wise, one sample per
+     * column). They return the loss of activation(Z) like the functions above
+     * and write its gradient with respect to Z, (p - y) / n, to grad. The loss
+     * is computed with log-sum-exp, or log1p(exp(-|z|)) for the sigmoid, so it
+     * stays accurate for saturated logits instead of clamping p. grad may be
+     * the logits themselves, the matrix versions resize it if needed.
+    */
+    template <typename T>
+    double softmax_cross_entropy_with_logits(BasicMatrixView<const T> y_true, BasicMatrixView<const T> logits, BasicMatrixView<T> grad);
+    template <typename T>
+    double softmax_cross_entropy_with_logits(const BasicMatrix<T>& y_true, const BasicMatrix<T>& logits, BasicMatrix<T>& grad);
+
+    template <typename T>
+    double sigmoid_bce_with_logits(BasicMatrixView<const T> y_true, BasicMatrixView<const T> logits, BasicMatrixView<T> grad);
+    template <typename T>
+    double sigmoid_bce_with_logits(const BasicMatrix<T>& y_true, const BasicMatrix<T>& logits, BasicMatrix<T>& grad);
 }
 
 #endif // LOSS_H
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+using std::string;
+
+/**
+ * Read-only memory mapping of a whole file. The pages are loaded lazily by
+ * the kernel and shared with the page cache, so no copy of the file is made.
+ * Empty files map to data() == nullptr and size() == 0.
+*/
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const string& path);   // throws std::runtime_error
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool is_open() const { return open_; }
+
+private:
+    void unmap_();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+};
+
+#endif // MAPPED_FILE_H
@@ -1,123 +1,293 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include "aligned_allocator.h"
+#include "bfloat16.h"
+#include "gemm.h"
+
 #include <vector>
 #include <ostream>
+#include <type_traits>
 
 using std::vector;
 using std::move;
 using std::ostream;
 using std::initializer_list;
 
-class Matrix {
+/**
+ * Non-owning view of a single matrix row. It is what Matrix::operator[]
+ * returns, so the familiar mat[row][col] syntax keeps working on top of
+ * the contiguous storage. Converts to a std::vector (copy) when needed.
+*/
+template <typename T>
+class RowSpan {
+public:
+    RowSpan(T* data, size_t size) : data_(data), size_(size) {}
+
+    T& operator[](size_t col) const { return data_[col]; }
+    T* data() const { return data_; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    operator vector<std::remove_const_t<T>>() const { return vector<std::remove_const_t<T>>(data_, data_ + size_); }
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+template <typename T>
+class BasicMatrix;
+
+/**
+ * Non-owning, strided window into matrix storage: element (row, col) lives
+ * at data()[row * get_row_stride() + col * get_col_stride()]. Row ranges,
+ * column ranges, sub-blocks and transposes are all views of the same
+ * buffer, so slicing never copies. T is const-qualified for read-only
+ * views (MatrixView) and non-const for writable ones (MatrixSpan).
+ *
+ * A view does not keep its matrix alive and is invalidated when the
+ * matrix is resized or destroyed. It converts to an owning BasicMatrix
+ * (a copy) wherever one is expected.
+*/
+template <typename T>
+class BasicMatrixView {
+public:
+    using value_type = std::remove_const_t<T>;
+    using MatrixRef = std::conditional_t<std::is_const_v<T>, const BasicMatrix<value_type>&, BasicMatrix<value_type>&>;
+
+    BasicMatrixView() = default;
+    BasicMatrixView(T* data, size_t rows, size_t cols, size_t row_stride, size_t col_stride = 1)
+        : data_(data), rows_(rows), cols_(cols), row_stride_(row_stride), col_stride_(col_stride) {}
+    BasicMatrixView(MatrixRef mat)
+        : BasicMatrixView(mat.data(), mat.get_rows(), mat.get_cols(), mat.get_stride()) {}
+
+    template <typename U = T, typename = std::enable_if_t<!std::is_const_v<U>>>
+    operator BasicMatrixView<const value_type>() const { return { data_, rows_, cols_, row_stride_, col_stride_ }; }
+    operator BasicMatrix<value_type>() const { return to_matrix(); }
+
+    T& operator()(size_t row, size_t col) const { return data_[row * row_stride_ + col * col_stride_]; }
+    T& at(size_t row, size_t col) const; // throws std::out_of_range
+
+    BasicMatrixView row_range(size_t begin, size_t end) const; // Rows [begin, end), throws std::out_of_range
+    BasicMatrixView col_range(size_t begin, size_t end) const; // Columns [begin, end), throws std::out_of_range
+    BasicMatrixView block(size_t row, size_t col, size_t n_rows, size_t n_cols) const; // throws std::out_of_range
+    BasicMatrixView transpose() const { return { data_, cols_, rows_, col_stride_, row_stride_ }; }
+
+    size_t get_rows() const { return rows_; }
+    size_t get_cols() const { return cols_; }
+    size_t get_row_stride() const { return row_stride_; }
+    size_t get_col_stride() const { return col_stride_; }
+    T* data() const { return data_; }
+    bool is_empty() const { return rows_ == 0 || cols_ == 0; }
+    bool is_contiguous() const { return col_stride_ == 1 && (row_stride_ == cols_ || rows_ <= 1); }
+
+    value_type min() const;
+    value_type max() const;
+    value_type sum() const;
+    value_type mean() const;
+
+    BasicMatrix<value_type> to_matrix() const;
+    bool equals(BasicMatrixView<const value_type> mat) const;
+    bool equals(initializer_list<initializer_list<value_type>> init_list) const;
+    bool operator==(BasicMatrixView<const value_type> mat) const { return equals(mat); }
+    bool operator==(initializer_list<initializer_list<value_type>> init_list) const { return equals(init_list); }
+    bool operator!=(BasicMatrixView<const value_type> mat) const { return !equals(mat); }
+    bool operator!=(initializer_list<initializer_list<value_type>> init_list) const { return !equals(init_list); }
+
+private:
+    T* data_ = nullptr;
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    size_t row_stride_ = 0;
+    size_t col_stride_ = 1;
+};
+
+/**
+ * Dense row-major matrix backed by a single 64-byte aligned buffer.
+ * Element (row, col) lives at data()[row * get_stride() + col].
+ *
+ * The element type is a template parameter; member definitions live in
+ * matrix.cpp and are explicitly instantiated for float, double and bfloat16.
+ * Matrix is the double precision version used throughout the library.
+*/
+template <typename T>
+class BasicMatrix {
 public:
-    Matrix() = default;
-    Matrix(size_t rows, size_t cols);
-    Matrix(size_t rows, size_t cols, double val);
-    Matrix(const Matrix& mat);
-    Matrix(const vector<double>& data); // Create 1 x N matrix (row vector)
-    Matrix(const vector<vector<double>>& data);
-    Matrix(Matrix&& mat) noexcept;
-    Matrix(vector<vector<double>>&& data);
-    Matrix(initializer_list<initializer_list<double>> init_list);
-    ~Matrix() = default;
+    using value_type = T;
+    using Buffer = vector<T, AlignedAllocator<T>>;
+    using View = BasicMatrixView<const T>;
+    using Span = BasicMatrixView<T>;
+
+    BasicMatrix() = default;
+    BasicMatrix(size_t rows, size_t cols);
+    BasicMatrix(size_t rows, size_t cols, T val);
+    BasicMatrix(const BasicMatrix& mat);
+    BasicMatrix(const vector<T>& data); // Create 1 x N matrix (row vector)
+    BasicMatrix(const vector<vector<T>>& data);
+    BasicMatrix(BasicMatrix&& mat) noexcept;
+    BasicMatrix(vector<vector<T>>&& data);
+    BasicMatrix(initializer_list<initializer_list<T>> init_list);
+    ~BasicMatrix() = default;
     
-    vector<double>& operator[](size_t row);
-    const vector<double>& operator[](size_t row) const;
-
-    double& operator()(size_t row, size_t col);
-    const double& operator()(size_t row, size_t col) const;
-
-    Matrix& operator=(const Matrix& mat);
-    Matrix& operator=(Matrix&& mat) noexcept;
-    Matrix& operator=(const vector<vector<double>>& data);
-    Matrix& operator=(vector<vector<double>>&& data);
-    Matrix& operator=(initializer_list<initializer_list<double>> init_list);
-
-    bool operator==(const Matrix& mat) const;
-    bool operator==(const vector<vector<double>>& data) const;
-    bool operator==(initializer_list<initializer_list<double>> init_list) const;
-    friend bool operator==(initializer_list<initializer_list<double>> init_list, const Matrix& mat) { return mat == init_list; }
+    RowSpan<T> operator[](size_t row);
+    RowSpan<const T> operator[](size_t row) const;
+
+    T& operator()(size_t row, size_t col);
+    const T& operator()(size_t row, size_t col) const;
+
+    BasicMatrix& operator=(const BasicMatrix& mat);
+    BasicMatrix& operator=(BasicMatrix&& mat) noexcept;
+    BasicMatrix& operator=(const vector<vector<T>>& data);
+    BasicMatrix& operator=(vector<vector<T>>&& data);
+    BasicMatrix& operator=(initializer_list<initializer_list<T>> init_list);
+
+    bool operator==(const BasicMatrix& mat) const;
+    bool operator==(const vector<vector<T>>& data) const;
+    bool operator==(initializer_list<initializer_list<T>> init_list) const;
+    friend bool operator==(initializer_list<initializer_list<T>> init_list, const BasicMatrix& mat) { return mat == init_list; }
     
-    bool operator!=(const Matrix& mat) const;
-    bool operator!=(const vector<vector<double>>& data) const;
-    bool operator!=(initializer_list<initializer_list<double>> init_list) const;
-    friend bool operator!=(initializer_list<initializer_list<double>> init_list, const Matrix& mat) { return mat != init_list; }
-
-    Matrix operator+(double val) const;
-    friend Matrix operator+(double val, const Matrix& mat);
-    Matrix operator+(const Matrix& mat) const;
+    bool operator!=(const BasicMatrix& mat) const;
+    bool operator!=(const vector<vector<T>>& data) const;
+    bool operator!=(initializer_list<initializer_list<T>> init_list) const;
+    friend bool operator!=(initializer_list<initializer_list<T>> init_list, const BasicMatrix& mat) { return mat != init_list; }
+
+    BasicMatrix operator+(T val) const;
+    friend BasicMatrix operator+(T val, const BasicMatrix& mat) { return mat + val; }
+    BasicMatrix operator+(View mat) const;
     
-    Matrix operator-(double val) const;
-    Matrix operator-(const Matrix& mat) const;
+    BasicMatrix operator-(T val) const;
+    BasicMatrix operator-(View mat) const;
 
-    Matrix operator*(double val) const;
-    friend Matrix operator*(double val, const Matrix& mat);
-    Matrix operator*(const Matrix& mat) const;
-    Matrix operator*(const vector<double>& vec) const;
-    friend Matrix operator*(const vector<double>& vec, const Matrix& mat);
+    BasicMatrix operator*(T val) const;
+    friend BasicMatrix operator*(T val, const BasicMatrix& mat) { return mat * val; }
+    BasicMatrix operator*(View mat) const;
+    BasicMatrix operator*(const vector<T>& vec) const;
+    friend BasicMatrix operator*(const vector<T>& vec, const BasicMatrix& mat) { return BasicMatrix(vec) * mat; }
 
-    Matrix operator-() const;
+    BasicMatrix operator-() const;
 
-    Matrix elementwise_mul(const Matrix& mat) const;
+    BasicMatrix elementwise_mul(View mat) const;
 
-    double& at(size_t row, size_t col);
-    const double& at(size_t row, size_t col) const;
+    T& at(size_t row, size_t col);
+    const T& at(size_t row, size_t col) const;
     
-    void fill(double val);
-    Matrix transpose() const;
+    void fill(T val);
+    BasicMatrix transpose() const;
     void resize(size_t new_rows, size_t new_cols);
     void reshape(size_t new_rows, size_t new_cols);
-    double det() const;
-    double trace() const; // Sum of diagonal elements
-    double min() const;
-    double max() const;
-    double sum() const;
-    double mean() const;
-    Matrix inverse() const;
-    Matrix flatten() const;
+    T det() const;
+    T trace() const; // Sum of diagonal elements
+    T min() const;
+    T max() const;
+    T sum() const;
+    T mean() const;
+    BasicMatrix inverse() const;
+    BasicMatrix flatten() const;
     void fill_random(double min = -1.0, double max = 1.0);
 
-    Matrix add_bias_row(double val = 1.0, bool prepend = true) const;
-    Matrix add_bias_column(double val = 1.0, bool prepend = true) const;
+    // Zero-copy slicing, the views are invalidated by resize() and assignment
+    View view() const { return View(*this); }
+    Span view() { return Span(*this); }
+    View row_range(size_t begin, size_t end) const { return view().row_range(begin, end); }
+    Span row_range(size_t begin, size_t end) { return view().row_range(begin, end); }
+    View col_range(size_t begin, size_t end) const { return view().col_range(begin, end); }
+    Span col_range(size_t begin, size_t end) { return view().col_range(begin, end); }
+    View block(size_t row, size_t col, size_t n_rows, size_t n_cols) const { return view().block(row, col, n_rows, n_cols); }
+    Span block(size_t row, size_t col, size_t n_rows, size_t n_cols) { return view().block(row, col, n_rows, n_cols); }
+
+    BasicMatrix add_bias_row(T val = T(1.0), bool prepend = true) const;
+    BasicMatrix add_bias_column(T val = T(1.0), bool prepend = true) const;
+
+    // Element-wise conversion to another element type
+    template <typename U>
+    BasicMatrix<U> cast() const {
+        BasicMatrix<U> result(rows_, cols_);
+        for (size_t row = 0; row < rows_; ++row) {
+            const T* src = data_.data() + row * stride_;
+            U* dst = result.data() + row * result.get_stride();
+            for (size_t col = 0; col < cols_; ++col) {
+                dst[col] = static_cast<U>(static_cast<compute_t<T>>(src[col]));
+            }
+        }
+        return result;
+    }
 
     size_t get_rows() const { return rows_; }
     size_t get_cols() const { return cols_; }
+    size_t get_stride() const { return stride_; }
+    T* data() { return data_.data(); }
+    const T* data() const { return data_.data(); }
     bool is_empty() const { return rows_ == 0 || cols_ == 0; }
-    bool equals(const Matrix& mat) const;
-    bool equals(const vector<vector<double>>& data) const;
-    bool equals(initializer_list<initializer_list<double>> init_list) const;
-    friend ostream& operator<<(ostream&, const Matrix& matrix);
-
-    static Matrix identity(size_t size);
-    static Matrix zeros(size_t rows, size_t cols);
-    static Matrix ones(size_t rows, size_t cols);
-    static Matrix diagonal(size_t size, double val);
+    bool equals(const BasicMatrix& mat) const;
+    bool equals(const vector<vector<T>>& data) const;
+    bool equals(initializer_list<initializer_list<T>> init_list) const;
+    friend ostream& operator<<(ostream& os, const BasicMatrix& matrix) { return matrix.print_(os); }
+
+    static BasicMatrix identity(size_t size);
+    static BasicMatrix zeros(size_t rows, size_t cols);
+    static BasicMatrix ones(size_t rows, size_t cols);
+    static BasicMatrix diagonal(size_t size, T val);
+
+    // result = op(lhs) * op(rhs), where op() optionally transposes the operand without copying it
+    static void multiply_into(View lhs, bool lhs_transposed,
+                              View rhs, bool rhs_transposed,
+                              BasicMatrix& result);
+    // Same, writing into a preallocated view of the exact result shape (it must have unit column stride
+    // and must not alias the operands), so no memory is ever allocated. The GEMM epilogue (bias and
+    // activation) is fused into the kernel, see Gemm::Epilogue.
+    static void multiply_into(View lhs, bool lhs_transposed,
+                              View rhs, bool rhs_transposed,
+                              Span result,
+                              const Gemm::Epilogue<T>& epilogue = {});
     
 private:
+    template <typename> friend class BasicMatrixView;
+
     static constexpr double eps = 1e-9;
-    static constexpr size_t PARALLEL_THRESHOLD = 256;
 
-    vector<vector<double>> data_;
-    size_t rows_;
-    size_t cols_;
+    Buffer data_;       // Contiguous row-major storage (rows_ * stride_ elements)
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    size_t stride_ = 0; // Distance between the starts of consecutive rows (equal to cols_ for owned matrices)
 
-    void validate_and_set_shape_(const vector<vector<double>>& vec);
-    void assign_from_(const vector<vector<double>>& vec);
-    void assign_from_(const vector<vector<double>>&& vec);
-    void assign_from_(initializer_list<initializer_list<double>> init_list);
+    ostream& print_(ostream& os) const;
 
-    void add_sequentially_(double val, Matrix& result) const;
-    void add_sequentially_(const Matrix& mat, Matrix& result) const;
-    
-    void add_concurrently_(double val, Matrix& result) const;
-    void add_concurrently_(const Matrix& mat, Matrix& result) const;
+    void validate_and_set_shape_(const vector<vector<T>>& vec);
+    void assign_from_(const vector<vector<T>>& vec);
+    void assign_from_(initializer_list<initializer_list<T>> init_list);
 
-    void multiply_sequentially_(double val, Matrix& result) const;
-    void multiply_sequentially_(const Matrix& mat, Matrix& result) const;
-    
-    void multiply_concurrently_(double val, Matrix& result) const;
-    void multiply_concurrently_(const Matrix& mat, Matrix& result) const;
+    // result = op(*this, mat) element by element, split across the pool for large matrices
+    template <typename Op>
+    void combine_(View mat, BasicMatrix& result, Op op, const char* overflow_message) const;
+
+    void add_sequentially_(T val, BasicMatrix& result) const;
+    void add_concurrently_(T val, BasicMatrix& result) const;
+
+    void multiply_sequentially_(T val, BasicMatrix& result) const;
+    void multiply_concurrently_(T val, BasicMatrix& result) const;
+
+    static void multiply_sequentially_(View lhs, View rhs, Span result, const Gemm::Epilogue<T>& epilogue);
+    static void multiply_concurrently_(View lhs, View rhs, Span result, const Gemm::Epilogue<T>& epilogue);
 };
 
-#endif // MATRIX_H
\ No newline at end of file
+extern template class BasicMatrix<float>;
+extern template class BasicMatrix<double>;
+extern template class BasicMatrix<bfloat16>;
+extern template class BasicMatrixView<const float>;
+extern template class BasicMatrixView<const double>;
+extern template class BasicMatrixView<const bfloat16>;
+extern template class BasicMatrixView<float>;
+extern template class BasicMatrixView<double>;
+extern template class BasicMatrixView<bfloat16>;
+
+using Matrix = BasicMatrix<double>;
+using MatrixF = BasicMatrix<float>;
+using MatrixBF16 = BasicMatrix<bfloat16>;
+
+using MatrixView = BasicMatrixView<const double>;
+using MatrixSpan = BasicMatrixView<double>;
+
+#endif // MATRIX_H
@@ -0,0 +1,388 @@
+#ifndef MATRIX_EXPR_H
+#define MATRIX_EXPR_H
+
+#include "matrix.h"
+#include "thread_pool.h"
+#include "numeric_policy.h"
+#include "parallel_tuning.h"
+#include "profiler.h"
+
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * Lazily evaluated Matrix arithmetic.
+ *
+ * Wrapping an operand with Expr::lazy() (or Expr::transposed()) makes the
+ * arithmetic operators build a small expression tree instead of computing
+ * temporaries. The tree is evaluated when it is converted to a Matrix or
+ * passed to Expr::assign(), in a single pass writing into one output buffer:
+ *
+ *     Matrix D = Expr::lazy(A) - Expr::lazy(B) * 2.0 + 1.0;  // one loop, one allocation
+ *     Matrix Z = Expr::transposed(W) * X;                    // transposed GEMM, W^T never built
+ *     Expr::assign(Z, Expr::lazy(Z) * 0.5);                  // reuses Z's storage
+ *
+ * Only operations with an expression operand are lazy. A plain Matrix
+ * operand must be a named matrix, e.g. the B in `Expr::lazy(A) - B`, and is
+ * best wrapped with Expr::lazy() as well; temporaries such as `B * 2.0` are
+ * rejected at compile time.
+ *
+ * Expressions only hold pointers to their operands, so they must not outlive
+ * the matrices they were built from. Results are checked for overflow in the
+ * same way as the eager Matrix operators, following the active NumericPolicy.
+*/
+namespace Expr {
+
+template <typename Derived>
+class Elementwise;
+
+template <typename T, typename E>
+void assign(BasicMatrix<T>& dst, const Elementwise<E>& expr);
+
+// Base of every element-wise expression node (CRTP). Nodes evaluate to compute_t<value_type>,
+// so bfloat16 expressions are computed in float and rounded once when stored.
+template <typename Derived>
+class Elementwise {
+public:
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+
+    template <typename T, typename D = Derived, typename = std::enable_if_t<std::is_same_v<T, typename D::value_type>>>
+    operator BasicMatrix<T>() const {
+        BasicMatrix<T> result;
+        assign(result, *this);
+        return result;
+    }
+};
+
+template <typename T>
+class Leaf : public Elementwise<Leaf<T>> {
+public:
+    using value_type = T;
+
+    explicit Leaf(const BasicMatrix<T>& mat) : mat_(&mat) {}
+    explicit Leaf(const BasicMatrix<T>&&) = delete;
+
+    size_t rows() const { return mat_->get_rows(); }
+    size_t cols() const { return mat_->get_cols(); }
+    compute_t<T> operator()(size_t row, size_t col) const { return mat_->data()[row * mat_->get_stride() + col]; }
+
+    // Reading the same element that is being written is safe
+    bool unsafe_alias(const void*) const { return false; }
+
+    const BasicMatrix<T>& matrix() const { return *mat_; }
+    static constexpr bool transposed = false;
+
+private:
+    const BasicMatrix<T>* mat_;
+};
+
+template <typename T>
+class Transposed : public Elementwise<Transposed<T>> {
+public:
+    using value_type = T;
+
+    explicit Transposed(const BasicMatrix<T>& mat) : mat_(&mat) {}
+    explicit Transposed(const BasicMatrix<T>&&) = delete;
+
+    size_t rows() const { return mat_->get_cols(); }
+    size_t cols() const { return mat_->get_rows(); }
+    compute_t<T> operator()(size_t row, size_t col) const { return mat_->data()[col * mat_->get_stride() + row]; }
+
+    bool unsafe_alias(const void* dst) const { return mat_ == dst; }
+
+    const BasicMatrix<T>& matrix() const { return *mat_; }
+    static constexpr bool transposed = true;
+
+private:
+    const BasicMatrix<T>* mat_;
+};
+
+template <typename T>
+class Scalar {
+public:
+    using value_type = T;
+
+    explicit Scalar(double val) : val_(static_cast<compute_t<T>>(val)) {}
+
+    compute_t<T> operator()(size_t, size_t) const { return val_; }
+    bool unsafe_alias(const void*) const { return false; }
+
+private:
+    compute_t<T> val_;
+};
+
+struct Add { template <typename V> static V apply(V a, V b) { return a + b; } };
+struct Sub { template <typename V> static V apply(V a, V b) { return a - b; } };
+struct Mul { template <typename V> static V apply(V a, V b) { return a * b; } };
+struct Neg { template <typename V> static V apply(V a) { return -a; } };
+
+namespace detail {
+
+template <typename T>
+struct is_scalar : std::false_type {};
+
+template <typename T>
+struct is_scalar<Scalar<T>> : std::true_type {};
+
+} // namespace detail
+
+template <typename Op, typename L, typename R>
+class Binary : public Elementwise<Binary<Op, L, R>> {
+public:
+    using value_type = typename std::conditional_t<detail::is_scalar<L>::value, R, L>::value_type;
+    static_assert(std::is_same_v<typename L::value_type, typename R::value_type>,
+                  "Matrix expression operands must have the same element type");
+
+    Binary(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+        if constexpr (!detail::is_scalar<L>::value && !detail::is_scalar<R>::value) {
+            if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols()) {
+                throw std::domain_error("Matrix expression operands have different shapes!");
+            }
+        }
+    }
+
+    size_t rows() const {
+        if constexpr (detail::is_scalar<L>::value) {
+            return rhs_.rows();
+        } else {
+            return lhs_.rows();
+        }
+    }
+
+    size_t cols() const {
+        if constexpr (detail::is_scalar<L>::value) {
+            return rhs_.cols();
+        } else {
+            return lhs_.cols();
+        }
+    }
+
+    compute_t<value_type> operator()(size_t row, size_t col) const { return Op::apply(lhs_(row, col), rhs_(row, col)); }
+    bool unsafe_alias(const void* dst) const { return lhs_.unsafe_alias(dst) || rhs_.unsafe_alias(dst); }
+
+private:
+    L lhs_;
+    R rhs_;
+};
+
+template <typename Op, typename E>
+class Unary : public Elementwise<Unary<Op, E>> {
+public:
+    using value_type = typename E::value_type;
+
+    explicit Unary(const E& expr) : expr_(expr) {}
+
+    size_t rows() const { return expr_.rows(); }
+    size_t cols() const { return expr_.cols(); }
+    compute_t<value_type> operator()(size_t row, size_t col) const { return Op::apply(expr_(row, col)); }
+    bool unsafe_alias(const void* dst) const { return expr_.unsafe_alias(dst); }
+
+private:
+    E expr_;
+};
+
+/**
+ * Matrix product of two (optionally transposed) matrices. It is not an
+ * element-wise node: it is evaluated as a whole by the GEMM kernel, which
+ * reads transposed operands through swapped strides.
+*/
+template <typename L, typename R>
+class Product {
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same_v<typename L::value_type, typename R::value_type>,
+                  "Matrix product operands must have the same element type");
+
+    Product(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+        if (lhs.cols() != rhs.rows()) {
+            throw std::domain_error("Matrices can not be multiplied!");
+        }
+    }
+
+    size_t rows() const { return lhs_.rows(); }
+    size_t cols() const { return rhs_.cols(); }
+
+    void eval_into(BasicMatrix<value_type>& dst) const {
+        BasicMatrix<value_type>::multiply_into(lhs_.matrix(), L::transposed, rhs_.matrix(), R::transposed, dst);
+    }
+
+    operator BasicMatrix<value_type>() const {
+        BasicMatrix<value_type> result;
+        eval_into(result);
+        return result;
+    }
+
+private:
+    L lhs_;
+    R rhs_;
+};
+
+template <typename T>
+Leaf<T> lazy(const BasicMatrix<T>& mat) { return Leaf<T>(mat); }
+
+template <typename T>
+Leaf<T> lazy(const BasicMatrix<T>&&) = delete;
+
+template <typename T>
+Transposed<T> transposed(const BasicMatrix<T>& mat) { return Transposed<T>(mat); }
+
+template <typename T>
+Transposed<T> transposed(const BasicMatrix<T>&&) = delete;
+
+namespace detail {
+
+template <typename T>
+struct is_expr : std::is_base_of<Elementwise<T>, T> {};
+
+template <typename T>
+struct is_matrix : std::false_type {};
+
+template <typename T>
+struct is_matrix<BasicMatrix<T>> : std::true_type {};
+
+template <typename T>
+struct is_gemm_leaf : std::false_type {};
+
+template <typename T>
+struct is_gemm_leaf<Leaf<T>> : std::true_type {};
+
+template <typename T>
+struct is_gemm_leaf<Transposed<T>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_operand_v = is_expr<T>::value || is_matrix<T>::value;
+
+template <typename T>
+constexpr bool is_gemm_operand_v = is_gemm_leaf<T>::value || is_matrix<T>::value;
+
+// Operator templates only kick in when at least one side is already an expression,
+// so plain Matrix arithmetic keeps using the eager Matrix operators.
+template <typename L, typename R>
+constexpr bool any_expr_v = is_expr<L>::value || is_expr<R>::value;
+
+template <typename T>
+Leaf<T> wrap(const BasicMatrix<T>& mat) { return Leaf<T>(mat); }
+
+template <typename E>
+const E& wrap(const Elementwise<E>& expr) { return expr.self(); }
+
+template <typename T>
+using wrapped_t = std::decay_t<decltype(wrap(std::declval<const std::decay_t<T>&>()))>;
+
+// Leaves point to their matrix, which would be destroyed before a stored expression is evaluated
+template <typename T>
+constexpr bool is_temporary_matrix_v = is_matrix<std::decay_t<T>>::value && !std::is_lvalue_reference_v<T>;
+
+template <typename L, typename R>
+constexpr void check_operands() {
+    static_assert(!is_temporary_matrix_v<L> && !is_temporary_matrix_v<R>,
+                  "Matrix expressions can not refer to temporary matrices, store them in a variable first");
+}
+
+} // namespace detail
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<std::decay_t<L>> && detail::is_operand_v<std::decay_t<R>> &&
+                                      detail::any_expr_v<std::decay_t<L>, std::decay_t<R>>>>
+Binary<Add, detail::wrapped_t<L>, detail::wrapped_t<R>> operator+(L&& lhs, R&& rhs) {
+    detail::check_operands<L, R>();
+    return { detail::wrap(lhs), detail::wrap(rhs) };
+}
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<std::decay_t<L>> && detail::is_operand_v<std::decay_t<R>> &&
+                                      detail::any_expr_v<std::decay_t<L>, std::decay_t<R>>>>
+Binary<Sub, detail::wrapped_t<L>, detail::wrapped_t<R>> operator-(L&& lhs, R&& rhs) {
+    detail::check_operands<L, R>();
+    return { detail::wrap(lhs), detail::wrap(rhs) };
+}
+
+// Element-wise (Hadamard) product of two expressions
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_operand_v<std::decay_t<L>> && detail::is_operand_v<std::decay_t<R>>>>
+Binary<Mul, detail::wrapped_t<L>, detail::wrapped_t<R>> hadamard(L&& lhs, R&& rhs) {
+    detail::check_operands<L, R>();
+    return { detail::wrap(lhs), detail::wrap(rhs) };
+}
+
+template <typename E>
+using scalar_of_t = Scalar<typename E::value_type>;
+
+template <typename E>
+Binary<Add, E, scalar_of_t<E>> operator+(const Elementwise<E>& expr, double val) { return { expr.self(), scalar_of_t<E>(val) }; }
+
+template <typename E>
+Binary<Add, scalar_of_t<E>, E> operator+(double val, const Elementwise<E>& expr) { return { scalar_of_t<E>(val), expr.self() }; }
+
+template <typename E>
+Binary<Sub, E, scalar_of_t<E>> operator-(const Elementwise<E>& expr, double val) { return { expr.self(), scalar_of_t<E>(val) }; }
+
+template <typename E>
+Binary<Sub, scalar_of_t<E>, E> operator-(double val, const Elementwise<E>& expr) { return { scalar_of_t<E>(val), expr.self() }; }
+
+template <typename E>
+Binary<Mul, E, scalar_of_t<E>> operator*(const Elementwise<E>& expr, double val) { return { expr.self(), scalar_of_t<E>(val) }; }
+
+template <typename E>
+Binary<Mul, scalar_of_t<E>, E> operator*(double val, const Elementwise<E>& expr) { return { scalar_of_t<E>(val), expr.self() }; }
+
+template <typename E>
+Unary<Neg, E> operator-(const Elementwise<E>& expr) { return Unary<Neg, E>(expr.self()); }
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::is_gemm_operand_v<std::decay_t<L>> && detail::is_gemm_operand_v<std::decay_t<R>> &&
+                                      detail::any_expr_v<std::decay_t<L>, std::decay_t<R>>>>
+Product<detail::wrapped_t<L>, detail::wrapped_t<R>> operator*(L&& lhs, R&& rhs) {
+    detail::check_operands<L, R>();
+    return { detail::wrap(lhs), detail::wrap(rhs) };
+}
+
+/**
+ * Evaluates an element-wise expression into dst in a single pass. The
+ * storage of dst is reused when it already has the right shape.
+*/
+template <typename T, typename E>
+void assign(BasicMatrix<T>& dst, const Elementwise<E>& expr) {
+    static_assert(std::is_same_v<T, typename E::value_type>, "Expression and destination element types differ");
+    PROFILE_ZONE("matrix.expression");
+    const E& e = expr.self();
+    if (e.unsafe_alias(&dst)) {
+        BasicMatrix<T> tmp;
+        assign(tmp, expr);
+        dst = std::move(tmp);
+        return;
+    }
+
+    const size_t rows = e.rows();
+    const size_t cols = e.cols();
+    if (dst.get_rows() != rows || dst.get_cols() != cols) {
+        dst = BasicMatrix<T>(rows, cols);
+    }
+
+    auto kernel = [&](size_t start, size_t end) {
+        for (size_t row = start; row < end; ++row) {
+            T* out = dst[row].data();
+            for (size_t col = 0; col < cols; ++col) {
+                out[col] = e(row, col);
+            }
+        }
+    };
+    if (!Parallel::use_pool(Parallel::Kernel::Elementwise, rows * cols)) {
+        kernel(0, rows);
+    } else {
+        parallel_for(0, rows, kernel);
+    }
+
+    if (Numeric::checks_enabled() && !Numeric::all_finite(dst.data(), rows * dst.get_stride())) {
+        throw std::overflow_error("Matrix expression overflowed!");
+    }
+}
+
+template <typename T, typename L, typename R>
+void assign(BasicMatrix<T>& dst, const Product<L, R>& product) {
+    product.eval_into(dst);
+}
+
+} // namespace Expr
+
+#endif // MATRIX_EXPR_H
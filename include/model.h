@@ -15,6 +15,9 @@ using types::LayerType;
 using types::LossFunction;
 using types::TaskType;
 
+class DatasetStream;
+class BatchLoader;
+
 class Model {
 public:
     Model();
@@ -32,17 +35,34 @@ public:
     Model& add_layer(size_t n_neurons, LayerType layer_type);
     Model& add_layer(size_t n_neurons, ActivationFunction activation_function);
 
+    // Mini-batch SGD. X holds one sample per row (as loaded by Dataset), y the matching targets
     Model& fit(const Matrix& X, const Matrix& y,
+                       size_t epochs = 100, double learning_rate = 0.01,
+                       LossFunction loss = LossFunction::BinaryCrossEntropy,
+                       size_t batch_size = 32);
+    // Same, over the batches of a stream or a loader from where they stand, rewinding them after every epoch
+    Model& fit(DatasetStream& stream,
+                       size_t epochs = 100, double learning_rate = 0.01,
+                       LossFunction loss = LossFunction::BinaryCrossEntropy);
+    Model& fit(BatchLoader& loader,
                        size_t epochs = 100, double learning_rate = 0.01,
                        LossFunction loss = LossFunction::BinaryCrossEntropy);
 
-    Matrix predict(const Matrix& input) const;
+    // One row of outputs per row (sample) of input. Not const: the forward passes run through the
+    // network's workspace, so predict() must not overlap another predict() or a training step
+    Matrix predict(const Matrix& input);
     Model& clear();
     void save(const string& filename) const;
     void load(const string& filename);
     vector<size_t> shape() const { return nn_.get_shape(); }
 
 private:
+    // Epoch loop shared by the streaming fit() overloads, Source is a DatasetStream or a BatchLoader
+    template <typename Source>
+    Model& fit_batches_(Source& source, size_t epochs, double learning_rate, LossFunction loss);
+    // One SGD step on a batch of samples given as rows, returns the batch loss
+    double train_batch_(MatrixView X_batch, MatrixView y_batch, double learning_rate, LossFunction loss, Matrix& output);
+
     NeuralNetwork nn_;
     TaskType task_type_;
     bool fit_;
@@ -8,52 +8,103 @@
 using std::vector;
 using types::ActivationFunction;
 using types::LayerType;
+using types::LossFunction;
 
-class NeuralNetwork {
+/**
+ * Fully connected network whose weights, activations and arithmetic use the
+ * compute dtype T (float, double or bfloat16). NeuralNetwork is the double
+ * precision version; e.g. BasicNeuralNetwork<float> halves memory traffic
+ * and doubles the SIMD width of the GEMM kernels.
+ *
+ * Layer l maps a batch of column vectors X to act(W^T X + b), with W of shape
+ * (inputs x outputs) and the bias b a separate (outputs x 1) column. The bias
+ * and the activation are applied in the GEMM epilogue, tile by tile.
+*/
+template <typename T>
+class BasicNeuralNetwork {
 public:
-    NeuralNetwork();
-    NeuralNetwork(const vector<size_t>& shape, const vector<ActivationFunction>& activation_functions);
-    NeuralNetwork(const NeuralNetwork& nn) = default;
-    NeuralNetwork(NeuralNetwork&& nn) noexcept = default;
-    ~NeuralNetwork() = default;
+    using value_type = T;
+    using Mat = BasicMatrix<T>;
+    using View = BasicMatrixView<const T>;
+    using Span = BasicMatrixView<T>;
 
-    NeuralNetwork& operator=(const NeuralNetwork& nn) = default;
-    NeuralNetwork& operator=(NeuralNetwork&& nn) noexcept = default;
+    static constexpr size_t DEFAULT_MAX_BATCH_SIZE = 64;
 
-    NeuralNetwork& erase(); // Erases all layers, sizes and weights (state as after default constructor)
-    NeuralNetwork& build();
+    BasicNeuralNetwork();
+    BasicNeuralNetwork(const vector<size_t>& shape, const vector<ActivationFunction>& activation_functions);
+    BasicNeuralNetwork(const BasicNeuralNetwork& nn) = default;
+    BasicNeuralNetwork(BasicNeuralNetwork&& nn) noexcept = default;
+    ~BasicNeuralNetwork() = default;
 
-    Matrix forward(const Matrix& input, bool learning = false);
-    void backward(const Matrix& input, const Matrix& target, double learning_rate);
+    BasicNeuralNetwork& operator=(const BasicNeuralNetwork& nn) = default;
+    BasicNeuralNetwork& operator=(BasicNeuralNetwork&& nn) noexcept = default;
+
+    BasicNeuralNetwork& erase(); // Erases all layers, sizes and weights (state as after default constructor)
+    // Allocates the weights and plans the per-layer buffers for batches of up to max_batch_size columns.
+    // Building an already built network draws new weights.
+    BasicNeuralNetwork& build(size_t max_batch_size = DEFAULT_MAX_BATCH_SIZE);
+
+    Mat forward(View input, bool learning = false);
+    // Writes the network output (n_outputs x batch) into `output`. Every intermediate result goes to the
+    // buffers planned by build(), so batches not wider than the planned size do not allocate memory.
+    void forward_into(View input, Span output, bool learning = false);
+    // Backpropagates `loss` through the last learning forward pass (which must have been made on `input`),
+    // takes one SGD step and returns the loss of the batch before the step. All gradients live in
+    // buffers planned by build(), so once the first step has sized the thread-local scratch of the
+    // kernels, training steps do not allocate memory either, fused output layers included.
+    double backward(View input, View target, double learning_rate, LossFunction loss = LossFunction::MSE);
     bool is_built() const { return built_; }
     
-    NeuralNetwork& add_layer(size_t n_neurons, LayerType layer_type, ActivationFunction activation_function);
+    BasicNeuralNetwork& add_layer(size_t n_neurons, LayerType layer_type, ActivationFunction activation_function);
     // If layer_type is equal to LayerType::Output, then activation_function parameter can be ommitted (it will not be used)
     
     // Overloads for "Python-like" parameter passing
-    NeuralNetwork& add_layer(size_t n_neurons);
-    NeuralNetwork& add_layer(size_t n_neurons, LayerType layer_type);
-    NeuralNetwork& add_layer(size_t n_neurons, ActivationFunction activation_function);
+    BasicNeuralNetwork& add_layer(size_t n_neurons);
+    BasicNeuralNetwork& add_layer(size_t n_neurons, LayerType layer_type);
+    BasicNeuralNetwork& add_layer(size_t n_neurons, ActivationFunction activation_function);
     
     size_t get_n_layers() const { return n_layers_; }
     vector<size_t> get_shape() const { return shape_; }
     vector<ActivationFunction>& get_activation_functions() { return activation_functions_; }
     const vector<ActivationFunction>& get_activation_functions() const { return activation_functions_; }
-    vector<Matrix>& get_weights() { return weights_; }
-    const vector<Matrix>& get_weights() const { return weights_; }
-    const vector<Matrix>& get_activations() const { return A_values_; }
-    const vector<Matrix>& get_pre_activations() const { return Z_values_; }
+    vector<Mat>& get_weights() { return weights_; }
+    const vector<Mat>& get_weights() const { return weights_; }
+    vector<Mat>& get_biases() { return biases_; }
+    const vector<Mat>& get_biases() const { return biases_; }
+    // Gradients of the last backward pass
+    const vector<Mat>& get_weight_gradients() const { return weight_gradients_; }
+    const vector<Mat>& get_bias_gradients() const { return bias_gradients_; }
+    size_t get_max_batch_size() const { return max_batch_size_; }
+    // Per-layer outputs and pre-activations of the last forward pass made with learning = true
+    vector<View> get_activations() const;
+    vector<View> get_pre_activations() const;
     
 private:
     void randomize_weights_();
+    void plan_workspace_(size_t max_batch_size);
+    static typename Gemm::Epilogue<T>::Function activation_kernel_(ActivationFunction activation_function);
+    double output_gradient_(View target, LossFunction loss);
+    static void activation_gradient_(ActivationFunction activation_function, View A, Span G);
     
     size_t n_layers_;
     vector<size_t> shape_;
     vector<ActivationFunction> activation_functions_;
-    vector<Matrix> weights_;
+    vector<Mat> weights_;
+    vector<Mat> biases_;
     bool built_;
-    vector<Matrix> A_values_;
-    vector<Matrix> Z_values_;
+    size_t max_batch_size_;
+    size_t learning_batch_size_; // Columns kept from the last learning forward pass (0 if none)
+    vector<Mat> A_values_;       // Workspace: per-layer buffers of max_batch_size_ columns
+    vector<Mat> Z_values_;
+    vector<Mat> G_values_;       // Gradients of the loss with respect to Z_values_
+    vector<Mat> weight_gradients_;
+    vector<Mat> bias_gradients_;
 };
 
+extern template class BasicNeuralNetwork<float>;
+extern template class BasicNeuralNetwork<double>;
+extern template class BasicNeuralNetwork<bfloat16>;
+
+using NeuralNetwork = BasicNeuralNetwork<double>;
+
 #endif // NEURAL_NETWORK_H
@@ -0,0 +1,46 @@
+#ifndef NUMERIC_POLICY_H
+#define NUMERIC_POLICY_H
+
+#include <cstddef>
+#include "types.h"
+#include "bfloat16.h"
+
+using types::NumericPolicy;
+
+/**
+ * Controls whether Matrix kernels verify that their results are finite.
+ *
+ *  - Checked:   every result is scanned for NaN/Inf once it is computed and
+ *               std::overflow_error is thrown if any is found (default),
+ *  - Fast:      no checks at all, kernels run the plain vectorized loops,
+ *  - DebugOnly: behaves like Checked unless NDEBUG is defined.
+ *
+ * The process-wide policy is set with set_policy(). A ScopedPolicy object
+ * overrides it for the current thread until it goes out of scope, which
+ * gives a per-call switch:
+ *
+ *     { Numeric::ScopedPolicy fast(NumericPolicy::Fast); Z = W * X; }
+*/
+namespace Numeric {
+    void set_policy(NumericPolicy policy);
+    NumericPolicy get_policy(); // Thread override if active, otherwise the global policy
+    bool checks_enabled();
+
+    // Vectorizable scans, return false if any of the n values is NaN or +/-Inf
+    bool all_finite(const double* data, size_t n);
+    bool all_finite(const float* data, size_t n);
+    bool all_finite(const bfloat16* data, size_t n);
+
+    class ScopedPolicy {
+    public:
+        explicit ScopedPolicy(NumericPolicy policy);
+        ScopedPolicy(const ScopedPolicy&) = delete;
+        ScopedPolicy& operator=(const ScopedPolicy&) = delete;
+        ~ScopedPolicy();
+
+    private:
+        int previous_;
+    };
+}
+
+#endif // NUMERIC_POLICY_H
@@ -0,0 +1,80 @@
+#ifndef PARALLEL_TUNING_H
+#define PARALLEL_TUNING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+/**
+ * Decides when Matrix kernels hand their work to the thread pool.
+ *
+ * Every kernel class has a threshold on the work of one call: elements
+ * for element-wise kernels (rows x cols, so wide and narrow matrices of
+ * the same size are treated alike), multiply-adds for GEMM (m x n x k) and
+ * input elements for reductions, the fused losses included. Calls below it
+ * run on the calling thread, larger ones are split among the pool threads.
+ *
+ * The defaults are conservative guesses. calibrate() measures the
+ * crossover of each kernel class on this machine with the current pool
+ * size, and autotune() does so once per CPU model and pool size, caching
+ * the result in a small file:
+ *
+ *     Parallel::autotune();                                   // at startup
+ *     Parallel::set_threshold(Parallel::Kernel::Gemm, 1 << 20);  // or by hand
+ *
+ * Calibrated thresholds are kept between MIN_* and MAX_*, so batch-1 and
+ * small-batch layers stay on one thread and large GEMMs always fan out.
+ * Thresholds are process-wide; like ThreadPool::configure(), calibration
+ * must not run while other threads use the kernels.
+*/
+namespace Parallel {
+    enum class Kernel { Elementwise, Gemm, Reduce };
+
+    struct Thresholds {
+        size_t elementwise;
+        size_t gemm;
+        size_t reduce;
+    };
+
+    constexpr size_t NEVER = SIZE_MAX;  // Threshold that keeps a kernel on one thread
+    constexpr size_t DEFAULT_ELEMENTWISE_THRESHOLD = size_t(1) << 16;
+    constexpr size_t DEFAULT_GEMM_THRESHOLD = size_t(1) << 22;
+    constexpr size_t DEFAULT_REDUCE_THRESHOLD = size_t(1) << 15;
+    constexpr size_t MIN_ELEMENTWISE_THRESHOLD = size_t(1) << 12;
+    constexpr size_t MAX_ELEMENTWISE_THRESHOLD = size_t(1) << 20;
+    constexpr size_t MIN_GEMM_THRESHOLD = size_t(1) << 18;
+    constexpr size_t MAX_GEMM_THRESHOLD = size_t(1) << 24;
+    constexpr size_t MIN_REDUCE_THRESHOLD = size_t(1) << 12;
+    constexpr size_t MAX_REDUCE_THRESHOLD = size_t(1) << 21;
+
+    size_t get_threshold(Kernel kernel);
+    void set_threshold(Kernel kernel, size_t work);    // Runtime override, NEVER disables the pool
+    Thresholds get_thresholds();
+    void set_thresholds(const Thresholds& thresholds);
+    void reset_thresholds();                            // Back to the defaults
+
+    inline bool use_pool(Kernel kernel, size_t work) { return work >= get_threshold(kernel); }
+
+    /**
+     * Times every kernel class on one thread and on the pool over growing
+     * sizes and sets each threshold to the smallest size from which the
+     * pool is faster, clamped to [MIN, MAX]. With a single thread there is
+     * nothing to gain and the pool is disabled (NEVER). Takes about a
+     * second. Returns the thresholds set.
+    */
+    Thresholds calibrate();
+
+    string cpu_model();             // "unknown" where it can not be read
+    string default_cache_path();    // $XDG_CACHE_HOME or ~/.cache, then cppnn/parallel_thresholds, empty without either
+
+    /**
+     * Sets the thresholds cached in cache_path for this CPU model and pool
+     * size, or calibrates and adds them to the cache. An unusable cache is
+     * only logged. An empty path disables the cache.
+    */
+    Thresholds autotune(const string& cache_path = default_cache_path());
+}
+
+#endif // PARALLEL_TUNING_H
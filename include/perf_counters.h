@@ -0,0 +1,49 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Hardware performance counters of the calling thread (Linux
+ * perf_event_open), read together as one group.
+ *
+ * Counters the kernel or the CPU does not provide (containers without
+ * perf access, virtual machines without a PMU, other systems) are simply
+ * missing: nothing throws, available() and has() tell what is counted.
+ * When the CPU multiplexes the group, the values are scaled to the whole
+ * time they were enabled.
+*/
+class PerfCounters {
+public:
+    enum Counter {
+        Cycles,
+        Instructions,
+        L1DMisses,      // L1 data cache read misses
+        LLCMisses,      // Last level cache misses
+        BranchMisses,
+        N_COUNTERS
+    };
+    using Values = std::array<uint64_t, N_COUNTERS>;
+
+    PerfCounters();     // Counts the calling thread from here on
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters();
+
+    bool available() const { return n_open_ > 0; }
+    bool has(Counter counter) const { return position_[counter] >= 0; }
+
+    // Current totals, missing counters read 0; false when nothing could be read
+    bool read(Values& values) const;
+
+    static const char* name(Counter counter);
+
+private:
+    int fds_[N_COUNTERS];       // Group leader first, -1 for missing counters
+    int position_[N_COUNTERS];  // Of every counter in the group read, -1 when missing
+    size_t n_open_;
+};
+
+#endif // PERF_COUNTERS_H
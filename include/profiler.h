@@ -0,0 +1,130 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "timer.h"
+#include "perf_counters.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ * Hierarchical zone profiler.
+ *
+ * A zone is a named scope timed by a ScopedTimer. Zones opened inside
+ * another zone on the same thread become its children, so the same
+ * kernel shows up separately under every caller (e.g. the GEMM of each
+ * layer of the forward pass). Every thread records into its own tree
+ * without locks; report() merges the trees of all threads by zone path.
+ *
+ * Per zone, the number of calls, the total time and a log-scale histogram
+ * of the durations are kept, from which the percentiles are read (within
+ * 1/16 of the true value).
+ *
+ * With enable_counters(), zones also sum the hardware counters of their
+ * thread (PerfCounters) for IPC and cache behaviour. Zones told their
+ * floating point work with add_flops() report the GFLOP/s achieved. A
+ * zone timing a parallel kernel counts the calling thread only, the pool
+ * workers count in their own "pool task" zones.
+ *
+ * While tracing (start_tracing()), every zone also appends a begin/duration
+ * event to a buffer of its thread, without locks, and the events of all
+ * threads can be written as Chrome trace-event JSON (write_trace()), to be
+ * opened in Perfetto or chrome://tracing. Threads are named there with
+ * set_thread_name().
+ *
+ * The library is instrumented through PROFILE_ZONE(), PROFILE_FLOPS() and
+ * PROFILE_THREAD_NAME(), which compile to nothing unless CPPNN_PROFILE is
+ * defined, so production builds pay nothing for them.
+*/
+namespace Profiler {
+
+#ifdef CPPNN_PROFILE
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+struct ThreadProfile;
+
+struct ZoneStats {
+    string path;            // Names from the outermost zone, separated by '/'
+    size_t depth = 0;       // 0 for outermost zones
+    uint64_t count = 0;
+    double total_seconds = 0.0;
+    double mean_seconds = 0.0;
+    double p50_seconds = 0.0;
+    double p99_seconds = 0.0;
+    double max_seconds = 0.0;
+    uint64_t flops = 0;
+    double gflops = 0.0;        // flops per total time
+    uint64_t counted = 0;       // Calls measured with hardware counters
+    PerfCounters::Values counters{};    // Summed over the counted calls
+    double ipc = 0.0;           // Instructions per cycle of the counted calls, 0 when not counted
+};
+
+/**
+ * Times its own lifetime as a zone. The name must outlive the profiler
+ * (a string literal). The index tells apart instances of a zone, e.g.
+ * layers, and is shown as name[index].
+*/
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name);
+    ScopedTimer(const char* name, size_t index);
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer();
+
+private:
+    ThreadProfile* thread_;     // Tree of the thread that opened the zone
+    size_t node_;
+    Timer timer_;
+    bool counting_;
+    PerfCounters::Values counters_;     // At the start of the zone
+};
+
+vector<ZoneStats> report();     // Zones of all threads, every zone followed by its children
+string format_report();         // The same as a table
+void reset();                   // Zeroes the statistics, calls ending meanwhile on other threads may survive it
+
+void set_thread_name(const string& name);  // Of the calling thread, in traces
+
+/**
+ * Switches hardware counters for the zones of all threads. Returns whether
+ * the calling thread can count, without them zones are only timed.
+*/
+bool enable_counters(bool enabled = true);
+void add_flops(uint64_t flops);     // To the innermost open zone of the calling thread
+
+/**
+ * Starts recording zone events, dropping those of an earlier trace. Every
+ * thread keeps at most max_events, later ones are dropped and counted.
+*/
+void start_tracing(size_t max_events = size_t(1) << 20);
+void stop_tracing();
+bool tracing();
+string trace_json();                // Chrome trace-event JSON of the events recorded so far
+void write_trace(const string& path);   // throws std::runtime_error
+
+} // namespace Profiler
+
+#define PROFILE_CONCAT_INNER_(a, b) a##b
+#define PROFILE_CONCAT_(a, b) PROFILE_CONCAT_INNER_(a, b)
+
+// PROFILE_ZONE(name) or PROFILE_ZONE(name, index): times the rest of the enclosing scope
+#ifdef CPPNN_PROFILE
+#define PROFILE_ZONE(...) Profiler::ScopedTimer PROFILE_CONCAT_(profile_zone_, __LINE__)(__VA_ARGS__)
+#define PROFILE_THREAD_NAME(name) Profiler::set_thread_name(name)
+#define PROFILE_FLOPS(flops) Profiler::add_flops(flops)
+#else
+#define PROFILE_ZONE(...) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_FLOPS(flops) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,375 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include "matrix.h"
+#include "parallel_tuning.h"
+#include "profiler.h"
+#include "simd_math.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Reductions over arrays and matrix views: sums of Op::apply(x) or
+ * Op::apply(lhs, rhs), minimum and maximum. They work on three levels:
+ *
+ *   - SIMD lanes through SimdMath::dispatch(), every lane summed with Kahan
+ *     compensation (in float for float data, so no widening is needed),
+ *   - fixed chunks of the input reduced in parallel on the shared pool
+ *     once the input reaches the Parallel::Kernel::Reduce threshold,
+ *   - the per-chunk partials combined pairwise in double.
+ *
+ * Chunk boundaries only depend on the input size, so results are the same
+ * for any number of threads. Ops follow the SimdMath::map() convention and
+ * are applied to float for bfloat16 data.
+*/
+namespace Reduce {
+
+using SimdMath::Vec;
+
+constexpr size_t CHUNK = 1 << 15;  // Elements per parallel task
+constexpr size_t MAX_CHUNKS = 256; // The partials live on the stack
+
+// Plain sum
+struct Identity {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return x; }
+};
+
+// Sum of x * factor, e.g. a mean that can not overflow
+struct Scale {
+    double factor;
+
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return x * static_cast<T>(factor); }
+};
+
+template <typename T, size_t W>
+struct KahanLanes_ {
+    Vec<T, W> sum{};
+    Vec<T, W> compensation{};
+
+    SIMD_MATH_INLINE void add(Vec<T, W> x) {
+        const Vec<T, W> y = x - compensation;
+        const Vec<T, W> t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+
+    SIMD_MATH_INLINE double total() const {
+        double result = 0.0;
+        for (size_t lane = 0; lane < W; ++lane) {
+            result += static_cast<double>(sum[lane]) - static_cast<double>(compensation[lane]);
+        }
+        return result;
+    }
+};
+
+// Zeroes the lanes from `count` on
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> head_(Vec<T, W> x, size_t count) {
+    for (size_t lane = count; lane < W; ++lane) {
+        x[lane] = T(0);
+    }
+    return x;
+}
+
+template <typename Op>
+struct SumKernel_ {
+    template <size_t Bytes, typename T>
+    static SIMD_MATH_INLINE double run(const T* in, size_t n, Op op) {
+        constexpr size_t W = Bytes / sizeof(T);
+        KahanLanes_<T, W> acc;
+        size_t i = 0;
+        for (; i + W <= n; i += W) {
+            acc.add(op.template apply<T, W>(SimdMath::load<T, W>(in + i)));
+        }
+        if (i < n) {
+            T tail[W] = {};
+            std::memcpy(tail, in + i, (n - i) * sizeof(T));
+            acc.add(head_<T, W>(op.template apply<T, W>(SimdMath::load<T, W>(tail)), n - i));
+        }
+        return acc.total();
+    }
+
+    template <size_t Bytes, typename T>
+    static SIMD_MATH_INLINE double run(const T* lhs, const T* rhs, size_t n, Op op) {
+        constexpr size_t W = Bytes / sizeof(T);
+        KahanLanes_<T, W> acc;
+        size_t i = 0;
+        for (; i + W <= n; i += W) {
+            acc.add(op.template apply<T, W>(SimdMath::load<T, W>(lhs + i), SimdMath::load<T, W>(rhs + i)));
+        }
+        if (i < n) {
+            T lhs_tail[W] = {};
+            T rhs_tail[W] = {};
+            std::memcpy(lhs_tail, lhs + i, (n - i) * sizeof(T));
+            std::memcpy(rhs_tail, rhs + i, (n - i) * sizeof(T));
+            const Vec<T, W> val = op.template apply<T, W>(SimdMath::load<T, W>(lhs_tail), SimdMath::load<T, W>(rhs_tail));
+            acc.add(head_<T, W>(val, n - i));
+        }
+        return acc.total();
+    }
+};
+
+// Minimum (IsMax = false) or maximum with the comparisons of a scalar loop started at in[0], so NaNs
+// after the first element are skipped
+template <bool IsMax>
+struct ExtremumKernel_ {
+    template <typename T, size_t W>
+    static SIMD_MATH_INLINE Vec<T, W> pick_(Vec<T, W> acc, Vec<T, W> x) {
+        return IsMax ? (acc < x ? x : acc) : (x < acc ? x : acc);
+    }
+
+    template <size_t Bytes, typename T>
+    static SIMD_MATH_INLINE T run(const T* in, size_t n) {
+        constexpr size_t W = Bytes / sizeof(T);
+        Vec<T, W> acc = SimdMath::broadcast<T, W>(in[0]);
+        size_t i = 0;
+        for (; i + W <= n; i += W) {
+            acc = pick_<T, W>(acc, SimdMath::load<T, W>(in + i));
+        }
+        if (i < n) {
+            T tail[W];
+            std::fill_n(tail, W, in[0]);
+            std::memcpy(tail, in + i, (n - i) * sizeof(T));
+            acc = pick_<T, W>(acc, SimdMath::load<T, W>(tail));
+        }
+        T result = acc[0];
+        for (size_t lane = 1; lane < W; ++lane) {
+            result = IsMax ? (result < acc[lane] ? acc[lane] : result) : (acc[lane] < result ? acc[lane] : result);
+        }
+        return result;
+    }
+};
+
+// Serial reductions of one run, bfloat16 is widened to float in blocks that fit on the stack
+template <typename Op, typename T>
+double sum_run_(const T* in, size_t n, Op op) {
+    return SimdMath::dispatch<SumKernel_<Op>>(in, n, op);
+}
+
+template <typename Op>
+double sum_run_(const bfloat16* in, size_t n, Op op) {
+    constexpr size_t block = 256;
+    float buffer[block];
+    double total = 0.0;
+    for (size_t i = 0; i < n; i += block) {
+        const size_t m = std::min(block, n - i);
+        std::copy(in + i, in + i + m, buffer);
+        total += sum_run_(buffer, m, op);
+    }
+    return total;
+}
+
+template <typename Op, typename T>
+double sum_run_(const T* lhs, const T* rhs, size_t n, Op op) {
+    return SimdMath::dispatch<SumKernel_<Op>>(lhs, rhs, n, op);
+}
+
+template <typename Op>
+double sum_run_(const bfloat16* lhs, const bfloat16* rhs, size_t n, Op op) {
+    constexpr size_t block = 256;
+    float lhs_buffer[block];
+    float rhs_buffer[block];
+    double total = 0.0;
+    for (size_t i = 0; i < n; i += block) {
+        const size_t m = std::min(block, n - i);
+        std::copy(lhs + i, lhs + i + m, lhs_buffer);
+        std::copy(rhs + i, rhs + i + m, rhs_buffer);
+        total += sum_run_(lhs_buffer, rhs_buffer, m, op);
+    }
+    return total;
+}
+
+template <bool IsMax, typename T>
+T extremum_run_(const T* in, size_t n) {
+    return SimdMath::dispatch<ExtremumKernel_<IsMax>>(in, n);
+}
+
+template <bool IsMax>
+float extremum_run_(const bfloat16* in, size_t n) {
+    constexpr size_t block = 256;
+    float buffer[block];
+    float result = in[0];
+    for (size_t i = 0; i < n; i += block) {
+        const size_t m = std::min(block, n - i);
+        std::copy(in + i, in + i + m, buffer);
+        const float val = extremum_run_<IsMax>(buffer, m);
+        result = IsMax ? (result < val ? val : result) : (val < result ? val : result);
+    }
+    return result;
+}
+
+/**
+ * Reduces n units of work in fixed chunks of about `grain` units:
+ * partial(begin, end) reduces one chunk, combine(a, b) merges two partials.
+ * Neighbouring partials are merged pairwise, level by level. The chunks run
+ * on the thread pool when the `elements` they cover reach the Reduce
+ * threshold, otherwise in order on the calling thread, with the same
+ * result. n must be positive.
+*/
+template <typename R, typename Partial, typename Combine>
+R parallel_reduce(size_t n, size_t grain, size_t elements, Partial partial, Combine combine) {
+    PROFILE_ZONE("reduce");
+    grain = std::max<size_t>(grain, 1);
+    const size_t n_chunks = std::min(MAX_CHUNKS, (n + grain - 1) / grain);
+    if (n_chunks <= 1) {
+        return partial(size_t(0), n);
+    }
+    const size_t chunk = (n + n_chunks - 1) / n_chunks;
+    R partials[MAX_CHUNKS];
+    auto reduce_chunks = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            partials[i] = partial(std::min(n, i * chunk), std::min(n, (i + 1) * chunk));
+        }
+    };
+    if (Parallel::use_pool(Parallel::Kernel::Reduce, elements)) {
+        parallel_for(0, n_chunks, reduce_chunks);
+    } else {
+        reduce_chunks(0, n_chunks);
+    }
+    for (size_t width = 1; width < n_chunks; width *= 2) {
+        for (size_t i = 0; i + width < n_chunks; i += 2 * width) {
+            partials[i] = combine(partials[i], partials[i + width]);
+        }
+    }
+    return partials[0];
+}
+
+inline double plus_(double lhs, double rhs) { return lhs + rhs; }
+
+// Sum of op(in[i]) over n elements
+template <typename Op = Identity, typename T>
+double sum(const T* in, size_t n, Op op = Op()) {
+    if (n == 0) {
+        return 0.0;
+    }
+    return parallel_reduce<double>(n, CHUNK, n, [&](size_t begin, size_t end) {
+        return sum_run_(in + begin, end - begin, op);
+    }, plus_);
+}
+
+// Sum of op(lhs[i], rhs[i]) over n elements
+template <typename Op, typename T>
+double sum(const T* lhs, const T* rhs, size_t n, Op op) {
+    if (n == 0) {
+        return 0.0;
+    }
+    return parallel_reduce<double>(n, CHUNK, n, [&](size_t begin, size_t end) {
+        return sum_run_(lhs + begin, rhs + begin, end - begin, op);
+    }, plus_);
+}
+
+// Minimum or maximum of n > 0 elements
+template <bool IsMax, typename T>
+compute_t<T> extremum(const T* in, size_t n) {
+    using C = compute_t<T>;
+    return parallel_reduce<C>(n, CHUNK, n, [&](size_t begin, size_t end) {
+        return extremum_run_<IsMax>(in + begin, end - begin);
+    }, [](C lhs, C rhs) {
+        return IsMax ? (lhs < rhs ? rhs : lhs) : (rhs < lhs ? rhs : lhs);
+    });
+}
+
+/**
+ * Reduces a view run by run: dense views (also transposes of dense storage,
+ * the order does not matter) are one run, views with unit column stride one
+ * run per row, anything else (columns, diagonals) is gathered in blocks. run(ptr, n) reduces one
+ * contiguous run and combine() merges the results. The view must not be empty.
+*/
+template <typename R, typename T, typename Run, typename Combine>
+R reduce_view_(BasicMatrixView<const T> mat, Run run, Combine combine) {
+    if ((mat.get_col_stride() != 1 && mat.get_row_stride() == 1) || (mat.get_cols() == 1 && mat.get_rows() > 1)) {
+        mat = mat.transpose();
+    }
+    const size_t rows = mat.get_rows();
+    const size_t cols = mat.get_cols();
+    if (mat.is_contiguous()) {
+        return parallel_reduce<R>(rows * cols, CHUNK, rows * cols, [&](size_t begin, size_t end) {
+            return run(mat.data() + begin, end - begin);
+        }, combine);
+    }
+    return parallel_reduce<R>(rows, CHUNK / cols, rows * cols, [&](size_t first_row, size_t last_row) {
+        R result = R();
+        for (size_t row = first_row; row < last_row; ++row) {
+            if (mat.get_col_stride() == 1) {
+                const R val = run(&mat(row, 0), cols);
+                result = row == first_row ? val : combine(result, val);
+                continue;
+            }
+            constexpr size_t block = 256;
+            T buffer[block];
+            for (size_t begin = 0; begin < cols; begin += block) {
+                const size_t m = std::min(block, cols - begin);
+                for (size_t col = 0; col < m; ++col) {
+                    buffer[col] = mat(row, begin + col);
+                }
+                const R val = run(buffer, m);
+                result = row == first_row && begin == 0 ? val : combine(result, val);
+            }
+        }
+        return result;
+    }, combine);
+}
+
+template <typename Op = Identity, typename T>
+double sum(BasicMatrixView<const T> mat, Op op = Op()) {
+    if (mat.is_empty()) {
+        return 0.0;
+    }
+    return reduce_view_<double>(mat, [&](const T* in, size_t n) { return sum_run_(in, n, op); }, plus_);
+}
+
+// Sum of op(lhs(row, col), rhs(row, col)) over two views of the same shape, laid out as in reduce_view_()
+template <typename Op, typename T>
+double sum(BasicMatrixView<const T> lhs, BasicMatrixView<const T> rhs, Op op) {
+    if (lhs.is_empty()) {
+        return 0.0;
+    }
+    const size_t rows = lhs.get_rows();
+    const size_t cols = lhs.get_cols();
+    if (lhs.is_contiguous() && rhs.is_contiguous()) {
+        return sum(lhs.data(), rhs.data(), rows * cols, op);
+    }
+    return parallel_reduce<double>(rows, CHUNK / cols, rows * cols, [&](size_t first_row, size_t last_row) {
+        double result = 0.0;
+        for (size_t row = first_row; row < last_row; ++row) {
+            if (lhs.get_col_stride() == 1 && rhs.get_col_stride() == 1) {
+                result += sum_run_(&lhs(row, 0), &rhs(row, 0), cols, op);
+                continue;
+            }
+            constexpr size_t block = 256;
+            T lhs_buffer[block];
+            T rhs_buffer[block];
+            for (size_t begin = 0; begin < cols; begin += block) {
+                const size_t m = std::min(block, cols - begin);
+                for (size_t col = 0; col < m; ++col) {
+                    lhs_buffer[col] = lhs(row, begin + col);
+                    rhs_buffer[col] = rhs(row, begin + col);
+                }
+                result += sum_run_(lhs_buffer, rhs_buffer, m, op);
+            }
+        }
+        return result;
+    }, plus_);
+}
+
+template <bool IsMax, typename T>
+compute_t<T> extremum(BasicMatrixView<const T> mat) {
+    using C = compute_t<T>;
+    return reduce_view_<C>(mat, [](const T* in, size_t n) -> C { return extremum_run_<IsMax>(in, n); }, [](C lhs, C rhs) {
+        return IsMax ? (lhs < rhs ? rhs : lhs) : (rhs < lhs ? rhs : lhs);
+    });
+}
+
+template <typename T>
+compute_t<T> min(BasicMatrixView<const T> mat) { return extremum<false>(mat); }
+
+template <typename T>
+compute_t<T> max(BasicMatrixView<const T> mat) { return extremum<true>(mat); }
+
+} // namespace Reduce
+
+#endif // REDUCE_H
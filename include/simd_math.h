@@ -0,0 +1,431 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include "bfloat16.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_MATH_X86 1
+#endif
+
+/**
+ * Vectorized elementary functions written with GCC vector extensions, so a
+ * single template serves every SIMD width. They are force-inlined into
+ * kernels compiled with target("avx2,fma") or target("avx512f") (see
+ * transform() at the end) and lowered to that instruction set there;
+ * active_isa() tells which of those kernels this CPU can run.
+ *
+ * exp(x) = 2^n * e^r with n = round(x / ln 2) and |r| <= ln 2 / 2 (Cody-Waite
+ * reduction with ln 2 split in two parts). e^r - 1 is the Taylor polynomial
+ * of degree 13 (double) or 7 (float), whose truncation error is below
+ * 0.1 ULP, evaluated with Horner's scheme. Maximum errors measured against
+ * long double references over the whole finite range (activation_unittest
+ * checks these bounds, benchmarks/activation_benchmark.cpp prints them):
+ *
+ *                  double     float
+ *   exp            1.0 ULP    1.1 ULP
+ *   expm1          1.8 ULP    1.6 ULP
+ *   sigmoid        2.3 ULP    2.4 ULP
+ *   tanh           2.5 ULP    2.3 ULP
+ *
+ * log(x) = e ln 2 + log(m) with x = 2^e m and m in [sqrt(1/2), sqrt(2)),
+ * where log(m) = 2 atanh(s), s = (m - 1) / (m + 1), is an odd series in s
+ * of degree 21 (double) or 9 (float). log1p(x) corrects the rounding of
+ * 1 + x, so it stays accurate for tiny x:
+ *
+ *   log            1.0 ULP    0.9 ULP
+ *   log1p          2.4 ULP    2.4 ULP
+ *
+ * exp overflows to +inf like std::exp, but results below ~1e-307 (double)
+ * or ~1e-37 (float) are flushed to zero instead of going subnormal. NaNs
+ * propagate.
+*/
+// Everything operating on Vec must be force-inlined into the target-specific kernel (Op::apply too),
+// an out-of-line copy would be compiled for the baseline ISA with a different calling convention
+#define SIMD_MATH_INLINE inline __attribute__((always_inline))
+
+namespace SimdMath {
+
+enum class Isa { Generic, Avx2, Avx512 };
+
+template <typename T, size_t Width>
+struct VecOf {
+    typedef T type __attribute__((vector_size(Width * sizeof(T))));
+};
+
+// Width lanes of T
+template <typename T, size_t Width>
+using Vec = typename VecOf<T, Width>::type;
+
+template <typename T>
+struct Traits;
+
+template <>
+struct Traits<double> {
+    using Int = int64_t;
+    static constexpr int mantissa_bits = 52;
+    static constexpr int degree = 13;
+    static constexpr int log_degree = 10;
+    static constexpr double round_magic = 6755399441055744.0; // 1.5 * 2^52, adding it rounds to an integer
+    static constexpr double log2e = 1.44269504088896340736;
+    static constexpr double ln2_hi = 0.693147180369123816490;
+    static constexpr double ln2_lo = 1.90821492927058770002e-10;
+    static constexpr double exp_max = 709.782712893383973096;  // ln(DBL_MAX)
+    static constexpr double exp_min = -707.0;
+    static constexpr double tanh_saturation = 20.0;            // tanh(20) rounds to 1
+};
+
+template <>
+struct Traits<float> {
+    using Int = int32_t;
+    static constexpr int mantissa_bits = 23;
+    static constexpr int degree = 7;
+    static constexpr int log_degree = 4;
+    static constexpr float round_magic = 12582912.0f;          // 1.5 * 2^23
+    static constexpr float log2e = 1.44269504088896340736f;
+    static constexpr float ln2_hi = 0.693359375f;
+    static constexpr float ln2_lo = -2.12194440e-4f;
+    static constexpr float exp_max = 88.7228317f;              // ln(FLT_MAX)
+    static constexpr float exp_min = -86.0f;
+    static constexpr float tanh_saturation = 9.0f;
+};
+
+inline Isa detect_isa_() {
+#ifdef SIMD_MATH_X86
+    if (__builtin_cpu_supports("avx512f")) {
+        return Isa::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Isa::Avx2;
+    }
+#endif
+    return Isa::Generic;
+}
+
+inline std::atomic<Isa>& isa_() {
+    static std::atomic<Isa> isa(detect_isa_());
+    return isa;
+}
+
+// Widest instruction set the kernels use on this machine
+inline Isa active_isa() { return isa_().load(std::memory_order_relaxed); }
+
+// Restricts the kernels to a narrower instruction set (for testing and benchmarks), wider ones are ignored
+inline void set_isa(Isa isa) {
+    isa_().store(static_cast<int>(isa) < static_cast<int>(detect_isa_()) ? isa : detect_isa_());
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> broadcast(T val) {
+    Vec<T, W> v;
+    for (size_t i = 0; i < W; ++i) {
+        v[i] = val;
+    }
+    return v;
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> load(const T* src) {
+    Vec<T, W> v;
+    std::memcpy(&v, src, sizeof(v));
+    return v;
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE void store(T* dst, Vec<T, W> v) {
+    std::memcpy(dst, &v, sizeof(v));
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> max(Vec<T, W> a, Vec<T, W> b) {
+    return a > b ? a : b;
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> abs(Vec<T, W> x) {
+    using Int = typename Traits<T>::Int;
+    return (Vec<T, W>)((Vec<Int, W>)x & std::numeric_limits<Int>::max());
+}
+
+// |magnitude| with the sign of sign (also for -0.0)
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> copysign(Vec<T, W> magnitude, Vec<T, W> sign) {
+    using I = Vec<typename Traits<T>::Int, W>;
+    const typename Traits<T>::Int mask = std::numeric_limits<typename Traits<T>::Int>::max();
+    return (Vec<T, W>)(((I)magnitude & mask) | ((I)sign & ~mask));
+}
+
+// 1 / k! for the Taylor polynomial of e^r - 1
+template <typename T>
+struct TaylorCoefficients {
+    T values[Traits<T>::degree + 1] = {};
+
+    constexpr TaylorCoefficients() {
+        T factorial = 1;
+        for (int k = 1; k <= Traits<T>::degree; ++k) {
+            factorial *= k;
+            values[k] = T(1) / factorial;
+        }
+    }
+};
+
+// e^r - 1 for |r| <= ln 2 / 2
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> expm1_reduced_(Vec<T, W> r) {
+    constexpr int degree = Traits<T>::degree;
+    constexpr TaylorCoefficients<T> coefficients;
+    Vec<T, W> p = broadcast<T, W>(coefficients.values[degree]);
+    for (int k = degree - 1; k >= 2; --k) {
+        p = p * r + coefficients.values[k];
+    }
+    return r + r * r * p;
+}
+
+// Splits x = n * ln 2 + r, returning r and setting k to n + round_magic (n sits in the low mantissa bits)
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> reduce_(Vec<T, W> x, Vec<T, W>& k) {
+    using Tr = Traits<T>;
+    k = x * Tr::log2e + Tr::round_magic;
+    const Vec<T, W> n = k - Tr::round_magic;
+    return (x - n * Tr::ln2_hi) - n * Tr::ln2_lo;
+}
+
+// 2^(n + offset) for k as returned by reduce_()
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> pow2_(Vec<T, W> k, typename Traits<T>::Int offset) {
+    using Tr = Traits<T>;
+    using I = Vec<typename Tr::Int, W>;
+    const I n = (I)k - (I)broadcast<T, W>(Tr::round_magic);
+    return (Vec<T, W>)((n + offset) << Tr::mantissa_bits);
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> exp(Vec<T, W> x) {
+    using Tr = Traits<T>;
+    using I = Vec<typename Tr::Int, W>;
+    const Vec<T, W> clamped = x > Tr::exp_max ? Tr::exp_max : (x < Tr::exp_min ? Tr::exp_min : x);
+    Vec<T, W> k;
+    const Vec<T, W> p = expm1_reduced_<T, W>(reduce_<T, W>(clamped, k)) + T(1);
+    // 2^(n - 1) * p * 2 keeps the scale finite for n = max exponent + 1
+    const I n = (I)k - (I)broadcast<T, W>(Tr::round_magic);
+    Vec<T, W> result = (Vec<T, W>)((I)p + ((n - 1) << Tr::mantissa_bits)) * T(2);
+    result = x > Tr::exp_max ? std::numeric_limits<T>::infinity() : result;
+    result = x < Tr::exp_min ? T(0) : result;
+    return x != x ? x : result;
+}
+
+// e^x - 1 without cancellation near 0, for x in [exp_min, exp_max - 1]
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> expm1(Vec<T, W> x) {
+    Vec<T, W> k;
+    const Vec<T, W> q = expm1_reduced_<T, W>(reduce_<T, W>(x, k));
+    const Vec<T, W> scale = pow2_<T, W>(k, std::numeric_limits<T>::max_exponent - 1);
+    // 2^n * (e^r - 1) + (2^n - 1), exact for n = 0
+    return scale * q + (scale - T(1));
+}
+
+// 1 / (2k + 1) for the series of atanh
+template <typename T>
+struct AtanhCoefficients {
+    T values[Traits<T>::log_degree + 1] = {};
+
+    constexpr AtanhCoefficients() {
+        for (int k = 0; k <= Traits<T>::log_degree; ++k) {
+            values[k] = T(1) / T(2 * k + 1);
+        }
+    }
+};
+
+// Natural logarithm of positive normal finite numbers (no checks for zero, negatives, infinities or NaNs)
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> log(Vec<T, W> x) {
+    using Tr = Traits<T>;
+    using Int = typename Tr::Int;
+    using I = Vec<Int, W>;
+    constexpr Int exponent_bias = std::numeric_limits<T>::max_exponent - 1;
+    constexpr Int mantissa_mask = (Int(1) << Tr::mantissa_bits) - 1;
+    constexpr T sqrt2 = T(1.41421356237309504880);
+
+    // x = 2^e * m with m in [1, 2), then m is halved when above sqrt(2)
+    const I bits = (I)x;
+    I e = (bits >> Tr::mantissa_bits) - exponent_bias;
+    Vec<T, W> m = (Vec<T, W>)((bits & mantissa_mask) | (exponent_bias << Tr::mantissa_bits));
+    const I halve = (I)(m > sqrt2);
+    m = halve ? m * T(0.5) : m;
+    e -= halve; // Comparisons give -1 for true lanes
+
+    const Vec<T, W> f = m - T(1);
+    const Vec<T, W> s = f / (f + T(2));
+    const Vec<T, W> z = s * s;
+    constexpr AtanhCoefficients<T> coefficients;
+    Vec<T, W> p = broadcast<T, W>(coefficients.values[Tr::log_degree]);
+    for (int k = Tr::log_degree - 1; k >= 1; --k) {
+        p = p * z + coefficients.values[k];
+    }
+    // log(m) = 2s + 2s z p = f - s (f - 2 z p), which keeps the leading term exact
+    const Vec<T, W> log_m = f - s * (f - T(2) * z * p);
+
+    // e converted exactly through the round_magic trick
+    const Vec<T, W> n = (Vec<T, W>)((I)broadcast<T, W>(Tr::round_magic) + e) - Tr::round_magic;
+    return n * Tr::ln2_hi + (log_m + n * Tr::ln2_lo);
+}
+
+// log(1 + x) for x > -1 with 1 + x normal and finite
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> log1p(Vec<T, W> x) {
+    const Vec<T, W> u = x + T(1);
+    // log(u) * x / (u - 1) cancels the rounding error of u, and u == 1 means log1p(x) rounds to x
+    const Vec<T, W> d = u - T(1);
+    const Vec<T, W> safe_d = d == T(0) ? T(1) : d;
+    return d == T(0) ? x : log<T, W>(u) * (x / safe_d);
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> sigmoid(Vec<T, W> x) {
+    return T(1) / (T(1) + exp<T, W>(-x));
+}
+
+template <typename T, size_t W>
+SIMD_MATH_INLINE Vec<T, W> tanh(Vec<T, W> x) {
+    using Tr = Traits<T>;
+    // tanh(|x|) = expm1(2|x|) / (expm1(2|x|) + 2), then the sign of x is restored
+    Vec<T, W> a = abs<T, W>(x);
+    a = a > Tr::tanh_saturation ? Tr::tanh_saturation : a;
+    const Vec<T, W> e = expm1<T, W>(a + a);
+    const Vec<T, W> t = e / (e + T(2));
+    return copysign<T, W>(t, x);
+}
+
+/**
+ * out[i] = Op::apply(in[i]) over n elements, W lanes at a time. The tail is
+ * run through a zero-padded vector, so every element gets the same rounding.
+ * in and out may be the same array.
+*/
+template <typename T, size_t W, typename Op>
+SIMD_MATH_INLINE void map(const T* in, T* out, size_t n, const Op& op) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        store<T, W>(out + i, op.template apply<T, W>(load<T, W>(in + i)));
+    }
+    if (i < n) {
+        T tail[W] = {};
+        std::memcpy(tail, in + i, (n - i) * sizeof(T));
+        store<T, W>(tail, op.template apply<T, W>(load<T, W>(tail)));
+        std::memcpy(out + i, tail, (n - i) * sizeof(T));
+    }
+}
+
+// Same for binary operations: out[i] = Op::apply(lhs[i], rhs[i])
+template <typename T, size_t W, typename Op>
+SIMD_MATH_INLINE void map(const T* lhs, const T* rhs, T* out, size_t n, const Op& op) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        store<T, W>(out + i, op.template apply<T, W>(load<T, W>(lhs + i), load<T, W>(rhs + i)));
+    }
+    if (i < n) {
+        T lhs_tail[W] = {};
+        T rhs_tail[W] = {};
+        std::memcpy(lhs_tail, lhs + i, (n - i) * sizeof(T));
+        std::memcpy(rhs_tail, rhs + i, (n - i) * sizeof(T));
+        store<T, W>(lhs_tail, op.template apply<T, W>(load<T, W>(lhs_tail), load<T, W>(rhs_tail)));
+        std::memcpy(out + i, lhs_tail, (n - i) * sizeof(T));
+    }
+}
+
+#ifdef SIMD_MATH_X86
+template <typename Kernel, typename... Args>
+__attribute__((target("avx512f")))
+auto dispatch_avx512_(Args... args) {
+    return Kernel::template run<64>(args...);
+}
+
+template <typename Kernel, typename... Args>
+__attribute__((target("avx2,fma")))
+auto dispatch_avx2_(Args... args) {
+    return Kernel::template run<32>(args...);
+}
+#endif
+
+/**
+ * Calls Kernel::run<Bytes>(args...) compiled for the widest instruction set
+ * of active_isa(), Bytes being the vector size to use (64, 32 or 16). run()
+ * must be SIMD_MATH_INLINE, otherwise it is compiled for the baseline ISA.
+*/
+template <typename Kernel, typename... Args>
+auto dispatch(Args... args) {
+#ifdef SIMD_MATH_X86
+    switch (active_isa()) {
+        case Isa::Avx512:
+            return dispatch_avx512_<Kernel>(args...);
+        case Isa::Avx2:
+            return dispatch_avx2_<Kernel>(args...);
+        default:
+            break;
+    }
+#endif
+    return Kernel::template run<16>(args...);
+}
+
+template <typename Op>
+struct TransformKernel_ {
+    template <size_t Bytes, typename T>
+    static SIMD_MATH_INLINE void run(const T* in, T* out, size_t n) {
+        map<T, Bytes / sizeof(T)>(in, out, n, Op());
+    }
+
+    template <size_t Bytes, typename T>
+    static SIMD_MATH_INLINE void run(const T* lhs, const T* rhs, T* out, size_t n) {
+        map<T, Bytes / sizeof(T)>(lhs, rhs, out, n, Op());
+    }
+};
+
+/**
+ * out[i] = Op::apply(in[i]) or Op::apply(lhs[i], rhs[i]) over n elements
+ * through dispatch(). bfloat16 arrays are widened to float in blocks that fit
+ * on the stack.
+*/
+template <typename Op, typename T>
+void transform(const T* in, T* out, size_t n) {
+    dispatch<TransformKernel_<Op>>(in, out, n);
+}
+
+template <typename Op, typename T>
+void transform(const T* lhs, const T* rhs, T* out, size_t n) {
+    dispatch<TransformKernel_<Op>>(lhs, rhs, out, n);
+}
+
+template <typename Op>
+void transform(const bfloat16* in, bfloat16* out, size_t n) {
+    constexpr size_t block = 256;
+    float buffer[block];
+    for (size_t i = 0; i < n; i += block) {
+        const size_t m = std::min(block, n - i);
+        std::copy(in + i, in + i + m, buffer);
+        transform<Op>(buffer, buffer, m);
+        std::copy(buffer, buffer + m, out + i);
+    }
+}
+
+template <typename Op>
+void transform(const bfloat16* lhs, const bfloat16* rhs, bfloat16* out, size_t n) {
+    constexpr size_t block = 256;
+    float lhs_buffer[block];
+    float rhs_buffer[block];
+    for (size_t i = 0; i < n; i += block) {
+        const size_t m = std::min(block, n - i);
+        std::copy(lhs + i, lhs + i + m, lhs_buffer);
+        std::copy(rhs + i, rhs + i + m, rhs_buffer);
+        transform<Op>(lhs_buffer, rhs_buffer, lhs_buffer, m);
+        std::copy(lhs_buffer, lhs_buffer + m, out + i);
+    }
+}
+
+} // namespace SimdMath
+
+#endif // SIMD_MATH_H
@@ -0,0 +1,147 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using std::vector;
+
+/**
+ * Non-owning reference to a callable, the counterpart of std::function for
+ * callbacks that are only invoked while the call they are passed to runs.
+ * It is two pointers and never allocates; the callable must outlive it.
+*/
+template <typename Signature>
+class FunctionRef;
+
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+public:
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, FunctionRef> &&
+                                                      std::is_invocable_r_v<R, F&, Args...>>>
+    FunctionRef(F&& fn)
+        : object_(const_cast<void*>(static_cast<const void*>(&fn))), call_(&invoke_<std::remove_reference_t<F>>) {}
+
+    R operator()(Args... args) const { return call_(object_, std::forward<Args>(args)...); }
+
+private:
+    template <typename F>
+    static R invoke_(void* object, Args... args) { return (*static_cast<F*>(object))(std::forward<Args>(args)...); }
+
+    void* object_;
+    R (*call_)(void*, Args...);
+};
+
+/**
+ * Persistent work-stealing thread pool.
+ *
+ * Every worker owns a task deque: it pops its own work from the back and,
+ * when empty, steals from the front of the other workers' deques. Tasks
+ * submitted from outside the pool are distributed round-robin.
+ *
+ * parallel_for() does not allocate: its state lives in job slots created
+ * with the pool, and the workers are asked to help through fixed-size ring
+ * buffers next to the deques. When every slot is taken, e.g. by deeply
+ * nested calls, the range simply runs on the calling thread.
+ *
+ * A single process-wide instance (ThreadPool::instance()) is shared by all
+ * parallel kernels of the library. Its size and thread pinning can be
+ * changed with ThreadPool::configure() before heavy work starts.
+*/
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+    using RangeFunction = FunctionRef<void(size_t, size_t)>;
+
+    explicit ThreadPool(size_t n_threads = 0, bool pin_threads = false); // 0 -> hardware_concurrency()
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    void submit(Task task);
+
+    /**
+     * Calls fn(chunk_begin, chunk_end) over [begin, end) split into chunks of
+     * at least `grain` elements. The calling thread takes part in the work, so
+     * nested calls can not deadlock. Ranges not larger than `grain` run inline
+     * without touching the pool. The first exception thrown by fn is rethrown.
+    */
+    void parallel_for(size_t begin, size_t end, RangeFunction fn, size_t grain = 1);
+
+    size_t size() const { return workers_.size() + 1; } // Workers plus the calling thread
+    bool pinned() const { return pin_threads_; }
+
+    static ThreadPool& instance();
+    static void configure(size_t n_threads, bool pin_threads = false); // Not safe while the pool is in use
+
+private:
+    // State of one parallel_for() call, reused by the following ones
+    struct Job {
+        std::atomic<bool> claimed{false};
+        std::atomic<uint64_t> state{0};     // Generation << 32 | helpers inside the job
+        const RangeFunction* fn = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t chunk = 0;
+        size_t n_chunks = 0;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    // Request to help with a job, ignored once the job has moved on to another generation
+    struct JobRef {
+        size_t job;
+        uint32_t generation;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        vector<JobRef> jobs;    // Ring buffer, allocated with the pool
+        size_t jobs_head = 0;
+        size_t jobs_count = 0;
+    };
+
+    // What a worker took from a queue: a job to help with, or a task when `task` is set
+    struct Work {
+        JobRef job{ 0, 0 };
+        Task task;
+    };
+
+    void worker_loop_(size_t index);
+    bool try_pop_(size_t index, Work& work);
+    bool try_steal_(size_t thief, Work& work);
+    bool push_job_(const JobRef& ref);
+    void help_(const JobRef& ref);
+    void run_chunks_(Job& job);
+    void pin_to_cpu_(std::thread& thread, size_t cpu);
+
+    vector<std::thread> workers_;
+    vector<std::unique_ptr<WorkQueue>> queues_;
+    vector<std::unique_ptr<Job>> jobs_;
+    std::atomic<size_t> next_queue_;
+    std::atomic<size_t> pending_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+    bool pin_threads_;
+};
+
+// Convenience wrapper over ThreadPool::instance().parallel_for()
+void parallel_for(size_t begin, size_t end, ThreadPool::RangeFunction fn, size_t grain = 1);
+
+#endif // THREAD_POOL_H
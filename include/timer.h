@@ -18,6 +18,8 @@ public:
     long long get_microseconds();
     long long get_nanoseconds();
 
+    high_resolution_clock::time_point get_start_time() const { return start_time_; }
+
 private:
     high_resolution_clock::time_point start_time_;
     high_resolution_clock::time_point end_time_;
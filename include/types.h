@@ -7,6 +7,7 @@ enum class LossFunction { MSE, MAE, BinaryCrossEntropy, CategoricalCrossEntropy
 enum class ActivationFunction { ReLU, Tanh, Softmax, Sigmoid };
 enum class TaskType { Classification, Regression };
 enum class LayerType { Hidden, Output };
+enum class NumericPolicy { Checked, Fast, DebugOnly };
     
 }
 
@@ -1,5 +1,180 @@
 #include "activation.h"
+#include "aligned_allocator.h"
+#include "simd_math.h"
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using SimdMath::Vec;
+
+namespace {
+
+// Element-wise operations for SimdMath::map(), one per kernel
+struct ReluOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return x > T(0) ? x : T(0); }
+};
+
+struct ReluDerivativeOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return x > T(0) ? T(1) : T(0); }
+};
+
+struct SigmoidOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return SimdMath::sigmoid<T, W>(x); }
+};
+
+// s(x) (1 - s(x)) = e / (1 + e)^2 with e = exp(-|x|), which avoids the cancellation in 1 - s(x)
+struct SigmoidDerivativeOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const {
+        const Vec<T, W> e = SimdMath::exp<T, W>(-SimdMath::abs<T, W>(x));
+        const Vec<T, W> d = T(1) + e;
+        return e / (d * d);
+    }
+};
+
+struct TanhOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return SimdMath::tanh<T, W>(x); }
+};
+
+// 1 - tanh(x)^2 = 4u / (1 + u)^2 with u = exp(-2|x|), same reason
+struct TanhDerivativeOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const {
+        const Vec<T, W> a = SimdMath::abs<T, W>(x);
+        const Vec<T, W> u = SimdMath::exp<T, W>(-(a + a));
+        const Vec<T, W> d = T(1) + u;
+        return T(4) * u / (d * d);
+    }
+};
+
+struct ExpOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return SimdMath::exp<T, W>(x); }
+};
+
+// Backward operations dZ = dA * f'(Z) with the derivative written in terms of the output A = f(Z)
+struct ReluBackwardOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> dA, Vec<T, W> A) const { return A > T(0) ? dA : T(0); }
+};
+
+struct SigmoidBackwardOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> dA, Vec<T, W> A) const { return dA * (A * (T(1) - A)); }
+};
+
+struct TanhBackwardOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> dA, Vec<T, W> A) const { return dA * (T(1) - A * A); }
+};
+
+template <typename T>
+using ColumnBuffer = std::vector<compute_t<T>, AlignedAllocator<compute_t<T>>>;
+
+template <typename T>
+using Kernel = void (*)(const T*, T*, size_t);
+
+// Runs an array kernel over a view row by row, rows of transposed views are gathered into a buffer first
+template <typename T>
+void apply_(Kernel<T> kernel, BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    if (in.get_rows() != out.get_rows() || in.get_cols() != out.get_cols()) {
+        throw std::invalid_argument("Activation output has the wrong shape!");
+    }
+    if (in.is_empty()) {
+        return;
+    }
+    const size_t rows = in.get_rows();
+    const size_t cols = in.get_cols();
+    if (in.is_contiguous() && out.is_contiguous()) {
+        kernel(in.data(), out.data(), rows * cols);
+        return;
+    }
+    if (in.get_col_stride() == 1 && out.get_col_stride() == 1) {
+        for (size_t row = 0; row < rows; ++row) {
+            kernel(&in(row, 0), &out(row, 0), cols);
+        }
+        return;
+    }
+    static thread_local std::vector<T, AlignedAllocator<T>> buffer;
+    buffer.resize(cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            buffer[col] = in(row, col);
+        }
+        kernel(buffer.data(), buffer.data(), cols);
+        for (size_t col = 0; col < cols; ++col) {
+            out(row, col) = buffer[col];
+        }
+    }
+}
+
+// Owned matrices are dense, so the kernel runs over the whole buffer at once
+template <typename T>
+void apply_(Kernel<T> kernel, const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    if (out.get_rows() != mat.get_rows() || out.get_cols() != mat.get_cols()) {
+        out = BasicMatrix<T>(mat.get_rows(), mat.get_cols());
+    }
+    kernel(mat.data(), out.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+using BackwardKernel = void (*)(const T*, const T*, T*, size_t);
+
+// Same for the backward kernels dZ = g(dA, A)
+template <typename T>
+void apply_(BackwardKernel<T> kernel, BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ) {
+    if (dA.get_rows() != A.get_rows() || dA.get_cols() != A.get_cols() ||
+        dZ.get_rows() != A.get_rows() || dZ.get_cols() != A.get_cols()) {
+        throw std::invalid_argument("Activation gradients have the wrong shape!");
+    }
+    if (A.is_empty()) {
+        return;
+    }
+    const size_t rows = A.get_rows();
+    const size_t cols = A.get_cols();
+    if (dA.is_contiguous() && A.is_contiguous() && dZ.is_contiguous()) {
+        kernel(dA.data(), A.data(), dZ.data(), rows * cols);
+        return;
+    }
+    if (dA.get_col_stride() == 1 && A.get_col_stride() == 1 && dZ.get_col_stride() == 1) {
+        for (size_t row = 0; row < rows; ++row) {
+            kernel(&dA(row, 0), &A(row, 0), &dZ(row, 0), cols);
+        }
+        return;
+    }
+    static thread_local std::vector<T, AlignedAllocator<T>> dA_buffer;
+    static thread_local std::vector<T, AlignedAllocator<T>> A_buffer;
+    dA_buffer.resize(cols);
+    A_buffer.resize(cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            dA_buffer[col] = dA(row, col);
+            A_buffer[col] = A(row, col);
+        }
+        kernel(dA_buffer.data(), A_buffer.data(), dA_buffer.data(), cols);
+        for (size_t col = 0; col < cols; ++col) {
+            dZ(row, col) = dA_buffer[col];
+        }
+    }
+}
+
+template <typename T>
+void apply_(BackwardKernel<T> kernel, const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ) {
+    if (dA.get_rows() != A.get_rows() || dA.get_cols() != A.get_cols()) {
+        throw std::invalid_argument("Activation gradients have the wrong shape!");
+    }
+    if (dZ.get_rows() != A.get_rows() || dZ.get_cols() != A.get_cols()) {
+        dZ = BasicMatrix<T>(A.get_rows(), A.get_cols());
+    }
+    kernel(dA.data(), A.data(), dZ.data(), A.get_rows() * A.get_stride());
+}
+
+}
 
 namespace Activation {
 
@@ -7,13 +182,34 @@ double relu(double x) {
     return x > 0 ? x : 0;
 }
 
-Matrix relu(const Matrix& mat) {
-    Matrix result(mat.get_rows(), mat.get_cols());
-    for (size_t row = 0; row < result.get_rows(); ++row) {
-        for (size_t col = 0; col < result.get_cols(); ++col) {
-            result[row][col] = relu(mat[row][col]);
-        }
-    }
+float relu(float x) {
+    return x > 0 ? x : 0;
+}
+
+template <typename T>
+void relu(const T* in, T* out, size_t n) {
+    SimdMath::transform<ReluOp>(in, out, n);
+}
+
+template <typename T>
+void relu(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    apply_(relu<T>, in, out);
+}
+
+template <typename T>
+void relu(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    apply_(relu<T>, mat, out);
+}
+
+template <typename T>
+void relu_(BasicMatrix<T>& mat) {
+    relu(mat.data(), mat.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+BasicMatrix<T> relu(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result(mat.get_rows(), mat.get_cols());
+    relu(mat, result);
     return result;
 }
 
@@ -21,70 +217,260 @@ double relu_derivative(double x) {
     return x > 0.0 ? 1.0 : 0.0;
 }
 
-Matrix relu_derivative(const Matrix& mat) {
-    Matrix result(mat.get_rows(), mat.get_cols());
-    for (size_t row = 0; row < result.get_rows(); ++row) {
-        for (size_t col = 0; col < result.get_cols(); ++col) {
-            result[row][col] = mat[row][col] > 0.0 ? 1.0 : 0.0;
-        }
-    }
+float relu_derivative(float x) {
+    return x > 0.0f ? 1.0f : 0.0f;
+}
+
+template <typename T>
+void relu_derivative(const T* in, T* out, size_t n) {
+    SimdMath::transform<ReluDerivativeOp>(in, out, n);
+}
+
+template <typename T>
+void relu_derivative(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    apply_(relu_derivative<T>, in, out);
+}
+
+template <typename T>
+void relu_derivative(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    apply_(relu_derivative<T>, mat, out);
+}
+
+template <typename T>
+void relu_derivative_(BasicMatrix<T>& mat) {
+    relu_derivative(mat.data(), mat.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+BasicMatrix<T> relu_derivative(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result(mat.get_rows(), mat.get_cols());
+    relu_derivative(mat, result);
     return result;
 }
 
-Matrix softmax(const Matrix& mat) {
-    if (mat.get_rows() == 0 || mat.get_cols() == 0) {
-        throw std::domain_error("Softmax input cannot be empty!");
+template <typename T>
+void relu_backward(const T* dA, const T* A, T* dZ, size_t n) {
+    SimdMath::transform<ReluBackwardOp>(dA, A, dZ, n);
+}
+
+template <typename T>
+void relu_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ) {
+    apply_(relu_backward<T>, dA, A, dZ);
+}
+
+template <typename T>
+void relu_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ) {
+    apply_(relu_backward<T>, dA, A, dZ);
+}
+
+template <typename T>
+BasicMatrix<T> relu_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A) {
+    BasicMatrix<T> result(A.get_rows(), A.get_cols());
+    relu_backward(dA, A, result);
+    return result;
+}
+
+template <typename T>
+void softmax(const T* in, T* out, size_t n) {
+    using C = compute_t<T>;
+    if (n == 0) {
+        return;
+    }
+    // Subtract max_val to prevent numerical overflow (it makes all exponents <= 0)
+    // Softmax depends only on relative differences, not on absolute values
+    C max_val = in[0];
+    for (size_t i = 1; i < n; ++i) {
+        max_val = std::max(max_val, static_cast<C>(in[i]));
+    }
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<C>(in[i]) - max_val;
+    }
+    SimdMath::transform<ExpOp>(out, out, n);
+    C sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<C>(out[i]);
     }
+    const C inv_sum = C(1) / sum;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<C>(out[i]) * inv_sum;
+    }
+}
 
-    Matrix result(mat.get_rows(), mat.get_cols());
+template <typename T>
+void softmax(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    using C = compute_t<T>;
+    if (in.get_rows() != out.get_rows() || in.get_cols() != out.get_cols()) {
+        throw std::invalid_argument("Softmax output has the wrong shape!");
+    }
+    if (in.is_empty()) {
+        return;
+    }
+    const size_t rows = in.get_rows();
+    const size_t cols = in.get_cols();
 
-    // Single vector case (1xN or Nx1)
-    if (mat.get_rows() == 1 || mat.get_cols() == 1) {
-        
-        // Find maximal value
-        double max_val = mat[0][0];
-        for (size_t row = 0; row < mat.get_rows(); ++row) {
-            for (size_t col = 0; col < mat.get_cols(); ++col) {
-                max_val = std::max(max_val, mat[row][col]);
+    if (in.get_col_stride() != 1 || out.get_col_stride() != 1) {
+        // Columns are contiguous (e.g. transposed views), so every column is one vector
+        for (size_t col = 0; col < cols; ++col) {
+            C max_val = in(0, col);
+            for (size_t row = 1; row < rows; ++row) {
+                max_val = std::max(max_val, static_cast<C>(in(row, col)));
             }
-        }
-
-        double sum = 0.0;
-        for (size_t row = 0; row < mat.get_rows(); ++row) {
-            for (size_t col = 0; col < mat.get_cols(); ++col) {
-                // Subtract max_val to prevent numerical overflow (it makes all exponents <= 0)
-                // Softmax depends only on relative differences, not on absolute values
-                result[row][col] = std::exp(mat[row][col] - max_val);
-                sum += result[row][col];
+            C sum = 0.0;
+            for (size_t row = 0; row < rows; ++row) {
+                const C e = std::exp(static_cast<C>(in(row, col)) - max_val);
+                out(row, col) = e;
+                sum += e;
+            }
+            for (size_t row = 0; row < rows; ++row) {
+                out(row, col) = static_cast<C>(out(row, col)) / sum;
             }
         }
+        return;
+    }
 
-        for (size_t row = 0; row < mat.get_rows(); ++row) {
-            for (size_t col = 0; col < mat.get_cols(); ++col) {
-                result[row][col] /= sum;
-            }
+    // Sweep whole rows so the exponentials run through the vector kernel, with per-column
+    // maxima and sums kept in reusable buffers (no allocation in steady state)
+    static thread_local ColumnBuffer<T> max_vals;
+    static thread_local ColumnBuffer<T> sums;
+    max_vals.assign(&in(0, 0), &in(0, 0) + cols);
+    sums.assign(cols, C(0));
+    for (size_t row = 1; row < rows; ++row) {
+        const T* in_row = &in(row, 0);
+        for (size_t col = 0; col < cols; ++col) {
+            max_vals[col] = std::max(max_vals[col], static_cast<C>(in_row[col]));
         }
-    } else { // Batch case (apply column-wise softmax)
-        for (size_t col = 0; col < mat.get_cols(); ++col) {
-            double max_val = mat[0][col];
-            for (size_t row = 1; row < mat.get_rows(); ++row) {
-                max_val = std::max(max_val, mat[row][col]);
-            }
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        const T* in_row = &in(row, 0);
+        T* out_row = &out(row, 0);
+        for (size_t col = 0; col < cols; ++col) {
+            out_row[col] = static_cast<C>(in_row[col]) - max_vals[col];
+        }
+        SimdMath::transform<ExpOp>(out_row, out_row, cols);
+        for (size_t col = 0; col < cols; ++col) {
+            sums[col] += static_cast<C>(out_row[col]);
+        }
+    }
+    for (size_t col = 0; col < cols; ++col) {
+        sums[col] = C(1) / sums[col];
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        T* out_row = &out(row, 0);
+        for (size_t col = 0; col < cols; ++col) {
+            out_row[col] = static_cast<C>(out_row[col]) * sums[col];
+        }
+    }
+}
 
-            double sum = 0.0;
-            for (size_t row = 0; row < mat.get_rows(); ++row) {
-                // Subtract max_val to prevent numerical overflow (it makes all exponents <= 0)
-                // Softmax depends only on relative differences, not on absolute values
-                result[row][col] = std::exp(mat[row][col] - max_val);
-                sum += result[row][col];
-            }
+template <typename T>
+void softmax(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    if (mat.get_rows() == 0 || mat.get_cols() == 0) {
+        throw std::domain_error("Softmax input cannot be empty!");
+    }
+    if (out.get_rows() != mat.get_rows() || out.get_cols() != mat.get_cols()) {
+        out = BasicMatrix<T>(mat.get_rows(), mat.get_cols());
+    }
+
+    if (mat.get_rows() == 1 || mat.get_cols() == 1) {
+        // Single vector case (1xN or Nx1)
+        softmax(mat.data(), out.data(), mat.get_rows() * mat.get_cols());
+    } else {
+        // Batch case (apply column-wise softmax)
+        softmax(mat.view(), out.view());
+    }
+}
+
+template <typename T>
+void softmax_(BasicMatrix<T>& mat) {
+    softmax(mat, mat);
+}
+
+template <typename T>
+BasicMatrix<T> softmax(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result;
+    softmax(mat, result);
+    return result;
+}
 
-            for (size_t row = 0; row < mat.get_rows(); ++row) {
-                result[row][col] /= sum;
+template <typename T>
+void softmax_backward(const T* dA, const T* A, T* dZ, size_t n) {
+    using C = compute_t<T>;
+    // Jacobian-vector product: dZ_i = A_i * (dA_i - sum_k dA_k * A_k)
+    C dot = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        dot += static_cast<C>(dA[i]) * static_cast<C>(A[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        dZ[i] = static_cast<C>(A[i]) * (static_cast<C>(dA[i]) - dot);
+    }
+}
+
+template <typename T>
+void softmax_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ) {
+    using C = compute_t<T>;
+    if (dA.get_rows() != A.get_rows() || dA.get_cols() != A.get_cols() ||
+        dZ.get_rows() != A.get_rows() || dZ.get_cols() != A.get_cols()) {
+        throw std::invalid_argument("Activation gradients have the wrong shape!");
+    }
+    if (A.is_empty()) {
+        return;
+    }
+    const size_t rows = A.get_rows();
+    const size_t cols = A.get_cols();
+
+    if (dA.get_col_stride() != 1 || A.get_col_stride() != 1 || dZ.get_col_stride() != 1) {
+        for (size_t col = 0; col < cols; ++col) {
+            C dot = 0.0;
+            for (size_t row = 0; row < rows; ++row) {
+                dot += static_cast<C>(dA(row, col)) * static_cast<C>(A(row, col));
+            }
+            for (size_t row = 0; row < rows; ++row) {
+                dZ(row, col) = static_cast<C>(A(row, col)) * (static_cast<C>(dA(row, col)) - dot);
             }
         }
+        return;
+    }
+
+    // Row sweeps with the per-column dot products in a reusable buffer, like softmax()
+    static thread_local ColumnBuffer<T> dots;
+    dots.assign(cols, C(0));
+    for (size_t row = 0; row < rows; ++row) {
+        const T* dA_row = &dA(row, 0);
+        const T* A_row = &A(row, 0);
+        for (size_t col = 0; col < cols; ++col) {
+            dots[col] += static_cast<C>(dA_row[col]) * static_cast<C>(A_row[col]);
+        }
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        const T* dA_row = &dA(row, 0);
+        const T* A_row = &A(row, 0);
+        T* dZ_row = &dZ(row, 0);
+        for (size_t col = 0; col < cols; ++col) {
+            dZ_row[col] = static_cast<C>(A_row[col]) * (static_cast<C>(dA_row[col]) - dots[col]);
+        }
+    }
+}
+
+template <typename T>
+void softmax_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ) {
+    if (dA.get_rows() != A.get_rows() || dA.get_cols() != A.get_cols()) {
+        throw std::invalid_argument("Activation gradients have the wrong shape!");
     }
+    if (dZ.get_rows() != A.get_rows() || dZ.get_cols() != A.get_cols()) {
+        dZ = BasicMatrix<T>(A.get_rows(), A.get_cols());
+    }
+    if (A.get_rows() == 1 || A.get_cols() == 1) {
+        // Single vector, as in softmax()
+        softmax_backward(dA.data(), A.data(), dZ.data(), A.get_rows() * A.get_cols());
+    } else {
+        softmax_backward(dA.view(), A.view(), dZ.view());
+    }
+}
 
+template <typename T>
+BasicMatrix<T> softmax_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A) {
+    BasicMatrix<T> result(A.get_rows(), A.get_cols());
+    softmax_backward(dA, A, result);
     return result;
 }
 
@@ -92,13 +478,34 @@ double tanh(double x) {
     return (std::exp(x) - std::exp(-x)) / (std::exp(x) + std::exp(-x));
 }
 
-Matrix tanh(const Matrix& mat) {
-    Matrix result(mat.get_rows(), mat.get_cols());
-    for (size_t row = 0; row < result.get_rows(); ++row) {
-        for (size_t col = 0; col < result.get_cols(); ++col) {
-            result[row][col] = tanh(mat[row][col]);
-        }
-    }
+float tanh(float x) {
+    return (std::exp(x) - std::exp(-x)) / (std::exp(x) + std::exp(-x));
+}
+
+template <typename T>
+void tanh(const T* in, T* out, size_t n) {
+    SimdMath::transform<TanhOp>(in, out, n);
+}
+
+template <typename T>
+void tanh(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    apply_(tanh<T>, in, out);
+}
+
+template <typename T>
+void tanh(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    apply_(tanh<T>, mat, out);
+}
+
+template <typename T>
+void tanh_(BasicMatrix<T>& mat) {
+    tanh(mat.data(), mat.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+BasicMatrix<T> tanh(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result(mat.get_rows(), mat.get_cols());
+    tanh(mat, result);
     return result;
 }
 
@@ -107,14 +514,57 @@ double tanh_derivative(double x) {
     return 1.0 - t * t;
 }
 
-Matrix tanh_derivative(const Matrix& mat) {
-    Matrix result(mat.get_rows(), mat.get_cols());
-    for (size_t row = 0; row < result.get_rows(); ++row) {
-        for (size_t col = 0; col < result.get_cols(); ++col) {
-            double t = tanh(mat[row][col]);
-            result[row][col] = 1.0 - t * t;
-        }
-    }
+float tanh_derivative(float x) {
+    float t = tanh(x);
+    return 1.0f - t * t;
+}
+
+template <typename T>
+void tanh_derivative(const T* in, T* out, size_t n) {
+    SimdMath::transform<TanhDerivativeOp>(in, out, n);
+}
+
+template <typename T>
+void tanh_derivative(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    apply_(tanh_derivative<T>, in, out);
+}
+
+template <typename T>
+void tanh_derivative(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    apply_(tanh_derivative<T>, mat, out);
+}
+
+template <typename T>
+void tanh_derivative_(BasicMatrix<T>& mat) {
+    tanh_derivative(mat.data(), mat.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+BasicMatrix<T> tanh_derivative(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result(mat.get_rows(), mat.get_cols());
+    tanh_derivative(mat, result);
+    return result;
+}
+
+template <typename T>
+void tanh_backward(const T* dA, const T* A, T* dZ, size_t n) {
+    SimdMath::transform<TanhBackwardOp>(dA, A, dZ, n);
+}
+
+template <typename T>
+void tanh_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ) {
+    apply_(tanh_backward<T>, dA, A, dZ);
+}
+
+template <typename T>
+void tanh_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ) {
+    apply_(tanh_backward<T>, dA, A, dZ);
+}
+
+template <typename T>
+BasicMatrix<T> tanh_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A) {
+    BasicMatrix<T> result(A.get_rows(), A.get_cols());
+    tanh_backward(dA, A, result);
     return result;
 }
 
@@ -122,13 +572,34 @@ double sigmoid(double x) {
     return 1.0 / (1.0 + std::exp(-x));
 }
 
-Matrix sigmoid(const Matrix& mat) {
-    Matrix result(mat.get_rows(), mat.get_cols());
-    for (size_t row = 0; row < result.get_rows(); ++row) {
-        for (size_t col = 0; col < result.get_cols(); ++col) {
-            result[row][col] = sigmoid(mat[row][col]);
-        }
-    }
+float sigmoid(float x) {
+    return 1.0f / (1.0f + std::exp(-x));
+}
+
+template <typename T>
+void sigmoid(const T* in, T* out, size_t n) {
+    SimdMath::transform<SigmoidOp>(in, out, n);
+}
+
+template <typename T>
+void sigmoid(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    apply_(sigmoid<T>, in, out);
+}
+
+template <typename T>
+void sigmoid(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    apply_(sigmoid<T>, mat, out);
+}
+
+template <typename T>
+void sigmoid_(BasicMatrix<T>& mat) {
+    sigmoid(mat.data(), mat.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+BasicMatrix<T> sigmoid(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result(mat.get_rows(), mat.get_cols());
+    sigmoid(mat, result);
     return result;
 }
 
@@ -137,16 +608,117 @@ double sigmoid_derivative(double x) {
     return std::exp(-x) / (d_sqrt * d_sqrt); 
 }
 
-Matrix sigmoid_derivative(const Matrix& mat) {
-    Matrix result(mat.get_rows(), mat.get_cols());
-    for (size_t row = 0; row < result.get_rows(); ++row) {
-        for (size_t col = 0; col < result.get_cols(); ++col) {
-            double e = std::exp(-mat[row][col]);
-            double d_sqrt = (e + 1);
-            result[row][col] = e / (d_sqrt * d_sqrt);
-        }
-    }
+float sigmoid_derivative(float x) {
+    float d_sqrt = (std::exp(-x) + 1);
+    return std::exp(-x) / (d_sqrt * d_sqrt); 
+}
+
+template <typename T>
+void sigmoid_derivative(const T* in, T* out, size_t n) {
+    SimdMath::transform<SigmoidDerivativeOp>(in, out, n);
+}
+
+template <typename T>
+void sigmoid_derivative(BasicMatrixView<const T> in, BasicMatrixView<T> out) {
+    apply_(sigmoid_derivative<T>, in, out);
+}
+
+template <typename T>
+void sigmoid_derivative(const BasicMatrix<T>& mat, BasicMatrix<T>& out) {
+    apply_(sigmoid_derivative<T>, mat, out);
+}
+
+template <typename T>
+void sigmoid_derivative_(BasicMatrix<T>& mat) {
+    sigmoid_derivative(mat.data(), mat.data(), mat.get_rows() * mat.get_stride());
+}
+
+template <typename T>
+BasicMatrix<T> sigmoid_derivative(const BasicMatrix<T>& mat) {
+    BasicMatrix<T> result(mat.get_rows(), mat.get_cols());
+    sigmoid_derivative(mat, result);
     return result;
 }
 
+template <typename T>
+void sigmoid_backward(const T* dA, const T* A, T* dZ, size_t n) {
+    SimdMath::transform<SigmoidBackwardOp>(dA, A, dZ, n);
+}
+
+template <typename T>
+void sigmoid_backward(BasicMatrixView<const T> dA, BasicMatrixView<const T> A, BasicMatrixView<T> dZ) {
+    apply_(sigmoid_backward<T>, dA, A, dZ);
+}
+
+template <typename T>
+void sigmoid_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A, BasicMatrix<T>& dZ) {
+    apply_(sigmoid_backward<T>, dA, A, dZ);
+}
+
+template <typename T>
+BasicMatrix<T> sigmoid_backward(const BasicMatrix<T>& dA, const BasicMatrix<T>& A) {
+    BasicMatrix<T> result(A.get_rows(), A.get_cols());
+    sigmoid_backward(dA, A, result);
+    return result;
+}
+
+#define ACTIVATION_INSTANTIATE(T) \
+    template void softmax_backward(const T*, const T*, T*, size_t); \
+    template void softmax_backward(BasicMatrixView<const T>, BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void softmax_backward(const BasicMatrix<T>&, const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template BasicMatrix<T> softmax_backward(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template void relu_backward(const T*, const T*, T*, size_t); \
+    template void relu_backward(BasicMatrixView<const T>, BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void relu_backward(const BasicMatrix<T>&, const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template BasicMatrix<T> relu_backward(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template void tanh_backward(const T*, const T*, T*, size_t); \
+    template void tanh_backward(BasicMatrixView<const T>, BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void tanh_backward(const BasicMatrix<T>&, const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template BasicMatrix<T> tanh_backward(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template void sigmoid_backward(const T*, const T*, T*, size_t); \
+    template void sigmoid_backward(BasicMatrixView<const T>, BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void sigmoid_backward(const BasicMatrix<T>&, const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template BasicMatrix<T> sigmoid_backward(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template void softmax(const T*, T*, size_t); \
+    template void softmax(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void softmax(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void softmax_(BasicMatrix<T>&); \
+    template BasicMatrix<T> softmax(const BasicMatrix<T>&); \
+    template void relu(const T*, T*, size_t); \
+    template void relu(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void relu(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void relu_(BasicMatrix<T>&); \
+    template BasicMatrix<T> relu(const BasicMatrix<T>&); \
+    template void relu_derivative(const T*, T*, size_t); \
+    template void relu_derivative(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void relu_derivative(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void relu_derivative_(BasicMatrix<T>&); \
+    template BasicMatrix<T> relu_derivative(const BasicMatrix<T>&); \
+    template void tanh(const T*, T*, size_t); \
+    template void tanh(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void tanh(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void tanh_(BasicMatrix<T>&); \
+    template BasicMatrix<T> tanh(const BasicMatrix<T>&); \
+    template void tanh_derivative(const T*, T*, size_t); \
+    template void tanh_derivative(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void tanh_derivative(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void tanh_derivative_(BasicMatrix<T>&); \
+    template BasicMatrix<T> tanh_derivative(const BasicMatrix<T>&); \
+    template void sigmoid(const T*, T*, size_t); \
+    template void sigmoid(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void sigmoid(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void sigmoid_(BasicMatrix<T>&); \
+    template BasicMatrix<T> sigmoid(const BasicMatrix<T>&); \
+    template void sigmoid_derivative(const T*, T*, size_t); \
+    template void sigmoid_derivative(BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template void sigmoid_derivative(const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template void sigmoid_derivative_(BasicMatrix<T>&); \
+    template BasicMatrix<T> sigmoid_derivative(const BasicMatrix<T>&);
+
+ACTIVATION_INSTANTIATE(float)
+ACTIVATION_INSTANTIATE(double)
+ACTIVATION_INSTANTIATE(bfloat16)
+
+#undef ACTIVATION_INSTANTIATE
+
 } // namespace Activation
@@ -0,0 +1,296 @@
+#include "gemm.h"
+#include "aligned_allocator.h"
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEMM_X86 1
+#endif
+
+using std::vector;
+
+namespace Gemm {
+
+namespace {
+
+template <typename T>
+using PackBuffer = vector<T, AlignedAllocator<T>>;
+
+// Runs the epilogue over a rows x cols block of C
+template <typename T>
+void apply_epilogue_(const Epilogue<T>& epilogue, size_t rows, size_t cols, T* c, size_t c_rs) {
+    using Acc = compute_t<T>;
+    for (size_t r = 0; r < rows; ++r) {
+        T* c_row = c + r * c_rs;
+        if (epilogue.bias != nullptr) {
+            const Acc bias = epilogue.bias[r];
+            for (size_t col = 0; col < cols; ++col) {
+                c_row[col] = static_cast<Acc>(c_row[col]) + bias;
+            }
+        }
+        if (epilogue.activation != nullptr) {
+            epilogue.activation(c_row, epilogue.out + r * epilogue.out_rs, cols);
+        }
+    }
+}
+
+#ifdef GEMM_X86
+/**
+ * Packs an mc x kc block of A into MR-row slivers. Within a sliver the
+ * MR values of one column are stored next to each other, which is the
+ * order the micro-kernel broadcasts them in. Rows past mc are zero-padded.
+*/
+template <typename T>
+void pack_a_(size_t mc, size_t kc, const T* a, size_t a_rs, size_t a_cs, T* packed) {
+    for (size_t i = 0; i < mc; i += MR) {
+        const size_t rows = std::min(MR, mc - i);
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t r = 0; r < rows; ++r) {
+                packed[r] = a[(i + r) * a_rs + p * a_cs];
+            }
+            for (size_t r = rows; r < MR; ++r) {
+                packed[r] = T(0);
+            }
+            packed += MR;
+        }
+    }
+}
+
+/**
+ * Packs a kc x nc panel of B into NR-column slivers, row by row.
+ * Columns past nc are zero-padded.
+*/
+template <typename T>
+void pack_b_(size_t kc, size_t nc, const T* b, size_t b_rs, size_t b_cs, T* packed) {
+    constexpr size_t nr = NR_OF<T>;
+    for (size_t j = 0; j < nc; j += nr) {
+        const size_t cols = std::min(nr, nc - j);
+        for (size_t p = 0; p < kc; ++p) {
+            const T* b_row = b + p * b_rs + j * b_cs;
+            for (size_t c = 0; c < cols; ++c) {
+                packed[c] = b_row[c * b_cs];
+            }
+            for (size_t c = cols; c < nr; ++c) {
+                packed[c] = T(0);
+            }
+            packed += nr;
+        }
+    }
+}
+
+/**
+ * Computes the full MR x NR tile  tile = A_sliver * B_sliver  with twelve
+ * 256-bit accumulators, then writes (or adds) it to C.
+*/
+__attribute__((target("avx2,fma")))
+void micro_kernel_avx2_(size_t kc, const double* a, const double* b, double* c, size_t c_rs, bool accumulate) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+    for (size_t p = 0; p < kc; ++p) {
+        const __m256d b0 = _mm256_load_pd(b);
+        const __m256d b1 = _mm256_load_pd(b + 4);
+        __m256d a_val;
+        a_val = _mm256_broadcast_sd(a + 0); c00 = _mm256_fmadd_pd(a_val, b0, c00); c01 = _mm256_fmadd_pd(a_val, b1, c01);
+        a_val = _mm256_broadcast_sd(a + 1); c10 = _mm256_fmadd_pd(a_val, b0, c10); c11 = _mm256_fmadd_pd(a_val, b1, c11);
+        a_val = _mm256_broadcast_sd(a + 2); c20 = _mm256_fmadd_pd(a_val, b0, c20); c21 = _mm256_fmadd_pd(a_val, b1, c21);
+        a_val = _mm256_broadcast_sd(a + 3); c30 = _mm256_fmadd_pd(a_val, b0, c30); c31 = _mm256_fmadd_pd(a_val, b1, c31);
+        a_val = _mm256_broadcast_sd(a + 4); c40 = _mm256_fmadd_pd(a_val, b0, c40); c41 = _mm256_fmadd_pd(a_val, b1, c41);
+        a_val = _mm256_broadcast_sd(a + 5); c50 = _mm256_fmadd_pd(a_val, b0, c50); c51 = _mm256_fmadd_pd(a_val, b1, c51);
+        a += MR;
+        b += NR;
+    }
+
+    const __m256d tile[MR][2] = { {c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51} };
+    for (size_t r = 0; r < MR; ++r) {
+        double* c_row = c + r * c_rs;
+        __m256d lo = tile[r][0];
+        __m256d hi = tile[r][1];
+        if (accumulate) {
+            lo = _mm256_add_pd(lo, _mm256_loadu_pd(c_row));
+            hi = _mm256_add_pd(hi, _mm256_loadu_pd(c_row + 4));
+        }
+        _mm256_storeu_pd(c_row, lo);
+        _mm256_storeu_pd(c_row + 4, hi);
+    }
+}
+
+// Single precision version of the kernel above: the tile is MR x 16 floats
+__attribute__((target("avx2,fma")))
+void micro_kernel_avx2_(size_t kc, const float* a, const float* b, float* c, size_t c_rs, bool accumulate) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (size_t p = 0; p < kc; ++p) {
+        const __m256 b0 = _mm256_load_ps(b);
+        const __m256 b1 = _mm256_load_ps(b + 8);
+        __m256 a_val;
+        a_val = _mm256_broadcast_ss(a + 0); c00 = _mm256_fmadd_ps(a_val, b0, c00); c01 = _mm256_fmadd_ps(a_val, b1, c01);
+        a_val = _mm256_broadcast_ss(a + 1); c10 = _mm256_fmadd_ps(a_val, b0, c10); c11 = _mm256_fmadd_ps(a_val, b1, c11);
+        a_val = _mm256_broadcast_ss(a + 2); c20 = _mm256_fmadd_ps(a_val, b0, c20); c21 = _mm256_fmadd_ps(a_val, b1, c21);
+        a_val = _mm256_broadcast_ss(a + 3); c30 = _mm256_fmadd_ps(a_val, b0, c30); c31 = _mm256_fmadd_ps(a_val, b1, c31);
+        a_val = _mm256_broadcast_ss(a + 4); c40 = _mm256_fmadd_ps(a_val, b0, c40); c41 = _mm256_fmadd_ps(a_val, b1, c41);
+        a_val = _mm256_broadcast_ss(a + 5); c50 = _mm256_fmadd_ps(a_val, b0, c50); c51 = _mm256_fmadd_ps(a_val, b1, c51);
+        a += MR;
+        b += NR_OF<float>;
+    }
+
+    const __m256 tile[MR][2] = { {c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51} };
+    for (size_t r = 0; r < MR; ++r) {
+        float* c_row = c + r * c_rs;
+        __m256 lo = tile[r][0];
+        __m256 hi = tile[r][1];
+        if (accumulate) {
+            lo = _mm256_add_ps(lo, _mm256_loadu_ps(c_row));
+            hi = _mm256_add_ps(hi, _mm256_loadu_ps(c_row + 8));
+        }
+        _mm256_storeu_ps(c_row, lo);
+        _mm256_storeu_ps(c_row + 8, hi);
+    }
+}
+
+/**
+ * Runs the micro-kernel over every MR x NR tile of an mc x nc block of C.
+ * Edge tiles are computed into a local buffer and only the valid part is
+ * copied out, so the micro-kernel itself never needs bounds checks.
+ * A non-empty epilogue is applied to each tile right after it is stored.
+*/
+template <typename T>
+void macro_kernel_(size_t mc, size_t nc, size_t kc, const T* packed_a, const T* packed_b,
+                   T* c, size_t c_rs, bool accumulate, const Epilogue<T>& epilogue) {
+    constexpr size_t nr = NR_OF<T>;
+    alignas(64) T edge[MR * nr];
+    for (size_t j = 0; j < nc; j += nr) {
+        const size_t cols = std::min(nr, nc - j);
+        const T* b_sliver = packed_b + j * kc;
+        for (size_t i = 0; i < mc; i += MR) {
+            const size_t rows = std::min(MR, mc - i);
+            const T* a_sliver = packed_a + i * kc;
+            T* c_tile = c + i * c_rs + j;
+            if (rows == MR && cols == nr) {
+                micro_kernel_avx2_(kc, a_sliver, b_sliver, c_tile, c_rs, accumulate);
+            } else {
+                micro_kernel_avx2_(kc, a_sliver, b_sliver, edge, nr, false);
+                for (size_t r = 0; r < rows; ++r) {
+                    for (size_t col = 0; col < cols; ++col) {
+                        T val = edge[r * nr + col];
+                        c_tile[r * c_rs + col] = accumulate ? c_tile[r * c_rs + col] + val : val;
+                    }
+                }
+            }
+            if (!epilogue.empty()) {
+                apply_epilogue_(epilogue.at(i, j), rows, cols, c_tile, c_rs);
+            }
+        }
+    }
+}
+
+template <typename T>
+void multiply_packed_(size_t m, size_t n, size_t k,
+                      const T* a, size_t a_rs, size_t a_cs,
+                      const T* b, size_t b_rs, size_t b_cs,
+                      T* c, size_t c_rs, bool accumulate, const Epilogue<T>& epilogue) {
+    constexpr size_t nr = NR_OF<T>;
+    const Epilogue<T> none;
+    // Reused across calls, so steady-state multiplications do not allocate
+    static thread_local PackBuffer<T> packed_a;
+    static thread_local PackBuffer<T> packed_b;
+    packed_a.resize(MC * KC);
+    packed_b.resize(KC * ((std::min(NC, n) + nr - 1) / nr) * nr);
+
+    for (size_t jc = 0; jc < n; jc += NC) {
+        const size_t nc = std::min(NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += KC) {
+            const size_t kc = std::min(KC, k - pc);
+            // Only the first depth block may overwrite C, the rest add into it
+            const bool acc = accumulate || pc > 0;
+            // and the epilogue runs once C is final, i.e. after the last one
+            const bool last = pc + kc == k;
+            pack_b_(kc, nc, b + pc * b_rs + jc * b_cs, b_rs, b_cs, packed_b.data());
+            for (size_t ic = 0; ic < m; ic += MC) {
+                const size_t mc = std::min(MC, m - ic);
+                pack_a_(mc, kc, a + ic * a_rs + pc * a_cs, a_rs, a_cs, packed_a.data());
+                macro_kernel_(mc, nc, kc, packed_a.data(), packed_b.data(), c + ic * c_rs + jc, c_rs, acc,
+                              last ? epilogue.at(ic, jc) : none);
+            }
+        }
+    }
+}
+#endif
+
+} // namespace
+
+bool has_avx2_fma() {
+#ifdef GEMM_X86
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+Kernel active_kernel() {
+    return has_avx2_fma() ? Kernel::Avx2Fma : Kernel::Reference;
+}
+
+template <typename T>
+void multiply(size_t m, size_t n, size_t k,
+              const T* a, size_t a_rs, size_t a_cs,
+              const T* b, size_t b_rs, size_t b_cs,
+              T* c, size_t c_rs, bool accumulate, const Epilogue<T>& epilogue) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+#ifdef GEMM_X86
+    if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>) {
+        if (k > 0 && active_kernel() == Kernel::Avx2Fma) {
+            multiply_packed_(m, n, k, a, a_rs, a_cs, b, b_rs, b_cs, c, c_rs, accumulate, epilogue);
+            return;
+        }
+    }
+#endif
+    multiply_reference(m, n, k, a, a_rs, a_cs, b, b_rs, b_cs, c, c_rs, accumulate, epilogue);
+}
+
+template <typename T>
+void multiply_reference(size_t m, size_t n, size_t k,
+                        const T* a, size_t a_rs, size_t a_cs,
+                        const T* b, size_t b_rs, size_t b_cs,
+                        T* c, size_t c_rs, bool accumulate, const Epilogue<T>& epilogue) {
+    using Acc = compute_t<T>;
+    for (size_t row = 0; row < m; ++row) {
+        for (size_t col = 0; col < n; ++col) {
+            Acc v = accumulate ? static_cast<Acc>(c[row * c_rs + col]) : Acc(0);
+            for (size_t i = 0; i < k; ++i) {
+                v += static_cast<Acc>(a[row * a_rs + i * a_cs]) * static_cast<Acc>(b[i * b_rs + col * b_cs]);
+            }
+            c[row * c_rs + col] = v;
+        }
+        if (!epilogue.empty()) {
+            apply_epilogue_(epilogue.at(row, 0), 1, n, c + row * c_rs, c_rs);
+        }
+    }
+}
+
+#define GEMM_INSTANTIATE(T) \
+    template void multiply<T>(size_t, size_t, size_t, const T*, size_t, size_t, const T*, size_t, size_t, T*, size_t, bool, const Epilogue<T>&); \
+    template void multiply_reference<T>(size_t, size_t, size_t, const T*, size_t, size_t, const T*, size_t, size_t, T*, size_t, bool, const Epilogue<T>&);
+
+GEMM_INSTANTIATE(float)
+GEMM_INSTANTIATE(double)
+GEMM_INSTANTIATE(bfloat16)
+
+#undef GEMM_INSTANTIATE
+
+} // namespace Gemm
@@ -1,33 +1,196 @@
 #include "loss.h"
+#include "aligned_allocator.h"
+#include "parallel_tuning.h"
+#include "reduce.h"
+#include "profiler.h"
+#include "simd_math.h"
+#include "thread_pool.h"
 #include <cmath>
 #include <bits/stdc++.h>
 
-namespace Loss {
+namespace {
 
-double mse(const Matrix& y_true, const Matrix& y_pred) {
-    if (y_true.get_rows() != y_pred.get_rows() || y_true.get_cols() != y_pred.get_cols()) {
-        throw std::invalid_argument("Shape mismatch in MSE calculation!");
+using SimdMath::Vec;
+
+// Elements handled by one task of the fused kernels
+constexpr size_t PARALLEL_GRAIN = 1 << 14;
+
+// Runs worker over [0, n) on the pool when the kernel reads enough elements to reach the Reduce threshold,
+// otherwise on the calling thread. Every index writes its own partial, so both give the same loss.
+template <typename Worker>
+void dispatch_(size_t n, size_t elements, Worker& worker, size_t grain) {
+    if (!Parallel::use_pool(Parallel::Kernel::Reduce, elements)) {
+        worker(size_t(0), n);
+        return;
     }
+    parallel_for(0, n, worker, grain);
+}
 
-    long double sum = 0.0L;
-    double count = static_cast<double>(y_true.get_rows() * y_true.get_cols());
+template <typename T>
+using ColumnBuffer = std::vector<compute_t<T>, AlignedAllocator<compute_t<T>>>;
 
-    for (size_t row = 0; row < y_true.get_rows(); ++row) {
-        for (size_t col = 0; col < y_true.get_cols(); ++col) {
-            double diff = y_true[row][col] - y_pred[row][col];
-            sum += static_cast<long double>(diff) * diff;
+template <typename T>
+using ElementBuffer = std::vector<T, AlignedAllocator<T>>;
+
+// Per-task losses of the fused kernels, summed in task order. Owned by the calling thread and only grown,
+// so steady-state training steps do not allocate.
+double* partial_losses_(size_t n) {
+    static thread_local std::vector<double> partials;
+    if (partials.size() < n) {
+        partials.resize(n);
+    }
+    return partials.data();
+}
+
+struct ExpOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> x) const { return SimdMath::exp<T, W>(x); }
+};
+
+// Per-element terms of the losses, summed by Reduce::sum() as op(y_true, y_pred)
+struct SquaredErrorOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> y, Vec<T, W> p) const {
+        const Vec<T, W> diff = y - p;
+        return diff * diff;
+    }
+};
+
+struct AbsoluteErrorOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> y, Vec<T, W> p) const { return SimdMath::abs<T, W>(y - p); }
+};
+
+// Predictions are clamped to [1e-15, 1 - 1e-15], which keeps the logarithm on normal numbers
+constexpr double PROBABILITY_EPS = 1e-15;
+
+struct CrossEntropyOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> y, Vec<T, W> p) const {
+        const Vec<T, W> eps = SimdMath::broadcast<T, W>(static_cast<T>(PROBABILITY_EPS));
+        return -y * SimdMath::log<T, W>(SimdMath::max<T, W>(p, eps));
+    }
+};
+
+struct BinaryCrossEntropyOp {
+    template <typename T, size_t W>
+    SIMD_MATH_INLINE Vec<T, W> apply(Vec<T, W> y, Vec<T, W> p) const {
+        // 1 - p is clamped itself, 1 - eps rounds to 1 in float
+        const Vec<T, W> eps = SimdMath::broadcast<T, W>(static_cast<T>(PROBABILITY_EPS));
+        const Vec<T, W> log_p = SimdMath::log<T, W>(SimdMath::max<T, W>(p, eps));
+        const Vec<T, W> log_q = SimdMath::log<T, W>(SimdMath::max<T, W>(T(1) - p, eps));
+        return -(y * log_p + (T(1) - y) * log_q);
+    }
+};
+
+/**
+ * Sigmoid + BCE of n elements: writes (sigmoid(z) - y) * scale to grad and
+ * returns the summed loss max(z, 0) - z y + log1p(exp(-|z|)). Both come from
+ * the same exp(-|z|).
+*/
+struct SigmoidBceKernel {
+    template <typename T, size_t W>
+    static SIMD_MATH_INLINE Vec<T, W> step_(Vec<T, W> y, Vec<T, W> z, T scale, Vec<T, W>& grad) {
+        const Vec<T, W> e = SimdMath::exp<T, W>(-SimdMath::abs<T, W>(z));
+        const Vec<T, W> d = T(1) + e;
+        const Vec<T, W> p = (z >= T(0) ? T(1) : e) / d;
+        grad = (p - y) * scale;
+        return SimdMath::max<T, W>(z, Vec<T, W>{}) - z * y + SimdMath::log1p<T, W>(e);
+    }
+
+    template <size_t Bytes, typename T>
+    static SIMD_MATH_INLINE double run(const T* y, const T* z, T* grad, size_t n, T scale) {
+        constexpr size_t W = Bytes / sizeof(T);
+        constexpr size_t flush = 64; // Vectors summed in T before the lanes are added up in double
+        double total = 0.0;
+        Vec<T, W> sum{};
+        size_t i = 0;
+        for (size_t count = 1; i + W <= n; i += W, ++count) {
+            Vec<T, W> g;
+            sum += step_<T, W>(SimdMath::load<T, W>(y + i), SimdMath::load<T, W>(z + i), scale, g);
+            SimdMath::store<T, W>(grad + i, g);
+            if (count % flush == 0) {
+                for (size_t lane = 0; lane < W; ++lane) {
+                    total += sum[lane];
+                }
+                sum = Vec<T, W>{};
+            }
+        }
+        for (size_t lane = 0; lane < W; ++lane) {
+            total += sum[lane];
+        }
+        if (i < n) {
+            T y_tail[W] = {};
+            T z_tail[W] = {};
+            std::memcpy(y_tail, y + i, (n - i) * sizeof(T));
+            std::memcpy(z_tail, z + i, (n - i) * sizeof(T));
+            Vec<T, W> g;
+            const Vec<T, W> loss = step_<T, W>(SimdMath::load<T, W>(y_tail), SimdMath::load<T, W>(z_tail), scale, g);
+            SimdMath::store<T, W>(z_tail, g);
+            std::memcpy(grad + i, z_tail, (n - i) * sizeof(T));
+            for (size_t lane = 0; lane < n - i; ++lane) {
+                total += loss[lane];
+            }
         }
+        return total;
     }
+};
+
+template <typename T>
+double sigmoid_bce_(const T* y, const T* z, T* grad, size_t n, compute_t<T> scale) {
+    return SimdMath::dispatch<SigmoidBceKernel>(y, z, grad, n, scale);
+}
+
+// bfloat16 is widened to float in blocks that fit on the stack
+double sigmoid_bce_(const bfloat16* y, const bfloat16* z, bfloat16* grad, size_t n, float scale) {
+    constexpr size_t block = 256;
+    float y_buffer[block];
+    float z_buffer[block];
+    double total = 0.0;
+    for (size_t i = 0; i < n; i += block) {
+        const size_t m = std::min(block, n - i);
+        std::copy(y + i, y + i + m, y_buffer);
+        std::copy(z + i, z + i + m, z_buffer);
+        total += sigmoid_bce_(y_buffer, z_buffer, z_buffer, m, scale);
+        std::copy(z_buffer, z_buffer + m, grad + i);
+    }
+    return total;
+}
+
+template <typename T>
+void check_fused_shapes_(BasicMatrixView<const T> y_true, BasicMatrixView<const T> logits, BasicMatrixView<T> grad, const char* msg) {
+    if (y_true.get_rows() != logits.get_rows() || y_true.get_cols() != logits.get_cols() ||
+        grad.get_rows() != logits.get_rows() || grad.get_cols() != logits.get_cols()) {
+        throw std::invalid_argument(msg);
+    }
+}
+
+}
+
+namespace Loss {
+
+template <typename T>
+double mse(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred) {
+    if (y_true.get_rows() != y_pred.get_rows() || y_true.get_cols() != y_pred.get_cols()) {
+        throw std::invalid_argument("Shape mismatch in MSE calculation!");
+    }
+
+    const double count = static_cast<double>(y_true.get_rows() * y_true.get_cols());
+    return Reduce::sum(y_true, y_pred, SquaredErrorOp()) / count;
+}
 
-    return static_cast<double>(sum / count);
+template <typename T>
+double mse(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
+    return mse(y_true.view(), y_pred.view());
 }
 
-Matrix mse_derivative(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+BasicMatrix<T> mse_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() || y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in MSE derivative calculation!");
     }
 
-    Matrix grads(y_true.get_rows(), y_true.get_cols());
+    BasicMatrix<T> grads(y_true.get_rows(), y_true.get_cols());
     double scale = 2.0 / static_cast<double>(y_true.get_rows() * y_true.get_cols());
 
     for (size_t row = 0; row < y_true.get_rows(); ++row) {
@@ -39,29 +202,28 @@ Matrix mse_derivative(const Matrix& y_true, const Matrix& y_pred) {
     return grads;
 }
 
-double mae(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+double mae(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() || y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in MSE calculation!");
     }
 
-    long double sum = 0.0L;
-    double count = static_cast<double>(y_true.get_rows() * y_true.get_cols());
-
-    for (size_t row = 0; row < y_true.get_rows(); ++row) {
-        for (size_t col = 0; col < y_true.get_cols(); ++col) {
-            sum += static_cast<long double>(std::abs(y_true[row][col] - y_pred[row][col]));
-        }
-    }
+    const double count = static_cast<double>(y_true.get_rows() * y_true.get_cols());
+    return Reduce::sum(y_true, y_pred, AbsoluteErrorOp()) / count;
+}
 
-    return static_cast<double>(sum / count);
+template <typename T>
+double mae(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
+    return mae(y_true.view(), y_pred.view());
 }
 
-Matrix mae_derivative(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+BasicMatrix<T> mae_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() || y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in MSE derivative calculation!");
     }
 
-    Matrix grads(y_true.get_rows(), y_true.get_cols());
+    BasicMatrix<T> grads(y_true.get_rows(), y_true.get_cols());
     double scale = 1.0 / static_cast<double>(y_true.get_rows() * y_true.get_cols());
 
     for (size_t row = 0; row < y_true.get_rows(); ++row) {
@@ -74,35 +236,31 @@ Matrix mae_derivative(const Matrix& y_true, const Matrix& y_pred) {
     return grads;
 }
 
-double categorical_cross_entropy(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+double categorical_cross_entropy(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() ||
         y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in Categorical Cross Entropy calculation!");
     }
 
-    long double total_loss = 0.0L;
     const size_t n_examples = y_true.get_cols();
-    const size_t n_classes = y_true.get_rows();
-
-    for (size_t i = 0; i < n_examples; ++i) {
-        for (size_t k = 0; k < n_classes; ++k) {
-            double y_t = y_true[k][i];
-            double y_p = std::max(y_pred[k][i], 1e-15);
-            total_loss += static_cast<long double>(-y_t * std::log(y_p));
-        }
-    }
+    return Reduce::sum(y_true, y_pred, CrossEntropyOp()) / n_examples;
+}
 
-    return static_cast<double>(total_loss / n_examples);
+template <typename T>
+double categorical_cross_entropy(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
+    return categorical_cross_entropy(y_true.view(), y_pred.view());
 }
 
-Matrix categorical_cross_entropy_derivative(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+BasicMatrix<T> categorical_cross_entropy_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() ||
         y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in Categorical Cross Entropy derivative calculation!");
     }
 
     const double scale = 1.0 / static_cast<double>(y_true.get_cols());
-    Matrix grads(y_true.get_rows(), y_true.get_cols());
+    BasicMatrix<T> grads(y_true.get_rows(), y_true.get_cols());
     for (size_t row = 0; row < grads.get_rows(); ++row) {
         for (size_t col = 0; col < grads.get_cols(); ++col) {
             grads[row][col] = scale * (y_pred[row][col] - y_true[row][col]);
@@ -112,28 +270,24 @@ Matrix categorical_cross_entropy_derivative(const Matrix& y_true, const Matrix&
 }
 
     
-double binary_cross_entropy(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+double binary_cross_entropy(BasicMatrixView<const T> y_true, BasicMatrixView<const T> y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() ||
         y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in Binary Cross Entropy calculation!");
     }
 
-    long double total_loss = 0.0L;
     const size_t n_elements = y_true.get_rows() * y_true.get_cols();
-    const double eps = 1e-15;
-
-    for (size_t row = 0; row < y_true.get_rows(); ++row) {
-        for (size_t col = 0; col < y_true.get_cols(); ++col) {
-            double y_t = y_true[row][col];
-            double y_p = std::clamp(y_pred[row][col], eps, 1.0 - eps);
-            total_loss += static_cast<long double>( - (y_t * std::log(y_p) + (1.0 - y_t) * std::log(1.0 - y_p)) );
-        }
-    }
+    return Reduce::sum(y_true, y_pred, BinaryCrossEntropyOp()) / n_elements;
+}
 
-    return static_cast<double>(total_loss / n_elements);
+template <typename T>
+double binary_cross_entropy(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
+    return binary_cross_entropy(y_true.view(), y_pred.view());
 }
 
-Matrix binary_cross_entropy_derivative(const Matrix& y_true, const Matrix& y_pred) {
+template <typename T>
+BasicMatrix<T> binary_cross_entropy_derivative(const BasicMatrix<T>& y_true, const BasicMatrix<T>& y_pred) {
     if (y_true.get_rows() != y_pred.get_rows() ||
         y_true.get_cols() != y_pred.get_cols()) {
         throw std::invalid_argument("Shape mismatch in Binary Cross Entropy derivative calculation!");
@@ -141,15 +295,222 @@ Matrix binary_cross_entropy_derivative(const Matrix& y_true, const Matrix& y_pre
 
     const double scale = 1.0 / static_cast<double>(y_true.get_rows() * y_true.get_cols());
     const double eps = 1e-15;
-    Matrix grads(y_true.get_rows(), y_true.get_cols());
+    BasicMatrix<T> grads(y_true.get_rows(), y_true.get_cols());
     for (size_t row = 0; row < grads.get_rows(); ++row) {
         for (size_t col = 0; col < grads.get_cols(); ++col) {
             double y_t = y_true[row][col];
-            double y_p = std::clamp(y_pred[row][col], eps, 1.0 - eps);
+            double y_p = std::clamp(static_cast<double>(y_pred[row][col]), eps, 1.0 - eps);
             grads[row][col] = scale * ( (y_p - y_t) / (y_p * (1.0 - y_p)) );
         }
     }
     return grads;
 }
 
-}
\ No newline at end of file
+template <typename T>
+double softmax_cross_entropy_with_logits(BasicMatrixView<const T> y_true, BasicMatrixView<const T> logits, BasicMatrixView<T> grad) {
+    using C = compute_t<T>;
+    PROFILE_ZONE("loss.softmax_cross_entropy");
+    check_fused_shapes_(y_true, logits, grad, "Shape mismatch in Softmax Cross Entropy calculation!");
+    if (logits.is_empty()) {
+        return 0.0;
+    }
+    const size_t rows = logits.get_rows();
+    const size_t cols = logits.get_cols();
+    const C scale = C(1) / static_cast<C>(cols);
+
+    // Loss of sample c: sum_k y_k (lse_c - z_k) = lse_c * sum_k y_k - sum_k y_k z_k with lse_c = max_c + log(sum_k exp(z_k - max_c)).
+    // The y sums are taken before grad is written, so grad may alias the logits.
+    if (logits.get_col_stride() != 1 || grad.get_col_stride() != 1) {
+        // Strided logits or gradients: one column per element of the range, its loss kept as a partial
+        double* partial_losses = partial_losses_(cols);
+        auto worker = [&](size_t first_col, size_t last_col) {
+            for (size_t col = first_col; col < last_col; ++col) {
+                C max_val = logits(0, col);
+                C y_sum = 0.0;
+                C yz_sum = 0.0;
+                for (size_t row = 0; row < rows; ++row) {
+                    max_val = std::max(max_val, static_cast<C>(logits(row, col)));
+                    y_sum += static_cast<C>(y_true(row, col));
+                    yz_sum += static_cast<C>(y_true(row, col)) * static_cast<C>(logits(row, col));
+                }
+                C sum = 0.0;
+                for (size_t row = 0; row < rows; ++row) {
+                    const C e = std::exp(static_cast<C>(logits(row, col)) - max_val);
+                    grad(row, col) = e;
+                    sum += e;
+                }
+                partial_losses[col] = static_cast<double>((max_val + std::log(sum)) * y_sum - yz_sum);
+                for (size_t row = 0; row < rows; ++row) {
+                    grad(row, col) = (static_cast<C>(grad(row, col)) / sum - static_cast<C>(y_true(row, col))) * scale;
+                }
+            }
+        };
+        dispatch_(cols, rows * cols, worker, std::max<size_t>(1, PARALLEL_GRAIN / rows));
+        return Reduce::sum(partial_losses, cols) / cols;
+    }
+
+    // Blocks of columns swept row by row, so the exponentials of every row segment run through the vector kernel
+    constexpr size_t block_cols = 256;
+    const size_t n_blocks = (cols + block_cols - 1) / block_cols;
+    double* partial_losses = partial_losses_(n_blocks);
+    // Strided targets, such as the transposed sample rows Model trains on, are gathered block by block
+    const bool gather_targets = y_true.get_col_stride() != 1;
+    auto worker = [&](size_t first_block, size_t last_block) {
+        static thread_local ColumnBuffer<T> max_vals, sums, y_sums, yz_sums;
+        static thread_local ElementBuffer<T> y_block;
+        for (size_t block = first_block; block < last_block; ++block) {
+            const size_t begin = block * block_cols;
+            const size_t width = std::min(cols, begin + block_cols) - begin;
+            const T* y_base = gather_targets ? nullptr : &y_true(0, begin);
+            size_t y_row_stride = y_true.get_row_stride();
+            if (gather_targets) {
+                if (y_block.size() < rows * width) {
+                    y_block.resize(rows * width);
+                }
+                // Column by column, which reads the rows of a transposed target contiguously
+                for (size_t col = 0; col < width; ++col) {
+                    for (size_t row = 0; row < rows; ++row) {
+                        y_block[row * width + col] = y_true(row, begin + col);
+                    }
+                }
+                y_base = y_block.data();
+                y_row_stride = width;
+            }
+            max_vals.assign(&logits(0, begin), &logits(0, begin) + width);
+            sums.assign(width, C(0));
+            y_sums.assign(width, C(0));
+            yz_sums.assign(width, C(0));
+            for (size_t row = 0; row < rows; ++row) {
+                const T* z = &logits(row, begin);
+                const T* y = y_base + row * y_row_stride;
+                for (size_t col = 0; col < width; ++col) {
+                    max_vals[col] = std::max(max_vals[col], static_cast<C>(z[col]));
+                    y_sums[col] += static_cast<C>(y[col]);
+                    yz_sums[col] += static_cast<C>(y[col]) * static_cast<C>(z[col]);
+                }
+            }
+            for (size_t row = 0; row < rows; ++row) {
+                const T* z = &logits(row, begin);
+                T* g = &grad(row, begin);
+                for (size_t col = 0; col < width; ++col) {
+                    g[col] = static_cast<C>(z[col]) - max_vals[col];
+                }
+                SimdMath::transform<ExpOp>(g, g, width);
+                for (size_t col = 0; col < width; ++col) {
+                    sums[col] += static_cast<C>(g[col]);
+                }
+            }
+            double loss = 0.0;
+            for (size_t col = 0; col < width; ++col) {
+                loss += static_cast<double>((max_vals[col] + std::log(sums[col])) * y_sums[col] - yz_sums[col]);
+                sums[col] = C(1) / sums[col];
+            }
+            partial_losses[block] = loss;
+            for (size_t row = 0; row < rows; ++row) {
+                const T* y = y_base + row * y_row_stride;
+                T* g = &grad(row, begin);
+                for (size_t col = 0; col < width; ++col) {
+                    g[col] = (static_cast<C>(g[col]) * sums[col] - static_cast<C>(y[col])) * scale;
+                }
+            }
+        }
+    };
+    dispatch_(n_blocks, rows * cols, worker, std::max<size_t>(1, PARALLEL_GRAIN / (rows * block_cols)));
+
+    return Reduce::sum(partial_losses, n_blocks) / cols;
+}
+
+template <typename T>
+double softmax_cross_entropy_with_logits(const BasicMatrix<T>& y_true, const BasicMatrix<T>& logits, BasicMatrix<T>& grad) {
+    if (grad.get_rows() != logits.get_rows() || grad.get_cols() != logits.get_cols()) {
+        grad = BasicMatrix<T>(logits.get_rows(), logits.get_cols());
+    }
+    return softmax_cross_entropy_with_logits(y_true.view(), logits.view(), grad.view());
+}
+
+template <typename T>
+double sigmoid_bce_with_logits(BasicMatrixView<const T> y_true, BasicMatrixView<const T> logits, BasicMatrixView<T> grad) {
+    using C = compute_t<T>;
+    PROFILE_ZONE("loss.sigmoid_bce");
+    check_fused_shapes_(y_true, logits, grad, "Shape mismatch in Binary Cross Entropy calculation!");
+    if (logits.is_empty()) {
+        return 0.0;
+    }
+    const size_t rows = logits.get_rows();
+    const size_t cols = logits.get_cols();
+    const double n_elements = static_cast<double>(rows * cols);
+    const C scale = static_cast<C>(1.0 / n_elements);
+
+    if (y_true.get_col_stride() != 1 || logits.get_col_stride() != 1 || grad.get_col_stride() != 1) {
+        // Strided views: one row per element of the range, its loss kept as a partial
+        double* partial_losses = partial_losses_(rows);
+        auto worker = [&](size_t first_row, size_t last_row) {
+            for (size_t row = first_row; row < last_row; ++row) {
+                double row_loss = 0.0;
+                for (size_t col = 0; col < cols; ++col) {
+                    const C z = logits(row, col);
+                    const C y = y_true(row, col);
+                    const C e = std::exp(-std::abs(z));
+                    row_loss += static_cast<double>(std::max(z, C(0)) - z * y + std::log1p(e));
+                    grad(row, col) = ((z >= 0 ? C(1) : e) / (C(1) + e) - y) * scale;
+                }
+                partial_losses[row] = row_loss;
+            }
+        };
+        dispatch_(rows, rows * cols, worker, std::max<size_t>(1, PARALLEL_GRAIN / cols));
+        return Reduce::sum(partial_losses, rows) / n_elements;
+    }
+
+    // Dense views are one run of elements, otherwise every row is one
+    const bool dense = y_true.is_contiguous() && logits.is_contiguous() && grad.is_contiguous();
+    const size_t n_runs = dense ? 1 : rows;
+    const size_t run_length = dense ? rows * cols : cols;
+    const size_t chunk = dense ? PARALLEL_GRAIN : cols;
+    const size_t n_chunks = dense ? (run_length + chunk - 1) / chunk : rows;
+    double* partial_losses = partial_losses_(n_chunks);
+    auto worker = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            const size_t row = n_runs == 1 ? 0 : i;
+            const size_t begin = n_runs == 1 ? i * chunk : 0;
+            const size_t n = std::min(run_length, begin + chunk) - begin;
+            partial_losses[i] = sigmoid_bce_(&y_true(row, 0) + begin, &logits(row, 0) + begin, &grad(row, 0) + begin, n, scale);
+        }
+    };
+    dispatch_(n_chunks, rows * cols, worker, dense ? 1 : std::max<size_t>(1, PARALLEL_GRAIN / cols));
+
+    return Reduce::sum(partial_losses, n_chunks) / n_elements;
+}
+
+template <typename T>
+double sigmoid_bce_with_logits(const BasicMatrix<T>& y_true, const BasicMatrix<T>& logits, BasicMatrix<T>& grad) {
+    if (grad.get_rows() != logits.get_rows() || grad.get_cols() != logits.get_cols()) {
+        grad = BasicMatrix<T>(logits.get_rows(), logits.get_cols());
+    }
+    return sigmoid_bce_with_logits(y_true.view(), logits.view(), grad.view());
+}
+
+#define LOSS_INSTANTIATE(T) \
+    template double mse(BasicMatrixView<const T>, BasicMatrixView<const T>); \
+    template double mse(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template BasicMatrix<T> mse_derivative(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template double mae(BasicMatrixView<const T>, BasicMatrixView<const T>); \
+    template double mae(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template BasicMatrix<T> mae_derivative(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template double categorical_cross_entropy(BasicMatrixView<const T>, BasicMatrixView<const T>); \
+    template double categorical_cross_entropy(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template BasicMatrix<T> categorical_cross_entropy_derivative(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template double binary_cross_entropy(BasicMatrixView<const T>, BasicMatrixView<const T>); \
+    template double binary_cross_entropy(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template BasicMatrix<T> binary_cross_entropy_derivative(const BasicMatrix<T>&, const BasicMatrix<T>&); \
+    template double softmax_cross_entropy_with_logits(BasicMatrixView<const T>, BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template double softmax_cross_entropy_with_logits(const BasicMatrix<T>&, const BasicMatrix<T>&, BasicMatrix<T>&); \
+    template double sigmoid_bce_with_logits(BasicMatrixView<const T>, BasicMatrixView<const T>, BasicMatrixView<T>); \
+    template double sigmoid_bce_with_logits(const BasicMatrix<T>&, const BasicMatrix<T>&, BasicMatrix<T>&);
+
+LOSS_INSTANTIATE(float)
+LOSS_INSTANTIATE(double)
+LOSS_INSTANTIATE(bfloat16)
+
+#undef LOSS_INSTANTIATE
+
+} // namespace Loss
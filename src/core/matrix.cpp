@@ -1,133 +1,193 @@
 #include "matrix.h"
+#include "gemm.h"
+#include "thread_pool.h"
+#include "numeric_policy.h"
+#include "parallel_tuning.h"
+#include "reduce.h"
+#include "profiler.h"
 #include <stdexcept>
-#include <thread>
 #include <cmath>
-#include <future>
 #include <random>
 #include <algorithm>
+#include <cstdint>
 
-using std::thread;
+namespace {
 
-Matrix::Matrix(size_t rows, size_t cols)
-    : data_(vector<vector<double>>(rows, vector<double>(cols, 0.0))), rows_(rows), cols_(cols) {}
+// Single post-hoc scan of freshly computed values, only done under a checking numeric policy
+template <typename T>
+void check_finite(bool checked, const T* data, size_t n, const char* message) {
+    if (checked && !Numeric::all_finite(data, n)) {
+        throw std::overflow_error(message);
+    }
+}
+
+// Same for rows [first, last) of a view whose rows need not be adjacent
+template <typename T>
+void check_finite_rows(bool checked, BasicMatrixView<T> view, size_t first, size_t last, const char* message) {
+    if (!checked) {
+        return;
+    }
+    if (view.is_contiguous()) {
+        check_finite(checked, view.data() + first * view.get_row_stride(), (last - first) * view.get_cols(), message);
+        return;
+    }
+    for (size_t row = first; row < last; ++row) {
+        check_finite(checked, view.data() + row * view.get_row_stride(), view.get_cols(), message);
+    }
+}
 
-Matrix::Matrix(size_t rows, size_t cols, double val) 
-    : data_(vector<vector<double>>(rows, vector<double>(cols, val))), rows_(rows), cols_(cols) {}
+}
+
+template <typename T>
+BasicMatrix<T>::BasicMatrix(size_t rows, size_t cols)
+    : data_(rows * cols, T(0.0)), rows_(rows), cols_(cols), stride_(cols) {}
+
+template <typename T>
+BasicMatrix<T>::BasicMatrix(size_t rows, size_t cols, T val) 
+    : data_(rows * cols, val), rows_(rows), cols_(cols), stride_(cols) {}
 
-Matrix::Matrix(const Matrix& mat)
-    : data_(mat.data_), rows_(mat.rows_), cols_(mat.cols_) {} 
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const BasicMatrix& mat)
+    : data_(mat.data_), rows_(mat.rows_), cols_(mat.cols_), stride_(mat.stride_) {} 
 
-Matrix::Matrix(const vector<double>& vec)
-    : data_(vector<vector<double>>(1, vec)), rows_(1), cols_(vec.size()) {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const vector<T>& vec)
+    : data_(vec.begin(), vec.end()), rows_(1), cols_(vec.size()), stride_(vec.size()) {
     if (vec.empty()) {
         rows_ = 0;
         cols_ = 0;
-        data_ = {};
+        stride_ = 0;
     }
 }
 
-Matrix::Matrix(const vector<vector<double>>& data) {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const vector<vector<T>>& data) {
     assign_from_(data);
 }
 
-Matrix::Matrix(Matrix&& mat) noexcept
-    : data_(move(mat.data_)), rows_(mat.rows_), cols_(mat.cols_) {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(BasicMatrix&& mat) noexcept
+    : data_(move(mat.data_)), rows_(mat.rows_), cols_(mat.cols_), stride_(mat.stride_) {
     mat.rows_ = 0;
     mat.cols_ = 0;
+    mat.stride_ = 0;
 }
 
-Matrix::Matrix(vector<vector<double>>&& data) {
-    assign_from_(std::move(data));
+template <typename T>
+BasicMatrix<T>::BasicMatrix(vector<vector<T>>&& data) {
+    assign_from_(data);
 }
 
-Matrix::Matrix(initializer_list<initializer_list<double>> init_list) {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(initializer_list<initializer_list<T>> init_list) {
     assign_from_(init_list);
 }
 
-vector<double>& Matrix::operator[](size_t row) {
-    return data_[row];
+template <typename T>
+RowSpan<T> BasicMatrix<T>::operator[](size_t row) {
+    return RowSpan<T>(data_.data() + row * stride_, cols_);
 }
 
-const vector<double>& Matrix::operator[](size_t row) const {
-    return data_[row];
+template <typename T>
+RowSpan<const T> BasicMatrix<T>::operator[](size_t row) const {
+    return RowSpan<const T>(data_.data() + row * stride_, cols_);
 }
 
-double& Matrix::operator()(size_t row, size_t col) {
-    if (row >= rows_ || row < 0 || col >= cols_ || col < 0) {
+template <typename T>
+T& BasicMatrix<T>::operator()(size_t row, size_t col) {
+    if (row >= rows_ || col >= cols_) {
         throw std::out_of_range("Matrix indices out of bounds!");
     }
-    return data_[row][col];
+    return data_[row * stride_ + col];
 }
 
-const double& Matrix::operator()(size_t row, size_t col) const {
+template <typename T>
+const T& BasicMatrix<T>::operator()(size_t row, size_t col) const {
     if (row >= rows_ || col >= cols_) {
         throw std::out_of_range("Matrix indices out of bounds!");
     }
-    return data_[row][col];
+    return data_[row * stride_ + col];
 }
 
-Matrix& Matrix::operator=(const Matrix& mat) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(const BasicMatrix& mat) {
     if (this != &mat) {
         data_ = mat.data_;
         rows_ = mat.rows_;
         cols_ = mat.cols_;    
+        stride_ = mat.stride_;
     }
     return *this;
 }
 
-Matrix& Matrix::operator=(Matrix&& mat) noexcept {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(BasicMatrix&& mat) noexcept {
     if (this != &mat) {
         data_ = std::move(mat.data_);
         rows_ = mat.rows_;
         cols_ = mat.cols_;
+        stride_ = mat.stride_;
         mat.rows_ = 0;
         mat.cols_ = 0;
+        mat.stride_ = 0;
     }
     return *this;
 }
 
-Matrix& Matrix::operator=(const vector<vector<double>>& data) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(const vector<vector<T>>& data) {
     assign_from_(data);
     return *this;
 }
 
-Matrix& Matrix::operator=(vector<vector<double>>&& data) {
-    assign_from_(std::move(data));
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(vector<vector<T>>&& data) {
+    assign_from_(data);
     return *this;
 }
 
-Matrix& Matrix::operator=(initializer_list<initializer_list<double>> init_list) {
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(initializer_list<initializer_list<T>> init_list) {
     assign_from_(init_list);
     return *this;
 }
 
-bool Matrix::operator==(const Matrix& mat) const {
+template <typename T>
+bool BasicMatrix<T>::operator==(const BasicMatrix& mat) const {
     return equals(mat);
 }
 
-bool Matrix::operator==(const vector<vector<double>>& data) const {
+template <typename T>
+bool BasicMatrix<T>::operator==(const vector<vector<T>>& data) const {
     return equals(data);
 }
 
-bool Matrix::operator==(initializer_list<initializer_list<double>> init_list) const {
+template <typename T>
+bool BasicMatrix<T>::operator==(initializer_list<initializer_list<T>> init_list) const {
     return equals(init_list);
 }
 
-bool Matrix::operator!=(const Matrix& mat) const {
+template <typename T>
+bool BasicMatrix<T>::operator!=(const BasicMatrix& mat) const {
     return !(*this == mat);
 }
 
-bool Matrix::operator!=(const vector<vector<double>>& data) const {
+template <typename T>
+bool BasicMatrix<T>::operator!=(const vector<vector<T>>& data) const {
     return !(*this == data);
 }
 
-bool Matrix::operator!=(initializer_list<initializer_list<double>> init_list) const {
+template <typename T>
+bool BasicMatrix<T>::operator!=(initializer_list<initializer_list<T>> init_list) const {
     return !(*this == init_list);
 }
 
-Matrix Matrix::operator+(double val) const {
-    Matrix result(rows_, cols_);
-    if (rows_ < PARALLEL_THRESHOLD) {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator+(T val) const {
+    PROFILE_ZONE("matrix.add_scalar");
+    PROFILE_FLOPS(rows_ * cols_);
+    BasicMatrix result(rows_, cols_);
+    if (!Parallel::use_pool(Parallel::Kernel::Elementwise, rows_ * cols_)) {
         add_sequentially_(val, result);
     } else {
         add_concurrently_(val, result);
@@ -135,37 +195,38 @@ Matrix Matrix::operator+(double val) const {
     return result;
 }
 
-Matrix operator+(double val, const Matrix& mat) {
-    return mat + val;
-}
-
-Matrix Matrix::operator+(const Matrix& mat) const {
-    if (rows_ != mat.rows_ || cols_ != mat.cols_) {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator+(View mat) const {
+    if (rows_ != mat.get_rows() || cols_ != mat.get_cols()) {
         throw std::domain_error("Matrices can not be added!");
     }
-    Matrix result(rows_, cols_);
-    if (rows_ < PARALLEL_THRESHOLD) {
-        add_sequentially_(mat, result);
-    } else {
-        add_concurrently_(mat, result);
-    }
+    BasicMatrix result(rows_, cols_);
+    combine_(mat, result, [](compute_t<T> a, compute_t<T> b) { return a + b; }, "Addition/subtraction overflowed!");
     return result;
 }
 
-Matrix Matrix::operator-(double val) const {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator-(T val) const {
     return (*this) + (-val);
 }
 
-Matrix Matrix::operator-(const Matrix& mat) const {
-    if (rows_ != mat.rows_ || cols_ != mat.cols_) {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator-(View mat) const {
+    if (rows_ != mat.get_rows() || cols_ != mat.get_cols()) {
         throw std::domain_error("Matrices can not be subtracted!");
     }
-    return (*this) + (-mat);
+    // Single pass instead of materializing -mat first
+    BasicMatrix result(rows_, cols_);
+    combine_(mat, result, [](compute_t<T> a, compute_t<T> b) { return a - b; }, "Addition/subtraction overflowed!");
+    return result;
 }
 
-Matrix Matrix::operator*(double val) const {
-    Matrix result(rows_, cols_);
-    if (rows_ < PARALLEL_THRESHOLD) {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator*(T val) const {
+    PROFILE_ZONE("matrix.multiply_scalar");
+    PROFILE_FLOPS(rows_ * cols_);
+    BasicMatrix result(rows_, cols_);
+    if (!Parallel::use_pool(Parallel::Kernel::Elementwise, rows_ * cols_)) {
         multiply_sequentially_(val, result);
     } else {
         multiply_concurrently_(val, result);
@@ -173,123 +234,103 @@ Matrix Matrix::operator*(double val) const {
     return result;
 }
 
-Matrix operator*(double val, const Matrix& mat) {
-    return mat * val;
-}
-
-Matrix Matrix::operator*(const Matrix& mat) const {
-    if (cols_ != mat.rows_) {
-        throw std::domain_error("Matrices can not be multiplied!");
-    }
-    Matrix result(rows_, mat.cols_);
-    if (rows_ * mat.cols_ < PARALLEL_THRESHOLD * PARALLEL_THRESHOLD) {
-        multiply_sequentially_(mat, result);
-    } else {
-        multiply_concurrently_(mat, result);
-    }
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator*(View mat) const {
+    BasicMatrix result;
+    multiply_into(view(), false, mat, false, result);
     return result;
 }
 
-Matrix Matrix::operator*(const vector<double>& vec) const {
-    Matrix row_matrix(vec); // size 1 x vec.size()
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator*(const vector<T>& vec) const {
+    BasicMatrix row_matrix(vec); // size 1 x vec.size()
     return (*this) * row_matrix;
 }
 
-Matrix operator*(const vector<double>& vec, const Matrix& mat) {
-    Matrix row_matrix(vec); // size 1 x vec.size()
-    return row_matrix * mat;
-}
-
-Matrix Matrix::operator-() const {
-    Matrix result(rows_, cols_);
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            result[row][col] = -data_[row][col];
-        }
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::operator-() const {
+    BasicMatrix result(rows_, cols_);
+    for (size_t i = 0; i < data_.size(); ++i) {
+        result.data_[i] = -data_[i];
     }
     return result;
 }
 
-Matrix Matrix::elementwise_mul(const Matrix& mat) const {
-    if (rows_ != mat.rows_ || cols_ != mat.cols_) {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::elementwise_mul(View mat) const {
+    if (rows_ != mat.get_rows() || cols_ != mat.get_cols()) {
         throw std::domain_error("Matrices can not be multiplied!");
     }
-    Matrix result(rows_, cols_);
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            long double v_ld = static_cast<long double>(data_[row][col]) *
-                               static_cast<long double>(mat[row][col]);
-            double v_d = static_cast<double>(v_ld);
-            if (!std::isfinite(v_d)) {
-                throw std::overflow_error("Multiplication overflowed!");
-            }
-            result[row][col] = v_d;
-        }
-    }    
+    BasicMatrix result(rows_, cols_);
+    combine_(mat, result, [](compute_t<T> a, compute_t<T> b) { return a * b; }, "Multiplication overflowed!");
     return result;
 }
 
-double& Matrix::at(size_t row, size_t col) {
+template <typename T>
+T& BasicMatrix<T>::at(size_t row, size_t col) {
     if (row >= rows_ || col >= cols_) {
         throw std::out_of_range("Matrix indices out of bounds!");
     }
-    return data_[row][col];
+    return data_[row * stride_ + col];
 }
 
-const double& Matrix::at(size_t row, size_t col) const {
+template <typename T>
+const T& BasicMatrix<T>::at(size_t row, size_t col) const {
     if (row >= rows_ || col >= cols_) {
         throw std::out_of_range("Matrix indices out of bounds!");
     }
-    return data_[row][col];
+    return data_[row * stride_ + col];
 }
 
-void Matrix::fill(double val) {
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            data_[row][col] = val;
-        }
-    }
+template <typename T>
+void BasicMatrix<T>::fill(T val) {
+    std::fill(data_.begin(), data_.end(), val);
 }
 
-Matrix Matrix::transpose() const {
-    Matrix mat(cols_, rows_);
-    for (size_t i = 0; i < cols_; ++i) {
-        for (size_t j = 0; j < rows_; ++j) {
-            mat[i][j] = data_[j][i];
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::transpose() const {
+    BasicMatrix mat(cols_, rows_);
+    for (size_t j = 0; j < rows_; ++j) {
+        const T* src = data_.data() + j * stride_;
+        for (size_t i = 0; i < cols_; ++i) {
+            mat.data_[i * mat.stride_ + j] = src[i];
         }
     }
     return mat;
 }
 
-void Matrix::resize(size_t new_rows, size_t new_cols) {
-    data_.resize(new_rows);
-    for (auto& row : data_) {
-        row.resize(new_cols, 0.0);
+template <typename T>
+void BasicMatrix<T>::resize(size_t new_rows, size_t new_cols) {
+    if (new_cols == cols_) {
+        data_.resize(new_rows * new_cols, T(0.0));
+        rows_ = new_rows;
+        return;
     }
+    Buffer data(new_rows * new_cols, T(0.0));
+    const size_t copy_rows = std::min(rows_, new_rows);
+    const size_t copy_cols = std::min(cols_, new_cols);
+    for (size_t row = 0; row < copy_rows; ++row) {
+        std::copy_n(data_.data() + row * stride_, copy_cols, data.data() + row * new_cols);
+    }
+    data_ = std::move(data);
     rows_ = new_rows;
     cols_ = new_cols;
+    stride_ = new_cols;
 }
 
-void Matrix::reshape(size_t new_rows, size_t new_cols) {
+template <typename T>
+void BasicMatrix<T>::reshape(size_t new_rows, size_t new_cols) {
     if (rows_ * cols_ != new_rows * new_cols) {
         throw std::invalid_argument("Total number of elements after the reshape operation must be preserved!");
     }
-    Matrix result(new_rows, new_cols);
-    size_t idx = 0;
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            size_t new_row = idx / new_cols;
-            size_t new_col = idx % new_cols;
-            result[new_row][new_col] = data_[row][col];
-            ++idx;
-        }
-    }
-    data_ = std::move(result.data_);
+    // Storage is dense and row-major, so the element order is already the reshaped one
     rows_ = new_rows;
     cols_ = new_cols;
+    stride_ = new_cols;
 }
 
-double Matrix::det() const {
+template <typename T>
+T BasicMatrix<T>::det() const {
     if (rows_ != cols_) {
         throw std::domain_error("Matrix has to be square in order to calculate determinant!");
     }
@@ -298,14 +339,14 @@ double Matrix::det() const {
         return 1.0;
     } 
     if (n == 1) {
-        return data_[0][0];
+        return data_[0];
     }
     if (n == 2) {
-        return data_[0][0] * data_[1][1] - data_[0][1] * data_[1][0];
+        return data_[0] * data_[stride_ + 1] - data_[1] * data_[stride_];
     }
 
-    auto data = data_;
-    double det = 1.0;
+    BasicMatrix data(*this);
+    T det = 1.0;
     int sign = 1;
 
     /* 
@@ -338,7 +379,7 @@ double Matrix::det() const {
         }
 
         if (pivot != i) {
-            std::swap(data[pivot], data[i]);
+            std::swap_ranges(data[pivot].begin(), data[pivot].end(), data[i].begin());
             sign = -sign;
         }
 
@@ -346,7 +387,7 @@ double Matrix::det() const {
 
         // Eliminate below
         for (size_t j = i + 1; j < n; ++j) {
-            double factor = data[j][i] / data[i][i];
+            T factor = data[j][i] / data[i][i];
             for (size_t k = i; k < n; ++k) {
                 data[j][k] -= factor * data[i][k];
             }
@@ -356,98 +397,63 @@ double Matrix::det() const {
     return det * sign;
 }
 
-double Matrix::trace() const {
+template <typename T>
+T BasicMatrix<T>::trace() const {
     if (rows_ != cols_ || rows_ == 0) {
         throw std::domain_error("Trace requires a non-empty square matrix!");
     }
-    long double v_ld = 0.0;
-    for (size_t i = 0; i < rows_; ++i) {
-        v_ld += static_cast<long double>(data_[i][i]);
-    }
-    double result = static_cast<double>(v_ld);
+    // The diagonal is a 1 x n view stepping over a row and a column at a time
+    const double total = Reduce::sum(BasicMatrixView<const T>(data(), 1, rows_, stride_ + 1, stride_ + 1));
+    const compute_t<T> result = static_cast<compute_t<T>>(total);
     if (!std::isfinite(result)) {
         throw std::overflow_error("Addition/subtraction overflowed!");
     }
     return result;
 }
 
-double Matrix::min() const {
-    if (rows_ == 0 || cols_ == 0) {
-        throw std::domain_error("Matrix can not be empty!");
-    }
-    double min = data_[0][0];
-    for (auto& row : data_) {
-        double row_min = *std::min_element(row.begin(), row.end());
-        min = std::min(min, row_min);
-    }
-    return min;
+template <typename T>
+T BasicMatrix<T>::min() const {
+    return view().min();
 }
 
-double Matrix::max() const {
-    if (rows_ == 0 || cols_ == 0) {
-        throw std::domain_error("Matrix can not be empty!");
-    }
-    double max = data_[0][0];
-    for (auto& row : data_) {
-        double row_max = *std::max_element(row.begin(), row.end());
-        max = std::max(max, row_max);
-    }
-    return max;
+template <typename T>
+T BasicMatrix<T>::max() const {
+    return view().max();
 }
 
-double Matrix::sum() const {
-    if (rows_ == 0 || cols_ == 0) {
-        return 0.0;
-    }
-    long double v_ld = 0.0;
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            v_ld += static_cast<long double>(data_[row][col]);
-        }
-    }
-    double result = static_cast<double>(v_ld);
-    if (!std::isfinite(result)) {
-        throw std::overflow_error("Sum operation overflowed!");
-    }
-    return result;
+template <typename T>
+T BasicMatrix<T>::sum() const {
+    return view().sum();
 }
 
-double Matrix::mean() const {
-    if (rows_ == 0 || cols_ == 0) {
-        return 0.0;
-    }
-    size_t n = rows_ * cols_;
-    double result = 0.0;
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            result += static_cast<long double>(data_[row][col] / n);
-        }
-    }
-    return result;
+template <typename T>
+T BasicMatrix<T>::mean() const {
+    return view().mean();
 }
 
-Matrix Matrix::inverse() const {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::inverse() const {
     if (rows_ != cols_) {
         throw std::invalid_argument("Inverse requires a square matrix!");
     }
     size_t n = rows_;
 
     if (n == 0) {
-        return Matrix(0, 0);
+        return BasicMatrix(0, 0);
     }
 
     if (n == 1) {
-        if (std::abs(data_[0][0]) < eps) {
+        if (std::abs(data_[0]) < eps) {
             throw std::runtime_error("Inverse does not exist, because matrix is singular!");
         }
-        return Matrix(1, 1, 1.0 / data_[0][0]);
+        return BasicMatrix(1, 1, 1.0 / data_[0]);
     }
 
     // Augment matrix with identity
-    vector<vector<double>> aug(n, vector<double>(2 * n));
+    BasicMatrix aug(n, 2 * n);
     for (size_t i = 0; i < n; ++i) {
         for (size_t j = 0; j < n; ++j) {
-            aug[i][j] = data_[i][j];
+            aug[i][j] = data_[i * stride_ + j];
         }
         aug[i][n + i] = 1.0;
     }
@@ -467,11 +473,11 @@ Matrix Matrix::inverse() const {
         }
 
         if (pivot != i) {
-            std::swap(aug[pivot], aug[i]);
+            std::swap_ranges(aug[pivot].begin(), aug[pivot].end(), aug[i].begin());
         }
 
         // Normalize pivot row
-        double diag = aug[i][i];
+        T diag = aug[i][i];
         for (size_t j = 0; j < 2 * n; ++j) {
             aug[i][j] /= diag;
         }
@@ -481,7 +487,7 @@ Matrix Matrix::inverse() const {
             if (row == i) {
                 continue;
             }
-            double factor = aug[row][i];
+            T factor = aug[row][i];
             for (size_t j = 0; j < 2 * n; ++j) {
                 aug[row][j] -= factor * aug[i][j];
             }
@@ -489,17 +495,18 @@ Matrix Matrix::inverse() const {
     }
 
     // Extract inverse from augmented matrix
-    vector<vector<double>> inv_data(n, vector<double>(n));
+    BasicMatrix inv(n, n);
     for (size_t i = 0; i < n; ++i) {
         for (size_t j = 0; j < n; ++j) {
-            inv_data[i][j] = aug[i][n + j];
+            inv[i][j] = aug[i][n + j];
         }
     }
 
-    return Matrix(std::move(inv_data));
+    return inv;
 }
 
-Matrix Matrix::flatten() const {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::flatten() const {
     if (rows_ == 0 || cols_ == 0) {
         return {};
     }
@@ -508,96 +515,65 @@ Matrix Matrix::flatten() const {
         return *this;
     }
 
-    Matrix result(1, rows_ * cols_);
-    size_t i = 0;
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            result[0][i] = data_[row][col];
-            ++i;
-        }
-    }
-
+    BasicMatrix result(*this);
+    result.reshape(1, rows_ * cols_);
     return result;
 }
 
-void Matrix::fill_random(double min, double max) {
+template <typename T>
+void BasicMatrix<T>::fill_random(double min, double max) {
     static thread_local std::mt19937 gen(std::random_device{}());
     std::uniform_real_distribution<double> dist(min, max);
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            data_[row][col] = dist(gen);
-        }
+    for (T& val : data_) {
+        val = static_cast<T>(dist(gen));
     }
 }
 
-Matrix Matrix::add_bias_row(double val, bool prepend) const {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::add_bias_row(T val, bool prepend) const {
     if (rows_ == 0 || cols_ == 0) {
         return {};
     }
-    Matrix result(rows_ + 1, cols_);
-    if (prepend) {
-        for (size_t col = 0; col < cols_; ++col) {
-            result[0][col] = val;
-        }
-        for (size_t row = 0; row < rows_; ++row) {
-            result[row + 1] = data_[row];
-        }
-    } else {
-        for (size_t row = 0; row < rows_; ++row) {
-            result[row] = data_[row];
-        }
-        for (size_t col = 0; col < cols_; ++col) {
-            result[rows_][col] = val;
-        }
-    }
+    BasicMatrix result(rows_ + 1, cols_);
+    const size_t bias_row = prepend ? 0 : rows_;
+    const size_t first_row = prepend ? 1 : 0;
+    std::fill_n(result.data_.data() + bias_row * result.stride_, cols_, val);
+    std::copy(data_.begin(), data_.end(), result.data_.begin() + first_row * result.stride_);
     return result;
 }
 
-Matrix Matrix::add_bias_column(double val, bool prepend) const {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::add_bias_column(T val, bool prepend) const {
     if (rows_ == 0 || cols_ == 0) {
         return {};
     }
-    Matrix result(rows_, cols_ + 1);
+    BasicMatrix result(rows_, cols_ + 1);
+    const size_t bias_col = prepend ? 0 : cols_;
+    const size_t first_col = prepend ? 1 : 0;
     for (size_t row = 0; row < rows_; ++row) {
-        if (prepend) {
-            result[row][0] = val;
-            for (size_t col = 0; col < cols_; ++col) {
-                result[row][col + 1] = data_[row][col];
-            }    
-        } else {
-            for (size_t col = 0; col < cols_; ++col) {
-                result[row][col] = data_[row][col];
-            }    
-            result[row][cols_] = val;
-        }
+        auto result_row = result[row];
+        result_row[bias_col] = val;
+        std::copy_n(data_.data() + row * stride_, cols_, result_row.data() + first_col);
     }
     return result;
 }
 
-bool Matrix::equals(const Matrix& mat) const {
-    if (rows_ != mat.rows_ || cols_ != mat.cols_) {
-        return false;
-    }
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            if (abs(data_[row][col] - mat.data_[row][col]) > eps) {
-                return false;
-            }
-        }
-    }
-    return true;
+template <typename T>
+bool BasicMatrix<T>::equals(const BasicMatrix& mat) const {
+    return view().equals(mat.view());
 }
 
-bool Matrix::equals(const vector<vector<double>>& data) const {
+template <typename T>
+bool BasicMatrix<T>::equals(const vector<vector<T>>& data) const {
     if (data.empty()) {
-        return data_.empty();
+        return rows_ == 0;
     }
     if (rows_ != data.size() || cols_ != data[0].size()) {
         return false;
     }
     for (size_t row = 0; row < rows_; ++row) {
         for (size_t col = 0; col < cols_; ++col) {
-            if (abs(data_[row][col] - data[row][col]) > eps) {
+            if (abs(static_cast<double>(data_[row * stride_ + col] - data[row][col])) > eps) {
                 return false;
             }
         }
@@ -605,51 +581,24 @@ bool Matrix::equals(const vector<vector<double>>& data) const {
     return true;
 }
 
-bool Matrix::equals(initializer_list<initializer_list<double>> init_list) const {
-    if (init_list.size() != rows_) {
-        return false;
-    }
-
-    // Case of empty init list and 0 rows
-    if (rows_ == 0) {
-        return cols_ == 0;
-    }
-
-    const size_t cols = init_list.begin()->size();
-    if (cols != cols_) {
-        return false;
-    }
-
-    size_t i = 0;
-    for (const auto& row : init_list) {
-        if (row.size() != cols) {
-            return false;
-        }
-        size_t j = 0;
-        for (double val : row) {
-            if (abs(data_[i][j] - val) > eps) {
-                return false;
-            }
-            ++j;
-        }
-        ++i;
-    }
-    
-    return true;
+template <typename T>
+bool BasicMatrix<T>::equals(initializer_list<initializer_list<T>> init_list) const {
+    return view().equals(init_list);
 }
 
-ostream& operator<<(ostream& os, const Matrix& mat) {
+template <typename T>
+ostream& BasicMatrix<T>::print_(ostream& os) const {
     os << "\n[";
-    for (size_t row = 0; row < mat.get_rows(); ++row) {
+    for (size_t row = 0; row < rows_; ++row) {
         os << "[";
-        for (size_t col = 0; col < mat.get_cols(); ++col) {
-            os << mat.data_[row][col];
-            if (col < mat.get_cols() - 1) {
+        for (size_t col = 0; col < cols_; ++col) {
+            os << data_[row * stride_ + col];
+            if (col < cols_ - 1) {
                 os << ", ";
             }
         }
         os << "]";
-        if (row < mat.get_rows() - 1) {
+        if (row < rows_ - 1) {
             os << ",\n";
         }
     }
@@ -657,288 +606,457 @@ ostream& operator<<(ostream& os, const Matrix& mat) {
     return os;
 }
 
-Matrix Matrix::identity(size_t size) {
-    Matrix mat(size, size, 0.0);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::identity(size_t size) {
+    BasicMatrix mat(size, size, 0.0);
     for (size_t i = 0; i < size; ++i) {
         mat[i][i] = 1.0;
     }
     return mat;
 }
 
-Matrix Matrix::zeros(size_t rows, size_t cols) {
-    return Matrix(rows, cols, 0.0);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::zeros(size_t rows, size_t cols) {
+    return BasicMatrix(rows, cols, 0.0);
 }
 
-Matrix Matrix::ones(size_t rows, size_t cols) {
-    return Matrix(rows, cols, 1.0);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::ones(size_t rows, size_t cols) {
+    return BasicMatrix(rows, cols, 1.0);
 }
 
-Matrix Matrix::diagonal(size_t size, double val) {
-    Matrix mat(size, size);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::diagonal(size_t size, T val) {
+    BasicMatrix mat(size, size);
     for (size_t i = 0; i < mat.rows_; ++i) {
         mat[i][i] = val;
     }
     return mat;
 }
 
-void Matrix::validate_and_set_shape_(const vector<vector<double>>& vec) {
+template <typename T>
+void BasicMatrix<T>::multiply_into(View lhs, bool lhs_transposed, View rhs, bool rhs_transposed, BasicMatrix& result) {
+    // A transposed operand is just a view with swapped strides
+    if (lhs_transposed) {
+        lhs = lhs.transpose();
+    }
+    if (rhs_transposed) {
+        rhs = rhs.transpose();
+    }
+    const size_t rows = lhs.get_rows();
+    const size_t cols = rhs.get_cols();
+    if (lhs.get_cols() != rhs.get_rows()) {
+        throw std::domain_error("Matrices can not be multiplied!");
+    }
+    auto reads_from_result = [&result](View operand) {
+        const T* begin = result.data_.data();
+        const T* end = begin + result.data_.size();
+        return !result.data_.empty() && !std::less<const T*>()(operand.data(), begin) && std::less<const T*>()(operand.data(), end);
+    };
+    if (reads_from_result(lhs) || reads_from_result(rhs)) {
+        BasicMatrix tmp;
+        multiply_into(lhs, false, rhs, false, tmp);
+        result = std::move(tmp);
+        return;
+    }
+    if (result.rows_ != rows || result.cols_ != cols) {
+        result = BasicMatrix(rows, cols);
+    }
+    multiply_into(lhs, false, rhs, false, result.view());
+}
+
+template <typename T>
+void BasicMatrix<T>::multiply_into(View lhs, bool lhs_transposed, View rhs, bool rhs_transposed, Span result,
+                                   const Gemm::Epilogue<T>& epilogue) {
+    PROFILE_ZONE("gemm");
+    if (lhs_transposed) {
+        lhs = lhs.transpose();
+    }
+    if (rhs_transposed) {
+        rhs = rhs.transpose();
+    }
+    if (lhs.get_cols() != rhs.get_rows()) {
+        throw std::domain_error("Matrices can not be multiplied!");
+    }
+    if (result.get_rows() != lhs.get_rows() || result.get_cols() != rhs.get_cols()) {
+        throw std::invalid_argument("Result view has the wrong shape for the multiplication!");
+    }
+    if (result.get_col_stride() != 1 && result.get_cols() > 1) {
+        throw std::invalid_argument("Result view of a multiplication must have contiguous rows!");
+    }
+    if (result.is_empty()) {
+        return;
+    }
+    // Whole extents are compared, an operand may start before the result and still run into it
+    auto reads_from_result = [&result](View operand) {
+        if (operand.is_empty()) {
+            return false;
+        }
+        auto address = [](const T* ptr) { return reinterpret_cast<uintptr_t>(ptr); };
+        const uintptr_t begin = address(result.data());
+        const uintptr_t end = address(result.data() + (result.get_rows() - 1) * result.get_row_stride() + result.get_cols());
+        const uintptr_t operand_begin = address(operand.data());
+        const uintptr_t operand_end = address(operand.data() + (operand.get_rows() - 1) * operand.get_row_stride()
+                                              + (operand.get_cols() - 1) * operand.get_col_stride() + 1);
+        if (operand_begin >= end || begin >= operand_end) {
+            return false;
+        }
+        // Row blocks of the same matrix (same row stride) only overlap where their column ranges do
+        const size_t stride = result.get_row_stride();
+        if (operand.get_col_stride() == 1 && operand.get_row_stride() == stride && stride >= result.get_cols()
+            && operand_begin % sizeof(T) == begin % sizeof(T)) {
+            const ptrdiff_t offset = (static_cast<ptrdiff_t>(operand_begin) - static_cast<ptrdiff_t>(begin)) / static_cast<ptrdiff_t>(sizeof(T));
+            const size_t col = static_cast<size_t>(((offset % static_cast<ptrdiff_t>(stride)) + static_cast<ptrdiff_t>(stride))
+                                                   % static_cast<ptrdiff_t>(stride));
+            return col < result.get_cols() || col + operand.get_cols() > stride;
+        }
+        return true;
+    };
+    if (reads_from_result(lhs) || reads_from_result(rhs)) {
+        throw std::invalid_argument("Result view of a multiplication can not alias its operands!");
+    }
+    PROFILE_FLOPS(2 * result.get_rows() * result.get_cols() * lhs.get_cols());
+    if (!Parallel::use_pool(Parallel::Kernel::Gemm, result.get_rows() * result.get_cols() * lhs.get_cols())) {
+        multiply_sequentially_(lhs, rhs, result, epilogue);
+    } else {
+        multiply_concurrently_(lhs, rhs, result, epilogue);
+    }
+}
+
+template <typename T>
+void BasicMatrix<T>::validate_and_set_shape_(const vector<vector<T>>& vec) {
     if (vec.empty()) {
         rows_ = 0;
         cols_ = 0;
         return;
     }
-    cols_ = vec[0].size();
+    const size_t cols = vec[0].size();
     for (const auto& row : vec) {
-        if (row.size() != cols_) {
+        if (row.size() != cols) {
             throw std::invalid_argument("All rows must have the same number of columns!");
         }
     }
     rows_ = vec.size();
+    cols_ = cols;
 }
 
-void Matrix::assign_from_(const vector<vector<double>>& vec) {
+template <typename T>
+void BasicMatrix<T>::assign_from_(const vector<vector<T>>& vec) {
     validate_and_set_shape_(vec);
-    data_ = vec;
-}
-
-void Matrix::assign_from_(const vector<vector<double>>&& vec) {
-    validate_and_set_shape_(vec);
-    data_ = std::move(vec);
+    stride_ = cols_;
+    data_.clear();
+    data_.reserve(rows_ * cols_);
+    for (const auto& row : vec) {
+        data_.insert(data_.end(), row.begin(), row.end());
+    }
 }
 
-void Matrix::assign_from_(initializer_list<initializer_list<double>> init_list) {
-    rows_ = init_list.size();
-    cols_ = rows_ ? init_list.begin()->size() : 0;
+template <typename T>
+void BasicMatrix<T>::assign_from_(initializer_list<initializer_list<T>> init_list) {
+    const size_t rows = init_list.size();
+    const size_t cols = rows ? init_list.begin()->size() : 0;
     for (const auto& row : init_list) {
-        if (row.size() != cols_) {
+        if (row.size() != cols) {
             throw std::invalid_argument("All rows must have the same number of columns!");
         }
     }
+    rows_ = rows;
+    cols_ = cols;
+    stride_ = cols;
     data_.clear();
-    data_.reserve(rows_);
+    data_.reserve(rows_ * cols_);
     for (const auto& row : init_list) {
-        data_.emplace_back(row);
+        data_.insert(data_.end(), row.begin(), row.end());
     }
 }
 
-void Matrix::add_sequentially_(double val, Matrix& result) const {
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            long double v_ld = static_cast<long double>(data_[row][col]) +
-                               static_cast<long double>(val);
-            double v_d = static_cast<double>(v_ld);
-            if (!std::isfinite(v_d)) {
-                throw std::overflow_error("Addition/subtraction overflowed!");
+template <typename T>
+template <typename Op>
+void BasicMatrix<T>::combine_(View mat, BasicMatrix& result, Op op, const char* overflow_message) const {
+    PROFILE_ZONE("matrix.elementwise");
+    PROFILE_FLOPS(rows_ * cols_);
+    // The policy is thread-local, so it is resolved here and not in the workers
+    const bool checked = Numeric::checks_enabled();
+    const size_t rs = mat.get_row_stride();
+    const size_t cs = mat.get_col_stride();
+
+    auto worker = [&](size_t start, size_t end) {
+        end = std::min(end, rows_);
+        for (size_t row = start; row < end; ++row) {
+            const T* lhs = data_.data() + row * stride_;
+            const T* rhs = mat.data() + row * rs;
+            T* out = result.data_.data() + row * result.stride_;
+            if (cs == 1) {
+                for (size_t col = 0; col < cols_; ++col) {
+                    out[col] = op(lhs[col], rhs[col]);
+                }
+            } else {
+                for (size_t col = 0; col < cols_; ++col) {
+                    out[col] = op(lhs[col], rhs[col * cs]);
+                }
             }
-            result[row][col] = v_d;
         }
+        if (start < end) {
+            check_finite(checked, result.data_.data() + start * result.stride_, (end - start) * result.stride_, overflow_message);
+        }
+    };
+
+    if (!Parallel::use_pool(Parallel::Kernel::Elementwise, rows_ * cols_)) {
+        worker(0, rows_);
+    } else {
+        // Divide the rows among the pool threads, exceptions are propagated to this thread
+        parallel_for(0, rows_, worker);
     }
 }
 
-void Matrix::add_sequentially_(const Matrix& mat, Matrix& result) const {
-    for (size_t row = 0; row < rows_; ++row) {
-        for (size_t col = 0; col < cols_; ++col) {
-            long double v_ld = static_cast<long double>(data_[row][col]) + 
-                               static_cast<long double>(mat.data_[row][col]);
-            double v_d = static_cast<double>(v_ld);
-            if (!std::isfinite(v_d)) {
-                throw std::overflow_error("Addition/subtraction overflowed!");
-            }
-            result[row][col] = v_d;
-        }
+template <typename T>
+void BasicMatrix<T>::add_sequentially_(T val, BasicMatrix& result) const {
+    const T* in = data_.data();
+    T* out = result.data_.data();
+    for (size_t i = 0; i < data_.size(); ++i) {
+        out[i] = in[i] + val;
     }
+    check_finite(Numeric::checks_enabled(), out, result.data_.size(), "Addition/subtraction overflowed!");
 }
-    
-void Matrix::add_concurrently_(double val, Matrix& result) const {
-    size_t num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) {
-        num_threads = 2;
-    }
 
-    // formula for ceil() math function on integers, adding the (divisor - 1) bumps the remainder fraction to 1
-    size_t chunk = (rows_ + num_threads - 1) / num_threads; 
+    
+template <typename T>
+void BasicMatrix<T>::add_concurrently_(T val, BasicMatrix& result) const {
+    // The policy is thread-local, so it is resolved here and not in the workers
+    const bool checked = Numeric::checks_enabled();
 
     // Define lambda function to calculate cell value (division of calculations on rows)
     auto worker = [&](size_t start, size_t end) {
-        for (size_t row = 0; row < rows_; ++row) {
-            for (size_t col = 0; col < cols_; ++col) {
-                long double v_ld = static_cast<long double>(data_[row][col]) +
-                                   static_cast<long double>(val);
-                double v_d = static_cast<double>(v_ld);
-                if (!std::isfinite(v_d)) {
-                    throw std::overflow_error("Addition/subtraction overflowed!");
-                }
-                result[row][col] = v_d;
-            }
+        const size_t first = std::min(start, rows_) * stride_;
+        const size_t last = std::min(end, rows_) * stride_;
+        const T* in = data_.data();
+        T* out = result.data_.data();
+        for (size_t i = first; i < last; ++i) {
+            out[i] = in[i] + val;
         }
+        check_finite(checked, out + first, last - first, "Addition/subtraction overflowed!");
     };
 
-    // Divide the calculations among threads
-    std::vector<std::future<void>> futures;
-    futures.reserve(num_threads);
-    for (size_t t = 0; t < num_threads; ++t) {
-        size_t start = t * chunk;
-        size_t end = start + chunk;
-        futures.push_back(std::async(std::launch::async, worker, start, end));
-    }
-    
-    // Propagate exceptions to the main thread, if any were thrown
-    for (auto& f : futures) {
-        f.get();
-    }
+    // Divide the rows among the pool threads, exceptions are propagated to this thread
+    parallel_for(0, rows_, worker);
 }
 
-void Matrix::add_concurrently_(const Matrix& mat, Matrix& result) const {
-    size_t num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) {
-        num_threads = 2;
+
+template <typename T>
+void BasicMatrix<T>::multiply_sequentially_(T val, BasicMatrix& result) const {
+    const T* in = data_.data();
+    T* out = result.data_.data();
+    for (size_t i = 0; i < data_.size(); ++i) {
+        out[i] = in[i] * val;
     }
+    check_finite(Numeric::checks_enabled(), out, result.data_.size(), "Matrix multiplication overflowed!");
+}
+
+template <typename T>
+void BasicMatrix<T>::multiply_sequentially_(View lhs, View rhs, Span result, const Gemm::Epilogue<T>& epilogue) {
+    Gemm::multiply(result.get_rows(), result.get_cols(), lhs.get_cols(),
+                   lhs.data(), lhs.get_row_stride(), lhs.get_col_stride(),
+                   rhs.data(), rhs.get_row_stride(), rhs.get_col_stride(),
+                   result.data(), result.get_row_stride(), false, epilogue);
+    check_finite_rows(Numeric::checks_enabled(), result, 0, result.get_rows(), "Matrix multiplication overflowed!");
+}
 
-    // formula for ceil() math function on integers, adding the (divisor - 1) bumps the remainder fraction to 1
-    size_t chunk = (rows_ + num_threads - 1) / num_threads; 
+template <typename T>
+void BasicMatrix<T>::multiply_concurrently_(T val, BasicMatrix& result) const {
+    const bool checked = Numeric::checks_enabled();
 
     // Define lambda function to calculate cell value (division of calculations on rows)
     auto worker = [&](size_t start, size_t end) {
-        for (size_t row = 0; row < rows_; ++row) {
-            for (size_t col = 0; col < cols_; ++col) {
-                long double v_ld = static_cast<long double>(data_[row][col]) + 
-                                   static_cast<long double>(mat.data_[row][col]);
-                double v_d = static_cast<double>(v_ld);
-                if (!std::isfinite(v_d)) {
-                    throw std::overflow_error("Addition/subtraction overflowed!");
-                }
-                result[row][col] = v_d;
-            }
+        const size_t first = std::min(start, rows_) * stride_;
+        const size_t last = std::min(end, rows_) * stride_;
+        const T* in = data_.data();
+        T* out = result.data_.data();
+        for (size_t i = first; i < last; ++i) {
+            out[i] = in[i] * val;
         }
+        check_finite(checked, out + first, last - first, "Matrix multiplication overflowed!");
+    };
+
+    // Divide the rows among the pool threads, exceptions are propagated to this thread
+    parallel_for(0, rows_, worker);
+}
+
+template <typename T>
+void BasicMatrix<T>::multiply_concurrently_(View lhs, View rhs, Span result, const Gemm::Epilogue<T>& epilogue) {
+    const bool checked = Numeric::checks_enabled();
+    const size_t rows = result.get_rows();
+    const size_t cols = result.get_cols();
+    const size_t n_threads = ThreadPool::instance().size();
+
+    // Computes rows [row_begin, row_end) x columns [col_begin, col_end) of the result
+    auto multiply_block = [&](size_t row_begin, size_t row_end, size_t col_begin, size_t col_end) {
+        Gemm::multiply(row_end - row_begin, col_end - col_begin, lhs.get_cols(),
+                       lhs.data() + row_begin * lhs.get_row_stride(), lhs.get_row_stride(), lhs.get_col_stride(),
+                       rhs.data() + col_begin * rhs.get_col_stride(), rhs.get_row_stride(), rhs.get_col_stride(),
+                       result.data() + row_begin * result.get_row_stride() + col_begin, result.get_row_stride(),
+                       false, epilogue.at(row_begin, col_begin));
+        check_finite_rows(checked, result.col_range(col_begin, col_end), row_begin, row_end, "Matrix multiplication overflowed!");
     };
 
-    // Divide the calculations among threads
-    std::vector<std::future<void>> futures;
-    futures.reserve(num_threads);
-    for (size_t t = 0; t < num_threads; ++t) {
-        size_t start = t * chunk;
-        size_t end = start + chunk;
-        futures.push_back(std::async(std::launch::async, worker, start, end));
+    // Bands of whole MC row blocks, so every band packs A the way the sequential kernel does and
+    // B is packed once per band. With fewer row blocks than threads, split the columns instead
+    // into NR-aligned bands, each packing its own part of B and the (small) A.
+    const size_t n_row_blocks = (rows + Gemm::MC - 1) / Gemm::MC;
+    if (n_row_blocks >= n_threads) {
+        parallel_for(0, n_row_blocks, [&](size_t first, size_t last) {
+            multiply_block(first * Gemm::MC, std::min(last * Gemm::MC, rows), 0, cols);
+        });
+        return;
     }
-    
-    // Propagate exceptions to the main thread, if any were thrown
-    for (auto& f : futures) {
-        f.get();
+    constexpr size_t nr = Gemm::NR_OF<T>;
+    const size_t band = std::max<size_t>(1, (cols + n_threads * nr - 1) / (n_threads * nr)) * nr;
+    parallel_for(0, (cols + band - 1) / band, [&](size_t first, size_t last) {
+        multiply_block(0, rows, first * band, std::min(last * band, cols));
+    });
+}
+
+// --------------------------------------------------
+//  BasicMatrixView
+// --------------------------------------------------
+
+template <typename T>
+T& BasicMatrixView<T>::at(size_t row, size_t col) const {
+    if (row >= rows_ || col >= cols_) {
+        throw std::out_of_range("Matrix view indices out of bounds!");
     }
+    return (*this)(row, col);
 }
 
-void Matrix::multiply_sequentially_(double val, Matrix& result) const {
-    for (size_t row = 0; row < rows_; ++row) {
-        long double v_ld = 0.0;
-        for (size_t col = 0; col < cols_; ++col) {
-            v_ld = static_cast<long double>(data_[row][col]) * 
-                   static_cast<long double>(val);
-            double v_d = static_cast<double>(v_ld);
-            if (!std::isfinite(v_d)) {
-                throw std::overflow_error("Matrix multiplication overflowed!");
-            }
-            result[row][col] = v_d;
-        }
+template <typename T>
+BasicMatrixView<T> BasicMatrixView<T>::row_range(size_t begin, size_t end) const {
+    if (begin > end || end > rows_) {
+        throw std::out_of_range("Invalid row range of a matrix view!");
     }
+    return { data_ + begin * row_stride_, end - begin, cols_, row_stride_, col_stride_ };
 }
 
-void Matrix::multiply_sequentially_(const Matrix& mat, Matrix& result) const {
-    size_t common_dim = cols_; 
-    for (size_t row = 0; row < result.rows_; ++row) {
-        for (size_t col = 0; col < result.cols_; ++col) {
-            long double v_ld = 0.0;
-            for (size_t i = 0; i < common_dim; ++i) {
-                v_ld += static_cast<long double>(data_[row][i]) * 
-                       static_cast<long double>(mat.data_[i][col]);
-            }
-            double v_d = static_cast<double>(v_ld);
-            if (!std::isfinite(v_d)) {
-                throw std::overflow_error("Matrix multiplication overflowed!");
-            }
-            result[row][col] = v_d;
-        }
+template <typename T>
+BasicMatrixView<T> BasicMatrixView<T>::col_range(size_t begin, size_t end) const {
+    if (begin > end || end > cols_) {
+        throw std::out_of_range("Invalid column range of a matrix view!");
     }
+    return { data_ + begin * col_stride_, rows_, end - begin, row_stride_, col_stride_ };
 }
 
-void Matrix::multiply_concurrently_(double val, Matrix& result) const {
-    size_t num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) {
-        num_threads = 2;
+template <typename T>
+BasicMatrixView<T> BasicMatrixView<T>::block(size_t row, size_t col, size_t n_rows, size_t n_cols) const {
+    return row_range(row, row + n_rows).col_range(col, col + n_cols);
+}
+
+template <typename T>
+typename BasicMatrixView<T>::value_type BasicMatrixView<T>::min() const {
+    if (is_empty()) {
+        throw std::domain_error("Matrix can not be empty!");
     }
+    return Reduce::min(BasicMatrixView<const value_type>(*this));
+}
 
-    // formula for ceil() math function on integers, adding the (divisor - 1) bumps the remainder fraction to 1
-    size_t chunk = (rows_ + num_threads - 1) / num_threads; 
+template <typename T>
+typename BasicMatrixView<T>::value_type BasicMatrixView<T>::max() const {
+    if (is_empty()) {
+        throw std::domain_error("Matrix can not be empty!");
+    }
+    return Reduce::max(BasicMatrixView<const value_type>(*this));
+}
 
-    // Define lambda function to calculate cell value (division of calculations on rows)
-    auto worker = [&](size_t start, size_t end) {
-        for (size_t row = start; row < end && row < rows_; ++row) {
-            long double v_ld = 0.0;
+template <typename T>
+typename BasicMatrixView<T>::value_type BasicMatrixView<T>::sum() const {
+    if (is_empty()) {
+        return value_type(0.0);
+    }
+    const compute_t<value_type> result = static_cast<compute_t<value_type>>(Reduce::sum(BasicMatrixView<const value_type>(*this)));
+    if (!std::isfinite(result)) {
+        throw std::overflow_error("Sum operation overflowed!");
+    }
+    return result;
+}
+
+template <typename T>
+typename BasicMatrixView<T>::value_type BasicMatrixView<T>::mean() const {
+    if (is_empty()) {
+        return value_type(0.0);
+    }
+    // Scaling each element first keeps the mean finite where the sum would overflow
+    const Reduce::Scale scale{ 1.0 / static_cast<double>(rows_ * cols_) };
+    return static_cast<compute_t<value_type>>(Reduce::sum(BasicMatrixView<const value_type>(*this), scale));
+}
+
+template <typename T>
+BasicMatrix<typename BasicMatrixView<T>::value_type> BasicMatrixView<T>::to_matrix() const {
+    BasicMatrix<value_type> result(rows_, cols_);
+    for (size_t row = 0; row < rows_; ++row) {
+        value_type* out = result.data() + row * result.get_stride();
+        if (col_stride_ == 1) {
+            std::copy_n(data_ + row * row_stride_, cols_, out);
+        } else {
             for (size_t col = 0; col < cols_; ++col) {
-                v_ld = static_cast<long double>(data_[row][col]) * 
-                    static_cast<long double>(val);
-                double v_d = static_cast<double>(v_ld);
-                if (!std::isfinite(v_d)) {
-                    throw std::overflow_error("Matrix multiplication overflowed!");
-                }
-                result[row][col] = v_d;
+                out[col] = (*this)(row, col);
             }
         }
-    };
+    }
+    return result;
+}
 
-    // Divide the calculations among threads
-    std::vector<std::future<void>> futures;
-    futures.reserve(num_threads);
-    for (size_t t = 0; t < num_threads; ++t) {
-        size_t start = t * chunk;
-        size_t end = start + chunk;
-        futures.push_back(std::async(std::launch::async, worker, start, end));
+template <typename T>
+bool BasicMatrixView<T>::equals(BasicMatrixView<const value_type> mat) const {
+    if (rows_ != mat.get_rows() || cols_ != mat.get_cols()) {
+        return false;
     }
-    
-    // Propagate exceptions to the main thread, if any were thrown
-    for (auto& f : futures) {
-        f.get();
+    for (size_t row = 0; row < rows_; ++row) {
+        for (size_t col = 0; col < cols_; ++col) {
+            if (abs(static_cast<double>((*this)(row, col) - mat(row, col))) > BasicMatrix<value_type>::eps) {
+                return false;
+            }
+        }
     }
+    return true;
 }
 
-void Matrix::multiply_concurrently_(const Matrix& mat, Matrix& result) const {
-    size_t num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) {
-        num_threads = 2;
+template <typename T>
+bool BasicMatrixView<T>::equals(initializer_list<initializer_list<value_type>> init_list) const {
+    if (init_list.size() != rows_) {
+        return false;
     }
-   
-    // formula for ceil() math function on integers, adding the (divisor - 1) bumps the remainder fraction to 1
-    size_t chunk = (rows_ + num_threads - 1) / num_threads;
 
-    // Define lambda function to calculate cell value (division of calculations on rows)
-    auto worker = [&](size_t start, size_t end) {
-        size_t common_dim = cols_; 
-        for (size_t row = start; row < end && row < rows_; ++row) {
-            for (size_t col = 0; col < mat.cols_; ++col) {
-                long double sum = 0;
-                for (size_t i = 0; i < common_dim; ++i) {
-                    sum += static_cast<long double>(data_[row][i]) *
-                           static_cast<long double>(mat.data_[i][col]);
-                }
-                double v = static_cast<double>(sum);
-                if (!std::isfinite(v)) {
-                    throw std::overflow_error("Matrix multiplication overflowed!");
-                }
-                result[row][col] = v;
+    // Case of empty init list and 0 rows
+    if (rows_ == 0) {
+        return cols_ == 0;
+    }
+
+    const size_t cols = init_list.begin()->size();
+    if (cols != cols_) {
+        return false;
+    }
+
+    size_t i = 0;
+    for (const auto& row : init_list) {
+        if (row.size() != cols) {
+            return false;
+        }
+        size_t j = 0;
+        for (value_type val : row) {
+            if (abs(static_cast<double>((*this)(i, j) - val)) > BasicMatrix<value_type>::eps) {
+                return false;
             }
+            ++j;
         }
-    };
-
-    // Divide the calculations among threads
-    std::vector<std::future<void>> futures;
-    futures.reserve(num_threads);
-    for (size_t t = 0; t < num_threads; ++t) {
-        size_t start = t * chunk;
-        size_t end = start + chunk;
-        futures.push_back(std::async(std::launch::async, worker, start, end));
+        ++i;
     }
     
-    // Propagate exceptions to the main thread, if any were thrown
-    for (auto& f : futures) {
-        f.get();
-    }
-}
\ No newline at end of file
+    return true;
+}
+
+template class BasicMatrix<float>;
+template class BasicMatrix<double>;
+template class BasicMatrix<bfloat16>;
+template class BasicMatrixView<const float>;
+template class BasicMatrixView<const double>;
+template class BasicMatrixView<const bfloat16>;
+template class BasicMatrixView<float>;
+template class BasicMatrixView<double>;
+template class BasicMatrixView<bfloat16>;
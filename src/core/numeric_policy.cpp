@@ -0,0 +1,83 @@
+#include "numeric_policy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+namespace Numeric {
+
+namespace {
+
+constexpr int NO_OVERRIDE = -1;
+
+std::atomic<NumericPolicy> global_policy{NumericPolicy::Checked};
+thread_local int thread_policy = NO_OVERRIDE;
+
+}
+
+void set_policy(NumericPolicy policy) {
+    global_policy.store(policy, std::memory_order_relaxed);
+}
+
+NumericPolicy get_policy() {
+    if (thread_policy != NO_OVERRIDE) {
+        return static_cast<NumericPolicy>(thread_policy);
+    }
+    return global_policy.load(std::memory_order_relaxed);
+}
+
+bool checks_enabled() {
+    switch (get_policy()) {
+        case NumericPolicy::Checked:
+            return true;
+        case NumericPolicy::Fast:
+            return false;
+        case NumericPolicy::DebugOnly:
+#ifdef NDEBUG
+            return false;
+#else
+            return true;
+#endif
+    }
+    return true;
+}
+
+namespace {
+
+template <typename Bits, typename T>
+bool all_finite_(const T* data, size_t n, Bits exponent_mask) {
+    // A value is NaN or Inf exactly when all of its exponent bits are set.
+    // Working on the bit patterns keeps the loop branch-free and vectorizable.
+    Bits non_finite = 0;
+    for (size_t i = 0; i < n; ++i) {
+        Bits bits;
+        std::memcpy(&bits, data + i, sizeof(bits));
+        non_finite |= static_cast<Bits>((bits & exponent_mask) == exponent_mask);
+    }
+    return non_finite == 0;
+}
+
+}
+
+bool all_finite(const double* data, size_t n) {
+    return all_finite_<uint64_t>(data, n, 0x7FF0000000000000ULL);
+}
+
+bool all_finite(const float* data, size_t n) {
+    return all_finite_<uint32_t>(data, n, 0x7F800000u);
+}
+
+bool all_finite(const bfloat16* data, size_t n) {
+    return all_finite_<uint16_t>(data, n, static_cast<uint16_t>(0x7F80u));
+}
+
+ScopedPolicy::ScopedPolicy(NumericPolicy policy)
+    : previous_(thread_policy) {
+    thread_policy = static_cast<int>(policy);
+}
+
+ScopedPolicy::~ScopedPolicy() {
+    thread_policy = previous_;
+}
+
+} // namespace Numeric
@@ -0,0 +1,265 @@
+#include "parallel_tuning.h"
+#include "matrix.h"
+#include "thread_pool.h"
+#include "timer.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+namespace Parallel {
+
+namespace {
+
+std::atomic<size_t> elementwise_threshold{DEFAULT_ELEMENTWISE_THRESHOLD};
+std::atomic<size_t> gemm_threshold{DEFAULT_GEMM_THRESHOLD};
+std::atomic<size_t> reduce_threshold{DEFAULT_REDUCE_THRESHOLD};
+
+std::atomic<size_t>& threshold_(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Gemm:
+            return gemm_threshold;
+        case Kernel::Reduce:
+            return reduce_threshold;
+        default:
+            return elementwise_threshold;
+    }
+}
+
+constexpr size_t CALIBRATION_WORK = size_t(1) << 22;   // Per timing, small kernels are repeated up to it
+constexpr int N_TRIALS = 3;
+constexpr double MIN_SPEEDUP = 1.1;     // The pool must win clearly, noise should not pull thresholds down
+constexpr size_t CALIBRATION_COLS = 256;
+
+struct Sample {
+    size_t work;
+    double sequential_ns;
+    double parallel_ns;
+};
+
+// Best time per call of run(), with the kernel forced to one thread or to the pool
+template <typename Run>
+double time_(Kernel kernel, bool parallel, size_t work, Run run) {
+    set_threshold(kernel, parallel ? 0 : NEVER);
+    const size_t repeats = std::max<size_t>(1, CALIBRATION_WORK / work);
+    run();  // Warm up caches and the pool
+    Timer timer;
+    long long best = std::numeric_limits<long long>::max();
+    for (int trial = 0; trial < N_TRIALS; ++trial) {
+        timer.start();
+        for (size_t i = 0; i < repeats; ++i) {
+            run();
+        }
+        timer.stop();
+        best = std::min(best, timer.get_nanoseconds());
+    }
+    return static_cast<double>(best) / static_cast<double>(repeats);
+}
+
+// Smallest work from which the pool wins at every larger size measured, clamped to [min, max]
+size_t crossover_(const std::vector<Sample>& samples, size_t min, size_t max) {
+    size_t threshold = NEVER;
+    for (size_t i = samples.size(); i-- > 0;) {
+        if (samples[i].parallel_ns * MIN_SPEEDUP >= samples[i].sequential_ns) {
+            break;
+        }
+        threshold = samples[i].work;
+    }
+    return std::min(std::max(threshold, min), max);
+}
+
+size_t calibrate_elementwise_() {
+    std::vector<Sample> samples;
+    for (size_t rows = 16; rows <= 4096; rows *= 2) {
+        const Matrix mat(rows, CALIBRATION_COLS, 1.0);
+        const size_t work = rows * CALIBRATION_COLS;
+        auto run = [&]() {
+            Matrix result = mat * 2.0;
+        };
+        samples.push_back({ work, time_(Kernel::Elementwise, false, work, run), time_(Kernel::Elementwise, true, work, run) });
+    }
+    return crossover_(samples, MIN_ELEMENTWISE_THRESHOLD, MAX_ELEMENTWISE_THRESHOLD);
+}
+
+size_t calibrate_gemm_() {
+    std::vector<Sample> samples;
+    for (size_t n : { 16, 24, 32, 48, 64, 96, 128, 192, 256 }) {
+        Matrix lhs(n, n);
+        Matrix rhs(n, n);
+        Matrix result(n, n);
+        lhs.fill_random();
+        rhs.fill_random();
+        const size_t work = n * n * n;
+        auto run = [&]() {
+            Matrix::multiply_into(lhs, false, rhs, false, result.view());
+        };
+        samples.push_back({ work, time_(Kernel::Gemm, false, work, run), time_(Kernel::Gemm, true, work, run) });
+    }
+    return crossover_(samples, MIN_GEMM_THRESHOLD, MAX_GEMM_THRESHOLD);
+}
+
+size_t calibrate_reduce_() {
+    std::vector<Sample> samples;
+    for (size_t rows = 16; rows <= 8192; rows *= 2) {
+        Matrix mat(rows, CALIBRATION_COLS);
+        mat.fill_random();
+        const size_t work = rows * CALIBRATION_COLS;
+        volatile double sink = 0.0;
+        auto run = [&]() {
+            sink = sink + mat.sum();
+        };
+        samples.push_back({ work, time_(Kernel::Reduce, false, work, run), time_(Kernel::Reduce, true, work, run) });
+    }
+    return crossover_(samples, MIN_REDUCE_THRESHOLD, MAX_REDUCE_THRESHOLD);
+}
+
+string trim_(const string& str) {
+    const size_t first = str.find_first_not_of(" \t");
+    if (first == string::npos) {
+        return "";
+    }
+    return str.substr(first, str.find_last_not_of(" \t") + 1 - first);
+}
+
+// Cache lines are: CPU model, pool size, element-wise, GEMM and reduction thresholds, separated by tabs.
+// Lines written before the reduction threshold existed do not parse and are calibrated again.
+string cache_key_() {
+    return cpu_model() + '\t' + std::to_string(ThreadPool::instance().size());
+}
+
+bool parse_cache_line_(const string& line, const string& key, Thresholds& thresholds) {
+    if (line.compare(0, key.size(), key) != 0 || line.size() <= key.size() || line[key.size()] != '\t') {
+        return false;
+    }
+    size_t* const fields[] = { &thresholds.elementwise, &thresholds.gemm, &thresholds.reduce };
+    size_t begin = key.size() + 1;
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t tab = line.find('\t', begin);
+        if ((tab == string::npos) != (i == 2)) {
+            return false;
+        }
+        const string value = line.substr(begin, tab == string::npos ? string::npos : tab - begin);
+        try {
+            size_t parsed;
+            *fields[i] = std::stoull(value, &parsed);
+            if (value.empty() || parsed != value.size()) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        begin = tab + 1;
+    }
+    return true;
+}
+
+void append_to_cache_(const string& path, const string& key, const Thresholds& thresholds) {
+    std::error_code error;
+    const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, error);
+    }
+    std::ofstream file(path, std::ios::app);
+    if (!file.is_open()) {
+        spdlog::warn("Failed to open file for writing: '" + path + "'");
+        return;
+    }
+    file << key << '\t' << thresholds.elementwise << '\t' << thresholds.gemm << '\t' << thresholds.reduce << '\n';
+}
+
+} // namespace
+
+size_t get_threshold(Kernel kernel) {
+    return threshold_(kernel).load(std::memory_order_relaxed);
+}
+
+void set_threshold(Kernel kernel, size_t work) {
+    threshold_(kernel).store(work, std::memory_order_relaxed);
+}
+
+Thresholds get_thresholds() {
+    return { get_threshold(Kernel::Elementwise), get_threshold(Kernel::Gemm), get_threshold(Kernel::Reduce) };
+}
+
+void set_thresholds(const Thresholds& thresholds) {
+    set_threshold(Kernel::Elementwise, thresholds.elementwise);
+    set_threshold(Kernel::Gemm, thresholds.gemm);
+    set_threshold(Kernel::Reduce, thresholds.reduce);
+}
+
+void reset_thresholds() {
+    set_thresholds({ DEFAULT_ELEMENTWISE_THRESHOLD, DEFAULT_GEMM_THRESHOLD, DEFAULT_REDUCE_THRESHOLD });
+}
+
+Thresholds calibrate() {
+    Thresholds thresholds = { NEVER, NEVER, NEVER };
+    if (ThreadPool::instance().size() > 1) {
+        const Thresholds previous = get_thresholds();
+        try {
+            thresholds.elementwise = calibrate_elementwise_();
+            thresholds.gemm = calibrate_gemm_();
+            thresholds.reduce = calibrate_reduce_();
+        } catch (...) {
+            set_thresholds(previous);
+            throw;
+        }
+    }
+    set_thresholds(thresholds);
+    spdlog::info("Calibrated parallel thresholds | element-wise: {} elements | GEMM: {} multiply-adds | reduction: {} elements",
+                 thresholds.elementwise, thresholds.gemm, thresholds.reduce);
+    return thresholds;
+}
+
+string cpu_model() {
+    std::ifstream file("/proc/cpuinfo");
+    string line;
+    while (std::getline(file, line)) {
+        const size_t colon = line.find(':');
+        if (colon != string::npos && trim_(line.substr(0, colon)) == "model name") {
+            const string model = trim_(line.substr(colon + 1));
+            if (!model.empty()) {
+                return model;
+            }
+        }
+    }
+    return "unknown";
+}
+
+string default_cache_path() {
+    const char* cache_home = std::getenv("XDG_CACHE_HOME");
+    if (cache_home != nullptr && *cache_home != '\0') {
+        return string(cache_home) + "/cppnn/parallel_thresholds";
+    }
+    const char* home = std::getenv("HOME");
+    if (home != nullptr && *home != '\0') {
+        return string(home) + "/.cache/cppnn/parallel_thresholds";
+    }
+    return "";
+}
+
+Thresholds autotune(const string& cache_path) {
+    const string key = cache_key_();
+    if (!cache_path.empty()) {
+        std::ifstream file(cache_path);
+        string line;
+        Thresholds thresholds;
+        while (std::getline(file, line)) {
+            if (parse_cache_line_(line, key, thresholds)) {
+                set_thresholds(thresholds);
+                return thresholds;
+            }
+        }
+    }
+    const Thresholds thresholds = calibrate();
+    if (!cache_path.empty()) {
+        append_to_cache_(cache_path, key, thresholds);
+    }
+    return thresholds;
+}
+
+} // namespace Parallel
@@ -0,0 +1,110 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace {
+
+#ifdef __linux__
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventConfig EVENTS[PerfCounters::N_COUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+int open_event_(const EventConfig& event, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = group_fd < 0 ? 1 : 0;   // The leader starts the group once it is complete
+    // User space only, which is also all an unprivileged process may count
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters() : n_open_(0) {
+    for (size_t i = 0; i < N_COUNTERS; ++i) {
+        fds_[i] = -1;
+        position_[i] = -1;
+    }
+#ifdef __linux__
+    // The first counter that opens leads the group, the rest join it or stay missing
+    for (size_t i = 0; i < N_COUNTERS; ++i) {
+        const int fd = open_event_(EVENTS[i], n_open_ > 0 ? fds_[0] : -1);
+        if (fd < 0) {
+            continue;
+        }
+        fds_[n_open_] = fd;
+        position_[i] = static_cast<int>(n_open_);
+        ++n_open_;
+    }
+    if (n_open_ > 0) {
+        ::ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (size_t i = n_open_; i-- > 0;) {
+        ::close(fds_[i]);
+    }
+#endif
+}
+
+bool PerfCounters::read(Values& values) const {
+    values.fill(0);
+    if (n_open_ == 0) {
+        return false;
+    }
+#ifdef __linux__
+    // nr, time enabled, time running, then one value per counter of the group
+    uint64_t buffer[3 + N_COUNTERS];
+    const ssize_t expected = static_cast<ssize_t>((3 + n_open_) * sizeof(uint64_t));
+    if (::read(fds_[0], buffer, sizeof(buffer)) != expected || buffer[0] != n_open_ || buffer[2] == 0) {
+        return false;
+    }
+    const double scale = static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]);
+    for (size_t i = 0; i < N_COUNTERS; ++i) {
+        if (position_[i] >= 0) {
+            const uint64_t raw = buffer[3 + position_[i]];
+            values[i] = buffer[1] == buffer[2] ? raw : static_cast<uint64_t>(static_cast<double>(raw) * scale);
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* PerfCounters::name(Counter counter) {
+    switch (counter) {
+        case Cycles: return "cycles";
+        case Instructions: return "instructions";
+        case L1DMisses: return "L1D misses";
+        case LLCMisses: return "LLC misses";
+        case BranchMisses: return "branch misses";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,549 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace Profiler {
+
+namespace {
+
+// Durations in ns go to log-scale buckets: 8 per power of two, exact below 8 ns
+constexpr unsigned SUB_BUCKET_BITS = 3;
+constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+constexpr size_t N_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+const size_t NO_INDEX = static_cast<size_t>(-1);
+
+// Trace events are stored in chunks, so a thread only allocates what it records
+constexpr size_t TRACE_CHUNK_EVENTS = 4096;
+
+size_t bucket_of_(uint64_t ns) {
+    if (ns < SUB_BUCKETS) {
+        return static_cast<size_t>(ns);
+    }
+    const unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+}
+
+// Middle of the durations falling into a bucket
+double bucket_value_(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return static_cast<double>(bucket);
+    }
+    const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+    const double lower = std::ldexp(static_cast<double>(SUB_BUCKETS + bucket % SUB_BUCKETS), static_cast<int>(shift));
+    return lower + std::ldexp(0.5, static_cast<int>(shift));
+}
+
+// Only the owning thread writes, so plain loads and stores are enough to stay race free with readers
+void add_(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+struct Node {
+    Node(const char* name, size_t index, size_t parent) : name(name), index(index), parent(parent) {
+        for (std::atomic<uint64_t>& bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    const char* name;
+    size_t index;
+    size_t parent;
+    vector<size_t> children;
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::array<std::atomic<uint64_t>, N_BUCKETS> buckets;
+    std::atomic<uint64_t> flops{0};
+    std::atomic<uint64_t> counted{0};
+    std::array<std::atomic<uint64_t>, PerfCounters::N_COUNTERS> counters{};
+};
+
+struct TraceEvent {
+    const char* name;
+    size_t index;
+    int64_t begin_ns;   // Since the start of the trace
+    int64_t duration_ns;
+};
+
+/**
+ * Events of one thread in the current trace. The owner appends and then
+ * publishes the new size, readers take the events below the size. New
+ * chunks are added under the mutex of the thread profile.
+*/
+struct TraceBuffer {
+    uint64_t generation = 0;    // Trace the events belong to
+    vector<std::unique_ptr<TraceEvent[]>> chunks;
+    std::atomic<size_t> size{0};
+    std::atomic<size_t> dropped{0};
+};
+
+/**
+ * Zone tree of one thread. Only the owner records into it; the mutex
+ * guards the structure (new nodes) against report() and reset() from
+ * other threads. A deque never moves its nodes.
+*/
+struct ThreadProfile {
+    explicit ThreadProfile(size_t id) : id(id), name("thread " + std::to_string(id)) {
+        nodes.emplace_back(nullptr, NO_INDEX, 0);  // Root, parent of the outermost zones
+        stack.push_back(0);
+    }
+
+    std::mutex mutex;
+    std::deque<Node> nodes;
+    vector<size_t> stack;   // Open zones, the root at the bottom
+    size_t id;              // Order of registration, the thread id in traces
+    string name;
+    TraceBuffer trace;
+    std::unique_ptr<PerfCounters> counters;     // Opened by the first zone after enable_counters()
+    bool in_use = true;     // Guarded by the registry mutex
+};
+
+namespace {
+
+/**
+ * Profiles outlive their threads, for the reports. The profile of an
+ * exited thread is handed to the next new thread, so that threads started
+ * over and over (e.g. per epoch) do not add up.
+*/
+struct Registry {
+    std::mutex mutex;
+    vector<std::shared_ptr<ThreadProfile>> threads;
+};
+
+Registry& registry_() {
+    static Registry registry;
+    return registry;
+}
+
+// Read by every zone while tracing, changed under the registry mutex
+struct TraceState {
+    std::atomic<bool> active{false};
+    std::atomic<uint64_t> generation{0};
+    std::atomic<size_t> max_events{0};
+    std::atomic<int64_t> origin_ns{0};  // Clock time of the start of the trace
+};
+
+TraceState trace_state_;
+
+std::atomic<bool> counters_enabled_{false};
+
+// Counters of the thread, nullptr when it can not count
+PerfCounters* thread_counters_(ThreadProfile& thread) {
+    if (!thread.counters) {
+        thread.counters = std::make_unique<PerfCounters>();
+    }
+    return thread.counters->available() ? thread.counters.get() : nullptr;
+}
+
+int64_t clock_ns_(high_resolution_clock::time_point time) {
+    return duration_cast<nanoseconds>(time.time_since_epoch()).count();
+}
+
+// Holds the profile of a thread while it runs
+struct ThreadSlot {
+    ThreadSlot() {
+        Registry& registry = registry_();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& thread : registry.threads) {
+            if (!thread->in_use) {
+                thread->in_use = true;
+                std::lock_guard<std::mutex> thread_lock(thread->mutex);
+                thread->name = "thread " + std::to_string(thread->id);
+                profile = thread;
+                return;
+            }
+        }
+        profile = std::make_shared<ThreadProfile>(registry.threads.size());
+        registry.threads.push_back(profile);
+    }
+
+    ~ThreadSlot() {
+        profile->counters.reset();
+        Registry& registry = registry_();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        profile->in_use = false;
+    }
+
+    std::shared_ptr<ThreadProfile> profile;
+};
+
+ThreadProfile& this_thread_() {
+    thread_local ThreadSlot slot;
+    return *slot.profile;
+}
+
+void record_event_(ThreadProfile& thread, const Node& node, high_resolution_clock::time_point begin, uint64_t ns) {
+    TraceBuffer& buffer = thread.trace;
+    const uint64_t generation = trace_state_.generation.load(std::memory_order_acquire);
+    if (buffer.generation != generation) {
+        std::lock_guard<std::mutex> lock(thread.mutex);
+        buffer.chunks.clear();
+        buffer.size.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation = generation;
+    }
+    const size_t n = buffer.size.load(std::memory_order_relaxed);
+    if (n >= trace_state_.max_events.load(std::memory_order_relaxed)) {
+        add_(buffer.dropped, 1);
+        return;
+    }
+    if (n / TRACE_CHUNK_EVENTS == buffer.chunks.size()) {
+        std::lock_guard<std::mutex> lock(thread.mutex);
+        buffer.chunks.emplace_back(new TraceEvent[TRACE_CHUNK_EVENTS]);
+    }
+    buffer.chunks[n / TRACE_CHUNK_EVENTS][n % TRACE_CHUNK_EVENTS] = {
+        node.name, node.index, clock_ns_(begin) - trace_state_.origin_ns.load(std::memory_order_relaxed), static_cast<int64_t>(ns)
+    };
+    buffer.size.store(n + 1, std::memory_order_release);
+}
+
+string json_escape_(const string& text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped.push_back(' ');
+        } else {
+            escaped.push_back(c);
+        }
+    }
+    return escaped;
+}
+
+size_t enter_(ThreadProfile& thread, const char* name, size_t index) {
+    const size_t parent = thread.stack.back();
+    for (size_t child : thread.nodes[parent].children) {
+        const Node& node = thread.nodes[child];
+        if (node.index == index && (node.name == name || std::strcmp(node.name, name) == 0)) {
+            thread.stack.push_back(child);
+            return child;
+        }
+    }
+    std::lock_guard<std::mutex> lock(thread.mutex);
+    const size_t created = thread.nodes.size();
+    thread.nodes.emplace_back(name, index, parent);
+    thread.nodes[parent].children.push_back(created);
+    thread.stack.push_back(created);
+    return created;
+}
+
+string label_(const Node& node) {
+    return node.index == NO_INDEX ? string(node.name) : string(node.name) + "[" + std::to_string(node.index) + "]";
+}
+
+// Zones of all threads merged by path
+struct MergedNode {
+    string label;
+    vector<size_t> children;
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    vector<uint64_t> buckets = vector<uint64_t>(N_BUCKETS, 0);
+    uint64_t flops = 0;
+    uint64_t counted = 0;
+    PerfCounters::Values counters{};
+};
+
+void merge_(const ThreadProfile& thread, size_t source, vector<MergedNode>& merged, size_t target) {
+    for (size_t child : thread.nodes[source].children) {
+        const Node& node = thread.nodes[child];
+        const string label = label_(node);
+        auto it = std::find_if(merged[target].children.begin(), merged[target].children.end(),
+                               [&](size_t i) { return merged[i].label == label; });
+        size_t into;
+        if (it != merged[target].children.end()) {
+            into = *it;
+        } else {
+            into = merged.size();
+            merged.emplace_back();
+            merged.back().label = label;
+            merged[target].children.push_back(into);
+        }
+        MergedNode& entry = merged[into];
+        entry.count += node.count.load(std::memory_order_relaxed);
+        entry.total_ns += node.total_ns.load(std::memory_order_relaxed);
+        entry.max_ns = std::max(entry.max_ns, node.max_ns.load(std::memory_order_relaxed));
+        for (size_t bucket = 0; bucket < N_BUCKETS; ++bucket) {
+            entry.buckets[bucket] += node.buckets[bucket].load(std::memory_order_relaxed);
+        }
+        entry.flops += node.flops.load(std::memory_order_relaxed);
+        entry.counted += node.counted.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < PerfCounters::N_COUNTERS; ++i) {
+            entry.counters[i] += node.counters[i].load(std::memory_order_relaxed);
+        }
+        merge_(thread, child, merged, into);
+    }
+}
+
+double percentile_(const MergedNode& node, double q) {
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(node.count))));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < N_BUCKETS; ++bucket) {
+        seen += node.buckets[bucket];
+        if (seen >= rank) {
+            return std::min(bucket_value_(bucket), static_cast<double>(node.max_ns)) * 1e-9;
+        }
+    }
+    return static_cast<double>(node.max_ns) * 1e-9;
+}
+
+void flatten_(const vector<MergedNode>& merged, size_t index, const string& path, size_t depth, vector<ZoneStats>& out) {
+    for (size_t child : merged[index].children) {
+        const MergedNode& node = merged[child];
+        ZoneStats stats;
+        stats.path = path.empty() ? node.label : path + "/" + node.label;
+        stats.depth = depth;
+        stats.count = node.count;
+        stats.total_seconds = static_cast<double>(node.total_ns) * 1e-9;
+        stats.mean_seconds = node.count > 0 ? stats.total_seconds / static_cast<double>(node.count) : 0.0;
+        stats.p50_seconds = node.count > 0 ? percentile_(node, 0.50) : 0.0;
+        stats.p99_seconds = node.count > 0 ? percentile_(node, 0.99) : 0.0;
+        stats.max_seconds = static_cast<double>(node.max_ns) * 1e-9;
+        stats.flops = node.flops;
+        stats.gflops = stats.total_seconds > 0.0 ? static_cast<double>(node.flops) / stats.total_seconds * 1e-9 : 0.0;
+        stats.counted = node.counted;
+        stats.counters = node.counters;
+        const uint64_t cycles = node.counters[PerfCounters::Cycles];
+        stats.ipc = cycles > 0 ? static_cast<double>(node.counters[PerfCounters::Instructions]) / static_cast<double>(cycles) : 0.0;
+        out.push_back(stats);
+        flatten_(merged, child, stats.path, depth + 1, out);
+    }
+}
+
+} // namespace
+
+// --------------------------------------------------
+//  ScopedTimer
+// --------------------------------------------------
+
+ScopedTimer::ScopedTimer(const char* name) : ScopedTimer(name, NO_INDEX) {}
+
+ScopedTimer::ScopedTimer(const char* name, size_t index) : thread_(&this_thread_()), counting_(false) {
+    node_ = enter_(*thread_, name, index);
+    if (counters_enabled_.load(std::memory_order_relaxed)) {
+        PerfCounters* counters = thread_counters_(*thread_);
+        counting_ = counters != nullptr && counters->read(counters_);
+    }
+    timer_.start();
+}
+
+ScopedTimer::~ScopedTimer() {
+    timer_.stop();
+    const uint64_t ns = static_cast<uint64_t>(std::max<long long>(0, timer_.get_nanoseconds()));
+    Node& node = thread_->nodes[node_];
+    PerfCounters::Values end;
+    if (counting_ && thread_->counters->read(end)) {
+        add_(node.counted, 1);
+        for (size_t i = 0; i < PerfCounters::N_COUNTERS; ++i) {
+            add_(node.counters[i], end[i] - std::min(end[i], counters_[i]));
+        }
+    }
+    add_(node.count, 1);
+    add_(node.total_ns, ns);
+    if (ns > node.max_ns.load(std::memory_order_relaxed)) {
+        node.max_ns.store(ns, std::memory_order_relaxed);
+    }
+    add_(node.buckets[bucket_of_(ns)], 1);
+    if (trace_state_.active.load(std::memory_order_relaxed)) {
+        record_event_(*thread_, node, timer_.get_start_time(), ns);
+    }
+    thread_->stack.pop_back();
+}
+
+// --------------------------------------------------
+//  Reports
+// --------------------------------------------------
+
+vector<ZoneStats> report() {
+    vector<MergedNode> merged(1);
+    Registry& registry = registry_();
+    {
+        std::lock_guard<std::mutex> registry_lock(registry.mutex);
+        for (const auto& thread : registry.threads) {
+            std::lock_guard<std::mutex> lock(thread->mutex);
+            merge_(*thread, 0, merged, 0);
+        }
+    }
+    vector<ZoneStats> zones;
+    flatten_(merged, 0, "", 0, zones);
+    return zones;
+}
+
+string format_report() {
+    std::ostringstream out;
+    const vector<ZoneStats> zones = report();
+    const bool counted = std::any_of(zones.begin(), zones.end(), [](const ZoneStats& zone) { return zone.counted > 0; });
+    const bool flops = std::any_of(zones.begin(), zones.end(), [](const ZoneStats& zone) { return zone.flops > 0; });
+    out << std::left << std::setw(48) << "zone" << std::right
+        << std::setw(10) << "count" << std::setw(12) << "total ms" << std::setw(12) << "mean us"
+        << std::setw(12) << "p50 us" << std::setw(12) << "p99 us";
+    if (flops) {
+        out << std::setw(10) << "GFLOP/s";
+    }
+    if (counted) {
+        out << std::setw(8) << "IPC" << std::setw(14) << "L1D miss/ki" << std::setw(14) << "LLC miss/ki" << std::setw(14) << "br miss/ki";
+    }
+    out << '\n';
+    out << std::fixed;
+    // Events per thousand instructions
+    auto per_kilo = [](const ZoneStats& zone, PerfCounters::Counter counter) {
+        const uint64_t instructions = zone.counters[PerfCounters::Instructions];
+        return instructions > 0 ? 1e3 * static_cast<double>(zone.counters[counter]) / static_cast<double>(instructions) : 0.0;
+    };
+    for (const ZoneStats& zone : zones) {
+        const size_t slash = zone.path.rfind('/');
+        const string name = string(2 * zone.depth, ' ') + (slash == string::npos ? zone.path : zone.path.substr(slash + 1));
+        out << std::left << std::setw(48) << name << std::right
+            << std::setw(10) << zone.count
+            << std::setw(12) << std::setprecision(3) << zone.total_seconds * 1e3
+            << std::setw(12) << std::setprecision(2) << zone.mean_seconds * 1e6
+            << std::setw(12) << zone.p50_seconds * 1e6
+            << std::setw(12) << zone.p99_seconds * 1e6;
+        // Zones without flops or counters leave their columns blank
+        if (flops) {
+            if (zone.flops > 0) {
+                out << std::setw(10) << zone.gflops;
+            } else {
+                out << std::setw(10) << "-";
+            }
+        }
+        if (counted) {
+            if (zone.counted > 0) {
+                out << std::setw(8) << zone.ipc << std::setw(14) << per_kilo(zone, PerfCounters::L1DMisses)
+                    << std::setw(14) << per_kilo(zone, PerfCounters::LLCMisses) << std::setw(14) << per_kilo(zone, PerfCounters::BranchMisses);
+            } else {
+                out << std::setw(8) << "-" << std::setw(14) << "-" << std::setw(14) << "-" << std::setw(14) << "-";
+            }
+        }
+        out << '\n';
+    }
+    return out.str();
+}
+
+void reset() {
+    Registry& registry = registry_();
+    std::lock_guard<std::mutex> registry_lock(registry.mutex);
+    for (const auto& thread : registry.threads) {
+        std::lock_guard<std::mutex> lock(thread->mutex);
+        for (Node& node : thread->nodes) {
+            node.count.store(0, std::memory_order_relaxed);
+            node.total_ns.store(0, std::memory_order_relaxed);
+            node.max_ns.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t>& bucket : node.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            node.flops.store(0, std::memory_order_relaxed);
+            node.counted.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t>& counter : node.counters) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+// --------------------------------------------------
+//  Hardware counters
+// --------------------------------------------------
+
+bool enable_counters(bool enabled) {
+    counters_enabled_.store(enabled, std::memory_order_relaxed);
+    return enabled && thread_counters_(this_thread_()) != nullptr;
+}
+
+void add_flops(uint64_t flops) {
+    ThreadProfile& thread = this_thread_();
+    add_(thread.nodes[thread.stack.back()].flops, flops);
+}
+
+// --------------------------------------------------
+//  Traces
+// --------------------------------------------------
+
+void set_thread_name(const string& name) {
+    ThreadProfile& thread = this_thread_();
+    std::lock_guard<std::mutex> lock(thread.mutex);
+    thread.name = name;
+}
+
+void start_tracing(size_t max_events) {
+    Registry& registry = registry_();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    trace_state_.max_events.store(max_events, std::memory_order_relaxed);
+    trace_state_.origin_ns.store(clock_ns_(high_resolution_clock::now()), std::memory_order_relaxed);
+    trace_state_.generation.fetch_add(1, std::memory_order_release);
+    trace_state_.active.store(true, std::memory_order_relaxed);
+}
+
+void stop_tracing() {
+    trace_state_.active.store(false, std::memory_order_relaxed);
+}
+
+bool tracing() {
+    return trace_state_.active.load(std::memory_order_relaxed);
+}
+
+string trace_json() {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[";
+    size_t dropped = 0;
+    bool first = true;
+    auto separator = [&]() -> std::ostream& {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+
+    Registry& registry = registry_();
+    std::lock_guard<std::mutex> registry_lock(registry.mutex);
+    const uint64_t generation = trace_state_.generation.load(std::memory_order_acquire);
+    for (const auto& thread : registry.threads) {
+        std::lock_guard<std::mutex> lock(thread->mutex);
+        const TraceBuffer& buffer = thread->trace;
+        if (buffer.generation != generation) {
+            continue;
+        }
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+                    << ",\"args\":{\"name\":\"" << json_escape_(thread->name) << "\"}}";
+        const size_t n = buffer.size.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i) {
+            const TraceEvent& event = buffer.chunks[i / TRACE_CHUNK_EVENTS][i % TRACE_CHUNK_EVENTS];
+            const string name = event.index == NO_INDEX ? string(event.name) : string(event.name) + "[" + std::to_string(event.index) + "]";
+            separator() << "{\"name\":\"" << json_escape_(name) << "\",\"cat\":\"cppnn\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+                        << ",\"ts\":" << static_cast<double>(event.begin_ns) * 1e-3
+                        << ",\"dur\":" << static_cast<double>(event.duration_ns) * 1e-3 << "}";
+        }
+        dropped += buffer.dropped.load(std::memory_order_relaxed);
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+    return out.str();
+}
+
+void write_trace(const string& path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: '" + path + "'");
+    }
+    file << trace_json();
+    if (!file.good()) {
+        throw std::runtime_error("Failed to write file: '" + path + "'");
+    }
+}
+
+} // namespace Profiler
@@ -0,0 +1,315 @@
+#include "thread_pool.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// instance_mutex only guards creating and replacing the pool, instance() reads it through instance_ptr
+std::mutex instance_mutex;
+std::unique_ptr<ThreadPool> instance_pool;
+std::atomic<ThreadPool*> instance_ptr{nullptr};
+
+constexpr uint64_t HELPERS_MASK = 0xffffffff;
+
+}
+
+ThreadPool::ThreadPool(size_t n_threads, bool pin_threads)
+    : next_queue_(0), pending_(0), stopping_(false), pin_threads_(pin_threads) {
+    if (n_threads == 0) {
+        n_threads = std::thread::hardware_concurrency();
+    }
+    if (n_threads == 0) {
+        n_threads = 2;
+    }
+
+    // The thread calling parallel_for() also does work, so it counts towards the size
+    const size_t n_workers = n_threads - 1;
+    // Enough jobs for every thread to run a parallel_for() nested in another one
+    const size_t n_jobs = 2 * n_threads;
+    jobs_.reserve(n_jobs);
+    for (size_t i = 0; i < n_jobs; ++i) {
+        jobs_.push_back(std::make_unique<Job>());
+    }
+    queues_.reserve(n_workers);
+    for (size_t i = 0; i < n_workers; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+        queues_.back()->jobs.resize(n_jobs);
+    }
+    workers_.reserve(n_workers);
+    for (size_t i = 0; i < n_workers; ++i) {
+        workers_.emplace_back(&ThreadPool::worker_loop_, this, i);
+        if (pin_threads_) {
+            pin_to_cpu_(workers_.back(), i + 1);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    if (workers_.empty()) {
+        task();
+        return;
+    }
+    const size_t index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Incremented under the sleep mutex so a worker about to sleep can not miss it
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        pending_.fetch_add(1);
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, RangeFunction fn, size_t grain) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t range = end - begin;
+    if (range <= grain || workers_.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    // A free job slot, without one (deep nesting) the whole range runs here
+    Job* job = nullptr;
+    size_t index = 0;
+    for (; index < jobs_.size(); ++index) {
+        bool expected = false;
+        if (jobs_[index]->claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            job = jobs_[index].get();
+            break;
+        }
+    }
+    if (job == nullptr) {
+        fn(begin, end);
+        return;
+    }
+
+    // A few chunks per thread so that faster threads can pick up the slack
+    size_t n_chunks = std::min((range + grain - 1) / grain, size() * 4);
+    const size_t chunk = (range + n_chunks - 1) / n_chunks;
+    n_chunks = (range + chunk - 1) / chunk;
+
+    job->fn = &fn;
+    job->begin = begin;
+    job->end = end;
+    job->chunk = chunk;
+    job->n_chunks = n_chunks;
+    job->next.store(0);
+    job->done.store(0);
+    job->failed.store(false);
+    const uint32_t generation = static_cast<uint32_t>(job->state.load() >> 32);
+
+    // Chunks are claimed dynamically, so requests that reach a worker late find nothing left to do
+    const size_t n_helpers = std::min(workers_.size(), n_chunks - 1);
+    for (size_t i = 0; i < n_helpers; ++i) {
+        if (!push_job_({ index, generation })) {
+            break;
+        }
+    }
+    run_chunks_(*job);
+
+    // Wait for the chunks run by helpers, then retire the generation so that `fn` is never touched
+    // after we return. A helper entering in between is waited for as well.
+    std::unique_lock<std::mutex> lock(job->mutex);
+    for (;;) {
+        job->finished.wait(lock, [&] {
+            return job->done.load() == n_chunks && (job->state.load() & HELPERS_MASK) == 0;
+        });
+        uint64_t idle = uint64_t(generation) << 32;
+        if (job->state.compare_exchange_strong(idle, uint64_t(generation + 1) << 32)) {
+            break;
+        }
+    }
+    std::exception_ptr error = std::move(job->error);
+    job->error = nullptr;
+    job->fn = nullptr;
+    lock.unlock();
+    job->claimed.store(false, std::memory_order_release);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::push_job_(const JobRef& ref) {
+    WorkQueue& queue = *queues_[next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs_count == queue.jobs.size()) {
+            return false;
+        }
+        queue.jobs[(queue.jobs_head + queue.jobs_count) % queue.jobs.size()] = ref;
+        ++queue.jobs_count;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        pending_.fetch_add(1);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void ThreadPool::help_(const JobRef& ref) {
+    Job& job = *jobs_[ref.job];
+    uint64_t state = job.state.load();
+    do {
+        if (static_cast<uint32_t>(state >> 32) != ref.generation) {
+            return;
+        }
+    } while (!job.state.compare_exchange_weak(state, state + 1));
+
+    run_chunks_(job);
+    if (((job.state.fetch_sub(1) - 1) & HELPERS_MASK) == 0) {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.finished.notify_all();
+    }
+}
+
+void ThreadPool::run_chunks_(Job& job) {
+    for (;;) {
+        const size_t i = job.next.fetch_add(1);
+        if (i >= job.n_chunks) {
+            return;
+        }
+        if (!job.failed.load()) {
+            try {
+                (*job.fn)(job.begin + i * job.chunk, std::min(job.end, job.begin + (i + 1) * job.chunk));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job.mutex);
+                if (!job.error) {
+                    job.error = std::current_exception();
+                }
+                job.failed = true;
+            }
+        }
+        if (job.done.fetch_add(1) + 1 == job.n_chunks) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.finished.notify_all();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::instance() {
+    if (ThreadPool* pool = instance_ptr.load(std::memory_order_acquire)) {
+        return *pool;
+    }
+    std::lock_guard<std::mutex> lock(instance_mutex);
+    if (!instance_pool) {
+        instance_pool = std::make_unique<ThreadPool>();
+        instance_ptr.store(instance_pool.get(), std::memory_order_release);
+    }
+    return *instance_pool;
+}
+
+void ThreadPool::configure(size_t n_threads, bool pin_threads) {
+    std::lock_guard<std::mutex> lock(instance_mutex);
+    instance_ptr.store(nullptr, std::memory_order_release);
+    instance_pool.reset();
+    instance_pool = std::make_unique<ThreadPool>(n_threads, pin_threads);
+    instance_ptr.store(instance_pool.get(), std::memory_order_release);
+}
+
+void ThreadPool::worker_loop_(size_t index) {
+    PROFILE_THREAD_NAME("pool worker " + std::to_string(index));
+    Work work;
+    for (;;) {
+        if (try_pop_(index, work) || try_steal_(index, work)) {
+            pending_.fetch_sub(1);
+            PROFILE_ZONE("pool task");
+            if (!work.task) {
+                help_(work.job);
+                continue;
+            }
+            try {
+                work.task();
+            } catch (...) {
+                // Tasks submitted directly must handle their own errors (parallel_for does)
+            }
+            work.task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || pending_.load() > 0; });
+        if (stopping_ && pending_.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::try_pop_(size_t index, Work& work) {
+    WorkQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs_count > 0) {
+        --queue.jobs_count;
+        work.job = queue.jobs[(queue.jobs_head + queue.jobs_count) % queue.jobs.size()];
+        return true;
+    }
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    work.task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::try_steal_(size_t thief, Work& work) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        WorkQueue& victim = *queues_[(thief + offset) % queues_.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            continue;
+        }
+        if (victim.jobs_count > 0) {
+            work.job = victim.jobs[victim.jobs_head];
+            victim.jobs_head = (victim.jobs_head + 1) % victim.jobs.size();
+            --victim.jobs_count;
+            return true;
+        }
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        work.task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::pin_to_cpu_(std::thread& thread, size_t cpu) {
+#ifdef __linux__
+    const size_t n_cpus = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu % n_cpus, &cpu_set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpu_set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+void parallel_for(size_t begin, size_t end, ThreadPool::RangeFunction fn, size_t grain) {
+    ThreadPool::instance().parallel_for(begin, end, fn, grain);
+}
@@ -0,0 +1,315 @@
+#include "batch_loader.h"
+#include "timer.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+// --------------------------------------------------
+//  Constructors
+// --------------------------------------------------
+
+BatchLoader::BatchLoader(const Matrix& data, const Matrix& targets, size_t batch_size, bool shuffle,
+                         size_t n_buffers, size_t n_workers, uint64_t seed)
+    : data_(data),
+      targets_(targets),
+      n_batches_(0),
+      n_workers_(n_workers),
+      stream_(nullptr),
+      shuffle_buffer_(0),
+      batch_size_(batch_size),
+      n_features_(data.get_cols()),
+      n_targets_(targets.get_cols()),
+      shuffle_(shuffle),
+      seed_(seed),
+      epoch_(0),
+      current_(nullptr),
+      next_index_(0),
+      next_delivered_(0),
+      running_producers_(0),
+      stopping_(false) {
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive!");
+    }
+    if (n_buffers < 2) {
+        throw std::invalid_argument("A batch loader needs at least two buffers!");
+    }
+    if (n_workers == 0) {
+        throw std::invalid_argument("A batch loader needs at least one worker!");
+    }
+    if (data.get_rows() != targets.get_rows()) {
+        throw std::invalid_argument("Data and targets must have the same number of samples!");
+    }
+    n_batches_ = (data.get_rows() + batch_size - 1) / batch_size;
+    order_.resize(data.get_rows());
+
+    slots_.resize(n_buffers);
+    for (Slot& slot : slots_) {
+        slot.data = Matrix(batch_size_, n_features_);
+        slot.targets = Matrix(batch_size_, n_targets_);
+    }
+    start_();
+}
+
+BatchLoader::BatchLoader(DatasetStream& stream, size_t shuffle_buffer, bool shuffle, size_t n_buffers, uint64_t seed)
+    : n_batches_(0),
+      n_workers_(1),
+      stream_(&stream),
+      shuffle_buffer_(shuffle ? shuffle_buffer : 0),
+      batch_size_(stream.get_batch_size()),
+      n_features_(stream.get_features_count()),
+      n_targets_(1),
+      shuffle_(shuffle),
+      seed_(seed),
+      epoch_(0),
+      current_(nullptr),
+      next_index_(0),
+      next_delivered_(0),
+      running_producers_(0),
+      stopping_(false) {
+    if (n_buffers < 2) {
+        throw std::invalid_argument("A batch loader needs at least two buffers!");
+    }
+
+    slots_.resize(n_buffers);
+    for (Slot& slot : slots_) {
+        slot.data = Matrix(batch_size_, n_features_);
+        slot.targets = Matrix(batch_size_, 1);
+    }
+    start_();
+}
+
+BatchLoader::~BatchLoader() {
+    stop_();
+}
+
+// --------------------------------------------------
+//  Consumer side
+// --------------------------------------------------
+
+bool BatchLoader::next(Batch& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (current_ != nullptr) {
+        free_.push_back(current_);
+        current_ = nullptr;
+        slot_freed_.notify_all();
+    }
+
+    auto ready = [&]() { return ready_.count(next_delivered_) != 0; };
+    bool stalled = false;
+    Timer timer;
+    if (!ready() && running_producers_ > 0) {
+        PROFILE_ZONE("wait for batch");
+        stalled = true;
+        timer.start();
+        slot_ready_.wait(lock, [&]() { return ready() || running_producers_ == 0; });
+        timer.stop();
+    }
+    if (!ready()) {
+        if (error_) {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+        return false;
+    }
+
+    if (stalled) {
+        ++stats_.stalls;
+        stats_.stall_seconds += static_cast<double>(timer.get_nanoseconds()) * 1e-9;
+    }
+    ++stats_.batches;
+    auto it = ready_.find(next_delivered_++);
+    current_ = it->second;
+    ready_.erase(it);
+    batch.data = current_->data.row_range(0, current_->rows);
+    batch.targets = current_->targets.row_range(0, current_->rows);
+    return true;
+}
+
+void BatchLoader::reset() {
+    stop_();
+    start_();
+}
+
+void BatchLoader::start_() {
+    free_.clear();
+    ready_.clear();
+    for (Slot& slot : slots_) {
+        free_.push_back(&slot);
+    }
+    current_ = nullptr;
+    next_index_ = 0;
+    next_delivered_ = 0;
+    stopping_ = false;
+    error_ = nullptr;
+    ++epoch_;
+
+    if (stream_ != nullptr) {
+        stream_->reset();
+        running_producers_ = 1;
+        producers_.emplace_back(&BatchLoader::stream_loop_, this);
+        return;
+    }
+
+    std::iota(order_.begin(), order_.end(), size_t(0));
+    if (shuffle_) {
+        std::mt19937_64 gen(seed_ + epoch_);
+        std::shuffle(order_.begin(), order_.end(), gen);
+    }
+    // Counted before the first one starts, since producers count themselves out when done
+    const size_t n_producers = std::max<size_t>(1, std::min(n_workers_, n_batches_));
+    running_producers_ = n_producers;
+    for (size_t i = 0; i < n_producers; ++i) {
+        producers_.emplace_back(&BatchLoader::gather_loop_, this);
+    }
+}
+
+void BatchLoader::stop_() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    slot_freed_.notify_all();
+    for (std::thread& producer : producers_) {
+        producer.join();
+    }
+    producers_.clear();
+}
+
+// --------------------------------------------------
+//  Producer side
+// --------------------------------------------------
+
+BatchLoader::Slot* BatchLoader::acquire_free_slot_(size_t* index) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto exhausted = [&]() { return index != nullptr && next_index_ >= n_batches_; };
+    slot_freed_.wait(lock, [&]() { return stopping_ || exhausted() || !free_.empty(); });
+    if (stopping_ || exhausted()) {
+        return nullptr;
+    }
+    Slot* slot = free_.front();
+    free_.pop_front();
+    slot->rows = 0;
+    if (index != nullptr) {
+        *index = next_index_++;
+    }
+    return slot;
+}
+
+void BatchLoader::publish_(size_t index, Slot* slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.emplace(index, slot);
+    slot_ready_.notify_one();
+}
+
+void BatchLoader::finish_producer_(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error) {
+        if (!error_) {
+            error_ = error;
+        }
+        // The failed batch never arrives, the other producers must not wait for it to be consumed
+        stopping_ = true;
+        slot_freed_.notify_all();
+    }
+    --running_producers_;
+    slot_ready_.notify_all();
+}
+
+void BatchLoader::gather_loop_() {
+    PROFILE_THREAD_NAME("batch loader");
+    std::exception_ptr error;
+    try {
+        const size_t n_samples = order_.size();
+        size_t index = 0;
+        Slot* slot;
+        while ((slot = acquire_free_slot_(&index)) != nullptr) {
+            PROFILE_ZONE("gather batch");
+            const size_t begin = index * batch_size_;
+            const size_t end = std::min(n_samples, begin + batch_size_);
+            for (size_t row = begin; row < end; ++row) {
+                const size_t sample = order_[row];
+                std::copy_n(&data_(sample, 0), n_features_, slot->data.data() + slot->rows * slot->data.get_stride());
+                std::copy_n(&targets_(sample, 0), n_targets_, slot->targets.data() + slot->rows * slot->targets.get_stride());
+                ++slot->rows;
+            }
+            publish_(index, slot);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    finish_producer_(error);
+}
+
+void BatchLoader::stream_loop_() {
+    PROFILE_THREAD_NAME("batch loader");
+    std::mt19937_64 gen(seed_ + epoch_);
+    Matrix reservoir(shuffle_buffer_, n_features_);
+    Matrix reservoir_targets(shuffle_buffer_, 1);
+    size_t filled = 0;
+
+    Slot* slot = nullptr;
+    size_t index = 0;
+    // Copies one sample into the batch being assembled, false when stopping
+    auto emit = [&](const double* features, double target) {
+        if (slot == nullptr && (slot = acquire_free_slot_(nullptr)) == nullptr) {
+            return false;
+        }
+        std::copy_n(features, n_features_, slot->data.data() + slot->rows * slot->data.get_stride());
+        slot->targets(slot->rows, 0) = target;
+        if (++slot->rows == batch_size_) {
+            publish_(index++, slot);
+            slot = nullptr;
+        }
+        return true;
+    };
+    auto reservoir_row = [&](size_t row) { return reservoir.data() + row * reservoir.get_stride(); };
+
+    std::exception_ptr error;
+    try {
+        bool running = true;
+        DatasetStream::Batch input;
+        while (running && stream_->next(input)) {
+            for (size_t row = 0; running && row < input.data.get_rows(); ++row) {
+                const double* features = &input.data(row, 0);
+                const double target = input.targets(row, 0);
+                if (filled < shuffle_buffer_) {
+                    std::copy_n(features, n_features_, reservoir_row(filled));
+                    reservoir_targets(filled++, 0) = target;
+                } else if (shuffle_buffer_ == 0) {
+                    running = emit(features, target);
+                } else {
+                    // A random sample of the reservoir leaves, the new one takes its place
+                    const size_t pick = std::uniform_int_distribution<size_t>(0, filled - 1)(gen);
+                    running = emit(reservoir_row(pick), reservoir_targets(pick, 0));
+                    std::copy_n(features, n_features_, reservoir_row(pick));
+                    reservoir_targets(pick, 0) = target;
+                }
+            }
+        }
+        // Drains the reservoir in random order at the end of the file
+        while (running && filled > 0) {
+            const size_t pick = std::uniform_int_distribution<size_t>(0, filled - 1)(gen);
+            running = emit(reservoir_row(pick), reservoir_targets(pick, 0));
+            --filled;
+            std::copy_n(reservoir_row(filled), n_features_, reservoir_row(pick));
+            reservoir_targets(pick, 0) = reservoir_targets(filled, 0);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // The samples before the end (or an error) are the last batch
+    if (slot != nullptr) {
+        if (slot->rows > 0) {
+            publish_(index, slot);
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(slot);
+        }
+    }
+    finish_producer_(error);
+}
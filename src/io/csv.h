@@ -0,0 +1,88 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+/**
+ * Allocation-free pieces of the CSV readers (Dataset, DatasetStream),
+ * working on [begin, end) ranges of text.
+*/
+namespace Csv {
+
+inline const char* line_end(const char* begin, const char* end) {
+    const void* newline = std::memchr(begin, '\n', end - begin);
+    return newline ? static_cast<const char*>(newline) : end;
+}
+
+// Lines in [begin, end): every newline ends one, trailing text without a newline is one more
+inline size_t count_lines(const char* begin, const char* end) {
+    size_t count = 0;
+    for (const char* p = begin; (p = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr; ++p) {
+        ++count;
+    }
+    return count + (begin != end && end[-1] != '\n' ? 1 : 0);
+}
+
+/**
+ * Calls cell(index, begin, end) for every cell of the line, splitting on
+ * commas outside of quotes like Dataset::split_csv_line_(), and returns
+ * the number of cells.
+*/
+template <typename Cell>
+size_t for_each_cell(const char* begin, const char* end, Cell cell) {
+    size_t index = 0;
+    bool in_quotes = false;
+    const char* start = begin;
+    for (const char* p = begin; p != end; ++p) {
+        if (*p == '"') {
+            in_quotes = !in_quotes;
+        } else if (*p == ',' && !in_quotes) {
+            cell(index++, start, p);
+            start = p + 1;
+        }
+    }
+    cell(index++, start, end);
+    return index;
+}
+
+// Cell contents without surrounding whitespace and quotes
+inline std::string_view clean_cell(const char* begin, const char* end) {
+    auto trim = [&]() {
+        while (begin != end && std::isspace(static_cast<unsigned char>(*begin))) {
+            ++begin;
+        }
+        while (begin != end && std::isspace(static_cast<unsigned char>(end[-1]))) {
+            --end;
+        }
+    };
+    trim();
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        ++begin;
+        --end;
+        trim();
+    }
+    return std::string_view(begin, end - begin);
+}
+
+// Whole-cell number in the format std::stod() accepts, without the locale
+inline bool parse_number(std::string_view cell, double& value) {
+    if (!cell.empty() && cell.front() == '+') {
+        cell.remove_prefix(1);
+        if (!cell.empty() && cell.front() == '-') {
+            return false;
+        }
+    }
+    if (cell.empty()) {
+        return false;
+    }
+    const auto [ptr, ec] = std::from_chars(cell.data(), cell.data() + cell.size(), value);
+    return ec == std::errc() && ptr == cell.data() + cell.size();
+}
+
+} // namespace Csv
+
+#endif // CSV_H
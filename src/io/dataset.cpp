@@ -1,10 +1,18 @@
 #include "dataset.h"
+#include "thread_pool.h"
+#include "csv.h"
+#include "profiler.h"
 #include "spdlog/spdlog.h"
 
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <set>
 
 using std::ifstream;
@@ -13,6 +21,121 @@ using std::getline;
 using std::find_if;
 using std::isspace;
 using std::set;
+using std::string_view;
+
+namespace {
+
+// Bytes of the file parsed by one task, rounded up to the next line
+constexpr size_t CSV_CHUNK_BYTES = 1 << 22;
+
+// Shortest text that reads back as the same number
+string number_text_(double value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return string(buffer, result.ptr);
+}
+
+/**
+ * Binary cache layout, integers and doubles in native byte order:
+ *
+ *   BinaryHeader
+ *   per column: first_numeric (u8), label count (u64), labels
+ *   first line: cell count (u64), cells
+ *   padding up to table_offset (a multiple of 64)
+ *   per column: n_lines doubles, padded to `stride` elements
+ *
+ * Strings are a u64 length followed by the bytes. The version is bumped on
+ * any change of the layout.
+*/
+constexpr char BINARY_MAGIC[8] = { 'C', 'P', 'P', 'N', 'N', 'D', 'S', '\0' };
+constexpr uint32_t BINARY_VERSION = 1;
+constexpr size_t BINARY_ALIGNMENT = 64;
+
+enum class BinaryDType : uint32_t {
+    Float64 = 1,
+};
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    uint64_t n_cols;
+    uint64_t n_lines;
+    uint64_t stride;        // Elements per column block
+    uint64_t table_offset;  // Bytes from the start of the file to the first column block
+    int64_t target_column;
+    uint8_t headers;
+    uint8_t index_column;
+    uint8_t reserved[6];
+};
+
+size_t align_up_(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void put_u64_(string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string_(string& out, const string& str) {
+    put_u64_(out, str.size());
+    out.append(str);
+}
+
+// Bounds-checked reads from the mapped cache
+class BinaryReader {
+public:
+    BinaryReader(const char* data, size_t size, const string& path) : data_(data), size_(size), pos_(0), path_(path) {}
+
+    template <typename T>
+    T read() {
+        T value;
+        std::memcpy(&value, take_(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    string read_string() {
+        const uint64_t length = read<uint64_t>();
+        const char* begin = take_(length);
+        return string(begin, length);
+    }
+
+    // Number of items to follow, each taking at least item_bytes, checked before anything is allocated for them
+    uint64_t read_count(size_t item_bytes) {
+        const uint64_t count = read<uint64_t>();
+        check_count(count, item_bytes);
+        return count;
+    }
+
+    // Throws like a short read unless count items of at least item_bytes fit in the rest of the file
+    void check_count(uint64_t count, size_t item_bytes) const {
+        if (count > (size_ - pos_) / item_bytes) {
+            truncated_();
+        }
+    }
+
+private:
+    [[noreturn]] void truncated_() const {
+        string message = "Dataset cache is truncated: '" + path_ + "'";
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+
+    const char* take_(uint64_t n) {
+        if (n > size_ - pos_) {
+            truncated_();
+        }
+        const char* begin = data_ + pos_;
+        pos_ += n;
+        return begin;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    const string& path_;
+};
+}
 
 // --------------------------------------------------
 //  Constructors
@@ -20,11 +143,12 @@ using std::set;
 
 Dataset::Dataset()
     : path_(""), 
+      binary_(false),
+      raw_data_loaded_(false),
       size_(0), 
       target_column_(-1),
       headers_(false),
-      index_column_(false),
-      categorical_(false) {}
+      index_column_(false) {}
 
 Dataset::Dataset(const string& path)
     : Dataset() {
@@ -36,15 +160,156 @@ Dataset::Dataset(const string& path)
 // --------------------------------------------------
 
 void Dataset::load_csv(const string& path, bool headers, bool index_column, size_t target_column) {
+    PROFILE_ZONE("load_csv");
     spdlog::info("Loading dataset from: '" + path + "'");
-    
+
+    // A file that can not be loaded leaves the previous data in place
+    Source previous = take_source_();
     path_ = path;
     headers_ = headers;
     index_column_ = index_column;
     target_column_ = target_column;
-    size_ = 0;
+    try {
+        process_data_();
+    } catch (...) {
+        restore_source_(std::move(previous));
+        throw;
+    }
+}
+
+void Dataset::load_binary(const string& path) {
+    spdlog::info("Loading dataset cache from: '" + path + "'");
 
-    process_data_();
+    std::shared_ptr<const MappedFile> file;
+    try {
+        file = std::make_shared<const MappedFile>(path);
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        throw;
+    }
+
+    // The cache itself is validated before the dataset is touched
+    BinaryReader reader(file->data(), file->size(), path);
+    const BinaryHeader header = reader.read<BinaryHeader>();
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        string message = "Not a dataset cache: '" + path + "'";
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+    if (header.version != BINARY_VERSION || header.dtype != static_cast<uint32_t>(BinaryDType::Float64)) {
+        string message = "Unsupported dataset cache version " + std::to_string(header.version) + ": '" + path + "'";
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+    // Divided instead of multiplied, so that huge counts in a corrupt header can not wrap around
+    if (header.n_cols == 0 || header.stride < header.n_lines || header.table_offset % BINARY_ALIGNMENT != 0 ||
+        header.table_offset > file->size() ||
+        header.stride > (file->size() - header.table_offset) / sizeof(double) / header.n_cols) {
+        string message = "Dataset cache is truncated: '" + path + "'";
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+    // Every column takes a flag and a label count, every label and cell at least its length
+    reader.check_count(header.n_cols, sizeof(uint8_t) + sizeof(uint64_t));
+    vector<Column> columns(header.n_cols);
+    for (Column& column : columns) {
+        column.first_numeric = reader.read<uint8_t>() != 0;
+        column.labels.resize(reader.read_count(sizeof(uint64_t)));
+        for (string& label : column.labels) {
+            label = reader.read_string();
+        }
+    }
+    vector<string> first_line(reader.read_count(sizeof(uint64_t)));
+    for (string& cell : first_line) {
+        cell = reader.read_string();
+    }
+    // Categorical cells are indices into the labels of their column, checked once here (O(lines) for
+    // each categorical column) so that the lookups later on can trust them. A first line that is not a
+    // known label is stored as NaN.
+    const double* table = reinterpret_cast<const double*>(file->data() + header.table_offset);
+    for (size_t col = 0; col < columns.size(); ++col) {
+        const double n_labels = static_cast<double>(columns[col].labels.size());
+        if (n_labels == 0) {
+            continue;
+        }
+        const double* cells = table + col * header.stride;
+        for (size_t line = columns[col].first_numeric ? 0 : 1; line < header.n_lines; ++line) {
+            if (!(cells[line] >= 0.0 && cells[line] < n_labels)) {
+                string message = "Dataset cache is corrupt: '" + path + "'";
+                spdlog::error(message);
+                throw std::runtime_error(message);
+            }
+        }
+    }
+
+    // derive_views_() may still refuse the cache (too few lines, categorical features, ...),
+    // the previous data is put back in that case
+    Source previous = take_source_();
+    path_ = path;
+    file_ = std::move(file);
+    binary_ = true;
+    table_ = MatrixView(reinterpret_cast<const double*>(file_->data() + header.table_offset),
+                        header.n_cols, header.n_lines, header.stride);
+    columns_ = std::move(columns);
+    first_line_ = std::move(first_line);
+    headers_ = header.headers != 0;
+    index_column_ = header.index_column != 0;
+    target_column_ = header.target_column;
+    try {
+        derive_views_();
+    } catch (...) {
+        restore_source_(std::move(previous));
+        throw;
+    }
+}
+
+void Dataset::save_binary(const string& path) const {
+    spdlog::info("Saving dataset cache to: '" + path + "'");
+    if (columns_.empty()) {
+        throw std::runtime_error("Can not save an empty dataset: '" + path + "'");
+    }
+
+    string metadata;
+    for (const Column& column : columns_) {
+        metadata.push_back(static_cast<char>(column.first_numeric));
+        put_u64_(metadata, column.labels.size());
+        for (const string& label : column.labels) {
+            put_string_(metadata, label);
+        }
+    }
+    put_u64_(metadata, first_line_.size());
+    for (const string& cell : first_line_) {
+        put_string_(metadata, cell);
+    }
+
+    const size_t n_lines = table_.get_cols();
+    BinaryHeader header = {};
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.dtype = static_cast<uint32_t>(BinaryDType::Float64);
+    header.n_cols = columns_.size();
+    header.n_lines = n_lines;
+    header.stride = align_up_(n_lines, BINARY_ALIGNMENT / sizeof(double));
+    header.table_offset = align_up_(sizeof(header) + metadata.size(), BINARY_ALIGNMENT);
+    header.target_column = target_column_;
+    header.headers = headers_;
+    header.index_column = index_column_;
+
+    ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: '" + path + "'");
+    }
+    const vector<char> padding(BINARY_ALIGNMENT, 0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(metadata.data(), metadata.size());
+    file.write(padding.data(), header.table_offset - sizeof(header) - metadata.size());
+    for (size_t col = 0; col < columns_.size(); ++col) {
+        file.write(reinterpret_cast<const char*>(&table_(col, 0)), n_lines * sizeof(double));
+        file.write(padding.data(), (header.stride - n_lines) * sizeof(double));
+    }
+    if (!file.good()) {
+        throw std::runtime_error("Failed to write file: '" + path + "'");
+    }
 }
 
 void Dataset::save_csv(const string& path) {
@@ -67,7 +332,7 @@ void Dataset::save_csv(const string& path) {
     }
 
     // Write data
-    for (const auto& row : raw_data_) {
+    for (const auto& row : get_raw_data()) {
         for (size_t col = 0; col < row.size(); ++col) {
             file << row[col];
             if (col + 1 < row.size()) {
@@ -88,36 +353,39 @@ void Dataset::print() const {
 //  Data Access
 // --------------------------------------------------
 
-Matrix Dataset::operator[](size_t row) const {
+MatrixView Dataset::operator[](size_t row) const {
     if (row >= data_.get_rows()) {
         throw std::out_of_range("Row index out of bounds.");
     }
-    return data_[row];
+    return get_range(row, row + 1);
 }
 
-Matrix Dataset::get_range(size_t start_row, size_t end_row) const {
+MatrixView Dataset::get_range(size_t start_row, size_t end_row) const {
     if (start_row >= end_row || end_row > data_.get_rows()) {
         throw std::invalid_argument("Invalid dataset range: [" +
             std::to_string(start_row) + ", " + std::to_string(end_row) + ")");
     }
-
-    size_t n_rows = end_row - start_row;
-    Matrix result(n_rows, data_.get_cols());
-    for (size_t row = 0; row < n_rows; ++row) {
-        for (size_t col = 0; col < data_.get_cols(); ++col) {
-            result[row][col] = data_[start_row + row][col];
-        }
-    }
-    return result;
+    return data_.row_range(start_row, end_row);
 }
 
 const vector<string>& Dataset::get_row(size_t row) const {
-    if (row >= raw_data_.size()) {
+    if (row >= get_raw_data().size()) {
         throw std::out_of_range("Row index out of bounds.");
     }
     return raw_data_[row];
 }
 
+const vector<vector<string>>& Dataset::get_raw_data() const {
+    if (!raw_data_loaded_) {
+        load_raw_data_();
+    }
+    return raw_data_;
+}
+
+const vector<string>& Dataset::get_raw_targets() const {
+    return get_raw_data()[target_column_];
+}
+
 // --------------------------------------------------
 //  Configuration setters
 // --------------------------------------------------
@@ -126,24 +394,68 @@ void Dataset::set_target_column(size_t target_column) {
     if (target_column_ == static_cast<long long>(target_column)) {
         return;
     }
-    target_column_ = static_cast<long long>(target_column);
-    process_data_();
+    reconfigure_(static_cast<long long>(target_column), index_column_, headers_);
 }
 
 void Dataset::set_index_column(bool index_column) {
     if (index_column_ == index_column) {
         return;
     }
-    index_column_ = index_column;
-    process_data_();
+    reconfigure_(target_column_, index_column, headers_);
 }
 
 void Dataset::set_headers(bool headers) {
     if (headers_ == headers) {
         return;
     }
+    reconfigure_(target_column_, index_column_, headers);
+}
+
+// Moves the loaded file and table out of the dataset, the views derived from them stay valid
+Dataset::Source Dataset::take_source_() {
+    Source source = { std::move(path_), std::move(file_), binary_, std::move(table_storage_), table_,
+                      std::move(columns_), std::move(first_line_), target_column_, headers_, index_column_ };
+    path_.clear();
+    file_.reset();
+    table_storage_.reset();
+    table_ = MatrixView();
+    columns_.clear();
+    first_line_.clear();
+    return source;
+}
+
+void Dataset::restore_source_(Source&& source) {
+    path_ = std::move(source.path);
+    file_ = std::move(source.file);
+    binary_ = source.binary;
+    table_storage_ = std::move(source.table_storage);
+    table_ = source.table;
+    columns_ = std::move(source.columns);
+    first_line_ = std::move(source.first_line);
+    target_column_ = source.target_column;
+    headers_ = source.headers;
+    index_column_ = source.index_column;
+}
+
+/**
+ * Re-slices the loaded table for new options without touching the file.
+ * On failure the previous options and views are kept.
+*/
+void Dataset::reconfigure_(long long target_column, bool index_column, bool headers) {
+    const long long previous_target_column = target_column_;
+    const bool previous_index_column = index_column_;
+    const bool previous_headers = headers_;
+    target_column_ = target_column;
+    index_column_ = index_column;
     headers_ = headers;
-    process_data_();
+    try {
+        derive_views_();
+    } catch (...) {
+        target_column_ = previous_target_column;
+        index_column_ = previous_index_column;
+        headers_ = previous_headers;
+        throw;
+    }
 }
 
 // --------------------------------------------------
@@ -151,109 +463,329 @@ void Dataset::set_headers(bool headers) {
 // --------------------------------------------------
 
 void Dataset::process_data_() {
-    ifstream file(path_);
-    if (!file.is_open()) {
-        string message = "Failed to open file: " + path_;
-        spdlog::error(message);
-        throw std::runtime_error(message);
+    // The mapping and the table are only stored once the file has parsed
+    std::shared_ptr<const MappedFile> file;
+    try {
+        file = std::make_shared<const MappedFile>(path_);
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        throw;
     }
-    
-    // Erase any existing data
-    header_names_.clear();
-    raw_data_.clear();
-
-    // Obtain raw data
-    string line;
-    while (getline(file, line)) {
-        auto tokens = split_csv_line_(line);
-        if (headers_ && header_names_.empty()) {
-            header_names_ = std::move(tokens);
-            continue;
+    const char* const begin = file->data();
+    const char* const end = file->data() + file->size();
+
+    // Newline-aligned chunks, and the first line of each from a prefix sum of their line counts
+    vector<const char*> bounds = { begin };
+    for (const char* p = begin + CSV_CHUNK_BYTES; p < end; p = bounds.back() + CSV_CHUNK_BYTES) {
+        const char* eol = Csv::line_end(p, end);
+        if (eol == end) {
+            break;
         }
-        raw_data_.push_back(tokens);
+        bounds.push_back(eol + 1);
+    }
+    bounds.push_back(end);
+    const size_t n_chunks = bounds.size() - 1;
+    vector<size_t> first_lines(n_chunks + 1, 0);
+    {
+        PROFILE_ZONE("count lines");
+        parallel_for(0, n_chunks, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; ++chunk) {
+                first_lines[chunk + 1] = Csv::count_lines(bounds[chunk], bounds[chunk + 1]);
+            }
+        });
     }
-    if (raw_data_.empty()) {
+    for (size_t chunk = 0; chunk < n_chunks; ++chunk) {
+        first_lines[chunk + 1] += first_lines[chunk];
+    }
+    const size_t n_lines = first_lines[n_chunks];
+    if (n_lines == 0) {
         string message = "Empty dataset file: '" + path_ + "'";
         spdlog::error(message);
         throw std::runtime_error(message);
     }
 
-    // Verify number of columns
-    size_t n_columns = raw_data_[0].size();
-    for (auto& row : raw_data_) {
-        if (row.size() != n_columns) {
-            string message = "Loaded CSV file is corrupted - different number of columns in rows.";
-            spdlog::error(message);
-            throw std::invalid_argument(message);
-        }
+    // The first line may be headers, so the second one decides the number of columns
+    const char* first_eol = Csv::line_end(begin, end);
+    vector<string> first_line = split_csv_line_(string(begin, first_eol));
+    const char* second_line = n_lines > 1 ? first_eol + 1 : begin;
+    const size_t n_cols = Csv::for_each_cell(second_line, Csv::line_end(second_line, end), [](size_t, const char*, const char*) {});
+
+    // Errors are collected per chunk and reported after the parse
+    struct ChunkStatus {
+        bool corrupted = false;
+        vector<char> non_numeric;   // Per column, lines after the first
+    };
+    vector<ChunkStatus> status(n_chunks);
+    vector<char> first_numeric(n_cols, 0);
+    auto table = std::make_shared<Matrix>(n_cols, n_lines);
+    double* const table_data = table->data();
+    const size_t table_stride = table->get_stride();
+
+    {
+        PROFILE_ZONE("parse");
+        parallel_for(0, n_chunks, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; ++chunk) {
+                ChunkStatus& chunk_status = status[chunk];
+                chunk_status.non_numeric.assign(n_cols, 0);
+                size_t line_index = first_lines[chunk];
+                for (const char* line = bounds[chunk]; line < bounds[chunk + 1]; ++line_index) {
+                    const char* eol = Csv::line_end(line, bounds[chunk + 1]);
+                    const size_t n = Csv::for_each_cell(line, eol, [&](size_t col, const char* cell_begin, const char* cell_end) {
+                        if (col >= n_cols) {
+                            return;
+                        }
+                        double value;
+                        const bool numeric = Csv::parse_number(Csv::clean_cell(cell_begin, cell_end), value);
+                        table_data[col * table_stride + line_index] = numeric ? value : std::numeric_limits<double>::quiet_NaN();
+                        if (line_index == 0) {
+                            first_numeric[col] = numeric;
+                        } else if (!numeric) {
+                            chunk_status.non_numeric[col] = 1;
+                        }
+                    });
+                    // Missing cells of the first line are checked once it is known whether it holds headers
+                    for (size_t col = n; line_index == 0 && col < n_cols; ++col) {
+                        table_data[col * table_stride] = std::numeric_limits<double>::quiet_NaN();
+                    }
+                    chunk_status.corrupted |= line_index > 0 && n != n_cols;
+                    line = eol + 1;
+                }
+            }
+        });
     }
 
-    // Default to last column if invalid
-    if (target_column_ < 0 || target_column_ > static_cast<long long>(raw_data_[0].size()) - 1) {
-        target_column_ = static_cast<long long>(raw_data_[0].size()) - 1;
-    }
-    if (target_column_ < 0) {
-        string message = "Target column could not be set correctly - dataset empty.";
+    if (std::any_of(status.begin(), status.end(), [](const ChunkStatus& s) { return s.corrupted; })) {
+        string message = "Loaded CSV file is corrupted - different number of columns in rows.";
         spdlog::error(message);
         throw std::invalid_argument(message);
     }
 
-    spdlog::info("Raw CSV processed successfully.");
-    convert_to_numerical_();
+    // Columns with any text after the first line are categorical and hold label indices
+    vector<Column> columns(n_cols);
+    vector<size_t> categorical;
+    for (size_t col = 0; col < n_cols; ++col) {
+        columns[col].first_numeric = first_numeric[col];
+        if (std::any_of(status.begin(), status.end(), [&](const ChunkStatus& s) { return s.non_numeric[col]; })) {
+            categorical.push_back(col);
+        }
+    }
+    if (!categorical.empty()) {
+        PROFILE_ZONE("categorical");
+        vector<vector<string_view>> cells(categorical.size(), vector<string_view>(n_lines));
+        parallel_for(0, n_chunks, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; ++chunk) {
+                size_t line_index = first_lines[chunk];
+                for (const char* line = bounds[chunk]; line < bounds[chunk + 1]; ++line_index) {
+                    const char* eol = Csv::line_end(line, bounds[chunk + 1]);
+                    size_t next = 0;
+                    Csv::for_each_cell(line, eol, [&](size_t col, const char* cell_begin, const char* cell_end) {
+                        if (next < categorical.size() && col == categorical[next]) {
+                            cells[next++][line_index] = Csv::clean_cell(cell_begin, cell_end);
+                        }
+                    });
+                    line = eol + 1;
+                }
+            }
+        });
+        for (size_t i = 0; i < categorical.size(); ++i) {
+            Column& column = columns[categorical[i]];
+            double* values = table_data + categorical[i] * table_stride;
+            std::unordered_map<string_view, int> ids;
+            for (size_t line = 1; line < n_lines; ++line) {
+                ids.emplace(cells[i][line], 0);
+            }
+            vector<string_view> labels;
+            labels.reserve(ids.size());
+            for (const auto& entry : ids) {
+                labels.push_back(entry.first);
+            }
+            std::sort(labels.begin(), labels.end());
+            for (size_t id = 0; id < labels.size(); ++id) {
+                ids[labels[id]] = static_cast<int>(id);
+                column.labels.emplace_back(labels[id]);
+            }
+            for (size_t line = 1; line < n_lines; ++line) {
+                values[line] = ids[cells[i][line]];
+            }
+            const auto first_label = ids.find(first_line.size() > categorical[i] ? string_view(first_line[categorical[i]]) : string_view());
+            column.first_numeric = first_line.size() > categorical[i] && first_label != ids.end();
+            values[0] = column.first_numeric ? first_label->second : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    file_ = std::move(file);
+    binary_ = false;
+    table_storage_ = table;
+    table_ = table_storage_->view();
+    columns_ = std::move(columns);
+    first_line_ = std::move(first_line);
+    spdlog::info("CSV parsed successfully.");
+
+    derive_views_();
 }
 
-void Dataset::convert_to_numerical_() {
-    if (is_data_categorical_()) {
-        string message = "Categorical data procesing not supported!";
+/**
+ * Slices the data and targets for the current headers, index and target
+ * column out of the table. Features stay a view of the table when their
+ * columns are adjacent, otherwise they are gathered into a copy.
+*/
+void Dataset::derive_views_() {
+    PROFILE_ZONE("derive views");
+    const size_t n_cols = columns_.size();
+    const size_t n_lines = table_.get_cols();
+    const size_t first_row = headers_ ? 1 : 0;
+    if (n_lines <= first_row) {
+        string message = "Empty dataset file: '" + path_ + "'";
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+    if (!headers_ && first_line_.size() != n_cols) {
+        string message = "Loaded CSV file is corrupted - different number of columns in rows.";
         spdlog::error(message);
         throw std::invalid_argument(message);
     }
 
-    const size_t n_cols = raw_data_[0].size();
-    const size_t n_rows = raw_data_.size();
+    // Default to last column if invalid
+    if (target_column_ < 0 || target_column_ > static_cast<long long>(n_cols) - 1) {
+        target_column_ = static_cast<long long>(n_cols) - 1;
+    }
+    if (index_column_ && n_cols < 2) {
+        string message = "Target column could not be set correctly - dataset empty.";
+        spdlog::error(message);
+        throw std::invalid_argument(message);
+    }
     const size_t target_col = static_cast<size_t>(target_column_);
-    const size_t n_features = n_cols - (index_column_ ? 2 : 1);
-    size_ = n_rows;
 
-    /* Convert raw data into numerical */
-    data_ = Matrix(size_, n_features);
-    size_t feature_col = 0;
+    vector<size_t> features;
     for (size_t col = 0; col < n_cols; ++col) {
-        if ((index_column_ && col == 0) || col == target_col) {
+        if (col == target_col) {
             continue;
         }
-        for (size_t row = 0; row < n_rows; ++row) {
-            data_[row][feature_col] = std::stod(raw_data_[row][col]);
+        if (!columns_[col].labels.empty() || (!headers_ && !columns_[col].first_numeric)) {
+            string message = "Categorical data procesing not supported!";
+            spdlog::error(message);
+            throw std::invalid_argument(message);
+        }
+        if (!(index_column_ && col == 0)) {
+            features.push_back(col);
         }
-        ++feature_col;
     }
 
+    const size_t n_rows = n_lines - first_row;
+    const size_t n_features = features.size();
+    data_storage_.reset();
+    if (n_features == 0) {
+        data_ = MatrixView(table_.data(), n_rows, 0, 1, table_.get_row_stride());
+    } else if (features.back() - features.front() + 1 == n_features) {
+        data_ = table_.block(features.front(), first_row, n_features, n_rows).transpose();
+    } else {
+        auto data = std::make_shared<Matrix>(n_rows, n_features);
+        parallel_for(0, n_rows, [&](size_t first, size_t last) {
+            for (size_t row = first; row < last; ++row) {
+                double* out = data->data() + row * data->get_stride();
+                for (size_t feature = 0; feature < n_features; ++feature) {
+                    out[feature] = table_(features[feature], first_row + row);
+                }
+            }
+        }, 1024);
+        data_storage_ = data;
+        data_ = data_storage_->view();
+    }
+
+    map_targets_(target_col, first_row);
+
+    header_names_ = headers_ ? first_line_ : vector<string>();
+    size_ = n_rows;
+    raw_data_.clear();
+    raw_data_loaded_ = false;
+}
+
+/**
+ * Targets are the target column of the table, with label maps for
+ * categorical ones. When the first line joins the data and brings a label
+ * of its own, the targets are relabelled into a copy.
+*/
+void Dataset::map_targets_(size_t target_col, size_t first_row) {
+    const Column& column = columns_[target_col];
+    const size_t n_rows = table_.get_cols() - first_row;
     label_to_int_map_.clear();
     int_to_label_map_.clear();
+    targets_storage_.reset();
+    targets_ = table_.block(target_col, first_row, 1, n_rows).transpose();
+    if (column.labels.empty() && (first_row == 1 || column.first_numeric)) {
+        return;
+    }
 
-    /* Convert the target column to mapped integer values (from N to N-1) */
-    targets_ = Matrix(size_, 1);
-    if (is_target_column_categorical_()) {
-        set<string> unique_labels;
-        for (const auto& row : raw_data_) {
-            unique_labels.insert(row[target_col]);
-        }
-        int id = 0;
-        for (const auto& label : unique_labels) {
-            label_to_int_map_[label] = id;
-            int_to_label_map_[id] = label;
-            ++id;
+    vector<string> labels = column.labels;
+    if (first_row == 0 && !column.first_numeric) {
+        auto targets = std::make_shared<Matrix>(n_rows, 1);
+        if (column.labels.empty()) {
+            // Text in the first line makes the numbers labels too, written in their shortest form
+            vector<string> cells(n_rows);
+            cells[0] = first_line_[target_col];
+            for (size_t row = 1; row < n_rows; ++row) {
+                cells[row] = number_text_(table_(target_col, row));
+            }
+            labels = cells;
+            std::sort(labels.begin(), labels.end());
+            labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+            for (size_t row = 0; row < n_rows; ++row) {
+                (*targets)[row][0] = std::lower_bound(labels.begin(), labels.end(), cells[row]) - labels.begin();
+            }
+        } else {
+            // The new label moves the ones sorted after it up by one
+            const auto position = std::lower_bound(labels.begin(), labels.end(), first_line_[target_col]);
+            const double id = position - labels.begin();
+            labels.insert(position, first_line_[target_col]);
+            (*targets)[0][0] = id;
+            for (size_t row = 1; row < n_rows; ++row) {
+                const double value = table_(target_col, row);
+                (*targets)[row][0] = value >= id ? value + 1 : value;
+            }
         }
-        for (size_t row = 0; row < n_rows; ++row) {
-            targets_[row][0] = static_cast<double>(label_to_int_map_.at(raw_data_[row][target_col]));
+        targets_storage_ = targets;
+        targets_ = targets_storage_->view();
+    }
+
+    for (size_t id = 0; id < labels.size(); ++id) {
+        label_to_int_map_[labels[id]] = static_cast<int>(id);
+        int_to_label_map_[static_cast<int>(id)] = labels[id];
+    }
+}
+
+/**
+ * Rebuilds the string cells of the data rows: split out of the CSV text,
+ * or written back from the table for binary caches.
+*/
+void Dataset::load_raw_data_() const {
+    raw_data_.clear();
+    raw_data_.reserve(size_);
+    if (file_ && !binary_) {
+        const char* const end = file_->data() + file_->size();
+        bool skip_header = headers_;
+        for (const char* line = file_->data(); line < end; ) {
+            const char* eol = Csv::line_end(line, end);
+            if (!skip_header) {
+                raw_data_.push_back(split_csv_line_(string(line, eol)));
+            }
+            skip_header = false;
+            line = eol + 1;
         }
     } else {
-        for (size_t row = 0; row < n_rows; ++row) {
-            targets_[row][0] = std::stod(raw_data_[row][target_col]);
+        for (size_t line = headers_ ? 1 : 0; line < table_.get_cols(); ++line) {
+            if (line == 0) {
+                raw_data_.push_back(first_line_);
+                continue;
+            }
+            vector<string> cells(columns_.size());
+            for (size_t col = 0; col < columns_.size(); ++col) {
+                const double value = table_(col, line);
+                cells[col] = columns_[col].labels.empty() ? number_text_(value) : columns_[col].labels[static_cast<size_t>(value)];
+            }
+            raw_data_.push_back(std::move(cells));
         }
     }
-
-    spdlog::info("Conversion to numerical data successful.");
+    raw_data_loaded_ = true;
 }
 
 vector<string> Dataset::split_csv_line_(const string& line) const {
@@ -285,47 +817,3 @@ void Dataset::trim_(string& str) const {
         [](unsigned char ch) { return !isspace(ch); }).base(),
         str.end());
 }
-
-/**
- * It checks whether the loaded raw_data_ contains
- * any categorical data (excluding the target column).
-*/
-bool Dataset::is_data_categorical_() const {
-    size_t target_col = static_cast<size_t>(target_column_);
-    for (const auto& row : raw_data_) {
-        for (size_t col = 0; col < row.size(); ++col) {
-            if (col == target_col) {
-                continue;
-            }
-            if (!is_float_(row[col])) {
-                return true;
-            }
-        }
-
-    }
-    return false;
-}
-
-/**
- * It checks whether the given string is
- * a floating point number.
-*/
-bool Dataset::is_float_(const string& float_str) const {
-    try {
-        size_t pos;
-        std::stod(float_str, &pos);
-        return pos == float_str.size();
-    } catch (...) {
-        return false;
-    }
-}
-
-bool Dataset::is_target_column_categorical_() const {
-    size_t target_col = static_cast<size_t>(target_column_);
-    for (const auto& row : raw_data_) {
-        if (!is_float_(row[target_col])) {
-            return true;
-        }
-    }
-    return false;
-}
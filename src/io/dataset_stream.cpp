@@ -0,0 +1,281 @@
+#include "dataset_stream.h"
+#include "csv.h"
+#include "profiler.h"
+#include "spdlog/spdlog.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+// Bytes requested from the kernel per read
+constexpr size_t READ_BLOCK_BYTES = 1 << 20;
+
+const size_t NO_FEATURE = static_cast<size_t>(-1);
+
+// Closes the descriptor on every way out of the reader thread
+struct FileDescriptor {
+    int fd;
+    ~FileDescriptor() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+vector<string> split_cells_(const string& line) {
+    vector<string> cells;
+    Csv::for_each_cell(line.data(), line.data() + line.size(), [&](size_t, const char* begin, const char* end) {
+        cells.emplace_back(Csv::clean_cell(begin, end));
+    });
+    return cells;
+}
+
+}
+
+// --------------------------------------------------
+//  Constructors
+// --------------------------------------------------
+
+DatasetStream::DatasetStream(const string& path, size_t batch_size, bool headers, bool index_column,
+                             size_t target_column, size_t n_buffers)
+    : path_(path),
+      batch_size_(batch_size),
+      index_column_(index_column),
+      target_column_(target_column),
+      n_cols_(0),
+      n_features_(0),
+      data_offset_(0),
+      current_(nullptr),
+      finished_(false),
+      stopping_(false) {
+    spdlog::info("Streaming dataset from: '" + path + "'");
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive!");
+    }
+    if (n_buffers < 2) {
+        throw std::invalid_argument("A dataset stream needs at least two buffers!");
+    }
+
+    // Only the first lines are read here, for the headers and the number of columns
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        string message = "Failed to open file: " + path;
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+    string line;
+    if (headers && std::getline(file, line)) {
+        header_names_ = split_cells_(line);
+        const std::streamoff position = file.tellg();
+        data_offset_ = position < 0 ? 0 : static_cast<size_t>(position);
+    }
+    if (!std::getline(file, line)) {
+        string message = "Empty dataset file: '" + path + "'";
+        spdlog::error(message);
+        throw std::runtime_error(message);
+    }
+    n_cols_ = split_cells_(line).size();
+
+    // Default to last column if invalid
+    if (target_column_ >= n_cols_) {
+        target_column_ = n_cols_ - 1;
+    }
+    if (index_column_ && n_cols_ < 2) {
+        string message = "Target column could not be set correctly - dataset empty.";
+        spdlog::error(message);
+        throw std::invalid_argument(message);
+    }
+    feature_of_.assign(n_cols_, NO_FEATURE);
+    for (size_t col = 0; col < n_cols_; ++col) {
+        if (!(index_column_ && col == 0) && col != target_column_) {
+            feature_of_[col] = n_features_++;
+        }
+    }
+
+    slots_.resize(n_buffers);
+    for (Slot& slot : slots_) {
+        slot.data = Matrix(batch_size_, n_features_);
+        slot.targets = Matrix(batch_size_, 1);
+    }
+    start_();
+}
+
+DatasetStream::~DatasetStream() {
+    stop_();
+}
+
+// --------------------------------------------------
+//  Consumer side
+// --------------------------------------------------
+
+bool DatasetStream::next(Batch& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (current_ != nullptr) {
+        free_.push_back(current_);
+        current_ = nullptr;
+        slot_freed_.notify_one();
+    }
+    if (ready_.empty() && !finished_) {
+        PROFILE_ZONE("wait for batch");
+        slot_ready_.wait(lock, [&]() { return !ready_.empty() || finished_; });
+    }
+    if (ready_.empty()) {
+        if (error_) {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+        return false;
+    }
+    current_ = ready_.front();
+    ready_.pop_front();
+    batch.data = current_->data.row_range(0, current_->rows);
+    batch.targets = current_->targets.row_range(0, current_->rows);
+    return true;
+}
+
+void DatasetStream::reset() {
+    stop_();
+    start_();
+}
+
+void DatasetStream::start_() {
+    free_.clear();
+    ready_.clear();
+    for (Slot& slot : slots_) {
+        free_.push_back(&slot);
+    }
+    current_ = nullptr;
+    finished_ = false;
+    stopping_ = false;
+    error_ = nullptr;
+    reader_ = std::thread(&DatasetStream::read_loop_, this);
+}
+
+void DatasetStream::stop_() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    slot_freed_.notify_all();
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+}
+
+// --------------------------------------------------
+//  Reader thread
+// --------------------------------------------------
+
+DatasetStream::Slot* DatasetStream::acquire_free_slot_() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    slot_freed_.wait(lock, [&]() { return stopping_ || !free_.empty(); });
+    if (stopping_) {
+        return nullptr;
+    }
+    Slot* slot = free_.front();
+    free_.pop_front();
+    slot->rows = 0;
+    return slot;
+}
+
+void DatasetStream::publish_(Slot* slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push_back(slot);
+    slot_ready_.notify_one();
+}
+
+void DatasetStream::read_loop_() {
+    PROFILE_THREAD_NAME("dataset stream");
+    Slot* slot = nullptr;
+    try {
+        FileDescriptor file{ ::open(path_.c_str(), O_RDONLY) };
+        if (file.fd < 0 || ::lseek(file.fd, static_cast<off_t>(data_offset_), SEEK_SET) < 0) {
+            throw std::runtime_error("Failed to open file: " + path_);
+        }
+        // Lets the kernel read ahead further than by default
+        ::posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        slot = acquire_free_slot_();
+        auto emit = [&](const char* begin, const char* end) {
+            parse_line_(begin, end, *slot);
+            if (++slot->rows == batch_size_) {
+                publish_(slot);
+                slot = acquire_free_slot_();
+            }
+            return slot != nullptr;
+        };
+
+        // Lines are parsed in place, only those crossing a block boundary are copied
+        vector<char> block(READ_BLOCK_BYTES);
+        string carry;
+        bool running = slot != nullptr;
+        ssize_t n_read = 0;
+        while (running && (n_read = ::read(file.fd, block.data(), block.size())) > 0) {
+            PROFILE_ZONE("parse block");
+            const char* p = block.data();
+            const char* const end = block.data() + n_read;
+            while (running) {
+                const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (eol == nullptr) {
+                    carry.append(p, end);
+                    break;
+                }
+                if (carry.empty()) {
+                    running = emit(p, eol);
+                } else {
+                    carry.append(p, eol);
+                    running = emit(carry.data(), carry.data() + carry.size());
+                    carry.clear();
+                }
+                p = eol + 1;
+            }
+        }
+        if (n_read < 0) {
+            throw std::runtime_error("Failed to read file: " + path_);
+        }
+        if (running && !carry.empty()) {
+            running = emit(carry.data(), carry.data() + carry.size());
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+    }
+
+    // The rows before the end (or an error) are the last batch
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slot != nullptr) {
+        (slot->rows > 0 ? ready_ : free_).push_back(slot);
+    }
+    finished_ = true;
+    slot_ready_.notify_all();
+}
+
+void DatasetStream::parse_line_(const char* begin, const char* end, Slot& slot) const {
+    double* features = slot.data.data() + slot.rows * slot.data.get_stride();
+    double* target = slot.targets.data() + slot.rows * slot.targets.get_stride();
+    bool numeric = true;
+    const size_t n = Csv::for_each_cell(begin, end, [&](size_t col, const char* cell_begin, const char* cell_end) {
+        double value;
+        if (col >= n_cols_ || !numeric || (col != target_column_ && feature_of_[col] == NO_FEATURE)) {
+            return;
+        }
+        if (!Csv::parse_number(Csv::clean_cell(cell_begin, cell_end), value)) {
+            numeric = false;
+        } else if (col == target_column_) {
+            *target = value;
+        } else if (feature_of_[col] != NO_FEATURE) {
+            features[feature_of_[col]] = value;
+        }
+    });
+    if (n != n_cols_) {
+        throw std::invalid_argument("Loaded CSV file is corrupted - different number of columns in rows.");
+    }
+    if (!numeric) {
+        throw std::invalid_argument("Categorical data procesing not supported!");
+    }
+}
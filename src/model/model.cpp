@@ -1,9 +1,13 @@
 #include "model.h"
+#include "dataset_stream.h"
+#include "batch_loader.h"
+#include "profiler.h"
 #include "spdlog/spdlog.h"
 #include "activation.h"
 
 #include <stdexcept>
 #include <sstream>
+#include <algorithm>
 
 Model::Model()
     : nn_(NeuralNetwork()), task_type_(TaskType::Classification), fit_(false) {}
@@ -42,21 +46,128 @@ Model& Model::add_layer(size_t n_neurons, ActivationFunction activation_function
     return add_layer(n_neurons, LayerType::Hidden, activation_function);
 }
 
-Model& Model::fit(const Matrix& X, const Matrix& y, size_t epochs, double learning_rate, LossFunction loss) {
+Model& Model::fit(const Matrix& X, const Matrix& y, size_t epochs, double learning_rate, LossFunction loss, size_t batch_size) {
     spdlog::info("Model training started.");
+    // Rejected calls must leave the model as it was: everything is checked before it is built and locked
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive!");
+    }
+    if (X.get_rows() != y.get_rows()) {
+        throw std::invalid_argument("Number of samples and targets must be equal!");
+    }
+    // Networks with fewer than 2 layers are refused by build() below
+    const vector<size_t> shape = nn_.get_shape();
+    if (X.get_rows() > 0 && shape.size() >= 2 && (X.get_cols() != shape.front() || y.get_cols() != shape.back())) {
+        throw std::invalid_argument("Training data does not match the network's input or output size!");
+    }
+    if (!nn_.is_built()) {
+        nn_.build(batch_size);
+    }
     fit_ = true;
+    if (X.get_rows() == 0) {
+        spdlog::warn("No training samples given, nothing to fit.");
+        return *this;
+    }
+
+    const size_t n_samples = X.get_rows();
+    Matrix output(nn_.get_shape().back(), batch_size);
+    double epoch_loss = 0.0;
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        PROFILE_ZONE("epoch");
+        epoch_loss = 0.0;
+        for (size_t start = 0; start < n_samples; start += batch_size) {
+            const size_t end = std::min(n_samples, start + batch_size);
+            epoch_loss += train_batch_(X.row_range(start, end), y.row_range(start, end), learning_rate, loss, output)
+                          * static_cast<double>(end - start);
+        }
+        epoch_loss /= static_cast<double>(n_samples);
+        spdlog::debug("Epoch {}/{} | loss: {}", epoch + 1, epochs, epoch_loss);
+    }
+
+    std::ostringstream log_msg_oss;
+    log_msg_oss << "Model training finished. Final loss: " << epoch_loss;
+    spdlog::info(log_msg_oss.str());
+    return *this;
+}
+
+Model& Model::fit(DatasetStream& stream, size_t epochs, double learning_rate, LossFunction loss) {
+    return fit_batches_(stream, epochs, learning_rate, loss);
+}
+
+Model& Model::fit(BatchLoader& loader, size_t epochs, double learning_rate, LossFunction loss) {
+    return fit_batches_(loader, epochs, learning_rate, loss);
+}
+
+template <typename Source>
+Model& Model::fit_batches_(Source& source, size_t epochs, double learning_rate, LossFunction loss) {
+    spdlog::info("Model training started.");
+    const size_t batch_size = source.get_batch_size();
+    const vector<size_t> shape = nn_.get_shape();
+    if (shape.size() >= 2 && (source.get_features_count() != shape.front() || source.get_targets_count() != shape.back())) {
+        throw std::invalid_argument("Training data does not match the network's input or output size!");
+    }
+    if (nn_.is_built() && batch_size > nn_.get_max_batch_size()) {
+        throw std::invalid_argument("Batches are larger than the network was built for!");
+    }
     if (!nn_.is_built()) {
-        nn_.build();
+        nn_.build(batch_size);
+    }
+    fit_ = true;
+
+    Matrix output(nn_.get_shape().back(), batch_size);
+    double epoch_loss = 0.0;
+    typename Source::Batch batch;
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        PROFILE_ZONE("epoch");
+        epoch_loss = 0.0;
+        size_t n_samples = 0;
+        while (source.next(batch)) {
+            const size_t rows = batch.data.get_rows();
+            epoch_loss += train_batch_(batch.data, batch.targets, learning_rate, loss, output) * static_cast<double>(rows);
+            n_samples += rows;
+        }
+        // Rewound right away, the source prepares the next epoch while this one is logged
+        if (epoch + 1 < epochs) {
+            source.reset();
+        }
+        if (n_samples == 0) {
+            spdlog::warn("No training samples given, nothing to fit.");
+            return *this;
+        }
+        epoch_loss /= static_cast<double>(n_samples);
+        spdlog::debug("Epoch {}/{} | loss: {}", epoch + 1, epochs, epoch_loss);
     }
-    // calls forward() and backward()
 
-    spdlog::info("Model training finished.");
+    std::ostringstream log_msg_oss;
+    log_msg_oss << "Model training finished. Final loss: " << epoch_loss;
+    spdlog::info(log_msg_oss.str());
     return *this;
 }
 
-Matrix Model::predict(const Matrix& input) const {
-    // calls forward()
-    return {};
+double Model::train_batch_(MatrixView X_batch, MatrixView y_batch, double learning_rate, LossFunction loss, Matrix& output) {
+    // Samples are rows, the network takes columns: the batches are transposed views, not copies
+    const MatrixView X = X_batch.transpose();
+    const MatrixView y = y_batch.transpose();
+    nn_.forward_into(X, output.col_range(0, X.get_cols()), true);
+    return nn_.backward(X, y, learning_rate, loss);
+}
+
+Matrix Model::predict(const Matrix& input) {
+    if (!nn_.is_built()) {
+        throw std::logic_error("Model must be fit before calling predict()!");
+    }
+    if (input.get_cols() != nn_.get_shape().front()) {
+        throw std::invalid_argument("Input does not match the network's input size!");
+    }
+
+    // Batches of the planned size keep the forward passes inside the network's workspace
+    Matrix result(input.get_rows(), nn_.get_shape().back());
+    const size_t batch_size = nn_.get_max_batch_size();
+    for (size_t start = 0; start < input.get_rows(); start += batch_size) {
+        const size_t end = std::min(input.get_rows(), start + batch_size);
+        nn_.forward_into(input.row_range(start, end).transpose(), result.row_range(start, end).transpose());
+    }
+    return result;
 }
 
 Model& Model::clear() {
@@ -2,19 +2,24 @@
 #include "spdlog/spdlog.h"
 #include "activation.h"
 #include "loss.h"
+#include "profiler.h"
 
 #include <stdexcept>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
 
 using std::string;
 
-NeuralNetwork::NeuralNetwork()
+template <typename T>
+BasicNeuralNetwork<T>::BasicNeuralNetwork()
     : n_layers_(0), shape_({}), activation_functions_({}),
-      weights_({}), built_(false), A_values_({}), Z_values_({}) {}
+      weights_({}), biases_({}), built_(false), max_batch_size_(0), learning_batch_size_(0), A_values_({}), Z_values_({}) {}
 
-NeuralNetwork::NeuralNetwork(const vector<size_t>& new_shape, const vector<ActivationFunction>& new_activation_functions) 
+template <typename T>
+BasicNeuralNetwork<T>::BasicNeuralNetwork(const vector<size_t>& new_shape, const vector<ActivationFunction>& new_activation_functions) 
     : n_layers_(new_shape.size()), shape_(new_shape), activation_functions_(new_activation_functions), 
-      weights_({}), built_(false), A_values_({}), Z_values_({}) {
+      weights_({}), biases_({}), built_(false), max_batch_size_(0), learning_batch_size_(0), A_values_({}), Z_values_({}) {
 /*
     Network layer's sizes including input and output layers
 */
@@ -26,29 +31,44 @@ NeuralNetwork::NeuralNetwork(const vector<size_t>& new_shape, const vector<Activ
     }
 }
 
-NeuralNetwork& NeuralNetwork::erase() {
+template <typename T>
+BasicNeuralNetwork<T>& BasicNeuralNetwork<T>::erase() {
     n_layers_ = 0;
     shape_.clear();
     activation_functions_.clear();
     weights_.clear();
+    biases_.clear();
     A_values_.clear();
     Z_values_.clear();
+    G_values_.clear();
+    weight_gradients_.clear();
+    bias_gradients_.clear();
     built_ = false;
+    max_batch_size_ = 0;
+    learning_batch_size_ = 0;
     return *this;
 }
 
-NeuralNetwork& NeuralNetwork::build() {
+template <typename T>
+BasicNeuralNetwork<T>& BasicNeuralNetwork<T>::build(size_t max_batch_size) {
     spdlog::info("Building neural network...");
     if (n_layers_ < 2) {
         string err_msg = "Cannot build a network with fewer than 2 layers!.";
         spdlog::error(err_msg);
         throw std::logic_error(err_msg); 
     }
+    // Building again starts over with fresh weights for the current shape
+    weights_.clear();
+    biases_.clear();
     for (size_t layer = 0; layer < n_layers_ - 1; ++layer) {
-        Matrix layer_weights(shape_[layer] + 1, shape_[layer + 1]);
+        Mat layer_weights(shape_[layer], shape_[layer + 1]);
         layer_weights.fill_random();
         weights_.push_back(layer_weights); 
+        Mat layer_biases(shape_[layer + 1], 1);
+        layer_biases.fill_random();
+        biases_.push_back(layer_biases);
     }
+    plan_workspace_(max_batch_size);
     built_ = true;
 
     spdlog::info("Neural network built successfully.");
@@ -66,69 +86,240 @@ NeuralNetwork& NeuralNetwork::build() {
     return *this;
 }
 
-Matrix NeuralNetwork::forward(const Matrix& input, bool learning) {
+template <typename T>
+typename BasicNeuralNetwork<T>::Mat BasicNeuralNetwork<T>::forward(View input, bool learning) {
 /*
 It takes batch of column vectors on input.
 */
     if (!built_) {
         throw std::logic_error("Network must be built before forward pass!");
     }
+    Mat output(shape_.back(), input.get_cols());
+    forward_into(input, output.view(), learning);
+    return output;
+}
 
-    if (learning) {
-        Z_values_.clear();
-        A_values_.clear();
+template <typename T>
+void BasicNeuralNetwork<T>::forward_into(View input, Span output, bool learning) {
+    PROFILE_ZONE("forward");
+    if (!built_) {
+        throw std::logic_error("Network must be built before forward pass!");
+    }
+    const size_t batch_size = input.get_cols();
+    if (output.get_rows() != shape_.back() || output.get_cols() != batch_size) {
+        throw std::invalid_argument("Output of the forward pass has the wrong shape!");
     }
+    if (batch_size > max_batch_size_) {
+        spdlog::warn("Batch of {} columns exceeds the planned workspace of {} columns, growing it.", batch_size, max_batch_size_);
+        plan_workspace_(batch_size);
+    }
+    learning_batch_size_ = 0;
 
-    Matrix X = input;
+    // The input is only read through a view, so batches sliced out of a dataset are never copied
+    View X = input;
 
     for (size_t layer = 0; layer < weights_.size(); ++layer) {
-        Matrix X_bias = X.add_bias_row();
-        const Matrix& W = weights_[layer];
-        Matrix Z = W.transpose() * X_bias;
-        if (learning) {
-            Z_values_.push_back(Z);
+        PROFILE_ZONE("layer", layer);
+        Span Z = Z_values_[layer].col_range(0, batch_size);
+        Span A = A_values_[layer].col_range(0, batch_size);
+
+        // Z = W^T X + b and A = act(Z) are written together while each output tile is in cache.
+        // Softmax needs whole columns, so it runs as a separate pass over Z.
+        Gemm::Epilogue<T> epilogue;
+        epilogue.bias = biases_[layer].data();
+        if (activation_functions_[layer] != ActivationFunction::Softmax) {
+            epilogue.activation = activation_kernel_(activation_functions_[layer]);
+            epilogue.out = A.data();
+            epilogue.out_rs = A.get_row_stride();
         }
-        switch (activation_functions_[layer]) {
-            case ActivationFunction::ReLU:
-                X = Activation::relu(Z);
-                break;
-            case ActivationFunction::Tanh:
-                X = Activation::tanh(Z);
-                break;
-            case ActivationFunction::Sigmoid:
-                X = Activation::sigmoid(Z);
-                break;
-            case ActivationFunction::Softmax:
-                X = Activation::softmax(Z);
-                break;
-            default:
-                throw std::logic_error("Unknown activation function!");
+        Mat::multiply_into(weights_[layer], true, X, false, Z, epilogue);
+        if (activation_functions_[layer] == ActivationFunction::Softmax) {
+            PROFILE_ZONE("softmax");
+            Activation::softmax<T>(Z, A);
         }
+        X = A;
     }
 
+    for (size_t row = 0; row < output.get_rows(); ++row) {
+        for (size_t col = 0; col < batch_size; ++col) {
+            output(row, col) = X(row, col);
+        }
+    }
     if (learning) {
-        A_values_.push_back(X);
+        learning_batch_size_ = batch_size;
     }
-
-    return X;
 }
 
-/* TODO */
-void NeuralNetwork::backward(const Matrix& input, const Matrix& target, double learning_rate) {
-    if (A_values_.empty() || Z_values_.empty()) {
+template <typename T>
+double BasicNeuralNetwork<T>::backward(View input, View target, double learning_rate, LossFunction loss) {
+    PROFILE_ZONE("backward");
+    using C = compute_t<T>;
+    if (learning_batch_size_ == 0) {
         throw std::logic_error("Can not perform backward pass before the forward pass!");
     }
+    const size_t batch_size = learning_batch_size_;
+    if (input.get_rows() != shape_.front() || input.get_cols() != batch_size) {
+        throw std::invalid_argument("Input of the backward pass does not match the forward pass!");
+    }
+    if (target.get_rows() != shape_.back() || target.get_cols() != batch_size) {
+        throw std::invalid_argument("Target of the backward pass has the wrong shape!");
+    }
+    // The stored activations are stale once the weights change
+    learning_batch_size_ = 0;
 
-    // const size_t L = weights.size();
+    // dL/dZ of the output layer
+    const double batch_loss = output_gradient_(target, loss);
+    const C rate = static_cast<C>(learning_rate);
 
-    // 1) Compute loss derivative (dA[L])
-    Matrix dA = Loss::mse_derivative(target, A_values_.back());
+    for (size_t layer = weights_.size(); layer-- > 0;) {
+        PROFILE_ZONE("layer", layer);
+        View dZ = G_values_[layer].col_range(0, batch_size);
+        View X = layer == 0 ? input : View(A_values_[layer - 1].col_range(0, batch_size));
 
-    // ...
+        // dW = X dZ^T, db = dZ summed over the batch
+        Mat::multiply_into(X, false, dZ, true, weight_gradients_[layer].view());
+        T* db = bias_gradients_[layer].data();
+        {
+            PROFILE_ZONE("bias gradient");
+            for (size_t row = 0; row < dZ.get_rows(); ++row) {
+                C sum = 0.0;
+                for (size_t col = 0; col < batch_size; ++col) {
+                    sum += static_cast<C>(dZ(row, col));
+                }
+                db[row] = sum;
+            }
+        }
 
+        // dZ of the previous layer, computed before this layer's weights are updated
+        if (layer > 0) {
+            Span dA = G_values_[layer - 1].col_range(0, batch_size);
+            Mat::multiply_into(weights_[layer], false, dZ, false, dA);
+            PROFILE_ZONE("activation gradient");
+            activation_gradient_(activation_functions_[layer - 1], A_values_[layer - 1].col_range(0, batch_size), dA);
+        }
+
+        // SGD step
+        PROFILE_ZONE("update");
+        T* W = weights_[layer].data();
+        const T* dW = weight_gradients_[layer].data();
+        for (size_t i = 0; i < weights_[layer].get_rows() * weights_[layer].get_cols(); ++i) {
+            W[i] = static_cast<C>(W[i]) - rate * static_cast<C>(dW[i]);
+        }
+        T* b = biases_[layer].data();
+        for (size_t i = 0; i < biases_[layer].get_rows(); ++i) {
+            b[i] = static_cast<C>(b[i]) - rate * static_cast<C>(db[i]);
+        }
+    }
+
+    return batch_loss;
 }
 
-NeuralNetwork& NeuralNetwork::add_layer(size_t n_neurons, LayerType layer_type, ActivationFunction activation_function) {
+template <typename T>
+double BasicNeuralNetwork<T>::output_gradient_(View target, LossFunction loss) {
+/*
+Writes dL/dZ of the output layer to G_values_ and returns the loss. The losses
+and their scaling follow the definitions in loss.h.
+*/
+    using C = compute_t<T>;
+    const size_t last = weights_.size() - 1;
+    const size_t batch_size = target.get_cols();
+    View A = A_values_[last].col_range(0, batch_size);
+    Span G = G_values_[last].col_range(0, batch_size);
+    const ActivationFunction activation_function = activation_functions_[last];
+
+    // Sigmoid + BCE and softmax + CCE are fused: the loss comes straight from the logits and dL/dZ is (A - Y) / n
+    if (activation_function == ActivationFunction::Sigmoid && loss == LossFunction::BinaryCrossEntropy) {
+        return Loss::sigmoid_bce_with_logits<T>(target, Z_values_[last].col_range(0, batch_size), G);
+    }
+    if (activation_function == ActivationFunction::Softmax && loss == LossFunction::CategoricalCrossEntropy) {
+        return Loss::softmax_cross_entropy_with_logits<T>(target, Z_values_[last].col_range(0, batch_size), G);
+    }
+
+    // The loss is reduced by the Loss functions themselves, the gradient written by one loop per loss
+    const size_t rows = A.get_rows();
+    const double n_elements = static_cast<double>(rows * batch_size);
+    const double eps = 1e-15;
+    double batch_loss = 0.0;
+    switch (loss) {
+        case LossFunction::MSE: {
+            batch_loss = Loss::mse<T>(target, A);
+            const double scale = 2.0 / n_elements;
+            for (size_t row = 0; row < rows; ++row) {
+                for (size_t col = 0; col < batch_size; ++col) {
+                    G(row, col) = scale * (static_cast<C>(A(row, col)) - static_cast<C>(target(row, col)));
+                }
+            }
+            break;
+        }
+        case LossFunction::MAE: {
+            batch_loss = Loss::mae<T>(target, A);
+            const double scale = 1.0 / n_elements;
+            for (size_t row = 0; row < rows; ++row) {
+                for (size_t col = 0; col < batch_size; ++col) {
+                    const double diff = static_cast<C>(A(row, col)) - static_cast<C>(target(row, col));
+                    G(row, col) = scale * ((diff > 0) - (diff < 0));
+                }
+            }
+            break;
+        }
+        case LossFunction::BinaryCrossEntropy: {
+            batch_loss = Loss::binary_cross_entropy<T>(target, A);
+            const double scale = 1.0 / n_elements;
+            for (size_t row = 0; row < rows; ++row) {
+                for (size_t col = 0; col < batch_size; ++col) {
+                    const double y_t = static_cast<C>(target(row, col));
+                    const double p = std::clamp(static_cast<double>(static_cast<C>(A(row, col))), eps, 1.0 - eps);
+                    G(row, col) = scale * (p - y_t) / (p * (1.0 - p));
+                }
+            }
+            break;
+        }
+        case LossFunction::CategoricalCrossEntropy: {
+            batch_loss = Loss::categorical_cross_entropy<T>(target, A);
+            const double scale = 1.0 / static_cast<double>(batch_size);
+            for (size_t row = 0; row < rows; ++row) {
+                for (size_t col = 0; col < batch_size; ++col) {
+                    const double y_t = static_cast<C>(target(row, col));
+                    const double p = std::max(static_cast<double>(static_cast<C>(A(row, col))), eps);
+                    G(row, col) = -scale * y_t / p;
+                }
+            }
+            break;
+        }
+        default:
+            throw std::logic_error("Unknown loss function!");
+    }
+
+    activation_gradient_(activation_function, A, G);
+    return batch_loss;
+}
+
+template <typename T>
+void BasicNeuralNetwork<T>::activation_gradient_(ActivationFunction activation_function, View A, Span G) {
+/*
+Turns G = dL/dA into dL/dZ in place. The derivatives are taken from the cached
+activations, so no exponential is recomputed.
+*/
+    switch (activation_function) {
+        case ActivationFunction::ReLU:
+            Activation::relu_backward<T>(G, A, G);
+            break;
+        case ActivationFunction::Tanh:
+            Activation::tanh_backward<T>(G, A, G);
+            break;
+        case ActivationFunction::Sigmoid:
+            Activation::sigmoid_backward<T>(G, A, G);
+            break;
+        case ActivationFunction::Softmax:
+            Activation::softmax_backward<T>(G, A, G);
+            break;
+        default:
+            throw std::logic_error("Unknown activation function!");
+    }
+}
+
+template <typename T>
+BasicNeuralNetwork<T>& BasicNeuralNetwork<T>::add_layer(size_t n_neurons, LayerType layer_type, ActivationFunction activation_function) {
     ++n_layers_;
     shape_.push_back(n_neurons);
     if (layer_type != LayerType::Output) {
@@ -137,23 +328,84 @@ NeuralNetwork& NeuralNetwork::add_layer(size_t n_neurons, LayerType layer_type,
     return *this;
 }
 
-NeuralNetwork& NeuralNetwork::add_layer(size_t n_neurons) {
+template <typename T>
+BasicNeuralNetwork<T>& BasicNeuralNetwork<T>::add_layer(size_t n_neurons) {
     return add_layer(n_neurons, LayerType::Hidden, ActivationFunction::ReLU);
 }
 
-NeuralNetwork& NeuralNetwork::add_layer(size_t n_neurons, LayerType layer_type) {
+template <typename T>
+BasicNeuralNetwork<T>& BasicNeuralNetwork<T>::add_layer(size_t n_neurons, LayerType layer_type) {
     return add_layer(n_neurons, layer_type, ActivationFunction::ReLU);
 }
 
-NeuralNetwork& NeuralNetwork::add_layer(size_t n_neurons, ActivationFunction activation_function) {
+template <typename T>
+BasicNeuralNetwork<T>& BasicNeuralNetwork<T>::add_layer(size_t n_neurons, ActivationFunction activation_function) {
     return add_layer(n_neurons, LayerType::Hidden, activation_function);
 }
 
-void NeuralNetwork::randomize_weights_() {
+template <typename T>
+void BasicNeuralNetwork<T>::randomize_weights_() {
     if (built_ == false) {
         throw std::logic_error("Cannot randomize weights of an unbuilt network!"); 
     }
-    for (Matrix& weights : weights_) {
+    for (Mat& weights : weights_) {
         weights.fill_random();
     }
-}
\ No newline at end of file
+    for (Mat& biases : biases_) {
+        biases.fill_random();
+    }
+}
+
+template <typename T>
+vector<typename BasicNeuralNetwork<T>::View> BasicNeuralNetwork<T>::get_activations() const {
+    vector<View> activations;
+    for (size_t layer = 0; learning_batch_size_ > 0 && layer < A_values_.size(); ++layer) {
+        activations.push_back(A_values_[layer].col_range(0, learning_batch_size_));
+    }
+    return activations;
+}
+
+template <typename T>
+vector<typename BasicNeuralNetwork<T>::View> BasicNeuralNetwork<T>::get_pre_activations() const {
+    vector<View> pre_activations;
+    for (size_t layer = 0; learning_batch_size_ > 0 && layer < Z_values_.size(); ++layer) {
+        pre_activations.push_back(Z_values_[layer].col_range(0, learning_batch_size_));
+    }
+    return pre_activations;
+}
+
+template <typename T>
+void BasicNeuralNetwork<T>::plan_workspace_(size_t max_batch_size) {
+    max_batch_size_ = std::max<size_t>(max_batch_size, 1);
+    learning_batch_size_ = 0;
+    Z_values_.clear();
+    A_values_.clear();
+    G_values_.clear();
+    weight_gradients_.clear();
+    bias_gradients_.clear();
+    for (size_t layer = 0; layer < weights_.size(); ++layer) {
+        Z_values_.emplace_back(shape_[layer + 1], max_batch_size_);
+        A_values_.emplace_back(shape_[layer + 1], max_batch_size_);
+        G_values_.emplace_back(shape_[layer + 1], max_batch_size_);
+        weight_gradients_.emplace_back(shape_[layer], shape_[layer + 1]);
+        bias_gradients_.emplace_back(shape_[layer + 1], 1);
+    }
+}
+
+template <typename T>
+typename Gemm::Epilogue<T>::Function BasicNeuralNetwork<T>::activation_kernel_(ActivationFunction activation_function) {
+    switch (activation_function) {
+        case ActivationFunction::ReLU:
+            return Activation::relu<T>;
+        case ActivationFunction::Tanh:
+            return Activation::tanh<T>;
+        case ActivationFunction::Sigmoid:
+            return Activation::sigmoid<T>;
+        default:
+            throw std::logic_error("Unknown activation function!");
+    }
+}
+
+template class BasicNeuralNetwork<float>;
+template class BasicNeuralNetwork<double>;
+template class BasicNeuralNetwork<bfloat16>;
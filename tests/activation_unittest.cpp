@@ -1,6 +1,9 @@
 #include "matrix.h"
 #include "activation.h"
+#include "simd_math.h"
 #include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
 
 using il = std::initializer_list<std::initializer_list<double>>;
 
@@ -9,6 +12,40 @@ public:
     ActivationTest() {}
 
 protected:
+    // Distance from reference in units of the last place of T at the reference
+    template <typename T>
+    double ulp_error_(T val, long double reference) {
+        const T rounded = static_cast<T>(reference);
+        const long double ulp = std::nextafter(std::fabs(rounded), std::numeric_limits<T>::infinity()) - std::fabs(rounded);
+        return static_cast<double>(std::fabs(val - reference) / ulp);
+    }
+
+    // Max ULP error of a kernel over [lo, hi] for every instruction set of this CPU. The odd length hits the tails.
+    template <typename T>
+    double max_ulp_error_(void (*kernel)(const T*, T*, size_t), long double (*reference)(long double), double lo, double hi) {
+        const size_t n = 100003;
+        std::vector<T> in(n);
+        std::vector<T> out(n);
+        for (size_t i = 0; i < n; ++i) {
+            in[i] = static_cast<T>(lo + (hi - lo) * i / (n - 1));
+        }
+        const SimdMath::Isa detected = SimdMath::active_isa();
+        double max_error = 0.0;
+        for (SimdMath::Isa isa : { SimdMath::Isa::Generic, SimdMath::Isa::Avx2, SimdMath::Isa::Avx512 }) {
+            SimdMath::set_isa(isa);
+            kernel(in.data(), out.data(), n);
+            for (size_t i = 0; i < n; ++i) {
+                max_error = std::max(max_error, ulp_error_<T>(out[i], reference(static_cast<long double>(in[i]))));
+            }
+        }
+        SimdMath::set_isa(detected);
+        return max_error;
+    }
+
+    static long double sigmoid_reference_(long double x) { return 1.0L / (1.0L + std::exp(-x)); }
+    static long double tanh_reference_(long double x) { return std::tanh(x); }
+    static long double sigmoid_derivative_reference_(long double x) { return sigmoid_reference_(x) * sigmoid_reference_(-x); }
+    static long double tanh_derivative_reference_(long double x) { return 1.0L / (std::cosh(x) * std::cosh(x)); }
 };
 
 TEST_F(ActivationTest, ReluTest) {
@@ -140,3 +177,162 @@ TEST_F(ActivationTest, SoftmaxTest) {
         EXPECT_NEAR(sum, 1.0, 1e-9);
     }
 }
+
+TEST_F(ActivationTest, VectorizedKernelAccuracyTest) {
+    // Bounds documented in simd_math.h
+    EXPECT_LE(max_ulp_error_<double>(Activation::sigmoid<double>, sigmoid_reference_, -700.0, 40.0), 2.5);
+    EXPECT_LE(max_ulp_error_<float>(Activation::sigmoid<float>, sigmoid_reference_, -85.0, 20.0), 2.5);
+    EXPECT_LE(max_ulp_error_<double>(Activation::tanh<double>, tanh_reference_, -25.0, 25.0), 2.5);
+    EXPECT_LE(max_ulp_error_<float>(Activation::tanh<float>, tanh_reference_, -10.0, 10.0), 2.5);
+    EXPECT_LE(max_ulp_error_<double>(Activation::sigmoid_derivative<double>, sigmoid_derivative_reference_, -700.0, 700.0), 4.0);
+    EXPECT_LE(max_ulp_error_<double>(Activation::tanh_derivative<double>, tanh_derivative_reference_, -300.0, 300.0), 4.0);
+}
+
+TEST_F(ActivationTest, VectorizedKernelSpecialValuesTest) {
+    const double inf = std::numeric_limits<double>::infinity();
+    const std::vector<double> in = { -inf, -1000.0, -0.0, 0.0, 1e-300, 1000.0, inf, std::nan("") };
+    std::vector<double> out(in.size());
+
+    Activation::sigmoid(in.data(), out.data(), in.size());
+    EXPECT_EQ(out[0], 0.0);
+    EXPECT_EQ(out[1], 0.0);
+    EXPECT_EQ(out[3], 0.5);
+    EXPECT_EQ(out[5], 1.0);
+    EXPECT_EQ(out[6], 1.0);
+    EXPECT_TRUE(std::isnan(out[7]));
+
+    Activation::tanh(in.data(), out.data(), in.size());
+    EXPECT_EQ(out[0], -1.0);
+    EXPECT_EQ(out[1], -1.0);
+    EXPECT_TRUE(out[2] == 0.0 && std::signbit(out[2]));
+    EXPECT_EQ(out[3], 0.0);
+    EXPECT_EQ(out[4], 1e-300);
+    EXPECT_EQ(out[5], 1.0);
+    EXPECT_EQ(out[6], 1.0);
+    EXPECT_TRUE(std::isnan(out[7]));
+}
+
+TEST_F(ActivationTest, VectorizedMatchesScalarTest) {
+    // The matrix versions run the kernels, the scalar functions stay the reference
+    Matrix mat(7, 13);
+    mat.fill_random(-8.0, 8.0);
+    const Matrix sigmoid = Activation::sigmoid(mat);
+    const Matrix sigmoid_derivative = Activation::sigmoid_derivative(mat);
+    const Matrix tanh = Activation::tanh(mat);
+    const Matrix tanh_derivative = Activation::tanh_derivative(mat);
+    const Matrix softmax = Activation::softmax(mat);
+    for (size_t row = 0; row < mat.get_rows(); ++row) {
+        for (size_t col = 0; col < mat.get_cols(); ++col) {
+            EXPECT_NEAR(sigmoid[row][col], Activation::sigmoid(mat[row][col]), 1e-15);
+            EXPECT_NEAR(sigmoid_derivative[row][col], Activation::sigmoid_derivative(mat[row][col]), 1e-15);
+            EXPECT_NEAR(tanh[row][col], Activation::tanh(mat[row][col]), 1e-15);
+            EXPECT_NEAR(tanh_derivative[row][col], Activation::tanh_derivative(mat[row][col]), 1e-14);
+        }
+    }
+    for (size_t col = 0; col < mat.get_cols(); ++col) {
+        double max = mat[0][col];
+        for (size_t row = 1; row < mat.get_rows(); ++row) {
+            max = std::max(max, mat[row][col]);
+        }
+        double sum = 0.0;
+        for (size_t row = 0; row < mat.get_rows(); ++row) {
+            sum += std::exp(mat[row][col] - max);
+        }
+        for (size_t row = 0; row < mat.get_rows(); ++row) {
+            EXPECT_NEAR(softmax[row][col], std::exp(mat[row][col] - max) / sum, 1e-15);
+        }
+    }
+}
+
+TEST_F(ActivationTest, InPlaceAndDestinationTest) {
+    Matrix mat = { {-1.0, -2.0, -3.0}, {0.0, 0.5, 0.0}, {1.0, 2.0, 3.0} };
+    Matrix out(3, 3);
+    const double* buffer = out.data();
+
+    Activation::tanh(mat, out);
+    EXPECT_TRUE(out == Activation::tanh(mat));
+    EXPECT_EQ(out.data(), buffer);
+    Activation::sigmoid_derivative(mat, out);
+    EXPECT_TRUE(out == Activation::sigmoid_derivative(mat));
+    Activation::softmax(mat, out);
+    EXPECT_TRUE(out == Activation::softmax(mat));
+    EXPECT_EQ(out.data(), buffer);
+
+    // A destination of another shape is resized
+    Matrix small;
+    Activation::relu(mat, small);
+    EXPECT_TRUE((small == il{ {0.0, 0.0, 0.0}, {0.0, 0.5, 0.0}, {1.0, 2.0, 3.0} }));
+
+    Matrix copy = mat;
+    Activation::sigmoid_(copy);
+    EXPECT_TRUE(copy == Activation::sigmoid(mat));
+    copy = mat;
+    Activation::relu_derivative_(copy);
+    EXPECT_TRUE(copy == Activation::relu_derivative(mat));
+    copy = mat;
+    Activation::softmax_(copy);
+    EXPECT_TRUE(copy == Activation::softmax(mat));
+}
+
+TEST_F(ActivationTest, StridedViewTest) {
+    Matrix mat(6, 9);
+    mat.fill_random(-4.0, 4.0);
+    const Matrix expected = Activation::tanh(mat);
+
+    // Sub-block with a row stride, and its transpose with a column stride
+    Matrix out(6, 9);
+    Activation::tanh<double>(mat.block(1, 2, 4, 5), out.block(1, 2, 4, 5));
+    Matrix transposed(5, 4);
+    Activation::tanh<double>(mat.block(1, 2, 4, 5).transpose(), transposed.view());
+    for (size_t row = 0; row < 4; ++row) {
+        for (size_t col = 0; col < 5; ++col) {
+            EXPECT_EQ(out[row + 1][col + 2], expected[row + 1][col + 2]);
+            EXPECT_EQ(transposed[col][row], expected[row + 1][col + 2]);
+        }
+    }
+    EXPECT_EQ(out[0][0], 0.0);
+    EXPECT_THROW(Activation::tanh<double>(mat.view(), transposed.view()), std::invalid_argument);
+}
+
+TEST_F(ActivationTest, BackwardFromOutputTest) {
+    Matrix Z(5, 7);
+    Matrix dA(5, 7);
+    Z.fill_random(-3.0, 3.0);
+    dA.fill_random();
+
+    // dZ = dA * f'(Z), computed from A = f(Z) only
+    const Matrix relu_dZ = Activation::relu_backward(dA, Activation::relu(Z));
+    const Matrix tanh_dZ = Activation::tanh_backward(dA, Activation::tanh(Z));
+    const Matrix sigmoid_dZ = Activation::sigmoid_backward(dA, Activation::sigmoid(Z));
+    for (size_t row = 0; row < Z.get_rows(); ++row) {
+        for (size_t col = 0; col < Z.get_cols(); ++col) {
+            EXPECT_NEAR(relu_dZ[row][col], dA[row][col] * Activation::relu_derivative(Z[row][col]), 1e-12);
+            EXPECT_NEAR(tanh_dZ[row][col], dA[row][col] * Activation::tanh_derivative(Z[row][col]), 1e-12);
+            EXPECT_NEAR(sigmoid_dZ[row][col], dA[row][col] * Activation::sigmoid_derivative(Z[row][col]), 1e-12);
+        }
+    }
+
+    // Softmax: dZ_i = sum_k dA_k * dA_k/dZ_i per column, against the full Jacobian
+    const Matrix A = Activation::softmax(Z);
+    const Matrix softmax_dZ = Activation::softmax_backward(dA, A);
+    for (size_t col = 0; col < Z.get_cols(); ++col) {
+        for (size_t i = 0; i < Z.get_rows(); ++i) {
+            double expected = 0.0;
+            for (size_t k = 0; k < Z.get_rows(); ++k) {
+                expected += dA[k][col] * A[k][col] * ((i == k ? 1.0 : 0.0) - A[i][col]);
+            }
+            EXPECT_NEAR(softmax_dZ[i][col], expected, 1e-12);
+        }
+    }
+
+    // In place on a transposed view gives the same result
+    Matrix dA_t = dA.transpose();
+    const Matrix A_t = A.transpose();
+    Activation::softmax_backward<double>(dA_t.view().transpose(), A_t.view().transpose(), dA_t.view().transpose());
+    for (size_t row = 0; row < Z.get_rows(); ++row) {
+        for (size_t col = 0; col < Z.get_cols(); ++col) {
+            EXPECT_NEAR(dA_t[col][row], softmax_dZ[row][col], 1e-15);
+        }
+    }
+    EXPECT_THROW(Activation::tanh_backward(dA, A_t), std::invalid_argument);
+}
@@ -0,0 +1,163 @@
+#include "batch_loader.h"
+#include <gtest/gtest.h>
+#include "matrix.h"
+#include "spdlog/spdlog.h"
+#include <stdexcept>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+using std::string;
+
+class BatchLoaderTest : public testing::Test {
+public:
+    BatchLoaderTest() {
+        spdlog::set_level(spdlog::level::off);
+    }
+
+    ~BatchLoaderTest() {
+        spdlog::set_level(spdlog::level::info);
+    }
+
+protected:
+    // Every sample's features and target encode its index, so batches can be checked for consistency
+    void make_samples_(size_t n_samples, Matrix& data, Matrix& targets) {
+        data = Matrix(n_samples, 3);
+        targets = Matrix(n_samples, 2);
+        for (size_t i = 0; i < n_samples; ++i) {
+            data(i, 0) = static_cast<double>(i);
+            data(i, 1) = -static_cast<double>(i);
+            data(i, 2) = i * 0.5;
+            targets(i, 0) = static_cast<double>(i % 2);
+            targets(i, 1) = static_cast<double>(i);
+        }
+    }
+
+    // Sample indices of one epoch, in the order they are handed out
+    vector<size_t> epoch_(BatchLoader& loader) {
+        vector<size_t> samples;
+        BatchLoader::Batch batch;
+        while (loader.next(batch)) {
+            EXPECT_LE(batch.data.get_rows(), loader.get_batch_size());
+            EXPECT_EQ(batch.data.get_rows(), batch.targets.get_rows());
+            for (size_t i = 0; i < batch.data.get_rows(); ++i) {
+                const size_t sample = static_cast<size_t>(batch.data(i, 0));
+                EXPECT_EQ(batch.data(i, 1), -static_cast<double>(sample));
+                EXPECT_EQ(batch.targets(i, batch.targets.get_cols() - 1), batch.data(i, batch.data.get_cols() - 1) * 2.0);
+                samples.push_back(sample);
+            }
+        }
+        return samples;
+    }
+
+    bool is_permutation_(vector<size_t> samples, size_t n_samples) {
+        std::sort(samples.begin(), samples.end());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (samples[i] != i) {
+                return false;
+            }
+        }
+        return samples.size() == n_samples;
+    }
+};
+
+TEST_F(BatchLoaderTest, SequentialTest) {
+    Matrix data, targets;
+    make_samples_(10, data, targets);
+    BatchLoader loader(data, targets, 4, false, 2);
+    EXPECT_EQ(loader.get_features_count(), 3u);
+    EXPECT_EQ(loader.get_targets_count(), 2u);
+
+    BatchLoader::Batch batch;
+    for (size_t expected : { 4u, 4u, 2u }) {
+        ASSERT_TRUE(loader.next(batch));
+        EXPECT_EQ(batch.data.get_rows(), expected);
+    }
+    EXPECT_FALSE(loader.next(batch));
+    EXPECT_FALSE(loader.next(batch));
+    EXPECT_EQ(loader.get_stats().batches, 3u);
+
+    loader.reset();
+    const vector<size_t> samples = epoch_(loader);
+    ASSERT_EQ(samples.size(), 10u);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_EQ(samples[i], i);
+    }
+    EXPECT_EQ(loader.get_stats().batches, 6u);
+    EXPECT_LE(loader.get_stats().stalls, 6u);
+    loader.reset_stats();
+    EXPECT_EQ(loader.get_stats().batches, 0u);
+}
+
+TEST_F(BatchLoaderTest, ShuffleTest) {
+    const size_t n_samples = 1000;
+    Matrix data, targets;
+    make_samples_(n_samples, data, targets);
+
+    BatchLoader loader(data, targets, 32, true, 3, 4, 7);
+    const vector<size_t> first = epoch_(loader);
+    loader.reset();
+    const vector<size_t> second = epoch_(loader);
+    EXPECT_TRUE(is_permutation_(first, n_samples));
+    EXPECT_TRUE(is_permutation_(second, n_samples));
+    EXPECT_NE(first, second);
+
+    // Same seed, same order, whatever the number of workers
+    BatchLoader single(data, targets, 32, true, 2, 1, 7);
+    EXPECT_EQ(epoch_(single), first);
+
+    // Interrupted epochs
+    BatchLoader::Batch batch;
+    loader.reset();
+    ASSERT_TRUE(loader.next(batch));
+    loader.reset();
+    EXPECT_TRUE(is_permutation_(epoch_(loader), n_samples));
+}
+
+TEST_F(BatchLoaderTest, StreamReservoirTest) {
+    const string temp_path = "./tests/data/batch_loader_test_temp.csv";
+    const size_t n_samples = 5000;
+    {
+        std::ofstream file(temp_path);
+        for (size_t i = 0; i < n_samples; ++i) {
+            file << i << ',' << -static_cast<double>(i) << ',' << i * 0.5 << ',' << i << '\n';
+        }
+    }
+
+    DatasetStream stream(temp_path, 50);
+    BatchLoader sequential(stream, 0, false);
+    const vector<size_t> in_order = epoch_(sequential);
+    ASSERT_EQ(in_order.size(), n_samples);
+    for (size_t i = 0; i < n_samples; ++i) {
+        ASSERT_EQ(in_order[i], i);
+    }
+
+    BatchLoader loader(stream, 256, true, 3, 3);
+    const vector<size_t> first = epoch_(loader);
+    loader.reset();
+    const vector<size_t> second = epoch_(loader);
+    std::remove(temp_path.c_str());
+
+    EXPECT_TRUE(is_permutation_(first, n_samples));
+    EXPECT_TRUE(is_permutation_(second, n_samples));
+    EXPECT_NE(first, in_order);
+    EXPECT_NE(first, second);
+    // A reservoir only delays samples: none comes out before the samples read with it
+    for (size_t i = 0; i < n_samples; ++i) {
+        EXPECT_LE(first[i], i + 256);
+    }
+}
+
+TEST_F(BatchLoaderTest, InvalidArgumentsTest) {
+    Matrix data, targets;
+    make_samples_(10, data, targets);
+    EXPECT_THROW(BatchLoader(data, targets, 0), std::invalid_argument);
+    EXPECT_THROW(BatchLoader(data, targets, 4, true, 1), std::invalid_argument);
+    EXPECT_THROW(BatchLoader(data, targets, 4, true, 3, 0), std::invalid_argument);
+    EXPECT_THROW(BatchLoader(data, Matrix(9, 2), 4), std::invalid_argument);
+
+    Matrix empty;
+    BatchLoader loader(empty, empty, 4);
+    BatchLoader::Batch batch;
+    EXPECT_FALSE(loader.next(batch));
+}
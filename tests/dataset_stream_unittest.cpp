@@ -0,0 +1,126 @@
+#include "dataset_stream.h"
+#include <gtest/gtest.h>
+#include "matrix.h"
+#include "spdlog/spdlog.h"
+#include <stdexcept>
+#include <cstdio>
+#include <fstream>
+
+using std::string;
+
+class DatasetStreamTest : public testing::Test {
+public:
+    DatasetStreamTest() {
+        spdlog::set_level(spdlog::level::off);
+    }
+
+    ~DatasetStreamTest() {
+        spdlog::set_level(spdlog::level::info);
+    }
+
+protected:
+    // id, two features and a numeric target, rows spanning several read blocks when n_rows is large
+    void write_csv_(const string& path, size_t n_rows, bool trailing_newline = true) {
+        std::ofstream file(path);
+        file.precision(17);
+        file << "id,a,b,target\r\n";
+        for (size_t row = 0; row < n_rows; ++row) {
+            file << "row" << row << ',' << row * 0.5 << ", \"" << -static_cast<double>(row) << "\" ," << row % 2;
+            if (row + 1 < n_rows || trailing_newline) {
+                file << "\r\n";
+            }
+        }
+    }
+};
+
+TEST_F(DatasetStreamTest, BatchesTest) {
+    const string temp_path = "./tests/data/dataset_stream_test_temp.csv";
+    const size_t n_rows = 100000;
+    write_csv_(temp_path, n_rows);
+
+    DatasetStream stream(temp_path, 64, true, true);
+    EXPECT_EQ(stream.get_batch_size(), 64u);
+    EXPECT_EQ(stream.get_features_count(), 2u);
+    EXPECT_EQ(stream.get_columns_count(), 4u);
+    ASSERT_EQ(stream.get_headers().size(), 4u);
+    EXPECT_EQ(stream.get_headers()[3], "target");
+
+    // Twice, the second time after a rewind in the middle of the file
+    for (size_t pass = 0; pass < 2; ++pass) {
+        DatasetStream::Batch batch;
+        size_t row = 0;
+        size_t n_batches = 0;
+        while (stream.next(batch)) {
+            ASSERT_EQ(batch.data.get_cols(), 2u);
+            ASSERT_EQ(batch.targets.get_cols(), 1u);
+            ASSERT_EQ(batch.data.get_rows(), batch.targets.get_rows());
+            ASSERT_EQ(batch.data.get_rows(), std::min<size_t>(64, n_rows - row));
+            for (size_t i = 0; i < batch.data.get_rows(); ++i, ++row) {
+                ASSERT_EQ(batch.data(i, 0), row * 0.5);
+                ASSERT_EQ(batch.data(i, 1), -static_cast<double>(row));
+                ASSERT_EQ(batch.targets(i, 0), static_cast<double>(row % 2));
+            }
+            ++n_batches;
+        }
+        EXPECT_EQ(row, n_rows);
+        EXPECT_EQ(n_batches, (n_rows + 63) / 64);
+        EXPECT_FALSE(stream.next(batch));
+
+        stream.reset();
+        ASSERT_TRUE(stream.next(batch));
+        ASSERT_TRUE(stream.next(batch));
+        EXPECT_EQ(batch.data(0, 0), 32.0);
+        stream.reset();
+    }
+    std::remove(temp_path.c_str());
+}
+
+TEST_F(DatasetStreamTest, TargetColumnWithoutTrailingNewlineTest) {
+    const string temp_path = "./tests/data/dataset_stream_test_temp.csv";
+    write_csv_(temp_path, 10, false);
+
+    DatasetStream stream(temp_path, 4, true, true, 1, 2);
+    EXPECT_EQ(stream.get_features_count(), 2u);
+    DatasetStream::Batch batch;
+    size_t n_rows = 0;
+    while (stream.next(batch)) {
+        for (size_t i = 0; i < batch.data.get_rows(); ++i, ++n_rows) {
+            EXPECT_EQ(batch.targets(i, 0), n_rows * 0.5);
+            EXPECT_EQ(batch.data(i, 0), -static_cast<double>(n_rows));
+            EXPECT_EQ(batch.data(i, 1), static_cast<double>(n_rows % 2));
+        }
+    }
+    EXPECT_EQ(n_rows, 10u);
+    std::remove(temp_path.c_str());
+}
+
+TEST_F(DatasetStreamTest, InvalidFileTest) {
+    EXPECT_THROW(DatasetStream("./tests/data/nonexistent.csv", 8), std::runtime_error);
+    EXPECT_THROW(DatasetStream("./tests/data/dataset_test_corrupted.csv", 0), std::invalid_argument);
+
+    // The batches before a broken line are still delivered
+    const string temp_path = "./tests/data/dataset_stream_test_temp.csv";
+    {
+        std::ofstream file(temp_path);
+        file << "1,2,0\n3,4,1\n5,6,0\n7,8\n9,10,1\n";
+    }
+    DatasetStream stream(temp_path, 2);
+    DatasetStream::Batch batch;
+    ASSERT_TRUE(stream.next(batch));
+    EXPECT_EQ(batch.data.get_rows(), 2u);
+    ASSERT_TRUE(stream.next(batch));
+    EXPECT_EQ(batch.data.get_rows(), 1u);
+    EXPECT_EQ(batch.data(0, 0), 5.0);
+    EXPECT_THROW(stream.next(batch), std::invalid_argument);
+    EXPECT_FALSE(stream.next(batch));
+
+    {
+        std::ofstream file(temp_path);
+        file << "1,2,0\n3,cat,1\n";
+    }
+    DatasetStream categorical(temp_path, 2);
+    ASSERT_TRUE(categorical.next(batch));
+    EXPECT_EQ(batch.data.get_rows(), 1u);
+    EXPECT_THROW(categorical.next(batch), std::invalid_argument);
+    std::remove(temp_path.c_str());
+}
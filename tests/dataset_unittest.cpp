@@ -3,7 +3,11 @@
 #include "matrix.h"
 #include "spdlog/spdlog.h"
 #include <stdexcept>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
 #include <iostream>
 
 using std::string;
@@ -88,6 +92,29 @@ TEST_F(DatasetTest, LoadCSVCorruptedFileTest) {
     EXPECT_THROW(ds.load_csv("./tests/data/dataset_test_corrupted.csv", true), std::invalid_argument);
 }
 
+TEST_F(DatasetTest, LoadCSVFailureKeepsDataTest) {
+    // A file that fails to parse leaves the previous data, views and raw cells in place
+    Dataset ds;
+    ds.load_csv("./tests/data/dataset_test.csv", true);
+    const size_t size = ds.size();
+    const vector<string> headers = ds.get_headers();
+    const vector<string> first_row = ds.get_row(0);
+    const Matrix data = ds.get_data();
+
+    EXPECT_THROW(ds.load_csv("./tests/data/dataset_test_corrupted.csv", true), std::invalid_argument);
+    EXPECT_THROW(ds.load_csv("./tests/data/no_such_file.csv", true), std::runtime_error);
+    EXPECT_EQ(ds.size(), size);
+    EXPECT_TRUE(string_row_equal_(ds.get_headers(), headers));
+    EXPECT_TRUE(string_row_equal_(ds.get_row(0), first_row));
+    EXPECT_TRUE(ds.get_data() == data);
+    EXPECT_EQ(ds.get_targets()[149][0], 2.0);
+
+    // The raw cells are split again from the file that is still loaded
+    ds.set_index_column(true);
+    ds.set_index_column(false);
+    EXPECT_TRUE(string_row_equal_(ds.get_row(0), first_row));
+}
+
 TEST_F(DatasetTest, LoadCSVNumericalTargetsTest) {
     Dataset ds;
     ds.load_csv("./tests/data/dataset_test_numerical_targets.csv", true);
@@ -193,6 +220,10 @@ TEST_F(DatasetTest, GetRangeMethodTest) {
     EXPECT_TRUE(double_row_equal_(range[2], data[5]));
 
     EXPECT_THROW(ds.get_range(3, 2), std::invalid_argument);
+
+    // Ranges and rows are views into the same storage
+    EXPECT_TRUE(ds.get_range(3, 6).data() == ds[3].data());
+    EXPECT_TRUE(ds.get_range(3, 6).row_range(2, 3).data() == ds[5].data());
 }
 
 TEST_F(DatasetTest, AccessOperatorTest) {
@@ -212,3 +243,260 @@ TEST_F(DatasetTest, SizeTest) {
     ds.load_csv("./tests/data/dataset_test_index_column.csv", true, true);
     EXPECT_TRUE(ds.size() == 12);
 }
+
+TEST_F(DatasetTest, LoadLargeCSVTest) {
+    // More than one parse chunk, with CRLF line ends, quoted cells and spaces around them
+    const string temp_path = "./tests/data/dataset_test_large_temp.csv";
+    const size_t n_rows = 150000;
+    {
+        std::ofstream file(temp_path);
+        file.precision(17);
+        file << "id,a,b,c,label\r\n";
+        for (size_t row = 0; row < n_rows; ++row) {
+            file << row << ',' << row * 0.25 << ", \"" << -static_cast<double>(row) << "\" ," << (row % 7) / 4.0
+                 << ',' << (row % 3 == 0 ? "\"cat\"" : row % 3 == 1 ? "dog" : "bird") << "\r\n";
+        }
+    }
+
+    Dataset ds;
+    ds.load_csv(temp_path, true, true);
+    std::remove(temp_path.c_str());
+
+    ASSERT_EQ(ds.size(), n_rows);
+    ASSERT_EQ(ds.get_features_count(), 3u);
+    EXPECT_TRUE(string_row_equal_(ds.get_headers(), { "id", "a", "b", "c", "label" }));
+    const Matrix& data = ds.get_data();
+    const Matrix& targets = ds.get_targets();
+    for (size_t row = 0; row < n_rows; row += 997) {
+        EXPECT_EQ(data[row][0], row * 0.25);
+        EXPECT_EQ(data[row][1], -static_cast<double>(row));
+        EXPECT_EQ(data[row][2], (row % 7) / 4.0);
+        EXPECT_EQ(targets[row][0], row % 3 == 0 ? 1.0 : row % 3 == 1 ? 2.0 : 0.0);   // bird, cat, dog
+    }
+    EXPECT_EQ(data[n_rows - 1][0], (n_rows - 1) * 0.25);
+
+    // String cells come from the mapping, which outlives the removed file
+    EXPECT_TRUE(string_row_equal_(ds.get_row(n_rows - 1), { "149999", "37499.75", "-149999", "0.75", "bird" }));
+}
+
+TEST_F(DatasetTest, LoadCSVCategoricalFeaturesTest) {
+    const string temp_path = "./tests/data/dataset_test_categorical_temp.csv";
+    {
+        std::ofstream file(temp_path);
+        file << "1.5,2,yes\n" << "0.5,x,no\n";
+    }
+    Dataset ds;
+    EXPECT_THROW(ds.load_csv(temp_path), std::invalid_argument);
+    std::remove(temp_path.c_str());
+}
+
+TEST_F(DatasetTest, BinaryRoundTripTest) {
+    Dataset csv;
+    csv.load_csv("./tests/data/dataset_test_index_column.csv", true, true);
+
+    const string cache_path = "./tests/data/dataset_test_cache_temp.bin";
+    csv.save_binary(cache_path);
+    Dataset cached;
+    cached.load_binary(cache_path);
+    std::remove(cache_path.c_str());
+
+    ASSERT_EQ(cached.size(), csv.size());
+    ASSERT_EQ(cached.get_features_count(), csv.get_features_count());
+    EXPECT_TRUE(string_row_equal_(cached.get_headers(), csv.get_headers()));
+    const Matrix data = cached.get_data();
+    const Matrix expected = csv.get_data();
+    for (size_t row = 0; row < data.get_rows(); ++row) {
+        for (size_t col = 0; col < data.get_cols(); ++col) {
+            EXPECT_EQ(data[row][col], expected[row][col]);
+        }
+        EXPECT_EQ(cached.get_targets()[row][0], csv.get_targets()[row][0]);
+    }
+
+    // Numbers are written back in their shortest form, labels as they were
+    EXPECT_TRUE(string_row_equal_(cached.get_row(4), { "5", "7", "3.2", "4.7", "1.4", "Versicolor" }));
+    EXPECT_TRUE(string_row_equal_(cached.get_row(0), { "1", "5.1", "3.5", "1.4", "0.2", "Setosa" }));
+}
+
+TEST_F(DatasetTest, BinaryNonAdjacentFeaturesTest) {
+    // A target in the middle splits the features, which are then gathered
+    Dataset csv;
+    csv.load_csv("./tests/data/dataset_test_numerical_targets.csv", true, false, 1);
+    const string cache_path = "./tests/data/dataset_test_cache_temp.bin";
+    csv.save_binary(cache_path);
+    Dataset cached;
+    cached.load_binary(cache_path);
+    std::remove(cache_path.c_str());
+
+    EXPECT_EQ(cached.get_features_count(), 4u);
+    EXPECT_TRUE(double_row_equal_(cached.get_data()[0], { 5.1, 1.4, 0.2, 444 }));
+    EXPECT_TRUE(double_row_equal_(cached.get_data()[149], { 5.9, 5.1, 1.8, 666 }));
+    EXPECT_NEAR(cached.get_targets()[0][0], 3.5, 1e-12);
+}
+
+TEST_F(DatasetTest, BinaryInvalidFileTest) {
+    Dataset ds;
+    EXPECT_THROW(ds.load_binary("./tests/data/dataset_test.csv"), std::runtime_error);
+    EXPECT_THROW(ds.load_binary("./tests/data/does_not_exist.bin"), std::runtime_error);
+
+    Dataset csv;
+    csv.load_csv("./tests/data/dataset_test.csv", true);
+    const string cache_path = "./tests/data/dataset_test_cache_temp.bin";
+    csv.save_binary(cache_path);
+    {
+        // Cut the file in the middle of the column blocks
+        std::ifstream in(cache_path, std::ios::binary);
+        const string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() / 2);
+    }
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    std::remove(cache_path.c_str());
+}
+
+TEST_F(DatasetTest, BinaryCorruptHeaderTest) {
+    Dataset csv;
+    csv.load_csv("./tests/data/dataset_test.csv", true);
+    const string cache_path = "./tests/data/dataset_test_cache_temp.bin";
+    csv.save_binary(cache_path);
+    std::ifstream in(cache_path, std::ios::binary);
+    const string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    // Overwrites u64 fields of a copy of the cache, offsets as in BinaryHeader and the first column block
+    auto write_corrupt = [&](std::initializer_list<std::pair<size_t, uint64_t>> fields) {
+        string corrupt = bytes;
+        for (const auto& [offset, value] : fields) {
+            std::memcpy(&corrupt[offset], &value, sizeof(value));
+        }
+        std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+        out.write(corrupt.data(), corrupt.size());
+    };
+    constexpr size_t N_COLS = 16, N_LINES = 24, STRIDE = 32, FIRST_LABEL_COUNT = 65;
+
+    Dataset ds;
+    // n_cols * stride * sizeof(double) wraps around to 0
+    write_corrupt({ { N_COLS, 2 }, { N_LINES, uint64_t(1) << 62 }, { STRIDE, uint64_t(1) << 62 } });
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    // An empty table with more columns than the file could describe
+    write_corrupt({ { N_COLS, uint64_t(1) << 60 }, { N_LINES, 0 }, { STRIDE, 0 } });
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    write_corrupt({ { FIRST_LABEL_COUNT, uint64_t(1) << 60 } });
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    std::remove(cache_path.c_str());
+}
+
+TEST_F(DatasetTest, BinaryCorruptLabelTest) {
+    Dataset csv;
+    csv.load_csv("./tests/data/dataset_test.csv", true);
+    const string cache_path = "./tests/data/dataset_test_cache_temp.bin";
+    csv.save_binary(cache_path);
+    std::ifstream in(cache_path, std::ios::binary);
+    const string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    uint64_t stride = 0;
+    uint64_t table_offset = 0;
+    std::memcpy(&stride, &bytes[32], sizeof(stride));
+    std::memcpy(&table_offset, &bytes[40], sizeof(table_offset));
+
+    // Overwrites one cell of the categorical "variety" column (the last of five)
+    auto write_variety = [&](size_t line, double value) {
+        string corrupt = bytes;
+        std::memcpy(&corrupt[table_offset + (4 * stride + line) * sizeof(double)], &value, sizeof(value));
+        std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+        out.write(corrupt.data(), corrupt.size());
+    };
+
+    Dataset ds;
+    write_variety(1, std::numeric_limits<double>::quiet_NaN());
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    write_variety(150, 3.0);
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    write_variety(2, -1.0);
+    EXPECT_THROW(ds.load_binary(cache_path), std::runtime_error);
+    write_variety(150, 2.0);
+    EXPECT_NO_THROW(ds.load_binary(cache_path));
+    EXPECT_TRUE(ds.get_raw_data()[149][4] == "Virginica");
+    std::remove(cache_path.c_str());
+}
+
+TEST_F(DatasetTest, BinaryRejectedKeepsDataTest) {
+    Dataset csv;
+    csv.load_csv("./tests/data/dataset_test.csv", true);
+    const string cache_path = "./tests/data/dataset_test_cache_temp.bin";
+    csv.save_binary(cache_path);
+
+    // A well-formed cache whose target is the first column leaves the categorical "variety" among the features
+    {
+        std::ifstream in(cache_path, std::ios::binary);
+        string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        const int64_t target_column = 0;
+        std::memcpy(&bytes[48], &target_column, sizeof(target_column));
+        std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    Dataset ds;
+    ds.load_csv("./tests/data/dataset_test_numerical_targets.csv", true);
+    const size_t size = ds.size();
+    const vector<string> headers = ds.get_headers();
+    const vector<string> first_row = ds.get_row(0);
+    const Matrix data = ds.get_data();
+
+    EXPECT_THROW(ds.load_binary(cache_path), std::invalid_argument);
+    std::remove(cache_path.c_str());
+    EXPECT_EQ(ds.size(), size);
+    EXPECT_TRUE(string_row_equal_(ds.get_headers(), headers));
+    EXPECT_TRUE(ds.get_data() == data);
+    ds.set_index_column(true);
+    ds.set_index_column(false);
+    EXPECT_TRUE(string_row_equal_(ds.get_row(0), first_row));
+    EXPECT_TRUE(ds.get_data() == data);
+}
+
+TEST_F(DatasetTest, ReconfigureWithoutFileTest) {
+    // The setters only re-slice the loaded table, so the file may be gone
+    const string temp_path = "./tests/data/dataset_test_reconfigure_temp.csv";
+    {
+        std::ofstream file(temp_path);
+        file << "1,2,zebra\n" << "3,4,ant\n" << "5,6,cat\n" << "7,8,ant\n";
+    }
+    Dataset ds;
+    ds.load_csv(temp_path, true);
+    std::remove(temp_path.c_str());
+
+    auto targets = [&]() {
+        vector<double> result;
+        for (size_t row = 0; row < ds.size(); ++row) {
+            result.push_back(ds.get_targets()[row][0]);
+        }
+        return result;
+    };
+    EXPECT_EQ(ds.size(), 3u);
+    EXPECT_TRUE(string_row_equal_(ds.get_headers(), { "1", "2", "zebra" }));
+    EXPECT_EQ(targets(), vector<double>({ 0, 1, 0 }));
+
+    // The first line joins the data with a label of its own, the others move up
+    ds.set_headers(false);
+    EXPECT_EQ(ds.size(), 4u);
+    EXPECT_TRUE(ds.get_headers().empty());
+    EXPECT_TRUE(double_row_equal_(ds[0].to_matrix()[0], { 1, 2 }));
+    EXPECT_TRUE(double_row_equal_(ds[3].to_matrix()[0], { 7, 8 }));
+    EXPECT_EQ(targets(), vector<double>({ 2, 0, 1, 0 }));
+    EXPECT_TRUE(string_row_equal_(ds.get_row(0), { "1", "2", "zebra" }));
+
+    // A failing change keeps the previous configuration
+    EXPECT_THROW(ds.set_target_column(1), std::invalid_argument);
+    EXPECT_EQ(ds.size(), 4u);
+    EXPECT_EQ(targets(), vector<double>({ 2, 0, 1, 0 }));
+
+    ds.set_index_column(true);
+    EXPECT_EQ(ds.get_features_count(), 1u);
+    EXPECT_TRUE(double_row_equal_(ds[2].to_matrix()[0], { 6 }));
+
+    ds.set_headers(true);
+    EXPECT_EQ(ds.size(), 3u);
+    EXPECT_EQ(targets(), vector<double>({ 0, 1, 0 }));
+    EXPECT_TRUE(double_row_equal_(ds[0].to_matrix()[0], { 4 }));
+}
@@ -0,0 +1,142 @@
+#include "gemm.h"
+#include "matrix.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+class GemmTest : public testing::Test {
+public:
+    GemmTest() {}
+
+protected:
+    bool all_near_(const Matrix& lhs, const Matrix& rhs, double tolerance = 1e-9) {
+        if (lhs.get_rows() != rhs.get_rows() || lhs.get_cols() != rhs.get_cols()) {
+            return false;
+        }
+        for (size_t row = 0; row < lhs.get_rows(); ++row) {
+            for (size_t col = 0; col < lhs.get_cols(); ++col) {
+                if (std::abs(lhs[row][col] - rhs[row][col]) > tolerance) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    Matrix reference_(const Matrix& a, const Matrix& b) {
+        Matrix c(a.get_rows(), b.get_cols());
+        Gemm::multiply_reference(a.get_rows(), b.get_cols(), a.get_cols(),
+                                 a.data(), a.get_stride(), 1,
+                                 b.data(), b.get_stride(), 1,
+                                 c.data(), c.get_stride());
+        return c;
+    }
+};
+
+TEST_F(GemmTest, MatchesReferenceOnEdgeShapesTest) {
+    // Shapes chosen to hit partial MR/NR tiles and more than one KC/MC block
+    const size_t shapes[][3] = { {1, 1, 1}, {5, 7, 3}, {6, 8, 1}, {13, 17, 300}, {97, 9, 257}, {1, 300, 64}, {200, 1, 50} };
+    for (const auto& shape : shapes) {
+        Matrix a(shape[0], shape[2]);
+        Matrix b(shape[2], shape[1]);
+        a.fill_random();
+        b.fill_random();
+
+        Matrix c(shape[0], shape[1]);
+        Gemm::multiply(shape[0], shape[1], shape[2],
+                       a.data(), a.get_stride(), 1,
+                       b.data(), b.get_stride(), 1,
+                       c.data(), c.get_stride());
+        EXPECT_TRUE(all_near_(c, reference_(a, b)));
+    }
+}
+
+TEST_F(GemmTest, TransposedOperandTest) {
+    Matrix a(37, 19);
+    Matrix b(37, 23);
+    a.fill_random();
+    b.fill_random();
+
+    // A^T * B by swapping the strides of A
+    Matrix c(19, 23);
+    Gemm::multiply(19, 23, 37,
+                   a.data(), 1, a.get_stride(),
+                   b.data(), b.get_stride(), 1,
+                   c.data(), c.get_stride());
+    EXPECT_TRUE(all_near_(c, reference_(a.transpose(), b)));
+}
+
+TEST_F(GemmTest, AccumulateTest) {
+    Matrix a(10, 12);
+    Matrix b(12, 9);
+    a.fill_random();
+    b.fill_random();
+
+    Matrix c(10, 9, 1.0);
+    Gemm::multiply(10, 9, 12,
+                   a.data(), a.get_stride(), 1,
+                   b.data(), b.get_stride(), 1,
+                   c.data(), c.get_stride(), true);
+    EXPECT_TRUE(all_near_(c, reference_(a, b) + 1.0));
+}
+
+TEST_F(GemmTest, SinglePrecisionTest) {
+    // Odd shapes exercise the 6 x 16 float tiles and their edges
+    const size_t m = 29, n = 35, k = 270;
+    MatrixF a(m, k);
+    MatrixF b(k, n);
+    a.fill_random();
+    b.fill_random();
+
+    MatrixF c(m, n);
+    MatrixF expected(m, n);
+    Gemm::multiply(m, n, k, a.data(), a.get_stride(), 1, b.data(), b.get_stride(), 1, c.data(), c.get_stride());
+    Gemm::multiply_reference(m, n, k, a.data(), a.get_stride(), 1, b.data(), b.get_stride(), 1, expected.data(), expected.get_stride());
+    for (size_t row = 0; row < m; ++row) {
+        for (size_t col = 0; col < n; ++col) {
+            EXPECT_NEAR(c[row][col], expected[row][col], 1e-3);
+        }
+    }
+}
+
+TEST_F(GemmTest, BFloat16Test) {
+    MatrixBF16 a = { {1.0, 2.0}, {3.0, 4.0} };
+    MatrixBF16 b = { {0.5, -1.0}, {2.0, 0.25} };
+
+    MatrixBF16 c = a * b;
+    EXPECT_TRUE((c == std::initializer_list<std::initializer_list<bfloat16>>{ {4.5, -0.5}, {9.5, -2.0} }));
+    EXPECT_FLOAT_EQ(static_cast<float>(c[0][0]), 4.5f);
+    EXPECT_FLOAT_EQ(static_cast<float>(c[1][1]), -2.0f);
+}
+
+TEST_F(GemmTest, EpilogueTest) {
+    // Bias and activation must be applied exactly once, also across several depth blocks and edge tiles
+    const size_t m = 13, n = 11, k = 300;
+    Matrix a(m, k);
+    Matrix b(k, n);
+    Matrix bias(m, 1);
+    a.fill_random();
+    b.fill_random();
+    bias.fill_random();
+
+    Gemm::Epilogue<double> epilogue;
+    epilogue.bias = bias.data();
+    epilogue.activation = [](const double* in, double* out, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = 2.0 * in[i];
+        }
+    };
+    Matrix c(m, n);
+    Matrix activated(m, n);
+    epilogue.out = activated.data();
+    epilogue.out_rs = activated.get_stride();
+    Gemm::multiply(m, n, k, a.data(), a.get_stride(), 1, b.data(), b.get_stride(), 1, c.data(), c.get_stride(), false, epilogue);
+
+    Matrix expected = reference_(a, b);
+    for (size_t row = 0; row < m; ++row) {
+        for (size_t col = 0; col < n; ++col) {
+            expected[row][col] += bias[row][0];
+        }
+    }
+    EXPECT_TRUE(all_near_(c, expected));
+    EXPECT_TRUE(all_near_(activated, expected * 2.0));
+}
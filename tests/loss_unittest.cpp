@@ -1,6 +1,9 @@
 #include "matrix.h"
 #include "loss.h"
+#include "activation.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
 
 using il = std::initializer_list<std::initializer_list<double>>;
 
@@ -174,3 +177,141 @@ TEST_F(LossTest, BinaryCrossEntropyDerivativeTest) {
     EXPECT_TRUE((Loss::binary_cross_entropy_derivative(y_true, y_pred) == il{ {-0.5555}, {0.625} }));
 }
 
+
+TEST_F(LossTest, LargeBatchLossTest) {
+    // Sizes that span several reduction chunks and leave vector tails, against long double loops
+    Matrix y_true(7, 20011);
+    Matrix y_pred(7, 20011);
+    y_true.fill_random(0.0, 1.0);
+    y_pred.fill_random(0.0, 1.0);
+    y_pred[3][5] = 0.0;
+    y_pred[4][6] = 1.0;
+
+    long double squared = 0.0L, absolute = 0.0L, categorical = 0.0L, binary = 0.0L;
+    for (size_t row = 0; row < 7; ++row) {
+        for (size_t col = 0; col < 20011; ++col) {
+            const long double y = y_true[row][col];
+            const long double p = std::clamp<long double>(y_pred[row][col], 1e-15L, 1.0L - 1e-15L);
+            squared += (y - y_pred[row][col]) * (y - y_pred[row][col]);
+            absolute += std::fabs(y - y_pred[row][col]);
+            categorical += -y * std::log(p);
+            binary += -(y * std::log(p) + (1.0L - y) * std::log(1.0L - p));
+        }
+    }
+    const double n = 7.0 * 20011.0;
+    EXPECT_NEAR(Loss::mse(y_true, y_pred), static_cast<double>(squared / n), 1e-12);
+    EXPECT_NEAR(Loss::mae(y_true, y_pred), static_cast<double>(absolute / n), 1e-12);
+    EXPECT_NEAR(Loss::categorical_cross_entropy(y_true, y_pred), static_cast<double>(categorical / 20011), 1e-9);
+    EXPECT_NEAR(Loss::binary_cross_entropy(y_true, y_pred), static_cast<double>(binary / n), 1e-9);
+
+    MatrixF y_true_f = y_true.cast<float>();
+    MatrixF y_pred_f = y_pred.cast<float>();
+    EXPECT_NEAR(Loss::binary_cross_entropy(y_true_f, y_pred_f), static_cast<double>(binary / n), 1e-4);
+}
+
+TEST_F(LossTest, SoftmaxCrossEntropyWithLogitsTest) {
+    // Enough columns for several parallel blocks
+    Matrix logits(7, 600);
+    Matrix y_true(7, 600);
+    logits.fill_random(-6.0, 6.0);
+    for (size_t col = 0; col < y_true.get_cols(); ++col) {
+        y_true[col % 7][col] = 1.0;
+    }
+
+    Matrix grad;
+    const double loss = Loss::softmax_cross_entropy_with_logits(y_true, logits, grad);
+    const Matrix y_pred = Activation::softmax(logits);
+    EXPECT_NEAR(loss, Loss::categorical_cross_entropy(y_true, y_pred), 1e-12);
+    const Matrix expected = Loss::categorical_cross_entropy_derivative(y_true, y_pred);
+    for (size_t row = 0; row < grad.get_rows(); ++row) {
+        for (size_t col = 0; col < grad.get_cols(); ++col) {
+            EXPECT_NEAR(grad[row][col], expected[row][col], 1e-15);
+        }
+    }
+
+    // Transposed views and grad written over the logits give the same result
+    Matrix logits_t = logits.transpose();
+    const Matrix y_true_t = y_true.transpose();
+    EXPECT_NEAR(Loss::softmax_cross_entropy_with_logits<double>(y_true_t.view().transpose(), logits_t.view().transpose(),
+                                                                 logits_t.view().transpose()), loss, 1e-12);
+    for (size_t row = 0; row < grad.get_rows(); ++row) {
+        for (size_t col = 0; col < grad.get_cols(); ++col) {
+            EXPECT_NEAR(logits_t[col][row], grad[row][col], 1e-15);
+        }
+    }
+
+    // Targets given as transposed sample rows, as Model::fit passes them, with contiguous logits and grad
+    Matrix grad_2(7, 600);
+    EXPECT_NEAR(Loss::softmax_cross_entropy_with_logits<double>(y_true_t.view().transpose(), logits.view(), grad_2.view()), loss, 1e-12);
+    for (size_t row = 0; row < grad.get_rows(); ++row) {
+        for (size_t col = 0; col < grad.get_cols(); ++col) {
+            EXPECT_NEAR(grad_2[row][col], grad[row][col], 1e-15);
+        }
+    }
+    MatrixF logits_f = logits.cast<float>();
+    MatrixF y_true_f = y_true.cast<float>();
+    const MatrixF y_true_f_t = y_true_f.transpose();
+    MatrixF grad_f, grad_f_2(7, 600);
+    const double loss_f = Loss::softmax_cross_entropy_with_logits(y_true_f, logits_f, grad_f);
+    EXPECT_NEAR(Loss::softmax_cross_entropy_with_logits<float>(y_true_f_t.view().transpose(), logits_f.view(), grad_f_2.view()), loss_f, 1e-12);
+    EXPECT_EQ(grad_f_2[3][17], grad_f[3][17]);
+
+    // Saturated logits: the clamped probability would give -log(1e-15), log-sum-exp gives the exact loss
+    Matrix extreme = { {1000.0}, {0.0} };
+    Matrix target = { {0.0}, {1.0} };
+    EXPECT_NEAR(Loss::softmax_cross_entropy_with_logits(target, extreme, grad), 1000.0, 1e-9);
+    EXPECT_NEAR(grad[0][0], 1.0, 1e-15);
+    EXPECT_NEAR(grad[1][0], -1.0, 1e-15);
+
+    EXPECT_THROW(Loss::softmax_cross_entropy_with_logits(target, logits, grad), std::invalid_argument);
+}
+
+TEST_F(LossTest, SigmoidBCEWithLogitsTest) {
+    Matrix logits(37, 45);
+    Matrix y_true(37, 45);
+    logits.fill_random(-8.0, 8.0);
+    y_true.fill_random(0.0, 1.0);
+
+    Matrix grad;
+    const double loss = Loss::sigmoid_bce_with_logits(y_true, logits, grad);
+    const Matrix y_pred = Activation::sigmoid(logits);
+    EXPECT_NEAR(loss, Loss::binary_cross_entropy(y_true, y_pred), 1e-12);
+    const double scale = 1.0 / (37 * 45);
+    for (size_t row = 0; row < grad.get_rows(); ++row) {
+        for (size_t col = 0; col < grad.get_cols(); ++col) {
+            EXPECT_NEAR(grad[row][col], scale * (y_pred[row][col] - y_true[row][col]), 1e-17);
+        }
+    }
+
+    // Row segments of a wider matrix take the strided path
+    Matrix wide(37, 50);
+    Matrix wide_grad(37, 50);
+    for (size_t row = 0; row < 37; ++row) {
+        for (size_t col = 0; col < 45; ++col) {
+            wide[row][col + 5] = logits[row][col];
+        }
+    }
+    EXPECT_NEAR(Loss::sigmoid_bce_with_logits<double>(y_true.view(), wide.col_range(5, 50), wide_grad.col_range(5, 50)), loss, 1e-12);
+    EXPECT_NEAR(wide_grad[36][49], grad[36][44], 1e-17);
+
+    // Transposed views take the strided path, one row per partial loss
+    Matrix logits_t = logits.transpose();
+    const Matrix y_true_t = y_true.transpose();
+    Matrix grad_t(45, 37);
+    EXPECT_NEAR(Loss::sigmoid_bce_with_logits<double>(y_true_t.view().transpose(), logits_t.view().transpose(),
+                                                      grad_t.view().transpose()), loss, 1e-12);
+    EXPECT_NEAR(grad_t[44][36], grad[36][44], 1e-17);
+    EXPECT_NEAR(grad_t[0][20], grad[20][0], 1e-17);
+
+    // No clamping: log1p(exp(-|z|)) keeps both tails exact
+    Matrix extreme = { {-800.0, 40.0} };
+    Matrix target = { {1.0, 1.0} };
+    EXPECT_NEAR(Loss::sigmoid_bce_with_logits(target, extreme, grad), (800.0 + std::exp(-40.0)) / 2.0, 1e-12);
+    EXPECT_NEAR(grad[0][0], -0.5, 1e-15);
+
+    MatrixF logits_f = { {-3.0f, 0.5f, 2.0f} };
+    MatrixF target_f = { {0.0f, 1.0f, 1.0f} };
+    MatrixF grad_f;
+    const double expected_f = (std::log1p(std::exp(-3.0)) + std::log1p(std::exp(-0.5)) + std::log1p(std::exp(-2.0))) / 3.0;
+    EXPECT_NEAR(Loss::sigmoid_bce_with_logits(target_f, logits_f, grad_f), expected_f, 1e-6);
+}
@@ -0,0 +1,115 @@
+#include "matrix_expr.h"
+#include <gtest/gtest.h>
+#include <limits>
+#include <type_traits>
+
+using il = std::initializer_list<std::initializer_list<double>>;
+
+#define DOUBLE_MAX (std::numeric_limits<double>::max())
+
+class MatrixExprTest : public testing::Test {
+public:
+    MatrixExprTest() {}
+
+protected:
+};
+
+// Whether Expr::lazy() and Expr::transposed() accept an operand of type M
+template <typename M, typename = void>
+struct accepts_lazy : std::false_type {};
+
+template <typename M>
+struct accepts_lazy<M, std::void_t<decltype(Expr::lazy(std::declval<M>()))>> : std::true_type {};
+
+template <typename M, typename = void>
+struct accepts_transposed : std::false_type {};
+
+template <typename M>
+struct accepts_transposed<M, std::void_t<decltype(Expr::transposed(std::declval<M>()))>> : std::true_type {};
+
+TEST_F(MatrixExprTest, FusedElementwiseTest) {
+    Matrix a = { {1.0, 2.0}, {3.0, 4.0} };
+    Matrix b = { {4.0, 3.0}, {2.0, 1.0} };
+
+    Matrix c(3, 2);
+
+    Matrix result_1 = Expr::lazy(a) - Expr::lazy(b) * 2.0 + 1.0;
+    Matrix result_2 = 2.0 * -Expr::lazy(a) + Expr::hadamard(a, b);
+    Matrix result_3 = 10.0 - Expr::lazy(a);
+
+    EXPECT_TRUE((result_1 == il{ {-6.0, -3.0}, {0.0, 3.0} }));
+    EXPECT_TRUE((result_2 == il{ {2.0, 2.0}, {0.0, -4.0} }));
+    EXPECT_TRUE((result_3 == il{ {9.0, 8.0}, {7.0, 6.0} }));
+    EXPECT_THROW(Matrix m = Expr::lazy(a) + c, std::domain_error);
+}
+
+TEST_F(MatrixExprTest, SingleLoopTest) {
+    Matrix a = { {1.0, 2.0}, {3.0, 4.0} };
+    Matrix b = { {4.0, 3.0}, {2.0, 1.0} };
+
+    // Every operation is a node of the tree, nothing is computed before the conversion to Matrix
+    auto expr = Expr::lazy(a) - Expr::lazy(b) * 2.0 + 1.0;
+    using Scaled = Expr::Binary<Expr::Mul, Expr::Leaf<double>, Expr::Scalar<double>>;
+    using Difference = Expr::Binary<Expr::Sub, Expr::Leaf<double>, Scaled>;
+    EXPECT_TRUE((std::is_same_v<decltype(expr), Expr::Binary<Expr::Add, Difference, Expr::Scalar<double>>>));
+
+    b(0, 0) = 0.0;
+    EXPECT_TRUE((Matrix(expr) == il{ {2.0, -3.0}, {0.0, 3.0} }));
+}
+
+TEST_F(MatrixExprTest, TemporaryOperandTest) {
+    EXPECT_TRUE((accepts_lazy<Matrix&>::value));
+    EXPECT_TRUE((accepts_lazy<const Matrix&>::value));
+    EXPECT_FALSE((accepts_lazy<Matrix>::value));
+    EXPECT_FALSE((accepts_lazy<const Matrix&&>::value));
+    EXPECT_TRUE((accepts_transposed<const Matrix&>::value));
+    EXPECT_FALSE((accepts_transposed<Matrix>::value));
+    EXPECT_FALSE((std::is_constructible_v<Expr::Leaf<double>, Matrix>));
+    EXPECT_TRUE((std::is_constructible_v<Expr::Leaf<double>, const Matrix&>));
+    EXPECT_FALSE((Expr::detail::is_temporary_matrix_v<Matrix&>));
+    EXPECT_TRUE((Expr::detail::is_temporary_matrix_v<Matrix>));
+}
+
+TEST_F(MatrixExprTest, AssignReusesStorageTest) {
+    Matrix a = { {1.0, 2.0}, {3.0, 4.0} };
+    Matrix dst(2, 2);
+    const double* storage = dst.data();
+
+    Expr::assign(dst, Expr::lazy(a) * 3.0);
+    EXPECT_TRUE(dst.data() == storage);
+    EXPECT_TRUE((dst == il{ {3.0, 6.0}, {9.0, 12.0} }));
+
+    // In-place update through a leaf referring to the destination
+    Expr::assign(dst, Expr::lazy(dst) - a);
+    EXPECT_TRUE(dst.data() == storage);
+    EXPECT_TRUE((dst == il{ {2.0, 4.0}, {6.0, 8.0} }));
+
+    // Transposed self-reference has to go through a temporary
+    Expr::assign(dst, Expr::transposed(dst) + 0.0);
+    EXPECT_TRUE((dst == il{ {2.0, 6.0}, {4.0, 8.0} }));
+}
+
+TEST_F(MatrixExprTest, TransposedProductTest) {
+    Matrix w(7, 5);
+    Matrix x(7, 3);
+    Matrix y(4, 7);
+    Matrix ones(2, 3, 1.0);
+    w.fill_random();
+    x.fill_random();
+    y.fill_random();
+
+    Matrix result_1 = Expr::transposed(w) * x;
+    Matrix result_2 = Expr::lazy(x) * Expr::transposed(ones);
+    Matrix result_3 = Expr::transposed(w) * Expr::transposed(y);
+
+    EXPECT_TRUE(result_1 == w.transpose() * x);
+    EXPECT_TRUE(result_2 == x * Matrix(3, 2, 1.0));
+    EXPECT_TRUE(result_3 == w.transpose() * y.transpose());
+    EXPECT_THROW(Matrix m = Expr::transposed(w) * y, std::domain_error);
+}
+
+TEST_F(MatrixExprTest, OverflowTest) {
+    Matrix a(3, 3, DOUBLE_MAX);
+    EXPECT_THROW(Matrix m = Expr::lazy(a) + a, std::overflow_error);
+    EXPECT_THROW(Matrix m = Expr::lazy(a) * 2.0 - 1.0, std::overflow_error);
+}
@@ -1,7 +1,9 @@
 #include "matrix.h"
+#include "numeric_policy.h"
 #include <gtest/gtest.h>
 #include <vector>
 #include <limits>
+#include <cmath>
 
 using std::vector;
 using std::initializer_list;
@@ -381,6 +383,109 @@ TEST_F(MatrixTest, AccessOperatorTest) {
     EXPECT_NEAR(matrix[1][1], 0.0, 1e-9);
 }
 
+TEST_F(MatrixTest, ContiguousStorageTest) {
+    Matrix matrix = { {1.0, 2.0, 3.0}, {4.0, 5.0, 6.0} };
+
+    EXPECT_TRUE(matrix.get_stride() == 3);
+    EXPECT_TRUE(reinterpret_cast<uintptr_t>(matrix.data()) % 64 == 0);
+    EXPECT_TRUE(matrix[1].data() == matrix.data() + matrix.get_stride());
+    EXPECT_TRUE(matrix[1].size() == 3);
+    EXPECT_TRUE(&matrix(1, 2) == matrix.data() + 5);
+
+    vector<double> row = matrix[1];
+    EXPECT_TRUE((row == vector<double>{ 4.0, 5.0, 6.0 }));
+}
+
+TEST_F(MatrixTest, NumericPolicyTest) {
+    Matrix matrix(4, 4, DOUBLE_MAX);
+    Matrix big(300, 300, DOUBLE_MAX);
+
+    EXPECT_TRUE(Numeric::get_policy() == NumericPolicy::Checked);
+    EXPECT_THROW(matrix + DOUBLE_MAX, std::overflow_error);
+    EXPECT_THROW(big * 2.0, std::overflow_error);
+    EXPECT_THROW(matrix.elementwise_mul(matrix), std::overflow_error);
+    {
+        Numeric::ScopedPolicy fast(NumericPolicy::Fast);
+        EXPECT_FALSE(Numeric::checks_enabled());
+        Matrix result = matrix + DOUBLE_MAX;
+        EXPECT_TRUE(std::isinf(result[3][3]));
+        EXPECT_NO_THROW(big * 2.0);
+        EXPECT_NO_THROW(matrix.elementwise_mul(matrix));
+    }
+    EXPECT_TRUE(Numeric::get_policy() == NumericPolicy::Checked);
+
+    Numeric::set_policy(NumericPolicy::Fast);
+    EXPECT_NO_THROW(matrix * matrix);
+    Numeric::set_policy(NumericPolicy::Checked);
+    EXPECT_THROW(matrix * matrix, std::overflow_error);
+}
+
+TEST_F(MatrixTest, AllFiniteScanTest) {
+    vector<double> values(37, 1.0);
+    EXPECT_TRUE(Numeric::all_finite(values.data(), values.size()));
+    values[36] = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_FALSE(Numeric::all_finite(values.data(), values.size()));
+    EXPECT_TRUE(Numeric::all_finite(values.data(), 36));
+    values[0] = -std::numeric_limits<double>::infinity();
+    EXPECT_FALSE(Numeric::all_finite(values.data(), 1));
+    EXPECT_TRUE(Numeric::all_finite(values.data(), 0));
+}
+
+TEST_F(MatrixTest, ElementTypeTest) {
+    MatrixF matrix_f = { {1.5f, -2.0f}, {3.0f, 4.25f} };
+    MatrixF result_f = (matrix_f + 1.0f) * 2.0f - matrix_f;
+    EXPECT_FLOAT_EQ(result_f[0][0], 3.5f);
+    EXPECT_FLOAT_EQ(result_f[1][1], 6.25f);
+    EXPECT_FLOAT_EQ(matrix_f.sum(), 6.75f);
+
+    // Conversions round to the nearest bfloat16 (8 significant bits)
+    EXPECT_FLOAT_EQ(static_cast<float>(bfloat16(1.0f)), 1.0f);
+    EXPECT_FLOAT_EQ(static_cast<float>(bfloat16(1.00390625f)), 1.0f);
+    EXPECT_FLOAT_EQ(static_cast<float>(bfloat16(1.01171875f)), 1.015625f);
+    EXPECT_TRUE(std::isnan(static_cast<float>(bfloat16(std::numeric_limits<float>::quiet_NaN()))));
+
+    Matrix matrix_d = { {0.1, 0.2}, {0.3, 0.4} };
+    MatrixBF16 matrix_bf = matrix_d.cast<bfloat16>();
+    Matrix round_trip = matrix_bf.cast<double>();
+    EXPECT_NEAR(round_trip[1][1], 0.4, 1e-2);
+    EXPECT_TRUE(matrix_bf.transpose().get_rows() == 2);
+    EXPECT_THROW(MatrixBF16(2, 2, 3e38) * bfloat16(10.0), std::overflow_error);
+}
+
+TEST_F(MatrixTest, ViewSlicingTest) {
+    Matrix matrix = { {1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}, {7.0, 8.0, 9.0} };
+
+    MatrixView rows = matrix.row_range(1, 3);
+    MatrixView cols = matrix.col_range(1, 3);
+    MatrixView block = matrix.block(1, 1, 2, 2);
+    EXPECT_TRUE(rows.data() == matrix.data() + 3);
+    EXPECT_TRUE(rows.is_contiguous());
+    EXPECT_FALSE(cols.is_contiguous());
+    EXPECT_TRUE((rows == il{ {4.0, 5.0, 6.0}, {7.0, 8.0, 9.0} }));
+    EXPECT_TRUE((cols == il{ {2.0, 3.0}, {5.0, 6.0}, {8.0, 9.0} }));
+    EXPECT_TRUE((block.transpose() == il{ {5.0, 8.0}, {6.0, 9.0} }));
+    EXPECT_TRUE(block.sum() == 28.0);
+    EXPECT_TRUE(cols.min() == 2.0);
+    EXPECT_TRUE(cols.max() == 9.0);
+    EXPECT_THROW(matrix.row_range(2, 4), std::out_of_range);
+    EXPECT_THROW(block.at(2, 0), std::out_of_range);
+
+    // Writes through a span are visible in the matrix
+    MatrixSpan span = matrix.block(0, 0, 2, 2);
+    span(1, 1) = 50.0;
+    EXPECT_TRUE(matrix[1][1] == 50.0);
+    span(1, 1) = 5.0;
+
+    // Operations read views in place, a copy is only made on conversion
+    Matrix copy = block;
+    EXPECT_TRUE((copy == il{ {5.0, 6.0}, {8.0, 9.0} }));
+    EXPECT_TRUE((copy + block.transpose() == il{ {10.0, 14.0}, {14.0, 18.0} }));
+    EXPECT_TRUE((copy - block == il{ {0.0, 0.0}, {0.0, 0.0} }));
+    EXPECT_TRUE((copy.elementwise_mul(cols.row_range(0, 2)) == il{ {10.0, 18.0}, {40.0, 54.0} }));
+    EXPECT_TRUE(matrix.col_range(0, 2).to_matrix() * block == matrix.col_range(0, 2).to_matrix() * copy);
+    EXPECT_TRUE(copy * block.transpose() == copy * copy.transpose());
+}
+
 TEST_F(MatrixTest, SecondaryAccessOperatorTest) {
     Matrix matrix(5, 5);
 
@@ -571,6 +676,52 @@ TEST_F(MatrixTest, MeanMethodTest) {
     EXPECT_NEAR(matrix_6.mean(), 0.0, 1e-9);
 }
 
+TEST_F(MatrixTest, LargeReductionTest) {
+    // Big enough for several parallel chunks, odd enough for vector tails
+    Matrix matrix(301, 1001);
+    matrix.fill_random(-10.0, 10.0);
+    matrix[123][456] = -20.0;
+    matrix[300][1000] = 20.0;
+
+    auto reference = [](MatrixView view) {
+        long double total = 0.0L;
+        for (size_t row = 0; row < view.get_rows(); ++row) {
+            for (size_t col = 0; col < view.get_cols(); ++col) {
+                total += view(row, col);
+            }
+        }
+        return static_cast<double>(total);
+    };
+    EXPECT_NEAR(matrix.sum(), reference(matrix.view()), 1e-9);
+    EXPECT_NEAR(matrix.mean(), reference(matrix.view()) / (301 * 1001), 1e-12);
+    EXPECT_EQ(matrix.min(), -20.0);
+    EXPECT_EQ(matrix.max(), 20.0);
+
+    // Row ranges, column ranges, transposes and single columns
+    const MatrixView views[] = { matrix.row_range(7, 290), matrix.col_range(3, 998), matrix.view().transpose(),
+                                 matrix.col_range(456, 457), matrix.block(100, 1, 50, 7).transpose() };
+    for (const MatrixView& view : views) {
+        EXPECT_NEAR(view.sum(), reference(view), 1e-9);
+    }
+    EXPECT_EQ(matrix.col_range(456, 457).min(), -20.0);
+    EXPECT_EQ(matrix.view().transpose().max(), 20.0);
+
+    double trace = 0.0;
+    Matrix square = matrix.block(0, 0, 301, 301);
+    for (size_t i = 0; i < 301; ++i) {
+        trace += square[i][i];
+    }
+    EXPECT_NEAR(square.trace(), trace, 1e-9);
+}
+
+TEST_F(MatrixTest, CompensatedSumTest) {
+    // A naive float sum stalls at 2^24, the compensated lanes do not
+    MatrixF matrix(1, 1 << 20, 1.0f);
+    matrix[0][0] = 16777216.0f;
+    EXPECT_EQ(matrix.sum(), 16777216.0f + (1 << 20) - 1);
+    EXPECT_NEAR(matrix.mean(), 17.0f, 1e-5);
+}
+
 TEST_F(MatrixTest, InverseMethodTest){
     Matrix matrix_1 = {};
     Matrix matrix_2 = { {2.0} };
@@ -810,6 +961,25 @@ TEST_F(MatrixTest, MultiplyByMatrixTest) {
     EXPECT_THROW(matrix_8 * matrix_8, std::overflow_error);
 }
 
+TEST_F(MatrixTest, MultiplyIntoAliasingTest) {
+    Matrix storage(8, 8, 1.0);
+    Matrix other(8, 8, 1.0);
+
+    // The whole matrix starts before the result block but reads through it
+    EXPECT_THROW(Matrix::multiply_into(storage, false, other.block(0, 0, 8, 4), false, storage.block(0, 4, 8, 4)),
+                 std::invalid_argument);
+    Matrix square(4, 4, 1.0);
+    EXPECT_THROW(Matrix::multiply_into(storage.block(0, 0, 4, 4), false, square, false, storage.block(2, 2, 4, 4)),
+                 std::invalid_argument);
+    EXPECT_THROW(Matrix::multiply_into(square, false, storage.block(0, 0, 4, 4).transpose(), false, storage.block(1, 1, 4, 4)),
+                 std::invalid_argument);
+
+    // Side by side column blocks of one matrix share rows but no element
+    Matrix::multiply_into(storage.block(0, 0, 4, 4), false, square, false, storage.block(0, 4, 4, 4));
+    EXPECT_TRUE((storage.block(0, 4, 4, 4).to_matrix() == Matrix(4, 4, 4.0)));
+    EXPECT_TRUE((storage.block(0, 0, 4, 4).to_matrix() == Matrix(4, 4, 1.0)));
+}
+
 TEST_F(MatrixTest, MultiplyByRowVecTest) {
     Matrix matrix_1 = { {3.0}, {4.0}, {5.0} };
     Matrix matrix_2 = { {1.0, 2.0, 3.0, 4.0}, {5.0, 6.0, 7.0, 8.0}, {9.0, 10.0, 11.0, 12.0} };
@@ -1,8 +1,12 @@
 #include "model.h"
+#include "dataset_stream.h"
+#include "batch_loader.h"
 #include <gtest/gtest.h>
 #include "matrix.h"
 #include "spdlog/spdlog.h"
 #include <stdexcept>
+#include <cstdio>
+#include <fstream>
 
 using il = std::initializer_list<std::initializer_list<double>>;
 
@@ -38,3 +42,83 @@ TEST_F(ModelTest, AddLayerMethodTest) {
     model.fit({}, {}, 100, 1e-5, LossFunction::MAE);
     EXPECT_THROW(model.add_layer(666), std::logic_error);
 }
+
+TEST_F(ModelTest, FitMethodTest) {
+    Model model;
+    model.add_layer(2, ActivationFunction::Tanh);
+    model.add_layer(4, ActivationFunction::Sigmoid);
+    model.add_layer(1, LayerType::Output);
+
+    // Logical OR, one sample per row
+    const Matrix X = { {0.0, 0.0}, {0.0, 1.0}, {1.0, 0.0}, {1.0, 1.0} };
+    const Matrix y = { {0.0}, {1.0}, {1.0}, {1.0} };
+    EXPECT_THROW(model.predict(X), std::logic_error);
+    EXPECT_THROW(model.fit(X, Matrix(3, 1)), std::invalid_argument);
+    EXPECT_THROW(model.fit(X, Matrix(4, 2)), std::invalid_argument);
+    EXPECT_THROW(model.fit(X, y, 1, 0.1, LossFunction::MSE, 0), std::invalid_argument);
+
+    // Rejected calls neither build nor lock the model
+    Model rejected;
+    rejected.add_layer(2, ActivationFunction::Tanh);
+    rejected.add_layer(1, LayerType::Output);
+    EXPECT_THROW(rejected.fit(Matrix(4, 3), y), std::invalid_argument);
+    EXPECT_THROW(rejected.predict(X), std::logic_error);
+    EXPECT_NO_THROW(rejected.add_layer(1, LayerType::Output));
+
+    model.fit(X, y, 2000, 0.5, LossFunction::BinaryCrossEntropy, 3);
+    Matrix prediction = model.predict(X);
+    EXPECT_TRUE(prediction.get_rows() == 4);
+    EXPECT_TRUE(prediction.get_cols() == 1);
+    EXPECT_TRUE(prediction[0][0] < 0.5);
+    EXPECT_TRUE(prediction[1][0] > 0.5);
+    EXPECT_TRUE(prediction[2][0] > 0.5);
+    EXPECT_TRUE(prediction[3][0] > 0.5);
+}
+
+TEST_F(ModelTest, FitStreamTest) {
+    // Logical OR again, read from a file in batches of 3
+    const string temp_path = "./tests/data/model_test_stream_temp.csv";
+    {
+        std::ofstream file(temp_path);
+        file << "a,b,y\n0,0,0\n0,1,1\n1,0,1\n1,1,1\n";
+    }
+
+    Model model;
+    model.add_layer(2, ActivationFunction::Tanh);
+    model.add_layer(4, ActivationFunction::Sigmoid);
+    model.add_layer(1, LayerType::Output);
+    DatasetStream stream(temp_path, 3, true);
+    model.fit(stream, 2000, 0.5, LossFunction::BinaryCrossEntropy);
+    std::remove(temp_path.c_str());
+
+    Matrix prediction = model.predict({ {0.0, 0.0}, {0.0, 1.0}, {1.0, 0.0}, {1.0, 1.0} });
+    EXPECT_TRUE(prediction[0][0] < 0.5);
+    EXPECT_TRUE(prediction[1][0] > 0.5);
+    EXPECT_TRUE(prediction[2][0] > 0.5);
+    EXPECT_TRUE(prediction[3][0] > 0.5);
+
+    Model wide;
+    wide.add_layer(3);
+    wide.add_layer(1, LayerType::Output);
+    EXPECT_THROW(wide.fit(stream, 1), std::invalid_argument);
+}
+
+TEST_F(ModelTest, FitLoaderTest) {
+    Model model;
+    model.add_layer(2, ActivationFunction::Tanh);
+    model.add_layer(4, ActivationFunction::Sigmoid);
+    model.add_layer(1, LayerType::Output);
+
+    // Logical OR, shuffled into batches of 2 by two workers
+    const Matrix X = { {0.0, 0.0}, {0.0, 1.0}, {1.0, 0.0}, {1.0, 1.0} };
+    const Matrix y = { {0.0}, {1.0}, {1.0}, {1.0} };
+    BatchLoader loader(X, y, 2, true, 3, 2);
+    model.fit(loader, 2000, 0.5, LossFunction::BinaryCrossEntropy);
+
+    Matrix prediction = model.predict(X);
+    EXPECT_TRUE(prediction[0][0] < 0.5);
+    EXPECT_TRUE(prediction[1][0] > 0.5);
+    EXPECT_TRUE(prediction[2][0] > 0.5);
+    EXPECT_TRUE(prediction[3][0] > 0.5);
+    EXPECT_EQ(loader.get_stats().batches, 4000u);
+}
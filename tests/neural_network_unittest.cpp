@@ -1,11 +1,46 @@
 #include "model.h"
 #include <gtest/gtest.h>
+#include "gemm.h"
+#include "loss.h"
 #include "matrix.h"
+#include "parallel_tuning.h"
+#include "thread_pool.h"
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <stdexcept>
+#include <limits>
+#include <thread>
 
 using il = std::initializer_list<std::initializer_list<double>>;
 
+// Every operator new of the test binary, on any thread, so allocation-free paths are checked beyond the matrix buffers
+namespace {
+std::atomic<size_t> heap_allocations{0};
+}
+
+void* operator new(size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(std::max<size_t>(size, 1))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* ptr = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+
 class NeuralNetworkTest : public testing::Test {
 public:
     NeuralNetworkTest() {
@@ -109,10 +144,36 @@ TEST_F(NeuralNetworkTest, BuildMethodTest) {
     EXPECT_TRUE(nn.is_built());
     for (size_t layer = 0; layer < nn.get_shape().size() - 1; ++layer) {
         Matrix& weights = nn.get_weights()[layer];
-        EXPECT_TRUE(weights.get_rows() == nn.get_shape()[layer] + 1);
+        EXPECT_TRUE(weights.get_rows() == nn.get_shape()[layer]);
         EXPECT_TRUE(weights.get_cols() == nn.get_shape()[layer + 1]);
+        Matrix& biases = nn.get_biases()[layer];
+        EXPECT_TRUE(biases.get_rows() == nn.get_shape()[layer + 1]);
+        EXPECT_TRUE(biases.get_cols() == 1);
     }
     EXPECT_TRUE(nn.get_weights().size() == nn.get_activation_functions().size());
+    EXPECT_TRUE(nn.get_biases().size() == nn.get_activation_functions().size());
+}
+
+TEST_F(NeuralNetworkTest, BuildMethodTwiceTest) {
+    NeuralNetwork nn;
+    nn.add_layer(4, ActivationFunction::Tanh);
+    nn.add_layer(8, ActivationFunction::Sigmoid);
+    nn.add_layer(2, LayerType::Output);
+
+    nn.build(16);
+    nn.build(32);
+    EXPECT_TRUE(nn.is_built());
+    EXPECT_TRUE(nn.get_max_batch_size() == 32);
+    EXPECT_TRUE(nn.get_weights().size() == 2);
+    EXPECT_TRUE(nn.get_biases().size() == 2);
+    EXPECT_TRUE(nn.get_weights()[1].get_rows() == 8);
+    EXPECT_TRUE(nn.get_weights()[1].get_cols() == 2);
+
+    Matrix input(4, 32);
+    input.fill_random();
+    Matrix output = nn.forward(input);
+    EXPECT_TRUE(output.get_rows() == 2);
+    EXPECT_TRUE(output.get_cols() == 32);
 }
 
 TEST_F(NeuralNetworkTest, ForwardMethodOutputShapeCheckSingleTest) {
@@ -155,8 +216,11 @@ TEST_F(NeuralNetworkTest, ForwardMethodOutputValuesCheckSingleTest) {
     nn.build();
 
     nn.get_weights()[0].fill(2.0);
+    nn.get_biases()[0].fill(2.0);
     nn.get_weights()[1].fill(4.0);
+    nn.get_biases()[1].fill(4.0);
     nn.get_weights()[2].fill(8.0);
+    nn.get_biases()[2].fill(8.0);
 
     Matrix input(4, 1);
     input.fill(0.5);
@@ -175,8 +239,11 @@ TEST_F(NeuralNetworkTest, ForwardMethodOutputValuesCheckBatchTest) {
     nn.build();
 
     nn.get_weights()[0].fill(2.0);
+    nn.get_biases()[0].fill(2.0);
     nn.get_weights()[1].fill(4.0);
+    nn.get_biases()[1].fill(4.0);
     nn.get_weights()[2].fill(8.0);
+    nn.get_biases()[2].fill(8.0);
 
     Matrix input(4, 5);
     input.fill(0.5);
@@ -186,8 +253,266 @@ TEST_F(NeuralNetworkTest, ForwardMethodOutputValuesCheckBatchTest) {
     EXPECT_TRUE((output == il{ {1.0, 1.0, 1.0, 1.0, 1.0}, {1.0, 1.0, 1.0, 1.0, 1.0} }));
 }
 
+TEST_F(NeuralNetworkTest, ForwardMethodComputeDtypeTest) {
+    BasicNeuralNetwork<float> nn;
+    nn.add_layer(4);
+    nn.add_layer(8);
+    nn.add_layer(16);
+    nn.add_layer(2, LayerType::Output);
+    nn.build();
+
+    nn.get_weights()[0].fill(2.0f);
+    nn.get_biases()[0].fill(2.0f);
+    nn.get_weights()[1].fill(4.0f);
+    nn.get_biases()[1].fill(4.0f);
+    nn.get_weights()[2].fill(8.0f);
+    nn.get_biases()[2].fill(8.0f);
+
+    MatrixF input(4, 3, 0.5f);
+    MatrixF output = nn.forward(input);
+    EXPECT_TRUE(output.get_rows() == 2);
+    EXPECT_TRUE(output.get_cols() == 3);
+    EXPECT_NEAR(output[0][0], 25096.0f, 1e-2);
+    EXPECT_NEAR(output[1][2], 25096.0f, 1e-2);
+}
+
+TEST_F(NeuralNetworkTest, ForwardIntoMethodTest) {
+    NeuralNetwork nn;
+    nn.add_layer(4);
+    nn.add_layer(8);
+    nn.add_layer(16);
+    nn.add_layer(2, LayerType::Output);
+    nn.build(8);
+    EXPECT_TRUE(nn.get_max_batch_size() == 8);
+
+    nn.get_weights()[0].fill(2.0);
+    nn.get_biases()[0].fill(2.0);
+    nn.get_weights()[1].fill(4.0);
+    nn.get_biases()[1].fill(4.0);
+    nn.get_weights()[2].fill(8.0);
+    nn.get_biases()[2].fill(8.0);
+
+    Matrix input(4, 3, 0.5);
+    Matrix output(2, 3);
+    nn.forward_into(input, output.view());
+    EXPECT_TRUE((output == il{ {25096.0, 25096.0, 25096.0}, {25096.0, 25096.0, 25096.0} }));
+    EXPECT_TRUE(nn.forward(input) == output);
+
+    Matrix wrong_shape(2, 4);
+    EXPECT_THROW(nn.forward_into(input, wrong_shape.view()), std::invalid_argument);
+
+    // Wider batches than planned grow the workspace instead of failing
+    Matrix wide_input(4, 20, 0.5);
+    Matrix wide_output(2, 20);
+    nn.forward_into(wide_input, wide_output.view());
+    EXPECT_TRUE(nn.get_max_batch_size() == 20);
+    EXPECT_TRUE(wide_output[1][19] == 25096.0);
+}
+
+TEST_F(NeuralNetworkTest, ForwardIntoMethodAllocationFreeTest) {
+    // The 512 x 512 layer on a batch of 16 reaches the GEMM threshold, so it is dispatched to the pool
+    ThreadPool::configure(4);
+    const size_t batch = 16;
+    const size_t width = 512;
+    EXPECT_TRUE(Parallel::use_pool(Parallel::Kernel::Gemm, width * width * batch));
+
+    NeuralNetwork nn;
+    nn.add_layer(32, ActivationFunction::Tanh);
+    nn.add_layer(width, ActivationFunction::ReLU);
+    nn.add_layer(width, ActivationFunction::Tanh);
+    nn.add_layer(48, ActivationFunction::Softmax);
+    nn.add_layer(10, LayerType::Output);
+    nn.build(batch);
+
+    Matrix input(32, batch);
+    input.fill_random();
+    Matrix output(10, batch);
+
+    // The first pass may still size thread-local GEMM packing buffers. Which pool threads take part in
+    // a pass varies, so every thread is held in a chunk until all of them arrived and sizes its own.
+    const size_t n_threads = ThreadPool::instance().size();
+    std::atomic<size_t> arrived{0};
+    parallel_for(0, n_threads, [&](size_t, size_t) {
+        ++arrived;
+        while (arrived.load() < n_threads) {
+            std::this_thread::yield();
+        }
+        Matrix lhs(width, width);
+        Matrix rhs(width, batch);
+        Matrix result(width, batch);
+        Gemm::multiply(width, batch, width, lhs.data(), lhs.get_stride(), 1, rhs.data(), rhs.get_stride(), 1,
+                       result.data(), result.get_stride());
+    });
+    nn.forward_into(input, output.view(), true);
+
+    const size_t before = AllocationCounter::count();
+    const size_t heap_before = heap_allocations.load();
+    for (size_t i = 0; i < 3; ++i) {
+        nn.forward_into(input, output.view(), true);
+        nn.forward_into(input.col_range(0, 5), output.col_range(0, 5));
+    }
+    EXPECT_TRUE(AllocationCounter::count() == before);
+    EXPECT_TRUE(heap_allocations.load() == heap_before);
+    ThreadPool::configure(0);
+}
+
 TEST_F(NeuralNetworkTest, BackwardMethodTest) {
     NeuralNetwork nn;
     EXPECT_THROW(nn.backward({}, {}, 1e-5), std::logic_error);
     // ...
 }
+
+TEST_F(NeuralNetworkTest, BackwardMethodGradientTest) {
+    // Analytic gradients must match central differences of the returned loss
+    struct Case { ActivationFunction hidden; ActivationFunction output; LossFunction loss; };
+    const Case cases[] = {
+        { ActivationFunction::Tanh, ActivationFunction::Sigmoid, LossFunction::BinaryCrossEntropy },
+        { ActivationFunction::Sigmoid, ActivationFunction::Softmax, LossFunction::CategoricalCrossEntropy },
+        { ActivationFunction::Tanh, ActivationFunction::Softmax, LossFunction::MSE },
+        { ActivationFunction::Sigmoid, ActivationFunction::Tanh, LossFunction::MAE },
+        { ActivationFunction::Tanh, ActivationFunction::Sigmoid, LossFunction::CategoricalCrossEntropy },
+    };
+    const Matrix input = { {0.5, -1.0, 0.25}, {1.5, 0.0, -0.5}, {-0.75, 0.5, 1.0} };
+    const Matrix target = { {1.0, 0.0, 0.0}, {0.0, 1.0, 1.0} };
+
+    for (const Case& test_case : cases) {
+        NeuralNetwork nn;
+        nn.add_layer(3, test_case.hidden);
+        nn.add_layer(4, test_case.output);
+        nn.add_layer(2, LayerType::Output);
+        nn.build(3);
+
+        auto loss = [&]() {
+            nn.forward(input, true);
+            return nn.backward(input, target, 0.0, test_case.loss);
+        };
+        loss();
+        const vector<Matrix> weight_gradients = nn.get_weight_gradients();
+        const vector<Matrix> bias_gradients = nn.get_bias_gradients();
+
+        const double h = 1e-6;
+        for (size_t layer = 0; layer < 2; ++layer) {
+            Matrix& weights = nn.get_weights()[layer];
+            for (size_t row = 0; row < weights.get_rows(); ++row) {
+                for (size_t col = 0; col < weights.get_cols(); ++col) {
+                    const double original = weights[row][col];
+                    weights[row][col] = original + h;
+                    const double loss_plus = loss();
+                    weights[row][col] = original - h;
+                    const double loss_minus = loss();
+                    weights[row][col] = original;
+                    EXPECT_NEAR(weight_gradients[layer][row][col], (loss_plus - loss_minus) / (2 * h), 1e-6);
+                }
+            }
+            Matrix& biases = nn.get_biases()[layer];
+            for (size_t row = 0; row < biases.get_rows(); ++row) {
+                const double original = biases[row][0];
+                biases[row][0] = original + h;
+                const double loss_plus = loss();
+                biases[row][0] = original - h;
+                const double loss_minus = loss();
+                biases[row][0] = original;
+                EXPECT_NEAR(bias_gradients[layer][row][0], (loss_plus - loss_minus) / (2 * h), 1e-6);
+            }
+        }
+    }
+}
+
+TEST_F(NeuralNetworkTest, BackwardMethodLossTest) {
+    // Unfused output layers return the same loss as the Loss functions on the forward output
+    const Matrix input = { {0.5, -1.0, 0.25, 2.0}, {1.5, 0.0, -0.5, 0.75} };
+    const Matrix target = { {1.0, 0.0, 0.0, 1.0}, {0.0, 1.0, 1.0, 0.0} };
+    // Targets as transposed sample rows, like Model::fit passes them
+    const Matrix target_rows = target.transpose();
+    const LossFunction losses[] = { LossFunction::MSE, LossFunction::MAE,
+                                    LossFunction::BinaryCrossEntropy, LossFunction::CategoricalCrossEntropy };
+
+    for (const LossFunction loss : losses) {
+        NeuralNetwork nn;
+        nn.add_layer(2, ActivationFunction::Tanh);
+        nn.add_layer(2, ActivationFunction::Softmax);
+        nn.add_layer(2, LayerType::Output);
+        nn.build(4);
+
+        const Matrix output = nn.forward(input, true);
+        double expected = 0.0;
+        switch (loss) {
+            case LossFunction::MSE: expected = Loss::mse(target, output); break;
+            case LossFunction::MAE: expected = Loss::mae(target, output); break;
+            case LossFunction::BinaryCrossEntropy: expected = Loss::binary_cross_entropy(target, output); break;
+            default: expected = Loss::categorical_cross_entropy(target, output); break;
+        }
+        EXPECT_DOUBLE_EQ(nn.backward(input, target_rows.view().transpose(), 0.0, loss), expected);
+    }
+}
+
+TEST_F(NeuralNetworkTest, BackwardMethodUpdateTest) {
+    NeuralNetwork nn;
+    nn.add_layer(2, ActivationFunction::Tanh);
+    nn.add_layer(1, ActivationFunction::Sigmoid);
+    nn.add_layer(1, LayerType::Output);
+    nn.build(4);
+
+    const Matrix input = { {0.0, 0.0, 1.0, 1.0}, {0.0, 1.0, 0.0, 1.0} };
+    const Matrix target = { {0.0, 1.0, 1.0, 1.0} };
+    EXPECT_THROW(nn.backward(input, target, 0.1, LossFunction::BinaryCrossEntropy), std::logic_error);
+
+    nn.forward(input, true);
+    EXPECT_THROW(nn.backward(input, Matrix(2, 4), 0.1, LossFunction::BinaryCrossEntropy), std::invalid_argument);
+
+    // Every step must lower the loss for a small enough learning rate
+    double previous_loss = std::numeric_limits<double>::max();
+    for (size_t step = 0; step < 20; ++step) {
+        nn.forward(input, true);
+        const double loss = nn.backward(input, target, 0.05, LossFunction::BinaryCrossEntropy);
+        EXPECT_TRUE(loss < previous_loss);
+        previous_loss = loss;
+    }
+
+    // Training steps reuse the gradient buffers
+    Matrix output(1, 4);
+    const size_t before = AllocationCounter::count();
+    const size_t heap_before = heap_allocations.load();
+    nn.forward_into(input, output.view(), true);
+    nn.backward(input, target, 0.05, LossFunction::BinaryCrossEntropy);
+    EXPECT_TRUE(AllocationCounter::count() == before);
+    EXPECT_TRUE(heap_allocations.load() == heap_before);
+}
+
+TEST_F(NeuralNetworkTest, BackwardMethodAllocationFreeTest) {
+    // Both fused output layers (sigmoid + BCE, softmax + CCE) and a plain one, after a few warm-up steps
+    struct Case { ActivationFunction output; LossFunction loss; size_t n_outputs; };
+    const Case cases[] = {
+        { ActivationFunction::Sigmoid, LossFunction::BinaryCrossEntropy, 1 },
+        { ActivationFunction::Softmax, LossFunction::CategoricalCrossEntropy, 3 },
+        { ActivationFunction::Tanh, LossFunction::MSE, 3 },
+    };
+    for (const Case& test_case : cases) {
+        NeuralNetwork nn;
+        nn.add_layer(4, ActivationFunction::Tanh);
+        nn.add_layer(8, test_case.output);
+        nn.add_layer(test_case.n_outputs, LayerType::Output);
+        nn.build(16);
+
+        Matrix input(4, 16);
+        Matrix target(test_case.n_outputs, 16, 0.0);
+        input.fill_random();
+        for (size_t col = 0; col < target.get_cols(); ++col) {
+            target(col % test_case.n_outputs, col) = 1.0;
+        }
+        Matrix output(test_case.n_outputs, 16);
+        for (size_t step = 0; step < 3; ++step) {
+            nn.forward_into(input, output.view(), true);
+            nn.backward(input, target, 0.05, test_case.loss);
+        }
+
+        const size_t before = AllocationCounter::count();
+        const size_t heap_before = heap_allocations.load();
+        for (size_t step = 0; step < 10; ++step) {
+            nn.forward_into(input, output.view(), true);
+            nn.backward(input, target, 0.05, test_case.loss);
+        }
+        EXPECT_TRUE(AllocationCounter::count() == before);
+        EXPECT_TRUE(heap_allocations.load() == heap_before);
+    }
+}
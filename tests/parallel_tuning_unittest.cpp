@@ -0,0 +1,206 @@
+#include "parallel_tuning.h"
+#include <gtest/gtest.h>
+#include "matrix.h"
+#include "gemm.h"
+#include "loss.h"
+#include "matrix_expr.h"
+#include "thread_pool.h"
+#include "spdlog/spdlog.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using Parallel::Kernel;
+
+class ParallelTuningTest : public testing::Test {
+public:
+    ParallelTuningTest() {
+        spdlog::set_level(spdlog::level::off);
+    }
+
+    ~ParallelTuningTest() {
+        Parallel::reset_thresholds();
+        ThreadPool::configure(0);
+        std::remove(cache_path_.c_str());
+        spdlog::set_level(spdlog::level::info);
+    }
+
+protected:
+    string read_cache_() {
+        std::ifstream file(cache_path_);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    const string cache_path_ = "./tests/data/parallel_tuning_test_temp.tsv";
+};
+
+TEST_F(ParallelTuningTest, ThresholdsTest) {
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Elementwise), Parallel::DEFAULT_ELEMENTWISE_THRESHOLD);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), Parallel::DEFAULT_GEMM_THRESHOLD);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Reduce), Parallel::DEFAULT_REDUCE_THRESHOLD);
+    EXPECT_FALSE(Parallel::use_pool(Kernel::Elementwise, Parallel::DEFAULT_ELEMENTWISE_THRESHOLD - 1));
+    EXPECT_TRUE(Parallel::use_pool(Kernel::Elementwise, Parallel::DEFAULT_ELEMENTWISE_THRESHOLD));
+
+    Parallel::set_threshold(Kernel::Gemm, 1000);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), 1000u);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Elementwise), Parallel::DEFAULT_ELEMENTWISE_THRESHOLD);
+    Parallel::set_thresholds({ 10, 20, 30 });
+    EXPECT_EQ(Parallel::get_thresholds().elementwise, 10u);
+    EXPECT_EQ(Parallel::get_thresholds().gemm, 20u);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Reduce), 30u);
+    Parallel::set_threshold(Kernel::Elementwise, Parallel::NEVER);
+    EXPECT_FALSE(Parallel::use_pool(Kernel::Elementwise, Parallel::NEVER - 1));
+
+    Parallel::reset_thresholds();
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Elementwise), Parallel::DEFAULT_ELEMENTWISE_THRESHOLD);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), Parallel::DEFAULT_GEMM_THRESHOLD);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Reduce), Parallel::DEFAULT_REDUCE_THRESHOLD);
+}
+
+TEST_F(ParallelTuningTest, ForcedPathsTest) {
+    // Both paths of every kernel give the same results, whatever the thresholds say
+    ThreadPool::configure(4);
+    Matrix a(37, 29);
+    Matrix b(37, 29);
+    Matrix c(29, 41);
+    a.fill_random();
+    b.fill_random();
+    c.fill_random();
+
+    // Reductions and fused losses large enough to be split into several chunks
+    Matrix wide(7, 20011);
+    Matrix targets(7, 20011);
+    wide.fill_random(-4.0, 4.0);
+    targets.fill_random(0.0, 1.0);
+    Matrix grad;
+
+    Parallel::set_thresholds({ Parallel::NEVER, Parallel::NEVER, Parallel::NEVER });
+    const Matrix sum = a + b;
+    const Matrix scaled = a * 3.0 + 1.0;
+    const Matrix fused = Expr::lazy(a) - Expr::lazy(b) * 2.0;
+    const Matrix product = a * c;
+    const double total = wide.sum();
+    const double maximum = wide.max();
+    const double squared_error = Loss::mse(targets, wide);
+    const double softmax_loss = Loss::softmax_cross_entropy_with_logits(targets, wide, grad);
+    const Matrix softmax_grad = grad;
+    const double sigmoid_loss = Loss::sigmoid_bce_with_logits(targets, wide, grad);
+    const Matrix sigmoid_grad = grad;
+
+    Parallel::set_thresholds({ 0, 0, 0 });
+    EXPECT_TRUE(a + b == sum);
+    EXPECT_TRUE(a * 3.0 + 1.0 == scaled);
+    EXPECT_TRUE(Matrix(Expr::lazy(a) - Expr::lazy(b) * 2.0) == fused);
+    EXPECT_TRUE(a * c == product);
+    EXPECT_EQ(wide.sum(), total);
+    EXPECT_EQ(wide.max(), maximum);
+    EXPECT_EQ(Loss::mse(targets, wide), squared_error);
+    EXPECT_EQ(Loss::softmax_cross_entropy_with_logits(targets, wide, grad), softmax_loss);
+    EXPECT_TRUE(grad == softmax_grad);
+    EXPECT_EQ(Loss::sigmoid_bce_with_logits(targets, wide, grad), sigmoid_loss);
+    EXPECT_TRUE(grad == sigmoid_grad);
+}
+
+TEST_F(ParallelTuningTest, PooledGemmSplitTest) {
+    // Tall products are split on MC row blocks, short and wide ones on NR-aligned column bands,
+    // the epilogue must follow the block in both cases
+    ThreadPool::configure(4);
+    for (const auto& [m, n] : { std::pair<size_t, size_t>{ 5 * Gemm::MC + 7, 41 }, { 37, 300 }, { 2 * Gemm::MC, 3 } }) {
+        const size_t k = 29;
+        Matrix a(m, k);
+        Matrix b(n, k);
+        Matrix bias(m, 1);
+        a.fill_random();
+        b.fill_random();
+        bias.fill_random();
+        Gemm::Epilogue<double> epilogue;
+        epilogue.bias = bias.data();
+        epilogue.activation = [](const double* in, double* out, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = 2.0 * in[i];
+            }
+        };
+
+        Matrix sequential(m, n);
+        Matrix sequential_out(m, n);
+        epilogue.out = sequential_out.data();
+        epilogue.out_rs = sequential_out.get_stride();
+        Parallel::set_threshold(Kernel::Gemm, Parallel::NEVER);
+        Matrix::multiply_into(a, false, b, true, sequential.view(), epilogue);
+
+        Matrix pooled(m, n);
+        Matrix pooled_out(m, n);
+        epilogue.out = pooled_out.data();
+        epilogue.out_rs = pooled_out.get_stride();
+        Parallel::set_threshold(Kernel::Gemm, 0);
+        Matrix::multiply_into(a, false, b, true, pooled.view(), epilogue);
+
+        EXPECT_TRUE(pooled == sequential);
+        EXPECT_TRUE(pooled_out == sequential_out);
+    }
+}
+
+TEST_F(ParallelTuningTest, CalibrateTest) {
+    ThreadPool::configure(1);
+    Parallel::Thresholds thresholds = Parallel::calibrate();
+    EXPECT_EQ(thresholds.elementwise, Parallel::NEVER);
+    EXPECT_EQ(thresholds.gemm, Parallel::NEVER);
+    EXPECT_EQ(thresholds.reduce, Parallel::NEVER);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), Parallel::NEVER);
+
+    ThreadPool::configure(2);
+    thresholds = Parallel::calibrate();
+    EXPECT_GE(thresholds.elementwise, Parallel::MIN_ELEMENTWISE_THRESHOLD);
+    EXPECT_LE(thresholds.elementwise, Parallel::MAX_ELEMENTWISE_THRESHOLD);
+    EXPECT_GE(thresholds.gemm, Parallel::MIN_GEMM_THRESHOLD);
+    EXPECT_LE(thresholds.gemm, Parallel::MAX_GEMM_THRESHOLD);
+    EXPECT_GE(thresholds.reduce, Parallel::MIN_REDUCE_THRESHOLD);
+    EXPECT_LE(thresholds.reduce, Parallel::MAX_REDUCE_THRESHOLD);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Elementwise), thresholds.elementwise);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), thresholds.gemm);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Reduce), thresholds.reduce);
+}
+
+TEST_F(ParallelTuningTest, AutotuneCacheTest) {
+    ThreadPool::configure(1);
+    std::remove(cache_path_.c_str());
+
+    // First run calibrates and caches the result for this CPU model and pool size
+    Parallel::Thresholds thresholds = Parallel::autotune(cache_path_);
+    EXPECT_EQ(thresholds.gemm, Parallel::NEVER);
+    const string key = Parallel::cpu_model() + "\t1\t";
+    EXPECT_EQ(read_cache_().find(key), 0u);
+
+    // Cached values are used as they are, other CPUs, pool sizes, broken lines and lines without
+    // the reduction threshold are skipped
+    {
+        std::ofstream file(cache_path_);
+        file << "Some other CPU\t1\t1\t2\t3\n";
+        file << Parallel::cpu_model() << "\t7\t3\t4\t5\n";
+        file << Parallel::cpu_model() << "\t1\tbroken\n";
+        file << Parallel::cpu_model() << "\t1\t6\t7\n";
+        file << Parallel::cpu_model() << "\t1\t8\t9\t10\t11\n";
+        file << Parallel::cpu_model() << "\t1\t5000\t600000\t70000\n";
+    }
+    thresholds = Parallel::autotune(cache_path_);
+    EXPECT_EQ(thresholds.elementwise, 5000u);
+    EXPECT_EQ(thresholds.gemm, 600000u);
+    EXPECT_EQ(thresholds.reduce, 70000u);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), 600000u);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Reduce), 70000u);
+
+    // An override afterwards wins, an empty path calibrates without a cache
+    Parallel::set_threshold(Kernel::Gemm, 123);
+    EXPECT_EQ(Parallel::get_threshold(Kernel::Gemm), 123u);
+    EXPECT_EQ(Parallel::autotune("").gemm, Parallel::NEVER);
+}
+
+TEST_F(ParallelTuningTest, DefaultCachePathTest) {
+    const string path = Parallel::default_cache_path();
+    if (!path.empty()) {
+        EXPECT_NE(path.find("cppnn/parallel_thresholds"), string::npos);
+    }
+    EXPECT_FALSE(Parallel::cpu_model().empty());
+}
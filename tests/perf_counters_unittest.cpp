@@ -0,0 +1,47 @@
+#include "perf_counters.h"
+#include <gtest/gtest.h>
+
+class PerfCountersTest : public testing::Test {
+protected:
+    // Some work the counters can see
+    static double spin_(size_t n) {
+        volatile double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sum = sum + static_cast<double>(i) * 0.5;
+        }
+        return sum;
+    }
+};
+
+TEST_F(PerfCountersTest, ReadTest) {
+    PerfCounters counters;
+    PerfCounters::Values before;
+    PerfCounters::Values after;
+    if (!counters.available()) {
+        // Without perf access nothing is counted, and nothing throws either
+        EXPECT_FALSE(counters.read(before));
+        for (uint64_t value : before) {
+            EXPECT_EQ(value, 0u);
+        }
+        for (size_t i = 0; i < PerfCounters::N_COUNTERS; ++i) {
+            EXPECT_FALSE(counters.has(static_cast<PerfCounters::Counter>(i)));
+        }
+        return;
+    }
+
+    ASSERT_TRUE(counters.read(before));
+    spin_(1000000);
+    ASSERT_TRUE(counters.read(after));
+    for (size_t i = 0; i < PerfCounters::N_COUNTERS; ++i) {
+        EXPECT_GE(after[i], before[i]) << PerfCounters::name(static_cast<PerfCounters::Counter>(i));
+    }
+    if (counters.has(PerfCounters::Instructions)) {
+        EXPECT_GT(after[PerfCounters::Instructions] - before[PerfCounters::Instructions], 1000000u);
+    }
+}
+
+TEST_F(PerfCountersTest, NameTest) {
+    EXPECT_STREQ(PerfCounters::name(PerfCounters::Cycles), "cycles");
+    EXPECT_STREQ(PerfCounters::name(PerfCounters::Instructions), "instructions");
+    EXPECT_STREQ(PerfCounters::name(PerfCounters::BranchMisses), "branch misses");
+}
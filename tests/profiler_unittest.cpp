@@ -0,0 +1,208 @@
+#include "profiler.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using std::string;
+
+class ProfilerTest : public testing::Test {
+public:
+    ProfilerTest() {
+        Profiler::reset();
+    }
+
+    ~ProfilerTest() {
+        Profiler::stop_tracing();
+    }
+
+protected:
+    // Statistics of the zone at path, a zero count when it is not there
+    Profiler::ZoneStats find_(const string& path) {
+        const vector<Profiler::ZoneStats> zones = Profiler::report();
+        auto it = std::find_if(zones.begin(), zones.end(), [&](const Profiler::ZoneStats& zone) { return zone.path == path; });
+        return it != zones.end() ? *it : Profiler::ZoneStats();
+    }
+};
+
+TEST_F(ProfilerTest, NestedZonesTest) {
+    for (size_t i = 0; i < 10; ++i) {
+        Profiler::ScopedTimer outer("profiler_test.outer");
+        for (size_t layer = 0; layer < 3; ++layer) {
+            Profiler::ScopedTimer inner("layer", layer);
+            Profiler::ScopedTimer leaf("leaf");
+        }
+    }
+    {
+        // Same name at another place of the tree, a separate zone
+        Profiler::ScopedTimer leaf("leaf");
+    }
+
+    const Profiler::ZoneStats outer = find_("profiler_test.outer");
+    EXPECT_EQ(outer.count, 10u);
+    EXPECT_EQ(outer.depth, 0u);
+    EXPECT_EQ(find_("profiler_test.outer/layer[1]").count, 10u);
+    EXPECT_EQ(find_("profiler_test.outer/layer[2]/leaf").count, 10u);
+    EXPECT_EQ(find_("profiler_test.outer/layer[2]/leaf").depth, 2u);
+    EXPECT_EQ(find_("leaf").count, 1u);
+    EXPECT_GE(outer.total_seconds, find_("profiler_test.outer/layer[0]").total_seconds);
+
+    // Every zone comes right after its parent's subtree starts
+    const vector<Profiler::ZoneStats> zones = Profiler::report();
+    for (size_t i = 0; i < zones.size(); ++i) {
+        if (zones[i].depth > 0) {
+            ASSERT_GT(i, 0u);
+            EXPECT_LE(zones[i].depth, zones[i - 1].depth + 1);
+        }
+    }
+    EXPECT_NE(Profiler::format_report().find("  layer[1]"), string::npos);
+
+    Profiler::reset();
+    EXPECT_EQ(find_("profiler_test.outer").count, 0u);
+}
+
+TEST_F(ProfilerTest, PercentilesTest) {
+    for (size_t i = 0; i < 100; ++i) {
+        Profiler::ScopedTimer zone("profiler_test.sleep");
+        std::this_thread::sleep_for(std::chrono::microseconds(i == 99 ? 20000 : 200));
+    }
+    const Profiler::ZoneStats zone = find_("profiler_test.sleep");
+    ASSERT_EQ(zone.count, 100u);
+    EXPECT_GE(zone.p50_seconds, 200e-6 * 15 / 16);
+    EXPECT_LT(zone.p50_seconds, 10e-3);
+    EXPECT_GE(zone.p99_seconds, zone.p50_seconds);
+    EXPECT_GE(zone.max_seconds, 20e-3);
+    EXPECT_GE(zone.total_seconds, 99 * 200e-6 + 20e-3);
+    EXPECT_NEAR(zone.mean_seconds, zone.total_seconds / 100, 1e-12);
+}
+
+TEST_F(ProfilerTest, ThreadsTest) {
+    // Trees of all threads are merged, also of threads that have exited
+    vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (size_t i = 0; i < 50; ++i) {
+                Profiler::ScopedTimer zone("profiler_test.worker");
+                Profiler::ScopedTimer inner("inner");
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(find_("profiler_test.worker").count, 200u);
+    EXPECT_EQ(find_("profiler_test.worker/inner").count, 200u);
+}
+
+TEST_F(ProfilerTest, FlopsTest) {
+    for (size_t i = 0; i < 4; ++i) {
+        Profiler::ScopedTimer zone("profiler_test.kernel");
+        Profiler::add_flops(1000);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    const Profiler::ZoneStats zone = find_("profiler_test.kernel");
+    EXPECT_EQ(zone.flops, 4000u);
+    EXPECT_GT(zone.gflops, 0.0);
+    EXPECT_NEAR(zone.gflops, 4000.0 / zone.total_seconds * 1e-9, 1e-12);
+    EXPECT_NE(Profiler::format_report().find("GFLOP/s"), string::npos);
+}
+
+TEST_F(ProfilerTest, CountersTest) {
+    // Where perf is not available, zones are still timed and report no counters
+    const bool counting = Profiler::enable_counters();
+    for (size_t i = 0; i < 10; ++i) {
+        Profiler::ScopedTimer zone("profiler_test.counted");
+        volatile double sum = 0.0;
+        for (size_t j = 0; j < 10000; ++j) {
+            sum = sum + static_cast<double>(j);
+        }
+    }
+    Profiler::enable_counters(false);
+    {
+        Profiler::ScopedTimer zone("profiler_test.counted");
+    }
+
+    const Profiler::ZoneStats zone = find_("profiler_test.counted");
+    EXPECT_EQ(zone.count, 11u);
+    if (counting) {
+        EXPECT_EQ(zone.counted, 10u);
+        EXPECT_GT(zone.counters[PerfCounters::Instructions], 100000u);
+        EXPECT_GT(zone.ipc, 0.0);
+        EXPECT_NE(Profiler::format_report().find("IPC"), string::npos);
+    } else {
+        EXPECT_EQ(zone.counted, 0u);
+        EXPECT_EQ(zone.ipc, 0.0);
+        EXPECT_EQ(Profiler::format_report().find("IPC"), string::npos);
+    }
+}
+
+TEST_F(ProfilerTest, ZoneMacroTest) {
+    {
+        PROFILE_ZONE("profiler_test.macro");
+        PROFILE_ZONE("profiler_test.indexed", 3);
+    }
+    EXPECT_EQ(find_("profiler_test.macro").count, Profiler::ENABLED ? 1u : 0u);
+    EXPECT_EQ(find_("profiler_test.macro/profiler_test.indexed[3]").count, Profiler::ENABLED ? 1u : 0u);
+}
+
+TEST_F(ProfilerTest, TraceTest) {
+    auto occurrences = [](const string& text, const string& pattern) {
+        size_t count = 0;
+        for (size_t pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1)) {
+            ++count;
+        }
+        return count;
+    };
+
+    {
+        // Not recorded, no trace is running
+        Profiler::ScopedTimer zone("profiler_test.untraced");
+    }
+    Profiler::start_tracing();
+    EXPECT_TRUE(Profiler::tracing());
+    std::thread worker([]() {
+        Profiler::set_thread_name("profiler \"test\" worker");
+        for (size_t i = 0; i < 5; ++i) {
+            Profiler::ScopedTimer zone("profiler_test.traced", i);
+        }
+    });
+    worker.join();
+    {
+        Profiler::ScopedTimer outer("profiler_test.traced_outer");
+        Profiler::ScopedTimer inner("profiler_test.traced_inner");
+    }
+    Profiler::stop_tracing();
+    EXPECT_FALSE(Profiler::tracing());
+    {
+        Profiler::ScopedTimer zone("profiler_test.untraced");
+    }
+
+    const string json = Profiler::trace_json();
+    EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(occurrences(json, "\"ph\":\"X\""), 7u);
+    EXPECT_EQ(occurrences(json, "\"name\":\"profiler_test.traced[4]\""), 1u);
+    EXPECT_EQ(occurrences(json, "profiler_test.untraced"), 0u);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"profiler \\\"test\\\" worker\"}"), string::npos);
+    EXPECT_NE(json.find("\"dropped_events\":0"), string::npos);
+
+    // Events past the limit are dropped and counted
+    Profiler::start_tracing(2);
+    for (size_t i = 0; i < 5; ++i) {
+        Profiler::ScopedTimer zone("profiler_test.limited");
+    }
+    const string limited = Profiler::trace_json();
+    EXPECT_EQ(occurrences(limited, "\"ph\":\"X\""), 2u);
+    EXPECT_NE(limited.find("\"dropped_events\":3"), string::npos);
+
+    const string temp_path = "./tests/data/profiler_test_trace_temp.json";
+    Profiler::write_trace(temp_path);
+    std::ifstream file(temp_path);
+    std::stringstream written;
+    written << file.rdbuf();
+    EXPECT_EQ(written.str(), limited);
+    std::remove(temp_path.c_str());
+    EXPECT_THROW(Profiler::write_trace("./tests/nonexistent/trace.json"), std::runtime_error);
+}
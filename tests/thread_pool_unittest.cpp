@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+using std::vector;
+
+class ThreadPoolTest : public testing::Test {
+public:
+    ThreadPoolTest() {}
+
+protected:
+};
+
+TEST_F(ThreadPoolTest, ParallelForCoversRangeOnceTest) {
+    ThreadPool pool(4);
+    vector<int> hits(10007, 0);
+    pool.parallel_for(0, hits.size(), [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            ++hits[i];
+        }
+    });
+    for (int hit : hits) {
+        EXPECT_TRUE(hit == 1);
+    }
+}
+
+TEST_F(ThreadPoolTest, ParallelForSmallRangeRunsInlineTest) {
+    ThreadPool pool(4);
+    size_t calls = 0;
+    pool.parallel_for(5, 10, [&](size_t start, size_t end) {
+        EXPECT_TRUE(start == 5 && end == 10);
+        ++calls;
+    }, 16);
+    pool.parallel_for(3, 3, [&](size_t, size_t) { ++calls; });
+    EXPECT_TRUE(calls == 1);
+}
+
+TEST_F(ThreadPoolTest, ParallelForPropagatesExceptionTest) {
+    ThreadPool pool(3);
+    EXPECT_THROW(pool.parallel_for(0, 1000, [](size_t start, size_t) {
+        if (start > 0) {
+            throw std::overflow_error("Worker failed!");
+        }
+    }), std::overflow_error);
+}
+
+TEST_F(ThreadPoolTest, NestedParallelForTest) {
+    ThreadPool pool(2);
+    std::atomic<size_t> total{0};
+    pool.parallel_for(0, 8, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            pool.parallel_for(0, 100, [&](size_t s, size_t e) { total += e - s; });
+        }
+    });
+    EXPECT_TRUE(total == 800);
+}
+
+TEST_F(ThreadPoolTest, DeeplyNestedParallelForTest) {
+    // Nesting deeper than the job slots of the pool runs the inner ranges inline
+    ThreadPool pool(2);
+    std::atomic<size_t> total{0};
+    std::function<void(size_t)> nest = [&](size_t depth) {
+        pool.parallel_for(0, 4, [&](size_t start, size_t end) {
+            for (size_t i = start; i < end; ++i) {
+                if (depth == 0) {
+                    ++total;
+                } else {
+                    nest(depth - 1);
+                }
+            }
+        });
+    };
+    nest(5);
+    EXPECT_TRUE(total == 4096);
+}
+
+TEST_F(ThreadPoolTest, ParallelForReusesJobsTest) {
+    // Late requests of a finished call must not run chunks of the next one
+    ThreadPool pool(4);
+    vector<int> hits(64, 0);
+    for (int round = 1; round <= 2000; ++round) {
+        pool.parallel_for(0, hits.size(), [&](size_t start, size_t end) {
+            for (size_t i = start; i < end; ++i) {
+                ++hits[i];
+            }
+        });
+    }
+    for (int hit : hits) {
+        EXPECT_TRUE(hit == 2000);
+    }
+}
+
+TEST_F(ThreadPoolTest, SubmitAndConfigureTest) {
+    ThreadPool::configure(3, true);
+    EXPECT_TRUE(ThreadPool::instance().size() == 3);
+    EXPECT_TRUE(ThreadPool::instance().pinned());
+
+    std::atomic<int> counter{0};
+    parallel_for(0, 64, [&](size_t start, size_t end) { counter += static_cast<int>(end - start); });
+    EXPECT_TRUE(counter == 64);
+
+    ThreadPool::configure(0);
+    EXPECT_FALSE(ThreadPool::instance().pinned());
+}